@@ -0,0 +1,273 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_neighbors.hpp
+ * @ingroup common
+ * @author  tpan
+ * @brief   hamming distance 1 neighborhood of a kmer, enumerated in place, subsets of it, and its aggregated lookup result.
+ * @details neighbor 0 is the kmer itself.  neighbor 1 + pos * (2^bitsPerChar - 1) + (d - 1) replaces the character
+ *          at pos (0 is the least significant, i.e. most recently added, character) with (character XOR d),
+ *          for d in [1, 2^bitsPerChar).  substitutions outside of the alphabet are skipped, so for DNA all 3k
+ *          indices are used.  the index of a substitution does not depend on the kmer, so results for
+ *          the same origin kmer from different ranks can be merged by index.
+ *
+ *          enumeration XORs d into the kmer word holding the character, calls the visitor, and XORs it back,
+ *          so no neighbor kmer is constructed.  characters split between words are set via setCharsAtPos.
+ */
+#ifndef KMER_NEIGHBORS_HPP_
+#define KMER_NEIGHBORS_HPP_
+
+#include <cstdint>
+#include <cstring>      // memset
+#include <functional>
+#include <type_traits>
+
+#include "mxx/datatypes.hpp"
+
+#include "common/kmer.hpp"
+
+namespace bliss
+{
+  namespace common
+  {
+
+    /// hamming distance 1 neighbors of a kmer type.
+    template <typename KMER>
+    struct hamming_neighbors {
+        using KmerType = KMER;
+        using WordType = typename KMER::KmerWordType;
+
+        /// substitutions per character position, including those outside of the alphabet.
+        static constexpr unsigned int variants = (1U << KMER::bitsPerChar) - 1;
+        /// number of neighbor indices, including the kmer itself.
+        static constexpr unsigned int count = KMER::size * variants + 1;
+
+        static constexpr unsigned int bitsPerWord = sizeof(WordType) * 8;
+
+        /// character position and replacement XOR of a neighbor index > 0.
+        static inline void decode(unsigned int idx, unsigned int & pos, unsigned int & d) {
+          pos = (idx - 1) / variants;
+          d = (idx - 1) % variants + 1;
+        }
+
+        /**
+         * @brief  call f(neighbor, index) for the kmer itself and each of its single substitution neighbors.
+         * @details  neighbor is a temporary that is only valid during the call.
+         */
+        template <typename F>
+        static void for_each(KMER const & km, F && f) {
+          KMER nb(km);
+          f(static_cast<KMER const &>(nb), 0U);
+
+          WordType * data = nb.getDataRef();
+          unsigned int idx = 1;
+          for (unsigned int pos = 0; pos < KMER::size; ++pos, idx += variants) {
+            unsigned int bit = pos * KMER::bitsPerChar;
+            unsigned int w = bit / bitsPerWord;
+            unsigned int offset = bit % bitsPerWord;
+            WordType c = km.getCharsAtPos(pos, 1);
+
+            if ((offset + KMER::bitsPerChar) <= bitsPerWord) {
+              // within 1 word:  flip in place.
+              for (unsigned int d = 1; d <= variants; ++d) {
+                if ((c ^ d) >= KMER::KmerAlphabet::SIZE) continue;
+                WordType mask = static_cast<WordType>(static_cast<WordType>(d) << offset);
+                data[w] ^= mask;
+                f(static_cast<KMER const &>(nb), idx + d - 1);
+                data[w] ^= mask;
+              }
+            } else {
+              for (unsigned int d = 1; d <= variants; ++d) {
+                if ((c ^ d) >= KMER::KmerAlphabet::SIZE) continue;
+                nb.setCharsAtPos(static_cast<WordType>(c ^ d), pos, 1);
+                f(static_cast<KMER const &>(nb), idx + d - 1);
+              }
+              nb.setCharsAtPos(c, pos, 1);
+            }
+          }
+        }
+
+        /// the neighbor with index idx.
+        static KMER get(KMER const & km, unsigned int idx) {
+          KMER nb(km);
+          if (idx == 0) return nb;
+          unsigned int pos, d;
+          decode(idx, pos, d);
+          nb.setCharsAtPos(static_cast<WordType>(km.getCharsAtPos(pos, 1) ^ d), pos, 1);
+          return nb;
+        }
+    };
+
+
+    template <typename KMER>
+    constexpr unsigned int hamming_neighbors<KMER>::variants;
+    template <typename KMER>
+    constexpr unsigned int hamming_neighbors<KMER>::count;
+    template <typename KMER>
+    constexpr unsigned int hamming_neighbors<KMER>::bitsPerWord;
+
+
+    /**
+     * @brief  a subset of the hamming distance 1 neighborhood of 1 kmer, e.g. the neighbors owned by 1 rank.
+     * @details  a bitmap of neighbor indices.  trivially copyable, for all2allv.
+     */
+    template <typename KMER>
+    struct neighborhood_mask {
+        using neighbors = hamming_neighbors<KMER>;
+        static constexpr unsigned int n_words = (neighbors::count + 63) / 64;
+
+        KMER kmer;
+        uint64_t bits[n_words];
+
+        neighborhood_mask() : kmer() {
+          memset(bits, 0, sizeof(bits));
+        }
+        explicit neighborhood_mask(KMER const & km) : kmer(km) {
+          memset(bits, 0, sizeof(bits));
+        }
+
+        inline void set(unsigned int idx) {
+          bits[idx >> 6] |= (static_cast<uint64_t>(1) << (idx & 63));
+        }
+        inline bool test(unsigned int idx) const {
+          return (bits[idx >> 6] >> (idx & 63)) & 1;
+        }
+        /// number of neighbors in the subset.
+        unsigned int size() const {
+          unsigned int n = 0;
+          for (unsigned int i = 0; i < n_words; ++i) n += __builtin_popcountll(bits[i]);
+          return n;
+        }
+
+        /// call f(neighbor, index) for each neighbor in the subset, in index order.
+        template <typename F>
+        void for_each(F && f) const {
+          for (unsigned int w = 0; w < n_words; ++w) {
+            uint64_t b = bits[w];
+            while (b != 0) {
+              unsigned int idx = (w << 6) + __builtin_ctzll(b);
+              f(neighbors::get(kmer, idx), idx);
+              b &= b - 1;
+            }
+          }
+        }
+    };
+
+    template <typename KMER>
+    constexpr unsigned int neighborhood_mask<KMER>::n_words;
+
+
+    /**
+     * @brief  aggregated lookup result of the hamming distance 1 neighborhood of 1 kmer.
+     * @details  a bitmap of the neighbor indices present in the map, and the index and value of the best one.
+     *           trivially copyable, for all2allv.
+     */
+    template <typename KMER, typename T>
+    struct neighborhood_hits {
+        using neighbors = hamming_neighbors<KMER>;
+        static constexpr unsigned int n_words = (neighbors::count + 63) / 64;
+        /// best value for no hit.
+        static constexpr uint32_t none = neighbors::count;
+
+        uint64_t hits[n_words];
+        T best_value;
+        /// neighbor index of the best hit, or none.
+        uint32_t best;
+
+        neighborhood_hits() : best_value(), best(none) {
+          memset(hits, 0, sizeof(hits));
+        }
+
+        inline bool found() const {
+          return best != none;
+        }
+        inline bool hit(unsigned int idx) const {
+          return (hits[idx >> 6] >> (idx & 63)) & 1;
+        }
+        /// number of neighbors present, including the kmer itself.
+        unsigned int hit_count() const {
+          unsigned int n = 0;
+          for (unsigned int i = 0; i < n_words; ++i) n += __builtin_popcountll(hits[i]);
+          return n;
+        }
+
+        /// record a present neighbor.  the best has the largest value, ties go to the lower index.
+        template <typename Less = ::std::less<T> >
+        inline void add(unsigned int idx, T const & value, Less const & less = Less()) {
+          hits[idx >> 6] |= (static_cast<uint64_t>(1) << (idx & 63));
+          if (!found() || less(best_value, value) || (!less(value, best_value) && (idx < best))) {
+            best = idx;
+            best_value = value;
+          }
+        }
+
+        /// merge the hits of the same origin kmer from another rank.
+        template <typename Less = ::std::less<T> >
+        inline void merge(neighborhood_hits const & other, Less const & less = Less()) {
+          for (unsigned int i = 0; i < n_words; ++i) hits[i] |= other.hits[i];
+          if (other.found() &&
+              (!found() || less(best_value, other.best_value) || (!less(other.best_value, best_value) && (other.best < best)))) {
+            best = other.best;
+            best_value = other.best_value;
+          }
+        }
+    };
+
+    template <typename KMER, typename T>
+    constexpr unsigned int neighborhood_hits<KMER, T>::n_words;
+    template <typename KMER, typename T>
+    constexpr uint32_t neighborhood_hits<KMER, T>::none;
+
+  } // namespace common
+} // namespace bliss
+
+
+namespace mxx {
+
+  template<typename KMER>
+    struct datatype_builder<::bliss::common::neighborhood_mask<KMER> > :
+    public datatype_contiguous<uint8_t, sizeof(::bliss::common::neighborhood_mask<KMER>)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(::bliss::common::neighborhood_mask<KMER>)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+  template<typename KMER, typename T>
+    struct datatype_builder<::bliss::common::neighborhood_hits<KMER, T> > :
+    public datatype_contiguous<uint8_t, sizeof(::bliss::common::neighborhood_hits<KMER, T>)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(::bliss::common::neighborhood_hits<KMER, T>)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+}  // namespace mxx
+
+#endif /* KMER_NEIGHBORS_HPP_ */
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_kmer_neighbors.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the in place hamming distance 1 neighbor enumeration against per character substitution,
+ *          including characters split between words, and the merge of neighborhood hits.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/kmer_neighbors.hpp"
+
+
+template <typename kmer_type>
+class KmerNeighborsTest : public ::testing::Test
+{
+  protected:
+    std::vector<kmer_type> kmers;
+
+    virtual void SetUp() {
+      std::default_random_engine gen(23);
+      std::uniform_int_distribution<int> dist(0, kmer_type::KmerAlphabet::SIZE - 1);
+      for (size_t i = 0; i < 20; ++i) {
+        kmer_type km;
+        for (unsigned int j = 0; j < kmer_type::size; ++j) km.nextFromChar(dist(gen));
+        kmers.push_back(km);
+      }
+    }
+};
+
+TYPED_TEST_CASE_P(KmerNeighborsTest);
+
+
+TYPED_TEST_P(KmerNeighborsTest, enumerate)
+{
+  using Neighbors = ::bliss::common::hamming_neighbors<TypeParam>;
+  constexpr unsigned int alpha = TypeParam::KmerAlphabet::SIZE;
+
+  for (auto const & km : this->kmers) {
+    std::vector<TypeParam> nbs;
+    std::vector<unsigned int> ids;
+    Neighbors::for_each(km, [&nbs, &ids](TypeParam const & nb, unsigned int idx) {
+      nbs.push_back(nb);
+      ids.push_back(idx);
+    });
+
+    // the kmer itself, and (alphabet size - 1) substitutions per position.
+    ASSERT_EQ(TypeParam::size * (alpha - 1) + 1, nbs.size());
+    EXPECT_EQ(km, nbs[0]);
+    EXPECT_EQ(0U, ids[0]);
+
+    std::set<unsigned int> unique_ids(ids.begin(), ids.end());
+    EXPECT_EQ(ids.size(), unique_ids.size());
+
+    for (size_t i = 1; i < nbs.size(); ++i) {
+      ASSERT_LT(ids[i], Neighbors::count);
+      unsigned int pos, d;
+      Neighbors::decode(ids[i], pos, d);
+
+      // reference:  substitute 1 character.
+      TypeParam expected(km);
+      expected.setCharsAtPos(km.getCharsAtPos(pos, 1) ^ d, pos, 1);
+      EXPECT_EQ(expected, nbs[i]);
+      EXPECT_EQ(expected, Neighbors::get(km, ids[i]));
+
+      // exactly 1 character differs.
+      unsigned int diffs = 0;
+      for (unsigned int j = 0; j < TypeParam::size; ++j) {
+        diffs += (km.getCharsAtPos(j, 1) != nbs[i].getCharsAtPos(j, 1)) ? 1 : 0;
+        EXPECT_LT(nbs[i].getCharsAtPos(j, 1), alpha);
+      }
+      EXPECT_EQ(1U, diffs);
+    }
+  }
+}
+
+TYPED_TEST_P(KmerNeighborsTest, merge)
+{
+  using Hits = ::bliss::common::neighborhood_hits<TypeParam, uint32_t>;
+
+  Hits a, b;
+  EXPECT_FALSE(a.found());
+  EXPECT_EQ(0U, a.hit_count());
+
+  a.add(5, 10);
+  a.add(Hits::none / 2, 3);
+  b.add(4, 10);
+  b.add(Hits::none - 1, 2);
+
+  // ties go to the lower index.
+  a.merge(b);
+  EXPECT_TRUE(a.found());
+  EXPECT_EQ(4U, a.best);
+  EXPECT_EQ(10U, a.best_value);
+  EXPECT_EQ(4U, a.hit_count());
+  EXPECT_TRUE(a.hit(Hits::none / 2));
+  EXPECT_TRUE(a.hit(Hits::none - 1));
+  EXPECT_FALSE(a.hit(0));
+
+  // empty merge changes nothing.
+  Hits c;
+  a.merge(c);
+  EXPECT_EQ(4U, a.best);
+  c.merge(a);
+  EXPECT_EQ(4U, c.best);
+  EXPECT_EQ(4U, c.hit_count());
+}
+
+TYPED_TEST_P(KmerNeighborsTest, mask)
+{
+  using Neighbors = ::bliss::common::hamming_neighbors<TypeParam>;
+  using Mask = ::bliss::common::neighborhood_mask<TypeParam>;
+
+  TypeParam km;
+  km.nextFromChar(1);
+  for (unsigned int i = 1; i < TypeParam::size; ++i) km.nextFromChar(i % 3);
+
+  // every third neighbor, plus the last.
+  Mask m(km);
+  EXPECT_EQ(0U, m.size());
+  std::vector<unsigned int> gold;
+  for (unsigned int i = 0; i < Neighbors::count; i += 3) {
+    m.set(i);
+    gold.push_back(i);
+  }
+  if (gold.back() != Neighbors::count - 1) {
+    m.set(Neighbors::count - 1);
+    gold.push_back(Neighbors::count - 1);
+  }
+  EXPECT_EQ(gold.size(), m.size());
+  EXPECT_TRUE(m.test(0));
+  EXPECT_FALSE(m.test(1));
+
+  std::vector<unsigned int> ids;
+  m.for_each([&](TypeParam const & nb, unsigned int idx) {
+    ids.push_back(idx);
+    EXPECT_EQ(Neighbors::get(km, idx), nb);
+  });
+  EXPECT_EQ(gold, ids);
+}
+
+
+REGISTER_TYPED_TEST_CASE_P(KmerNeighborsTest, enumerate, merge, mask);
+
+typedef ::testing::Types<
+    ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>,   // 1 word, padded
+    ::bliss::common::Kmer<32, ::bliss::common::DNA, uint64_t>,   // 1 full word
+    ::bliss::common::Kmer<63, ::bliss::common::DNA, uint64_t>,   // 2 words
+    ::bliss::common::Kmer<21, ::bliss::common::DNA, uint8_t>,    // byte words
+    ::bliss::common::Kmer<31, ::bliss::common::DNA5, uint64_t>,  // 3 bit characters, split between words
+    ::bliss::common::Kmer<15, ::bliss::common::DNA16, uint32_t>
+> KmerNeighborsTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, KmerNeighborsTest, KmerNeighborsTestTypes);
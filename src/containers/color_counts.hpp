@@ -0,0 +1,270 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    color_counts.hpp
+ * @ingroup fsc
+ * @author  tpan
+ * @brief   per-sample (color) count vector, for storing the counts of 1 key from multiple samples.
+ * @details the counts are stored either sparse, as (color, count) pairs sorted by color, or dense,
+ *          as 1 count per sample.  an entry starts sparse, and becomes dense once the sparse form would
+ *          take as much space as the dense one, i.e. when half of the samples are present.
+ *          so with few samples the entries are dense right away, and with many samples only the common keys are.
+ *
+ *          the number of samples is a property of the owning map, and is passed in to each call instead
+ *          of being stored per entry.  the form is implied by the size:  dense iff size == number of samples.
+ *          all entries of 1 map therefore need the same number of samples.
+ *
+ *          the slots are stored inline up to 16 bytes (2 colors with 32 bit counts), and on the heap beyond that,
+ *          so the many keys that occur in 1 or 2 samples need no allocation.  an entry is the size of a std::vector.
+ */
+#ifndef SRC_CONTAINERS_COLOR_COUNTS_HPP_
+#define SRC_CONTAINERS_COLOR_COUNTS_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+namespace fsc {
+
+  /**
+   * @brief  compact count vector over samples.
+   * @tparam Count  unsigned count type.  also holds the color ids in the sparse form.
+   * @tparam Color  unsigned sample id type.
+   */
+  template <typename Count = uint32_t, typename Color = uint16_t>
+  class color_counts {
+      static_assert(::std::is_integral<Count>::value && !::std::is_signed<Count>::value, "count type has to be unsigned integral");
+      static_assert(::std::is_integral<Color>::value && !::std::is_signed<Color>::value, "color type has to be unsigned integral");
+      static_assert(sizeof(Color) <= sizeof(Count), "color ids are stored in count slots in the sparse form.");
+
+    public:
+      using count_type = Count;
+      using color_type = Color;
+
+    protected:
+      /// slots that fit in the inline buffer.
+      static constexpr size_t inline_slots = (16 / sizeof(Count)) < 2 ? 2 : (16 / sizeof(Count));
+
+      /// number of slots in use.
+      uint32_t len;
+      /// number of slots available.  on the heap iff more than inline_slots.
+      uint32_t cap;
+
+      /// sparse:  color, count, color, count..., sorted by color.   dense:  count of each color.
+      union {
+        Count local[inline_slots];
+        Count * heap;
+      } store;
+
+      inline bool on_heap() const {
+        return cap > inline_slots;
+      }
+      inline Count * data() {
+        return on_heap() ? store.heap : store.local;
+      }
+      inline Count const * data() const {
+        return on_heap() ? store.heap : store.local;
+      }
+
+      inline void release() {
+        if (on_heap()) delete [] store.heap;
+        cap = inline_slots;
+      }
+
+      /// make room for n slots, at least doubling the capacity.
+      void grow(size_t n) {
+        if (n <= cap) return;
+        size_t new_cap = (n < (static_cast<size_t>(cap) << 1)) ? (static_cast<size_t>(cap) << 1) : n;
+        Count * p = new Count[new_cap];
+        ::std::memcpy(p, data(), len * sizeof(Count));
+        release();
+        store.heap = p;
+        cap = static_cast<uint32_t>(new_cap);
+      }
+
+      /// position of color in the sparse form, or of the first larger color.
+      size_t sparse_lower_bound(Color const & color) const {
+        Count const * d = data();
+        size_t lo = 0;
+        size_t hi = len >> 1;
+        while (lo < hi) {
+          size_t mid = (lo + hi) >> 1;
+          if (d[mid << 1] < color) lo = mid + 1;
+          else hi = mid;
+        }
+        return lo;
+      }
+
+      /// convert sparse to dense.
+      void densify(size_t n_samples) {
+        // the sparse slots are read after the dense ones are written, so copy them out of the inline buffer first.
+        Count scratch[inline_slots];
+        bool was_heap = on_heap();
+        Count * sparse = was_heap ? store.heap : scratch;
+        if (!was_heap) ::std::memcpy(scratch, store.local, len * sizeof(Count));
+
+        Count * dense = (n_samples > inline_slots) ? new Count[n_samples] : store.local;
+        ::std::fill(dense, dense + n_samples, static_cast<Count>(0));
+        for (size_t i = 0; i < len; i += 2) {
+          dense[sparse[i]] = sparse[i + 1];
+        }
+
+        if (was_heap) delete [] sparse;
+        if (n_samples > inline_slots) store.heap = dense;
+        cap = (n_samples > inline_slots) ? static_cast<uint32_t>(n_samples) : static_cast<uint32_t>(inline_slots);
+        len = static_cast<uint32_t>(n_samples);
+      }
+
+    public:
+      color_counts() : len(0), cap(inline_slots) {}
+
+      color_counts(color_counts const & other) : len(other.len), cap(inline_slots) {
+        if (other.len > inline_slots) {
+          store.heap = new Count[other.len];
+          cap = other.len;
+        }
+        ::std::memcpy(data(), other.data(), len * sizeof(Count));
+      }
+
+      color_counts(color_counts && other) noexcept : len(other.len), cap(other.cap) {
+        if (other.on_heap()) store.heap = other.store.heap;
+        else ::std::memcpy(store.local, other.store.local, len * sizeof(Count));
+        other.len = 0;
+        other.cap = inline_slots;
+      }
+
+      color_counts & operator=(color_counts const & other) {
+        if (this == &other) return *this;
+        if (other.len > cap) {
+          release();
+          store.heap = new Count[other.len];
+          cap = other.len;
+        }
+        len = other.len;
+        ::std::memcpy(data(), other.data(), len * sizeof(Count));
+        return *this;
+      }
+
+      color_counts & operator=(color_counts && other) noexcept {
+        if (this == &other) return *this;
+        release();
+        len = other.len;
+        cap = other.cap;
+        if (other.on_heap()) store.heap = other.store.heap;
+        else ::std::memcpy(store.local, other.store.local, len * sizeof(Count));
+        other.len = 0;
+        other.cap = inline_slots;
+        return *this;
+      }
+
+      ~color_counts() {
+        release();
+      }
+
+
+      /// dense form is used iff there is 1 slot per sample.
+      inline bool is_dense(size_t n_samples) const {
+        return len == n_samples;
+      }
+
+      /// no counts at all.
+      inline bool empty() const {
+        return len == 0;
+      }
+
+      /// add cnt to the count of color.  color has to be less than n_samples.
+      void add(Color const & color, Count const & cnt, size_t n_samples) {
+        if (is_dense(n_samples)) {
+          data()[color] += cnt;
+          return;
+        }
+
+        size_t pos = sparse_lower_bound(color);
+        if (((pos << 1) < len) && (data()[pos << 1] == color)) {
+          data()[(pos << 1) + 1] += cnt;
+          return;
+        }
+
+        // new color.  go dense if the sparse form would no longer be smaller.
+        if ((len + 2) >= n_samples) {
+          densify(n_samples);
+          data()[color] += cnt;
+          return;
+        }
+        grow(len + 2);
+        Count * d = data();
+        ::std::memmove(d + (pos << 1) + 2, d + (pos << 1), (len - (pos << 1)) * sizeof(Count));
+        d[pos << 1] = static_cast<Count>(color);
+        d[(pos << 1) + 1] = cnt;
+        len += 2;
+      }
+
+      /// count of color.  0 if absent.
+      Count get(Color const & color, size_t n_samples) const {
+        Count const * d = data();
+        if (is_dense(n_samples)) return d[color];
+
+        size_t pos = sparse_lower_bound(color);
+        return (((pos << 1) < len) && (d[pos << 1] == color)) ? d[(pos << 1) + 1] : 0;
+      }
+
+      /// call op(color, count) for each color with non-zero count, in increasing color order.
+      template <typename Op>
+      void for_each(Op && op, size_t n_samples) const {
+        Count const * d = data();
+        if (is_dense(n_samples)) {
+          for (size_t i = 0; i < len; ++i) {
+            if (d[i] > 0) op(static_cast<Color>(i), d[i]);
+          }
+        } else {
+          for (size_t i = 0; i < len; i += 2) {
+            op(static_cast<Color>(d[i]), d[i + 1]);
+          }
+        }
+      }
+
+      /// number of samples with non-zero count.
+      size_t colors(size_t n_samples) const {
+        if (!is_dense(n_samples)) return len >> 1;
+        return len - ::std::count(data(), data() + len, static_cast<Count>(0));
+      }
+
+      /// write the counts of all samples to row[0, n_samples).
+      void to_counts(Count * row, size_t n_samples) const {
+        ::std::fill(row, row + n_samples, static_cast<Count>(0));
+        for_each([row](Color const & c, Count const & cnt) { row[c] = cnt; }, n_samples);
+      }
+
+      /// set the presence bits of all samples in row[0, (n_samples + 63) / 64).  bit i % 64 of word i / 64 is sample i.
+      void to_bits(uint64_t * row, size_t n_samples) const {
+        ::std::fill(row, row + ((n_samples + 63) >> 6), 0ULL);
+        for_each([row](Color const & c, Count const &) { row[c >> 6] |= (1ULL << (c & 63)); }, n_samples);
+      }
+
+      /// heap memory used by this entry, in bytes.  0 while inline.
+      inline size_t heap_bytes() const {
+        return on_heap() ? cap * sizeof(Count) : 0;
+      }
+  };
+
+  template <typename Count, typename Color>
+  constexpr size_t color_counts<Count, Color>::inline_slots;
+
+} // namespace fsc
+
+#endif /* SRC_CONTAINERS_COLOR_COUNTS_HPP_ */
@@ -0,0 +1,320 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    compressed_multimap.hpp
+ * @ingroup fsc::data_structures
+ * @author  tpan
+ * @brief   read-only multimap with sorted unique keys and delta + varint compressed value lists.
+ * @details intended for position indices (kmer -> positions), where the same key occurs many times and the
+ *          values are integers (or integer-like ids such as LongSequenceKmerId) that cluster within a sequence.
+ *
+ *          layout (CSR):
+ *            keys:     sorted unique keys, U entries.
+ *            offsets:  byte offset of each key's posting list in data, U + 1 entries.
+ *            data:     posting lists.  each list is varint(count), varint(v0), varint(v1 - v0), ...
+ *                      values within a list are sorted ascending, so deltas are non-negative and small.
+ *
+ *          memory:  sizeof(Key) U + 8 U + (1 to 2 bytes per value typically), compared to
+ *                   (sizeof(Key) + sizeof(T)) N for a sorted vector of pairs.
+ *
+ *          lookup is binary search on keys followed by sequential decode of one posting list.
+ *
+ *          the map is built once from a vector of pairs (build()).  no insert/erase after build -
+ *          rebuild from to_vector() if changes are needed.
+ *
+ *          value types are converted to uint64_t via posting_codec.  integral types and types with a
+ *          public integral "id" member (e.g. ::bliss::common::LongSequenceKmerId) are supported.
+ */
+#ifndef SRC_CONTAINERS_COMPRESSED_MULTIMAP_HPP_
+#define SRC_CONTAINERS_COMPRESSED_MULTIMAP_HPP_
+
+#include <vector>
+#include <utility>      // pair
+#include <functional>   // less
+#include <algorithm>    // sort, lower_bound
+#include <iterator>
+#include <type_traits>
+#include <cstdint>
+
+#include "utils/logging.h"
+
+namespace fsc {  // fast standard container
+
+  /**
+   * @brief convert values to and from uint64_t for posting list compression.  default for integral types.
+   */
+  template <typename T, typename Enable = void>
+  struct posting_codec {
+      static_assert(::std::is_integral<T>::value, "posting_codec requires integral type, or type with an integral \"id\" member.");
+
+      static inline uint64_t encode(T const & x) { return static_cast<uint64_t>(x); }
+      static inline T decode(uint64_t const & x) { return static_cast<T>(x); }
+  };
+
+  /// specialization for id types with a public integral "id" member, e.g. Long/ShortSequenceKmerId
+  template <typename T>
+  struct posting_codec<T, typename ::std::enable_if<!::std::is_integral<T>::value &&
+    ::std::is_integral<decltype(::std::declval<T>().id)>::value>::type> {
+
+      static inline uint64_t encode(T const & x) { return static_cast<uint64_t>(x.id); }
+      static inline T decode(uint64_t const & x) {
+        T out;
+        out.id = x;
+        return out;
+      }
+  };
+
+
+  /**
+   * @brief read-only multimap with compressed posting lists.  see file description.
+   * @tparam Key    key type
+   * @tparam T      value type.  must be supported by posting_codec
+   * @tparam Less   comparator for keys.  used for sort and binary search.
+   */
+  template <typename Key, typename T, typename Less = ::std::less<Key> >
+  class compressed_multimap {
+
+    protected:
+      using codec = posting_codec<T>;
+
+      /// sorted unique keys
+      ::std::vector<Key> keys;
+      /// start of each key's posting list in data.  keys.size() + 1 entries.
+      ::std::vector<uint64_t> offsets;
+      /// varint encoded posting lists
+      ::std::vector<uint8_t> data;
+      /// total number of entries
+      size_t s;
+
+      Less less;
+
+      /// append unsigned LEB128 varint
+      static inline void put_varint(::std::vector<uint8_t> & out, uint64_t v) {
+        while (v >= 0x80) {
+          out.push_back(static_cast<uint8_t>(v | 0x80));
+          v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+      }
+
+      /// decode unsigned LEB128 varint, advance pointer.
+      static inline uint64_t get_varint(uint8_t const * & p) {
+        uint64_t v = *p & 0x7F;
+        if (*p++ < 0x80) return v;    // single byte fast path: deltas are mostly small.
+
+        int shift = 7;
+        uint64_t b;
+        do {
+          b = *p++;
+          v |= (b & 0x7F) << shift;
+          shift += 7;
+        } while (b >= 0x80);
+        return v;
+      }
+
+      /// locate key.  returns keys.size() if not found.
+      inline size_t find_key(Key const & k) const {
+        auto it = ::std::lower_bound(keys.begin(), keys.end(), k, less);
+        if ((it == keys.end()) || less(k, *it)) return keys.size();
+        return ::std::distance(keys.begin(), it);
+      }
+
+      /// decode the posting list for key at index i into output.  returns number of entries
+      template <typename OutputIter, typename Op>
+      size_t decode_list(size_t i, OutputIter & output, Op const & op) const {
+        uint8_t const * p = data.data() + offsets[i];
+        size_t n = get_varint(p);
+
+        uint64_t v = 0;
+        for (size_t j = 0; j < n; ++j) {
+          v += get_varint(p);
+          *output = op(keys[i], codec::decode(v));
+          ++output;
+        }
+        return n;
+      }
+
+    public:
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<Key, T>;
+      using size_type             = size_t;
+
+      compressed_multimap(Less const & _less = Less()) : s(0), less(_less) {
+        offsets.push_back(0);
+      };
+
+      /// construct from input vector.  see build()
+      compressed_multimap(::std::vector<::std::pair<Key, T> > & input, bool sorted_input = false, Less const & _less = Less()) :
+        compressed_multimap(_less) {
+        this->build(input, sorted_input);
+      }
+
+      virtual ~compressed_multimap() {};
+
+      /**
+       * @brief build from vector of pairs.  replaces existing content.
+       * @details input is sorted by key if not already sorted.  input is modified only in that case.
+       * @param input         input key-value pairs.
+       * @param sorted_input  input is sorted by key.  values within a key are sorted here regardless.
+       */
+      void build(::std::vector<::std::pair<Key, T> > & input, bool sorted_input = false) {
+        if (!sorted_input) {
+          Less l = less;
+          ::std::sort(input.begin(), input.end(), [&l](::std::pair<Key, T> const & x, ::std::pair<Key, T> const & y){
+            return l(x.first, y.first);
+          });
+        }
+        this->build_sorted(input.begin(), input.end());
+      }
+
+      /**
+       * @brief build from a range of pairs already sorted by key.  replaces existing content.
+       */
+      template <typename InputIter>
+      void build_sorted(InputIter first, InputIter last) {
+        clear();
+        if (first == last) return;
+
+        size_t n = ::std::distance(first, last);
+        // estimate: 1 byte per delta, plus count.
+        data.reserve(n + (n >> 2));
+        ::std::vector<uint64_t> vals;
+
+        for (auto it = first; it != last; ) {
+          // find end of current key
+          auto group_end = it;
+          while ((group_end != last) && !less(it->first, group_end->first)) ++group_end;
+
+          vals.clear();
+          for (auto vit = it; vit != group_end; ++vit) vals.emplace_back(codec::encode(vit->second));
+          ::std::sort(vals.begin(), vals.end());
+
+          keys.emplace_back(it->first);
+          put_varint(data, vals.size());
+          uint64_t prev = 0;
+          for (auto v : vals) {
+            put_varint(data, v - prev);
+            prev = v;
+          }
+          offsets.emplace_back(data.size());
+
+          s += vals.size();
+          it = group_end;
+        }
+
+        keys.shrink_to_fit();
+        offsets.shrink_to_fit();
+        data.shrink_to_fit();
+      }
+
+      void clear() {
+        keys.clear();
+        offsets.clear();
+        offsets.push_back(0);
+        data.clear();
+        s = 0;
+      }
+
+      bool empty() const { return s == 0; }
+
+      size_type size() const { return s; }
+
+      size_type unique_size() const { return keys.size(); }
+
+      /// bytes used by the compressed representation
+      size_t memory_usage() const {
+        return keys.capacity() * sizeof(Key) + offsets.capacity() * sizeof(uint64_t) + data.capacity();
+      }
+
+      /// number of entries for a key.  only the count varint is decoded.
+      size_type count(Key const & k) const {
+        size_t i = find_key(k);
+        if (i == keys.size()) return 0;
+
+        uint8_t const * p = data.data() + offsets[i];
+        return get_varint(p);
+      }
+
+      /// decode the values for one key, in ascending order.  returns number of values found.
+      template <typename OutputIter>
+      size_t find_values(Key const & k, OutputIter output) const {
+        size_t i = find_key(k);
+        if (i == keys.size()) return 0;
+
+        return decode_list(i, output, [](Key const &, T const & v) { return v; });
+      }
+
+      /// find entries for a key, output as (key, value) pairs.  returns number of entries found.
+      template <typename OutputIter>
+      size_t find(Key const & k, OutputIter output) const {
+        size_t i = find_key(k);
+        if (i == keys.size()) return 0;
+
+        return decode_list(i, output, [](Key const & kk, T const & v) { return ::std::make_pair(kk, v); });
+      }
+
+      /// batch find.  queries are processed in sorted order so the key array is walked forward.
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key> & query, bool sorted_input = false) const {
+        ::std::vector<::std::pair<Key, T> > results;
+        if (query.size() == 0 || keys.size() == 0) return results;
+
+        if (!sorted_input) ::std::sort(query.begin(), query.end(), less);
+
+        auto emplace_iter = ::std::back_inserter(results);
+        auto kit = keys.begin();
+        for (auto q = query.begin(); q != query.end(); ++q) {
+          kit = ::std::lower_bound(kit, keys.end(), *q, less);
+          if (kit == keys.end()) break;
+          if (less(*q, *kit)) continue;
+
+          // skip duplicate queries
+          if ((q != query.begin()) && !less(*(q - 1), *q)) continue;
+
+          decode_list(::std::distance(keys.begin(), kit), emplace_iter,
+                      [](Key const & kk, T const & v) { return ::std::make_pair(kk, v); });
+        }
+        return results;
+      }
+
+      /// decompress into vector of pairs, sorted by key then value.
+      void to_vector(::std::vector<::std::pair<Key, T> > & result) const {
+        result.clear();
+        result.reserve(s);
+        auto emplace_iter = ::std::back_inserter(result);
+        for (size_t i = 0; i < keys.size(); ++i) {
+          decode_list(i, emplace_iter, [](Key const & kk, T const & v) { return ::std::make_pair(kk, v); });
+        }
+      }
+
+      /// copy of the unique keys.
+      void get_keys(::std::vector<Key> & result) const {
+        result.assign(keys.begin(), keys.end());
+      }
+
+      void report() const {
+        BL_INFOF("compressed multimap unique keys: %lu\n", keys.size());
+        BL_INFOF("compressed multimap total size: %lu\n", s);
+        BL_INFOF("compressed multimap posting bytes: %lu\n", data.size());
+        BL_INFOF("compressed multimap total bytes: %lu\n", memory_usage());
+      }
+  };
+
+} // end namespace fsc
+
+
+#endif /* SRC_CONTAINERS_COMPRESSED_MULTIMAP_HPP_ */
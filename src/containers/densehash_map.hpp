@@ -34,6 +34,7 @@
 #include <cmath>   // ceil
 #include <memory>  // allocator
 #include <iostream>
+#include <stdexcept>  // invalid_argument
 
 // TODO: http://stackoverflow.com/questions/6162201/c11-use-case-for-piecewise-construct-of-pair-and-tuple - use piecewise construct.
 
@@ -909,7 +910,7 @@ protected:
 
     inline bool exists(Key const & key) const {
       if (splitter(key)) {
-        return upper_map.find(key) != upper_map.end();
+        return lower_map.find(key) != lower_map.end();
       } else {
         return upper_map.find(key) != upper_map.end();
       }
@@ -1231,6 +1232,401 @@ class densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, fals
 
 
 
+
+/**
+ * @brief densehash map that is partitioned into independently growing segments, to limit peak memory during growth.
+ * @details google dense_hash_map grows by allocating a table twice as large while the old table is still live,
+ *          so a single table momentarily needs 3x its live size when it rehashes.  For a large local kmer table
+ *          these rehash moments, not the steady state size, determine the peak memory of a bulk insert or local_reduction.
+ *
+ *          Here the keys are assigned to one of 2^segment_bits segments using the high bits of the mixed storage hash,
+ *          and each segment is a densehash_map that resizes by itself.  Only one segment rehashes at a time,
+ *          so the peak is approximately (1 + 2 / segments) x live size.  The low bits of the hash continue to be used by
+ *          the segment for bucket selection.  The cost is 1 extra hash and multiply per operation.
+ *
+ *          Interface follows densehash_map so that it can be used as the local container in the distributed maps.
+ *
+ *          iterators hold a segment index and a position in that segment.  find returns an iterator that continues to the
+ *          end of the map.
+ */
+template <typename Key,
+typename T,
+typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+template<typename> class Transform = ::bliss::transform::identity,
+typename Hash =  ::fsc::TransformedHash<Key, ::std::hash, Transform>,
+typename Equal = ::fsc::sparsehash::compare<Key, ::std::equal_to, Transform>,
+typename Allocator = ::std::allocator<::std::pair<const Key, T> >,
+bool split = SpecialKeys::need_to_split >
+class densehash_segmented_map {
+
+  protected:
+    using segment_type = densehash_map<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split>;
+
+    using segment_iterator = typename segment_type::iterator;
+    using segment_const_iterator = typename segment_type::const_iterator;
+
+    /// hash function for choosing the segment.  same as the one used by the segments.
+    Hash hash;
+
+    /// log2 of number of segments.
+    uint8_t segment_bits;
+
+    std::vector<segment_type> segments;
+
+    /// choose segment using the high bits.  multiply first since distributed maps already use the high bits of some hash functions for rank assignment.
+    inline size_t segment_of(Key const & key) const {
+      return (segment_bits == 0) ? 0 :
+          static_cast<size_t>((static_cast<uint64_t>(hash(key)) * 0x9E3779B97F4A7C15ULL) >> (64 - segment_bits));
+    }
+
+    /**
+     * @brief forward iterator over the segments, as segment index and position in that segment.  no allocation.
+     * @details the position is never at the end of a segment except for the last one, so end is (last segment, its end).
+     *          empty segments are skipped without calling their begin(), which the split segments do not support.
+     */
+    template <typename SegmentIterator, typename Segments>
+    class segmented_iterator : public ::std::iterator<::std::forward_iterator_tag,
+                                                      typename ::std::iterator_traits<SegmentIterator>::value_type,
+                                                      typename ::std::iterator_traits<SegmentIterator>::difference_type,
+                                                      typename ::std::iterator_traits<SegmentIterator>::pointer,
+                                                      typename ::std::iterator_traits<SegmentIterator>::reference> {
+        friend class densehash_segmented_map;
+
+        Segments * segs;
+        size_t seg;
+        SegmentIterator curr;
+
+        segmented_iterator(Segments * _segs, size_t _seg, SegmentIterator const & _curr) :
+          segs(_segs), seg(_seg), curr(_curr) {
+          skip_empty();
+        }
+
+        /// position at the start of segment id, or at the end of the last segment.
+        static segmented_iterator at_segment(Segments * _segs, size_t id) {
+          if (id >= _segs->size()) return segmented_iterator(_segs, _segs->size() - 1, _segs->back().end());
+          return segmented_iterator(_segs, id, (*_segs)[id].empty() ? (*_segs)[id].end() : (*_segs)[id].begin());
+        }
+
+        inline void skip_empty() {
+          while ((seg + 1 < segs->size()) && (curr == (*segs)[seg].end())) {
+            ++seg;
+            curr = (*segs)[seg].empty() ? (*segs)[seg].end() : (*segs)[seg].begin();
+          }
+        }
+
+      public:
+        segmented_iterator() : segs(nullptr), seg(0), curr() {}
+
+        inline typename ::std::iterator_traits<SegmentIterator>::reference operator*() const {
+          return *curr;
+        }
+        inline typename ::std::iterator_traits<SegmentIterator>::pointer operator->() const {
+          return &(*curr);
+        }
+
+        segmented_iterator & operator++() {
+          ++curr;
+          skip_empty();
+          return *this;
+        }
+        segmented_iterator operator++(int) {
+          segmented_iterator out(*this);
+          ++(*this);
+          return out;
+        }
+
+        inline bool operator==(segmented_iterator const & other) const {
+          return (seg == other.seg) && (curr == other.curr);
+        }
+        inline bool operator!=(segmented_iterator const & other) const {
+          return !(*this == other);
+        }
+    };
+
+  public:
+    using key_type              = Key;
+    using mapped_type           = T;
+    using value_type            = ::std::pair<const Key, T>;
+    using hasher                = Hash;
+    using key_equal             = Equal;
+    using allocator_type        = Allocator;
+    using reference             = value_type&;
+    using const_reference       = const value_type&;
+    using pointer               = typename std::allocator_traits<Allocator>::pointer;
+    using const_pointer         = typename std::allocator_traits<Allocator>::const_pointer;
+    using iterator              = segmented_iterator<segment_iterator, std::vector<segment_type> >;
+    using const_iterator        = segmented_iterator<segment_const_iterator, const std::vector<segment_type> >;
+    using size_type             = size_t;
+    using difference_type       = ptrdiff_t;
+
+  protected:
+    using insert_result_type = decltype(::std::declval<segment_type &>().insert(::std::declval<value_type const &>()));
+    using range_type = decltype(::std::declval<segment_type &>().equal_range(::std::declval<Key const &>()));
+    using const_range_type = decltype(::std::declval<segment_type const &>().equal_range(::std::declval<Key const &>()));
+
+  public:
+
+    /// bucket_count is the total for all segments.  segment_bits = 4 gives 16 segments, so peak is about 1.125x live size during growth.
+    densehash_segmented_map(size_type bucket_count = 128, uint8_t _segment_bits = 4) :
+      hash(), segment_bits(_segment_bits) {
+
+      if (segment_bits > 16) throw std::invalid_argument("densehash_segmented_map: segment_bits should be 16 or less.");
+
+      size_t nsegs = 1UL << segment_bits;
+      segments.reserve(nsegs);
+      for (size_t i = 0; i < nsegs; ++i) {
+        segments.emplace_back((bucket_count + nsegs - 1) / nsegs);
+      }
+    };
+
+    template<class InputIt>
+    densehash_segmented_map(InputIt first, InputIt last) :
+      densehash_segmented_map(std::distance(first, last)) {
+      this->insert(first, last);
+    };
+
+    virtual ~densehash_segmented_map() {};
+
+    float get_max_load_factor() const {
+      return segments[0].get_max_load_factor();
+    }
+
+    size_t segment_count() const {
+      return segments.size();
+    }
+
+    iterator begin() {
+      return iterator::at_segment(&segments, 0);
+    }
+    const_iterator begin() const {
+      return cbegin();
+    }
+    const_iterator cbegin() const {
+      return const_iterator::at_segment(&segments, 0);
+    }
+
+    iterator end() {
+      return iterator::at_segment(&segments, segments.size());
+    }
+    const_iterator end() const {
+      return cend();
+    }
+    const_iterator cend() const {
+      return const_iterator::at_segment(&segments, segments.size());
+    }
+
+
+    std::vector<Key> keys() const  {
+      std::vector<Key> ks;
+
+      keys(ks);
+
+      return ks;
+    }
+    void keys(std::vector<Key> & ks) const  {
+      ks.clear();
+      ks.reserve(size());
+
+      for (auto const & seg : segments) {
+        if (seg.empty()) continue;  // split segment's begin() needs non-empty ranges.
+        for (auto it = seg.cbegin(), max = seg.cend(); it != max; ++it) {
+          ks.emplace_back((*it).first);
+        }
+      }
+    }
+
+    std::vector<std::pair<Key, T>> to_vector() const  {
+      std::vector<std::pair<Key, T>> vs;
+
+      to_vector(vs);
+
+      return vs;
+    }
+    void to_vector(  std::vector<std::pair<Key, T>> & vs) const  {
+      vs.clear();
+      vs.reserve(size());
+
+      for (auto const & seg : segments) {
+        if (seg.empty()) continue;
+        for (auto it = seg.cbegin(), max = seg.cend(); it != max; ++it) {
+          vs.emplace_back(*it);
+        }
+      }
+    }
+
+
+    bool empty() const {
+      for (auto const & seg : segments) {
+        if (!seg.empty()) return false;
+      }
+      return true;
+    }
+
+    size_type size() const {
+      size_type s = 0;
+      for (auto const & seg : segments) s += seg.size();
+      return s;
+    }
+
+    size_type unique_size() const {
+      return size();
+    }
+
+    void reset() {
+      for (auto & seg : segments) seg.reset();
+    }
+
+    void clear() {
+      for (auto & seg : segments) seg.clear();
+    }
+
+    /// resize each segment in turn, so only 1 segment is being reallocated at any time.
+    void resize(size_t const n) {
+      size_t nsegs = segments.size();
+      for (auto & seg : segments) seg.resize((n + nsegs - 1) / nsegs);
+    }
+
+    /// rehash for new count number of BUCKETS.  iterators are invalidated.
+    void rehash(size_type count) {
+      this->resize(count);
+    }
+
+    /// bucket count.  sum of all segments.
+    size_type bucket_count() {
+      size_type s = 0;
+      for (auto & seg : segments) s += seg.bucket_count();
+      return s;
+    }
+
+    float load_factor() {
+      return  static_cast<float>(size()) / static_cast<float>(bucket_count());
+    }
+
+
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+      for (auto it = first; it != last; ++it) {
+        static_cast<void>(this->insert(*it));
+      }
+    }
+
+    /// inserting a vector
+    void insert(::std::vector<::std::pair<Key, T> > & input) {
+      insert(input.begin(), input.end());
+    }
+
+    /// inserting a vector
+    void insert(::std::vector<value_type > & input) {
+      insert(input.begin(), input.end());
+    }
+
+    template <typename K = Key, typename = typename std::enable_if<!std::is_const<Key>::value> >
+    insert_result_type insert(::std::pair<Key, T> const & x) {
+      return segments[segment_of(x.first)].insert(x);
+    }
+
+    insert_result_type insert(::std::pair<const Key, T> const & x) {
+      return segments[segment_of(x.first)].insert(x);
+    }
+
+
+    template <typename V, typename Updater>
+    size_t update(::std::vector<::std::pair<Key, V> > & input, Updater const & op) {
+
+      if (input.size() == 0) return 0;
+
+      size_t count = 0;
+
+      for (auto iit = input.begin(); iit != input.end(); ++iit) {
+        auto range = segments[segment_of(iit->first)].equal_range(iit->first);
+        if (range.first == range.second) continue;
+
+        // update the entry
+        count += op((*(range.first)).second, iit->second );
+      }
+
+      return count;
+    }
+
+    // non distributed version
+    template <typename Filter, typename Updater>
+    size_t update(Filter const & fop, Updater const & op) {
+      size_t count = 0;
+      for (auto & seg : segments) {
+        count += seg.update(fop, op);
+      }
+      return count;
+    }
+
+
+    template <typename InputIt, typename Pred>
+    size_t erase(InputIt first, InputIt last, Pred const & pred) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      size_t count = 0;
+      for (; first != last; ++first) {
+        Key k = *first;
+        count += segments[segment_of(k)].erase(&k, &k + 1, pred);
+      }
+      return count;
+    }
+
+    template <typename InputIt>
+    size_t erase(InputIt first, InputIt last) {
+      static_assert(::std::is_convertible<Key, typename ::std::iterator_traits<InputIt>::value_type>::value,
+                    "InputIt value type for erase cannot be converted to key type");
+
+      size_t count = 0;
+      for (; first != last; ++first) {
+        Key k = *first;
+        count += segments[segment_of(k)].erase(&k, &k + 1);
+      }
+      return count;
+    }
+
+    template <typename Pred>
+    size_t erase(Pred const & pred) {
+      size_t count = 0;
+      for (auto & seg : segments) {
+        count += seg.erase(pred);
+      }
+      return count;
+    }
+
+    size_type count(Key const & key) const {
+      return segments[segment_of(key)].count(key);
+    }
+
+    range_type equal_range(Key const & key) {
+      return segments[segment_of(key)].equal_range(key);
+    }
+    const_range_type equal_range(Key const & key) const {
+      return segments[segment_of(key)].equal_range(key);
+    }
+
+    /// returns iterator that continues through the subsequent segments.  use exists or equal_range for membership tests.
+    iterator find(Key const &key) {
+      size_t id = segment_of(key);
+      auto it = segments[id].find(key);
+      if (it == segments[id].end()) return end();
+      return iterator(&segments, id, it);
+    }
+
+    const_iterator find(Key const &key) const {
+      size_t id = segment_of(key);
+      auto it = segments[id].find(key);
+      if (it == segments[id].cend()) return cend();
+      return const_iterator(&segments, id, it);
+    }
+
+    inline bool exists(Key const & key) const {
+      return segments[segment_of(key)].exists(key);
+    }
+};
+
+
+
 // lookup new left
 
 
@@ -2474,6 +2870,16 @@ class densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator,
 };
 
 
+/// true for densehash_multimap, which has a batch insert of all entries but no single insert returning an iterator.
+template <typename C>
+struct is_densehash_multimap : public ::std::false_type {};
+
+template <typename Key, typename T, typename SpecialKeys, template<typename> class Transform,
+  typename Hash, typename Equal, typename Allocator, bool split>
+struct is_densehash_multimap<densehash_multimap<Key, T, SpecialKeys, Transform, Hash, Equal, Allocator, split> > :
+  public ::std::true_type {};
+
+
 } // end namespace fsc.
 
 
@@ -53,6 +53,9 @@
 #include <cstdint>  // for uint8, etc.
 
 #include <type_traits>
+#include <stdexcept>
+#include <sstream>
+#include <limits>
 
 #include <mxx/collective.hpp>
 #include <mxx/reduction.hpp>
@@ -60,6 +63,7 @@
 
 #include "containers/distributed_map_base.hpp"
 #include "containers/densehash_map.hpp"
+#include "containers/color_counts.hpp"
 
 #include "utils/benchmark_utils.hpp"  // for timing.
 #include "utils/logging.h"
@@ -68,6 +72,7 @@
 
 
 #include "common/kmer_transform.hpp"
+#include "common/kmer_neighbors.hpp"
 
 #include "containers/dsc_container_utils.hpp"
 
@@ -226,11 +231,102 @@ namespace dsc  // distributed std container
       using size_type             = typename local_container_type::size_type;
       using difference_type       = typename local_container_type::difference_type;
 
+      /// key to rank hash.  maps with the same key type and distribution function on the same communicator are co-partitioned.
+      using distribution_function_type = typename Base::DistTransformedFunc;
+
     protected:
       local_container_type c;
 
       mutable bool local_changed;
 
+      /// erase predicate:  true if an entry's key is present (or absent) in db.
+      template <typename DB, bool Present>
+      struct KeyIn {
+          DB const & db;
+          KeyIn(DB const & _db) : db(_db) {}
+
+          template <typename V>
+          inline bool operator()(V const & x) const {
+            return (db.count(x.first) > 0) == Present;
+          }
+      };
+
+      /// true if the local container is a multimap.
+      static constexpr bool is_multimap = ::fsc::is_densehash_multimap<local_container_type>::value;
+
+      /// merge into a map:  keys already present get op(this value, other value).
+      template <typename OtherContainer, typename Op>
+      void merge_local(OtherContainer const & oc, Op const & op, ::std::false_type) {
+        for (auto it = oc.begin(); it != oc.end(); ++it) {
+          auto result = this->c.insert(::std::make_pair((*it).first, static_cast<T>((*it).second)));
+          if (!(result.second)) {
+            result.first->second = op(result.first->second, (*it).second);
+          }
+        }
+      }
+
+      /// merge into a multimap:  all entries are inserted, in 1 batch.  the multimaps have no const iterators, so use to_vector.
+      template <typename OtherContainer, typename Op>
+      void merge_local(OtherContainer const & oc, Op const &, ::std::true_type) {
+        if (oc.size() == 0) return;
+
+        ::std::vector<::std::pair<Key, typename OtherContainer::mapped_type> > entries;
+        oc.to_vector(entries);
+        insert_entries(entries);
+      }
+      void insert_entries(::std::vector<::std::pair<Key, T> > & entries) {
+        this->c.insert(entries);
+      }
+      template <typename V>
+      void insert_entries(::std::vector<::std::pair<Key, V> > const & entries) {
+        ::std::vector<::std::pair<Key, T> > converted(entries.begin(), entries.end());
+        this->c.insert(converted);
+      }
+
+      /// merge operator that keeps the existing value.
+      struct KeepFirst {
+          template <typename V1, typename V2>
+          inline V1 operator()(V1 const & x, V2 const &) const {
+            return x;
+          }
+      };
+
+      /**
+       * @brief  the other map's entries that belong to this rank under this map's key_to_rank.
+       * @details  if the maps are co-partitioned, this is the other map's local container, no communication.
+       *           otherwise the other map's entries are redistributed once, with 1 all2allv, and inserted into tmp.
+       */
+      template <typename OtherMap>
+      typename OtherMap::local_container_type const &
+      colocated_container(OtherMap const & other, typename OtherMap::local_container_type & tmp) const {
+        if (this->is_copartitioned(other)) return other.get_local_container();
+
+        BL_BENCH_INIT(colocate);
+
+        BL_BENCH_START(colocate);
+        ::std::vector<::std::pair<Key, typename OtherMap::mapped_type> > entries;
+        other.to_vector(entries);
+        BL_BENCH_END(colocate, "to_vector", entries.size());
+
+        BL_BENCH_COLLECTIVE_START(colocate, "distribute", this->comm);
+        if (this->comm.size() > 1) {
+          std::vector<size_t> recv_counts;
+          ::std::vector<::std::pair<Key, typename OtherMap::mapped_type> > buffer;
+          ::imxx::distribute(entries, this->key_to_rank, recv_counts, buffer, this->comm);
+          entries.swap(buffer);
+        }
+        BL_BENCH_END(colocate, "distribute", entries.size());
+
+        BL_BENCH_START(colocate);
+        tmp.resize(entries.size());
+        tmp.insert(entries);
+        BL_BENCH_END(colocate, "insert", tmp.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(colocate, "base_densehash:colocate", this->comm);
+
+        return tmp;
+      }
+
       struct LocalCount {
           // filtered element-wise.
           template<class DB, typename Query, class OutputIter,
@@ -358,9 +454,8 @@ namespace dsc  // distributed std container
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-				  std::vector<size_t> i2o;
 				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				  keys.swap(buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
@@ -394,7 +489,7 @@ namespace dsc  // distributed std container
                     static_cast<double>(req_sofar)) *
                                     static_cast<double>(req_total) * 1.1f);
                 if (new_est > results.capacity()) {
-                  if (this->comm.rank() == 0) printf("rank %d nkeys %lu nresuts %lu est result size %lu original estimate %lu\n", this->comm.rank(), keys.size(), results.size(), new_est, results.capacity());
+                  if (this->comm.rank() == 0) BL_DEBUGF("rank %d nkeys %lu nresuts %lu est result size %lu original estimate %lu\n", this->comm.rank(), keys.size(), results.size(), new_est, results.capacity());
                   results.reserve(new_est);  // if new_est is lower than capacity, nothing happens.
                 }
               }
@@ -407,12 +502,14 @@ namespace dsc  // distributed std container
               start = end;
             }
             BL_BENCH_END(find, "local_find", results.size());
-            if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
 
 
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
             // send back using the constructed recv count
+            size_t sent = results.size();
             mxx::all2allv(results, send_counts, this->comm).swap(results);
+            ::dsc::telemetry_a2a(sent, results);
             BL_BENCH_END(find, "a2a2", results.size());
 
           } else {
@@ -437,7 +534,7 @@ namespace dsc  // distributed std container
             QueryProcessor::process(c, keys.begin() + estimating, keys.end(), emplace_iter, find_element, sorted_input, pred);
             BL_BENCH_END(find, "local_find", results.size());
 
-            if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
 
           }
 
@@ -488,9 +585,8 @@ namespace dsc  // distributed std container
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
 				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				keys.swap(buffer);
 	//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	//            				typename Base::StoreTransformedFunc(),
@@ -543,7 +639,8 @@ namespace dsc  // distributed std container
             auto resp_total = resp_displs[this->comm.size() - 1] + resp_counts[this->comm.size() - 1];
             auto max_send_count = *(::std::max_element(send_counts.begin(), send_counts.end()));
             results.resize(resp_total);   // allocate, not just reserve
-            ::std::vector<::std::pair<Key, T> > local_results(2 * max_send_count);
+            // double buffered send buffer for the results.
+            ::std::vector<::std::pair<Key, T>, ::imxx::buffer_allocator<::std::pair<Key, T> > > local_results(2 * max_send_count);
             size_t local_offset = 0;
             auto local_results_iter = local_results.begin();
 
@@ -698,9 +795,8 @@ namespace dsc  // distributed std container
                 // distribute (communication part)
                 std::vector<size_t> recv_counts;
                 {
-					std::vector<size_t> i2o;
 					std::vector<Key > buffer;
-					::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+					::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 					keys.swap(buffer);
 		//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 		//            				typename Base::StoreTransformedFunc(),
@@ -735,7 +831,7 @@ namespace dsc  // distributed std container
                     static_cast<double>(req_sofar)) *
                                     static_cast<double>(req_total) * 1.1f);
                 if (new_est > results.capacity()) {
-                  if (this->comm.rank() == 0) printf("rank %d nkeys %lu nresuts %lu est result size %lu original estimate %lu\n", this->comm.rank(), keys.size(), results.size(), new_est, results.capacity());
+                  if (this->comm.rank() == 0) BL_DEBUGF("rank %d nkeys %lu nresuts %lu est result size %lu original estimate %lu\n", this->comm.rank(), keys.size(), results.size(), new_est, results.capacity());
                   results.reserve(new_est);  // if new_est is lower than capacity, nothing happens.
                 }
               }
@@ -749,12 +845,14 @@ namespace dsc  // distributed std container
               start = end;
             }
             BL_BENCH_END(find, "local_find", results.size());
-            if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
 
 
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
             // send back using the constructed recv count
+            size_t sent = results.size();
             mxx::all2allv(results, send_counts, this->comm).swap(results);
+            ::dsc::telemetry_a2a(sent, results);
             BL_BENCH_END(find, "a2a2", results.size());
 
           } else {
@@ -780,7 +878,7 @@ namespace dsc  // distributed std container
             QueryProcessor::process(c, keys.begin() + estimating, keys.end(), emplace_iter, find_element, sorted_input, pred, trans);
             BL_BENCH_END(find, "local_find", results.size());
 
-            if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
 
           }
 
@@ -1085,6 +1183,112 @@ namespace dsc  // distributed std container
       local_container_type& get_local_container() { return c; }
       local_container_type const & get_local_container() const { return c; }
 
+      /**
+       * @brief  check if the keys of another map are partitioned the same way as this map's.
+       * @details  true if both maps have the same key type and distribution function, and are on the same
+       *           (or a congruent) communicator.  then the set operations below are purely rank-local.
+       *           maps on communicators with the same processes in a different order are not co-partitioned,
+       *           and maps on different process groups cannot be combined.
+       */
+      template <typename OtherMap>
+      bool is_copartitioned(OtherMap const & other) const {
+        static_assert(::std::is_same<Key, typename OtherMap::key_type>::value,
+                      "set operations require maps with the same key type.");
+
+        int cmp = MPI_UNEQUAL;
+        MPI_Comm_compare(this->comm, other.get_comm(), &cmp);
+        if (cmp == MPI_UNEQUAL)
+          throw std::invalid_argument("set operations require maps distributed over the same processes.");
+
+        return ::std::is_same<distribution_function_type, typename OtherMap::distribution_function_type>::value &&
+            ((cmp == MPI_IDENT) || (cmp == MPI_CONGRUENT));
+      }
+
+      /**
+       * @brief  keep only the entries whose keys are also in other.  collective.
+       * @details  keys are compared as stored, so both maps should use the same input transform (e.g. canonical).
+       *           rank-local if co-partitioned, else other is redistributed once.
+       * @return number of local entries removed.
+       */
+      template <typename OtherMap>
+      size_t intersect(OtherMap const & other) {
+        typename OtherMap::local_container_type tmp;
+        auto const & oc = colocated_container(other, tmp);
+
+        size_t before = this->c.size();
+        if (before > 0) this->c.erase(KeyIn<typename OtherMap::local_container_type, false>(oc));
+
+        if (before != this->c.size()) local_changed = true;
+        return before - this->c.size();
+      }
+
+      /**
+       * @brief  remove the entries whose keys are in other.  collective.
+       * @details  rank-local if co-partitioned, else other is redistributed once.
+       * @return number of local entries removed.
+       */
+      template <typename OtherMap>
+      size_t subtract(OtherMap const & other) {
+        typename OtherMap::local_container_type tmp;
+        auto const & oc = colocated_container(other, tmp);
+
+        size_t before = this->c.size();
+        if ((before > 0) && (oc.size() > 0)) this->c.erase(KeyIn<typename OtherMap::local_container_type, true>(oc));
+
+        if (before != this->c.size()) local_changed = true;
+        return before - this->c.size();
+      }
+
+      /**
+       * @brief  insert other's entries into this map.  for keys already present, the value becomes op(this value, other value).  collective.
+       * @details  rank-local if co-partitioned, else other is redistributed once.  for multimaps, all entries are inserted.
+       * @param op   binary operator (T const &, OtherMap::mapped_type const &) -> T
+       * @return number of local entries added.
+       */
+      template <typename OtherMap, typename Op>
+      size_t merge(OtherMap const & other, Op const & op) {
+        typename OtherMap::local_container_type tmp;
+        auto const & oc = colocated_container(other, tmp);
+
+        size_t before = this->c.size();
+        merge_local(oc, op, ::std::integral_constant<bool, is_multimap>());
+
+        if (before != this->c.size()) local_changed = true;
+        return this->c.size() - before;
+      }
+
+      /// insert other's entries whose keys are not yet in this map.  collective.
+      template <typename OtherMap>
+      size_t merge(OtherMap const & other) {
+        return merge(other, KeepFirst());
+      }
+
+      /**
+       * @brief  inner join on key.  collective.
+       * @details  results are rank-local, on the rank that owns the key in this map.  multimap entries produce
+       *           all pairs of values.  rank-local if co-partitioned, else other is redistributed once.
+       */
+      template <typename OtherMap>
+      ::std::vector<::std::pair<Key, ::std::pair<T, typename OtherMap::mapped_type> > >
+      join(OtherMap const & other) const {
+        using OT = typename OtherMap::mapped_type;
+
+        typename OtherMap::local_container_type tmp;
+        auto const & oc = colocated_container(other, tmp);
+
+        ::std::vector<::std::pair<Key, ::std::pair<T, OT> > > results;
+        if (this->c.empty() || oc.empty()) return results;
+
+        results.reserve(::std::min(this->c.size(), oc.size()));
+        for (auto it = this->c.begin(); it != this->c.end(); ++it) {
+          auto range = oc.equal_range((*it).first);
+          for (auto oit = range.first; oit != range.second; ++oit) {
+            results.emplace_back((*it).first, ::std::make_pair((*it).second, (*oit).second));
+          }
+        }
+        return results;
+      }
+
 //      const_iterator cbegin() const
 //      {
 //        return c.cbegin();
@@ -1155,9 +1359,8 @@ namespace dsc  // distributed std container
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-            	std::vector<size_t> i2o;
                 std::vector<Key > buffer;
-                ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+                ::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
                 keys.swap(buffer);
             }
 //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
@@ -1191,7 +1394,9 @@ namespace dsc  // distributed std container
 
             // send back using the constructed recv count
             BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
+            size_t sent = results.size();
             mxx::all2allv(results, recv_counts, this->comm).swap(results);
+            ::dsc::telemetry_a2a(sent, results);
             BL_BENCH_END(count, "a2a2", results.size());
 
 
@@ -1261,9 +1466,8 @@ namespace dsc  // distributed std container
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-				  std::vector<size_t> i2o;
 				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				  keys.swap(buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
@@ -1297,7 +1501,9 @@ namespace dsc  // distributed std container
 
             // send back using the constructed recv count
             BL_BENCH_COLLECTIVE_START(count, "a2a2", this->comm);
+            size_t sent = results.size();
             mxx::all2allv(results, recv_counts, this->comm).swap(results);
+            ::dsc::telemetry_a2a(sent, results);
             BL_BENCH_END(count, "a2a2", results.size());
           } else {
 
@@ -1561,6 +1767,7 @@ namespace dsc  // distributed std container
 				// send back using the constructed recv count
 			  BL_BENCH_START(exists);
 			  auto tmp_results = mxx::all2allv(results, recv_counts, this->comm);
+			  ::dsc::telemetry_a2a(results.size(), tmp_results);
 			  BL_BENCH_END(exists, "a2a2", results.size());
 
 //				std::cout << "rank " << this->comm.rank() << " exists. results size=" << results.size() << " keys2 " << keys2.size() << std::endl;
@@ -1622,9 +1829,8 @@ namespace dsc  // distributed std container
 //            BLISS_UNUSED(recv_counts);
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
 				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				//::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
 				keys.swap(buffer);
             }
@@ -1733,16 +1939,19 @@ namespace dsc  // distributed std container
    * @tparam Hash   hash function for local and distribution.  requires a template arugment (Key), and a bool (prefix, chooses the MSBs of hash instead of LSBs)
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam LocalContainer  default to ::fsc::densehash_map.  ::fsc::densehash_segmented_map limits peak memory during table growth.
    */
   template<typename Key, typename T,
   	  template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
-	  class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+	  class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
   >
   class densehash_map : 
-    public densehash_map_base<Key, T, ::fsc::densehash_map, MapParams, SpecialKeys, Alloc> {
+    public densehash_map_base<Key, T, LocalContainer, MapParams, SpecialKeys, Alloc> {
     protected:
-      using Base = densehash_map_base<Key, T, ::fsc::densehash_map, MapParams, SpecialKeys, Alloc>;
+      using Base = densehash_map_base<Key, T, LocalContainer, MapParams, SpecialKeys, Alloc>;
 
 
     public:
@@ -1832,6 +2041,127 @@ namespace dsc  // distributed std container
           return Base::template find<remove_duplicate>(find_element, keys, sorted_input, pred, trans);
       }
 
+      /**
+       * @brief  error tolerant lookup:  aggregated find of the hamming distance 1 neighborhood of each query kmer.  collective.
+       * @details  the querying rank computes the owner of each neighbor (after the input transform, e.g. canonicalization),
+       *           and sends each distinct owner the query kmer once, with the mask of the neighbors that it owns.
+       *           the owner looks up only those neighbors and returns 1 neighborhood_hits.  the querying rank merges them.
+       *           a query therefore costs 1 request and 1 result per distinct owner rank, instead of 1 kmer and
+       *           1 (key, value) pair per neighbor.
+       * @param less  orders the values, to select the best hit.  e.g. the highest count.
+       * @return  1 result per query, in input order.
+       */
+      template <typename Less = ::std::less<T> >
+      ::std::vector<::bliss::common::neighborhood_hits<Key, T> >
+      find_neighbors(::std::vector<Key> const & keys, Less const & less = Less()) const {
+        static_assert(::bliss::common::is_kmer<Key>::value, "neighborhood queries require kmer keys.");
+        using Neighbors = ::bliss::common::hamming_neighbors<Key>;
+        using Mask = ::bliss::common::neighborhood_mask<Key>;
+        using Result = ::bliss::common::neighborhood_hits<Key, T>;
+
+        BL_BENCH_INIT(neighbors);
+
+        ::std::vector<Result> results(keys.size());
+        if (::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(neighbors, "densehash_map:find_neighbors", this->comm);
+          return results;
+        }
+
+        typename Base::Base::InputTransform trans;
+        int p = this->comm.size();
+
+        if (p == 1) {
+          BL_BENCH_START(neighbors);
+          for (size_t i = 0; i < keys.size(); ++i) {
+            Result & res = results[i];
+            Neighbors::for_each(keys[i], [this, &trans, &less, &res](Key const & nb, unsigned int idx) {
+              auto it = this->c.find(trans(nb));
+              if (it != this->c.end()) res.add(idx, (*it).second, less);
+            });
+          }
+          BL_BENCH_END(neighbors, "local_find", keys.size());
+
+          BL_BENCH_REPORT_MPI_NAMED(neighbors, "densehash_map:find_neighbors", this->comm);
+          return results;
+        }
+
+        // the neighbors of each query owned by each rank.  1 request per distinct owner, in query order.
+        BL_BENCH_START(neighbors);
+        std::vector<size_t> send_counts(p, 0);
+        std::vector<int> owners;
+        std::vector<Mask> masks;
+        owners.reserve(keys.size() * ::std::min(static_cast<size_t>(p), static_cast<size_t>(Neighbors::count)));
+        masks.reserve(owners.capacity());
+        std::vector<size_t> offsets(keys.size() + 1, 0);
+        std::vector<size_t> marked(p, keys.size());  // last query that included each rank.
+        std::vector<size_t> slot(p, 0);              // request of the last query for each rank.
+        for (size_t i = 0; i < keys.size(); ++i) {
+          Neighbors::for_each(keys[i], [this, &trans, &owners, &masks, &marked, &slot, &send_counts, &keys, i](Key const & nb, unsigned int idx) {
+            int r = this->key_to_rank(trans(nb));
+            if (marked[r] != i) {
+              marked[r] = i;
+              slot[r] = masks.size();
+              owners.push_back(r);
+              masks.emplace_back(keys[i]);
+              ++send_counts[r];
+            }
+            masks[slot[r]].set(idx);
+          });
+          offsets[i + 1] = owners.size();
+        }
+        BL_BENCH_END(neighbors, "owners", owners.size());
+
+        // bucket the requests by owner, remembering the query of each.
+        BL_BENCH_START(neighbors);
+        std::vector<size_t> pos(p, 0);
+        for (int r = 1; r < p; ++r) pos[r] = pos[r - 1] + send_counts[r - 1];
+        std::vector<Mask> requests(owners.size());
+        std::vector<size_t> origin(owners.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+          for (size_t j = offsets[i]; j < offsets[i + 1]; ++j) {
+            size_t s = pos[owners[j]]++;
+            requests[s] = masks[j];
+            origin[s] = i;
+          }
+        }
+        ::std::vector<int>().swap(owners);
+        ::std::vector<Mask>().swap(masks);
+        BL_BENCH_END(neighbors, "bucket", requests.size());
+
+        BL_BENCH_COLLECTIVE_START(neighbors, "a2a1", this->comm);
+        std::vector<size_t> recv_counts(p);
+        mxx::all2all(send_counts.data(), 1, recv_counts.data(), this->comm);
+        std::vector<Mask> received(::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0)));
+        mxx::all2allv(requests.data(), send_counts, received.data(), recv_counts, this->comm);
+        ::dsc::telemetry_a2a(requests.size(), received);
+        BL_BENCH_END(neighbors, "a2a1", received.size());
+
+        BL_BENCH_START(neighbors);
+        std::vector<Result> found(received.size());
+        for (size_t i = 0; i < received.size(); ++i) {
+          Result & res = found[i];
+          received[i].for_each([this, &trans, &less, &res](Key const & nb, unsigned int idx) {
+            auto it = this->c.find(trans(nb));
+            if (it != this->c.end()) res.add(idx, (*it).second, less);
+          });
+        }
+        BL_BENCH_END(neighbors, "local_find", received.size());
+
+        // answers come back in request order.
+        BL_BENCH_COLLECTIVE_START(neighbors, "a2a2", this->comm);
+        std::vector<Result> answers(requests.size());
+        mxx::all2allv(found.data(), recv_counts, answers.data(), send_counts, this->comm);
+        ::dsc::telemetry_a2a(found.size(), answers);
+        BL_BENCH_END(neighbors, "a2a2", answers.size());
+
+        BL_BENCH_START(neighbors);
+        for (size_t s = 0; s < answers.size(); ++s) results[origin[s]].merge(answers[s], less);
+        BL_BENCH_END(neighbors, "merge", results.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(neighbors, "densehash_map:find_neighbors", this->comm);
+        return results;
+      }
+
       template <class Predicate = ::bliss::filter::TruePredicate>
       ::std::vector<::std::pair<Key, T> > find(Predicate const& pred = Predicate()) const {
           ::std::vector<::std::pair<Key, T> > results;
@@ -1929,9 +2259,8 @@ namespace dsc  // distributed std container
 //          auto recv_counts(::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm));
 //          BLISS_UNUSED(recv_counts);
           std::vector<size_t> recv_counts;
-			  std::vector<size_t> i2o;
 			  std::vector<::std::pair<Key, T> > buffer;
-			  ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+			  ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
 			  input.swap(buffer);
           BL_BENCH_END(insert, "dist_data", input.size());
         }
@@ -1940,9 +2269,7 @@ namespace dsc  // distributed std container
         BL_BENCH_START(insert);
         // local compute part.  called by the communicator.
         //this->c.resize(input.size() / 2);
-        if (this->comm.rank() == 0)
-        std::cout << "rank " << this->comm.rank() <<
-          " BEFORE input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+        if (this->comm.rank() == 0) BL_DEBUGF("rank %d BEFORE input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
         size_t count = 0;
         if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
@@ -1950,9 +2277,7 @@ namespace dsc  // distributed std container
         else
           count = this->Base::local_insert(input);
 
-        if (this->comm.rank() == 0)
-        std::cout << "rank " << this->comm.rank() <<
-          " AFTER input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+        if (this->comm.rank() == 0) BL_DEBUGF("rank %d AFTER input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
         //this->c.resize(0);
 //        std::cout << "rank " << this->comm.rank() <<
@@ -1994,9 +2319,8 @@ namespace dsc  // distributed std container
 			BL_BENCH_START(update);
 //			::dsc::distribute_bucketed(input, recv_counts, this->comm).swap(input);
 			std::vector<size_t> recv_counts;
-			  std::vector<size_t> i2o;
 			  std::vector<::std::pair<Key, V> > buffer;
-			  ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+			  ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
 			  input.swap(buffer);
 
 			BL_BENCH_END(update, "distribute_(localcnt)", recv_counts[this->comm.rank()]);
@@ -2234,7 +2558,7 @@ namespace dsc  // distributed std container
       /// access the current the multiplicity.  only multimap needs to override this.
       virtual float get_multiplicity() const {
         // multimaps would add a collective function to change the multiplicity
-        if (this->comm.rank() == 0) printf("rank %d densehash_multimap get_multiplicity called\n", this->comm.rank());
+        if (this->comm.rank() == 0) BL_DEBUGF("rank %d densehash_multimap get_multiplicity called\n", this->comm.rank());
 
 
         // one approach is to add up the number of repeats for the key of each entry, then divide by total count.
@@ -2352,9 +2676,8 @@ namespace dsc  // distributed std container
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
 
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
           std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
           input.swap(buffer);
 
           //auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
@@ -2424,14 +2747,16 @@ namespace dsc  // distributed std container
   template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
   typename Reduc = ::std::plus<T>,
-  class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+  class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
   >
   class reduction_densehash_map : 
-    public densehash_map<Key, T, MapParams, SpecialKeys, Alloc> {
+    public densehash_map<Key, T, MapParams, SpecialKeys, Alloc, LocalContainer> {
       //static_assert(::std::is_arithmetic<T>::value, "mapped type has to be arithmetic");
 
     protected:
-      using Base = densehash_map<Key, T, MapParams, SpecialKeys, Alloc>;
+      using Base = densehash_map<Key, T, MapParams, SpecialKeys, Alloc, LocalContainer>;
 
     public:
       using local_container_type = typename Base::local_container_type;
@@ -2534,8 +2859,8 @@ namespace dsc  // distributed std container
         BL_BENCH_END(reduce_tuple, "reduce", temp.size());
 
         BL_BENCH_START(reduce_tuple);
-        input.clear();
-        temp.to_vector().swap(input);
+        // copy back into input's existing capacity, instead of allocating another vector while temp and input are both live.
+        temp.to_vector(input);
         BL_BENCH_END(reduce_tuple, "copy", input.size());
 
         //local_container_type().swap(temp);   // doing the swap to clear helps?
@@ -2556,6 +2881,13 @@ namespace dsc  // distributed std container
       using Base::erase;
       using Base::unique_size;
       using Base::update;
+      using Base::merge;
+
+      /// merge other's entries into this map, reducing values of common keys with this map's reduction operator.  collective.
+      template <typename OtherMap>
+      size_t merge(OtherMap const & other) {
+        return Base::merge(other, r);
+      }
 
       /**
        * @brief insert new elements in the distributed densehash_multimap.
@@ -2583,9 +2915,8 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
           std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
           input.swap(buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
@@ -2600,9 +2931,7 @@ namespace dsc  // distributed std container
         // local compute part.  called by the communicator.
         BL_BENCH_START(insert);
 //        this->c.resize(input.size() / 2);
-        if (this->comm.rank() == 0)
-        std::cout << "rank " << this->comm.rank() <<
-          " BEFORE input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+        if (this->comm.rank() == 0) BL_DEBUGF("rank %d BEFORE input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
         size_t count = 0;
         if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
@@ -2610,9 +2939,7 @@ namespace dsc  // distributed std container
         else
           count = this->local_insert(input.begin(), input.end());
 
-        if (this->comm.rank() == 0)
-        std::cout << "rank " << this->comm.rank() <<
-          " AFTER input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+        if (this->comm.rank() == 0) BL_DEBUGF("rank %d AFTER input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
 //        this->c.resize(0);
 
@@ -2664,14 +2991,16 @@ namespace dsc  // distributed std container
     typename Key, typename T,
     template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
-    class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
   >
   class counting_densehash_map : 
-    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc> {
+    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc, LocalContainer> {
       static_assert(::std::is_integral<T>::value, "count type has to be integral");
 
     protected:
-      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc>;
+      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, ::std::plus<T>, Alloc, LocalContainer>;
 
     public:
       using local_container_type = typename Base::local_container_type;
@@ -2774,9 +3103,8 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
           std::vector< Key > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
           input.swap(buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
@@ -2865,9 +3193,7 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // preallocate.  easy way out - estimate to be 1/2 of input.  then at the end, resize if significantly less.
           //this->c.resize(input.size() / 2);
-          if (this->comm.rank() == 0)
-          std::cout << "rank " << this->comm.rank() <<
-            " BEFORE input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+          if (this->comm.rank() == 0) BL_DEBUGF("rank %d BEFORE input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
           // then insert all the rest,
           auto local_start = ::bliss::iterator::make_transform_iterator(input.begin(), trans);
@@ -2878,9 +3204,7 @@ namespace dsc  // distributed std container
           else
             count += this->Base::local_insert(local_start, local_end);
 
-          if (this->comm.rank() == 0)
-          std::cout << "rank " << this->comm.rank() <<
-            " AFTER input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+          if (this->comm.rank() == 0) BL_DEBUGF("rank %d AFTER input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
           // resize further.
           //this->c.resize(0);
@@ -2942,15 +3266,17 @@ namespace dsc  // distributed std container
     typename Key, typename T,
     template <typename> class MapParams,
     typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
-    class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
   >
   class saturating_counting_densehash_map :
-    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, sat_plus<T>, Alloc> {
+    public reduction_densehash_map<Key, T, MapParams, SpecialKeys, sat_plus<T>, Alloc, LocalContainer> {
       static_assert(!::std::is_signed<T>::value &&
                     ::std::is_integral<T>::value, "only supports unsigned integer types for count");
 
     protected:
-      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, sat_plus<T>, Alloc>;
+      using Base = reduction_densehash_map<Key, T, MapParams, SpecialKeys, sat_plus<T>, Alloc, LocalContainer>;
 
     public:
       using local_container_type = typename Base::local_container_type;
@@ -3016,11 +3342,10 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
 
           std::vector<Key > buffer;
           //::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
           input.swap(buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
@@ -3037,9 +3362,7 @@ namespace dsc  // distributed std container
           // preallocate.  easy way out - estimate to be 1/2 of input.  then at the end, resize if significantly less.
           // this->c.resize(input.size() / 2);
 
-          if (this->comm.rank() == 0)
-          std::cout << "rank " << this->comm.rank() <<
-            " BEFORE input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+          if (this->comm.rank() == 0) BL_DEBUGF("rank %d BEFORE input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
 
           // then insert all the rest,
@@ -3051,9 +3374,7 @@ namespace dsc  // distributed std container
           else
             count += this->Base::local_insert(local_start, local_end);
 
-          if (this->comm.rank() == 0)
-          std::cout << "rank " << this->comm.rank() <<
-            " AFTER input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+          if (this->comm.rank() == 0) BL_DEBUGF("rank %d AFTER input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
 
           // resize further.
@@ -3069,6 +3390,374 @@ namespace dsc  // distributed std container
   };
 
 
+  /**
+   * @brief  distributed multi-sample (colored) counting map.  each key is stored once, with the counts from all samples.
+   * @details  the value of each key is a ::fsc::color_counts, sparse or dense depending on how many of the
+   *           samples contain the key (see color_counts.hpp).  the number of samples is fixed at construction.
+   *
+   *           kmers from any mix of samples are inserted in 1 pass as (key, sample id) pairs, so all samples share
+   *           1 all2allv per batch instead of 1 table and 1 all2allv per sample.  a batch from a single sample can
+   *           be inserted with the sample id as a separate argument, then only the keys are communicated.
+   *
+   *           the presence/absence and count matrices are queried collectively, 1 row per query key, in query order.
+   *           a presence row has (samples + 63) / 64 words, with sample i at bit i % 64 of word i / 64.
+   *
+   * @tparam Key
+   * @tparam T      unsigned count type.
+   * @tparam MapParams
+   * @tparam SpecialKeys
+   * @tparam Color  unsigned sample id type.  default supports 65536 samples.
+   * @tparam Alloc
+   */
+  template<typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    typename Color = uint16_t,
+    class Alloc = ::std::allocator< ::std::pair<const Key, ::fsc::color_counts<T, Color> > >
+  >
+  class colored_counting_densehash_map :
+    public densehash_map_base<Key, ::fsc::color_counts<T, Color>, ::fsc::densehash_map, MapParams, SpecialKeys, Alloc> {
+      static_assert(!::std::is_signed<T>::value &&
+                    ::std::is_integral<T>::value, "only supports unsigned integer types for count");
+
+    protected:
+      using Base = densehash_map_base<Key, ::fsc::color_counts<T, Color>, ::fsc::densehash_map, MapParams, SpecialKeys, Alloc>;
+
+    public:
+      using local_container_type = typename Base::local_container_type;
+
+      // std::densehash_multimap public members.
+      using key_type              = typename local_container_type::key_type;
+      using mapped_type           = typename local_container_type::mapped_type;
+      using value_type            = typename local_container_type::value_type;
+      using hasher                = typename local_container_type::hasher;
+      using key_equal             = typename local_container_type::key_equal;
+      using allocator_type        = typename local_container_type::allocator_type;
+      using iterator              = typename local_container_type::iterator;
+      using const_iterator        = typename local_container_type::const_iterator;
+      using size_type             = typename local_container_type::size_type;
+      using difference_type       = typename local_container_type::difference_type;
+
+      using count_type            = T;
+      using color_type            = Color;
+
+    protected:
+      /// number of samples.  same on all ranks.
+      const size_t n_samples;
+
+      /// throws if color is not a valid sample id.  call with the same color on all ranks, e.g. after a reduction.
+      void check_color(size_t const & color) const {
+        if (color >= n_samples) {
+          std::stringstream ss;
+          ss << "sample id " << static_cast<size_t>(color) << " is not less than the number of samples " << n_samples;
+          throw std::invalid_argument(ss.str());
+        }
+      }
+
+      /// add 1 to the count of color for key.
+      inline bool local_add(Key const & key, Color const & color) {
+        auto result = this->c.insert(::std::make_pair(key, mapped_type()));
+        (*(result.first)).second.add(color, static_cast<T>(1), n_samples);
+        return result.second;
+      }
+
+      /// insert (key, color) pairs.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t local_insert(std::vector<::std::pair<Key, Color> > const & input, Predicate const & pred = Predicate()) {
+        size_t before = this->c.size();
+        for (auto it = input.begin(); it != input.end(); ++it) {
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(*it))
+            local_add((*it).first, (*it).second);
+        }
+        if (this->c.size() != before) this->local_changed = true;
+        return this->c.size() - before;
+      }
+
+      /// insert keys from 1 sample.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t local_insert(std::vector<Key> const & input, Color const & color, Predicate const & pred = Predicate()) {
+        size_t before = this->c.size();
+        for (auto it = input.begin(); it != input.end(); ++it) {
+          if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(*it))
+            local_add(*it, color);
+        }
+        if (this->c.size() != before) this->local_changed = true;
+        return this->c.size() - before;
+      }
+
+      /// row writers for query_rows
+      struct PresenceRow {
+          size_t n;
+          inline void operator()(mapped_type const & v, uint64_t * row) const { v.to_bits(row, n); }
+      };
+      struct CountRow {
+          size_t n;
+          inline void operator()(mapped_type const & v, T * row) const { v.to_counts(row, n); }
+      };
+
+      /**
+       * @brief  look up keys on their owner ranks, and return 1 fixed width row per key, in query order.
+       * @details  rows of absent keys are 0.  keys are transformed in place, and returned in their original order.
+       */
+      template <typename V, typename RowOp>
+      void query_rows(std::vector<Key> & keys, size_t width, RowOp const & op, std::vector<V> & rows, const char * name) const {
+        BL_BENCH_INIT(query);
+
+        rows.clear();
+        if (::dsc::empty(keys, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(query, name, this->comm);
+          return;
+        }
+
+        BL_BENCH_START(query);
+        this->transform_input(keys);
+        BL_BENCH_END(query, "transform_input", keys.size());
+
+        std::vector<size_t> recv_counts;
+        std::vector<size_t> i2o;
+        std::vector<Key> buffer;
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(query, "dist_query", this->comm);
+          // keys become bucketed, buffer gets the queries for this rank.
+          ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          BL_BENCH_END(query, "dist_query", buffer.size());
+        }
+        std::vector<Key> const & local_keys = (this->comm.size() > 1) ? buffer : keys;
+
+        BL_BENCH_START(query);
+        std::vector<V> local_rows(local_keys.size() * width, static_cast<V>(0));
+        for (size_t i = 0; i < local_keys.size(); ++i) {
+          auto range = this->c.equal_range(local_keys[i]);
+          if (range.first != range.second) op((*(range.first)).second, local_rows.data() + i * width);
+        }
+        BL_BENCH_END(query, "local_find", local_keys.size());
+
+        if (this->comm.size() == 1) {
+          rows.swap(local_rows);
+          BL_BENCH_REPORT_MPI_NAMED(query, name, this->comm);
+          return;
+        }
+
+        BL_BENCH_COLLECTIVE_START(query, "a2a2", this->comm);
+        // rows go back in the order the queries were received.
+        std::vector<size_t> send_counts(this->comm.size());
+        mxx::all2all(recv_counts.data(), 1, send_counts.data(), this->comm);
+        for (size_t i = 0; i < recv_counts.size(); ++i) {
+          recv_counts[i] *= width;
+          send_counts[i] *= width;
+        }
+        std::vector<V> bucketed(keys.size() * width);
+        mxx::all2allv(local_rows.data(), recv_counts, bucketed.data(), send_counts, this->comm);
+        ::dsc::telemetry_a2a(local_rows.size(), bucketed);
+        BL_BENCH_END(query, "a2a2", bucketed.size());
+
+        BL_BENCH_START(query);
+        // bucketed key and row i2o[i] are query i's.
+        buffer.resize(keys.size());
+        rows.resize(keys.size() * width);
+        for (size_t i = 0; i < keys.size(); ++i) {
+          buffer[i] = keys[i2o[i]];
+          ::std::copy(bucketed.begin() + i2o[i] * width, bucketed.begin() + (i2o[i] + 1) * width,
+                      rows.begin() + i * width);
+        }
+        keys.swap(buffer);
+        BL_BENCH_END(query, "unpermute", rows.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(query, name, this->comm);
+      }
+
+      // the values own heap memory, so they cannot be sent as is.  use presence and counts instead.
+      using Base::find;
+      using Base::find_overlap;
+      using Base::to_vector;
+      using Base::merge;
+
+    public:
+      colored_counting_densehash_map(const mxx::comm& _comm, size_t samples) :
+        Base(_comm), n_samples(samples) {
+        if ((samples == 0) || ((samples - 1) > static_cast<size_t>(::std::numeric_limits<Color>::max())))
+          throw std::invalid_argument("number of samples has to be positive and representable by the color type.");
+      }
+
+      virtual ~colored_counting_densehash_map() {};
+
+      using Base::count;
+      using Base::erase;
+      using Base::unique_size;
+
+      /// number of samples (colors).
+      inline size_t num_samples() const {
+        return n_samples;
+      }
+
+      /// words per row of the presence/absence matrix.
+      inline size_t words_per_row() const {
+        return (n_samples + 63) >> 6;
+      }
+
+      /**
+       * @brief insert (key, sample id) pairs, from any mix of samples.  collective.
+       * @return number of new local keys.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector<::std::pair<Key, Color> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        // even if count is 0, still need to participate in mpi calls.  if (input.size() == 0) return;
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "colored_count_densehash_map:insert", this->comm);
+          return 0;
+        }
+
+        // validate locally, then agree on the result so that all ranks throw, before any other collective.
+        size_t max_color = 0;
+        for (auto const & x : input) max_color = ::std::max(max_color, static_cast<size_t>(x.second));
+        if (this->comm.size() > 1)
+          max_color = ::mxx::allreduce(max_color, [](size_t const & x, size_t const & y) { return ::std::max(x, y); }, this->comm);
+        check_color(max_color);
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        // communication part.  the sample id travels with its key.
+        if (this->comm.size() > 1) {
+          BL_BENCH_START(insert);
+          std::vector<size_t> recv_counts;
+          std::vector<::std::pair<Key, Color> > buffer;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
+          input.swap(buffer);
+          BL_BENCH_END(insert, "dist_data", input.size());
+        }
+
+        BL_BENCH_START(insert);
+        size_t count = this->local_insert(input, pred);
+        BL_BENCH_END(insert, "local_insert", this->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "colored_count_densehash_map:insert", this->comm);
+
+        return count;
+      }
+
+      /**
+       * @brief insert keys from 1 sample.  collective, but each rank can insert a different sample.
+       * @return number of new local keys.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector<Key>& input, Color const & sample, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        BL_BENCH_INIT(insert);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(insert, "colored_count_densehash_map:insert_key", this->comm);
+          return 0;
+        }
+
+        // only the samples are needed on the receiving side, 1 per source rank.
+        // all ranks check all samples, so all throw together.
+        std::vector<Color> samples = ::mxx::allgather(sample, this->comm);
+        check_color(static_cast<size_t>(*(::std::max_element(samples.begin(), samples.end()))));
+
+        BL_BENCH_START(insert);
+        this->transform_input(input);
+        BL_BENCH_END(insert, "transform_input", input.size());
+
+        std::vector<size_t> recv_counts(1, input.size());
+        if (this->comm.size() > 1) {
+          BL_BENCH_START(insert);
+          std::vector<Key> buffer;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
+          input.swap(buffer);
+          BL_BENCH_END(insert, "dist_data", input.size());
+        }
+
+        BL_BENCH_START(insert);
+        size_t before = this->c.size();
+        auto it = input.begin();
+        for (size_t i = 0; i < recv_counts.size(); ++i) {
+          for (auto end = it + recv_counts[i]; it != end; ++it) {
+            if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(*it))
+              local_add(*it, samples[i]);
+          }
+        }
+        if (this->c.size() != before) this->local_changed = true;
+        BL_BENCH_END(insert, "local_insert", this->local_size());
+
+        BL_BENCH_REPORT_MPI_NAMED(insert, "colored_count_densehash_map:insert_key", this->comm);
+
+        return this->c.size() - before;
+      }
+
+      /**
+       * @brief  presence/absence matrix of the query keys.  collective.
+       * @param keys   query keys.  transformed in place, order preserved.
+       * @param rows   output.  words_per_row() words per query key, in query order.  0 for absent keys.
+       */
+      void presence(std::vector<Key>& keys, std::vector<uint64_t> & rows) const {
+        query_rows(keys, words_per_row(), PresenceRow{n_samples}, rows, "colored_count_densehash_map:presence");
+      }
+
+      /**
+       * @brief  count matrix of the query keys.  collective.
+       * @param keys   query keys.  transformed in place, order preserved.
+       * @param rows   output.  num_samples() counts per query key, in query order.  0 for absent keys.
+       */
+      void counts(std::vector<Key>& keys, std::vector<T> & rows) const {
+        query_rows(keys, n_samples, CountRow{n_samples}, rows, "colored_count_densehash_map:counts");
+      }
+
+      /**
+       * @brief  presence/absence matrix of the local keys.  the union over ranks is the full matrix, each key once.  not collective.
+       */
+      void local_presence(std::vector<Key> & keys, std::vector<uint64_t> & rows) const {
+        size_t width = words_per_row();
+        keys.clear();
+        keys.reserve(this->c.size());
+        rows.clear();
+        rows.resize(this->c.size() * width, 0ULL);
+
+        uint64_t * row = rows.data();
+        for (auto it = this->c.begin(); it != this->c.end(); ++it, row += width) {
+          keys.emplace_back((*it).first);
+          (*it).second.to_bits(row, n_samples);
+        }
+      }
+
+      /**
+       * @brief  number of distinct keys shared by each pair of samples.  collective.
+       * @details  entry (i, j) at i * num_samples() + j.  the diagonal is the number of distinct keys in each sample.
+       *           cost per key is quadratic in the number of samples that contain it.
+       */
+      std::vector<size_t> sharing() const {
+        std::vector<size_t> shared(n_samples * n_samples, 0);
+        std::vector<Color> present;
+        present.reserve(n_samples);
+
+        for (auto it = this->c.begin(); it != this->c.end(); ++it) {
+          present.clear();
+          (*it).second.for_each([&present](Color const & c, T const &) { present.push_back(c); }, n_samples);
+
+          for (size_t i = 0; i < present.size(); ++i) {
+            size_t * r = shared.data() + present[i] * n_samples;
+            for (size_t j = 0; j < present.size(); ++j) ++r[present[j]];
+          }
+        }
+
+        if (this->comm.size() > 1)
+          return ::mxx::allreduce(shared, ::std::plus<size_t>(), this->comm);
+        return shared;
+      }
+
+      /// number of local keys stored in the dense form.
+      size_t local_dense_size() const {
+        size_t count = 0;
+        for (auto it = this->c.begin(); it != this->c.end(); ++it) {
+          if ((*it).second.is_dense(n_samples)) ++count;
+        }
+        return count;
+      }
+  };
+
+
 } /* namespace dsc */
 
 
@@ -34,6 +34,7 @@
 #include <mxx/collective.hpp>
 
 #include "utils/benchmark_utils.hpp"
+#include "utils/logging.h"
 
 
 
@@ -197,6 +198,9 @@ namespace dsc
     public:
       virtual ~map_base() {};
 
+      /// communicator that the map is distributed over.
+      const mxx::comm& get_comm() const { return comm; }
+
 
       // ================ data access functions
       virtual void to_vector(std::vector<std::pair<Key, T> > & result) const  = 0;
@@ -254,7 +258,7 @@ namespace dsc
       /// access the current the multiplicity.  only multimap needs to override this.
       virtual float get_multiplicity() const {
         // multimaps would add a collective function to change the multiplicity
-        if (this->comm.rank() == 0) printf("rank %d map_base get_multiplicity called\n", this->comm.rank());
+        if (this->comm.rank() == 0) BL_DEBUGF("rank %d map_base get_multiplicity called\n", this->comm.rank());
 
         return 1.0f;
       }
@@ -22,6 +22,7 @@
  *          data structures.
  *
  *          implementation is sort-based (load balanced).  assumption is that map is built once.
+ *          sorted_map and its subclasses can be appended to via append(), which sorts and merges only the new entries.
  *          distribution is via sort.  local storage is via hash.
  *
  *          for now, input and output via local vectors.
@@ -52,6 +53,7 @@
 #include <iterator>  // advance, distance
 #include <random>
 #include <cstdint>  // for uint8, etc.
+#include <stdexcept>
 
 
 #include <mxx/collective.hpp>
@@ -65,6 +67,7 @@
 #include "containers/distributed_map_base.hpp"
 #include "common/kmer_transform.hpp"
 #include "containers/dsc_container_utils.hpp"
+#include "containers/compressed_multimap.hpp"
 #include "io/incremental_mxx.hpp"
 
 
@@ -526,9 +529,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
 				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				keys.swap(buffer);
 //      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //      				  typename Base::StoreTransformedFunc(),
@@ -584,7 +586,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             auto resp_total = resp_displs[this->comm.size() - 1] + resp_counts[this->comm.size() - 1];
             auto max_send_count = *(::std::max_element(send_counts.begin(), send_counts.end()));
             results.resize(resp_total);   // allocate, not just reserve
-            ::std::vector<::std::pair<Key, T> > local_results(2 * max_send_count);
+            // double buffered send buffer for the results.
+            ::std::vector<::std::pair<Key, T>, ::imxx::buffer_allocator<::std::pair<Key, T> > > local_results(2 * max_send_count);
             size_t local_offset = 0;
             auto local_results_iter = local_results.begin();
 
@@ -740,9 +743,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             // distribute (communication part)
             std::vector<size_t> recv_counts;
             {
-				std::vector<size_t> i2o;
 				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				keys.swap(buffer);
 //      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //      				  typename Base::StoreTransformedFunc(),
@@ -754,7 +756,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             // do for each src proc one at a time.
             BL_BENCH_START(find);
             float multi = this->get_multiplicity();
-            if (this->comm.rank() == 0) printf("rank %d multiplicity %f\n", this->comm.rank(), multi);
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d multiplicity %f\n", this->comm.rank(), multi);
             results.reserve(keys.size() * multi);                   // TODO:  should estimate coverage.
             BL_BENCH_END(find, "reserve", results.capacity());
 
@@ -776,7 +778,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
                     static_cast<double>(req_sofar)) *
                                     static_cast<double>(req_total) * 1.1f);
                 if (new_est > results.capacity()) {
-                  if (this->comm.rank() == 0) printf("rank %d nkeys %lu nresuts %lu est result size %lu original estimate %lu\n", this->comm.rank(), keys.size(), results.size(), new_est, results.capacity());
+                  if (this->comm.rank() == 0) BL_DEBUGF("rank %d nkeys %lu nresuts %lu est result size %lu original estimate %lu\n", this->comm.rank(), keys.size(), results.size(), new_est, results.capacity());
                   results.reserve(new_est);  // if new_est is lower than capacity, nothing happens.
                 }
               }
@@ -792,7 +794,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               start = end;
             }
             BL_BENCH_END(find, "local_find", results.size());
-            if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
 
             // send back using the constructed recv count
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
@@ -845,7 +847,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             		emplace_iter, lf, sorted_input, pred);
             BL_BENCH_END(find, "local_find", results.size());
 
-            if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
 
 
           }
@@ -901,7 +903,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
       /// constructor
       sorted_map_base(const mxx::comm& _comm) : Base(_comm),
-          key_to_rank(_comm.size()), balanced(false), globally_sorted(false), sorted(false) {}
+          key_to_rank(_comm.size()), balanced(false), globally_sorted(false), sorted(false), max_imbalance(1.5) {}
 
       // ===================  sorted map specific virtual functions
       /// ensures container is globally sorted/organized and balanced, and splitters are capatured.  also ensures local sortedness.
@@ -946,12 +948,91 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         const_cast<typename std::remove_cv<typename std::remove_reference<decltype(*this)>::type>::type *>(this)->local_sort();
       }
 
+      // ==================== incremental append.  see sorted_map::append and sorted_multimap::append
+
+      /// imbalance threshold for append().
+      double max_imbalance;
+
+      /**
+       * @brief send sorted new elements to their ranks by the current splitters, and merge the received runs.  collective.
+       * @details since the splitters are sorted, the input goes to each rank as 1 contiguous run.  the p received runs
+       *          are merged pairwise, stably, so runs from lower ranks come first.
+       */
+      void append_distribute(::std::vector<value_type> & input) {
+        if (this->comm.size() == 1) return;
+
+        // contiguous run per target rank.
+        int p = this->comm.size();
+        ::std::vector<size_t> send_counts(p, 0);
+        auto start = input.begin();
+        for (int i = 0; i < p; ++i) {
+          auto end = ::std::partition_point(start, input.end(), [this, i](value_type const & x) {
+            return this->key_to_rank(x) <= i;
+          });
+          send_counts[i] = ::std::distance(start, end);
+          start = end;
+        }
+
+        ::std::vector<size_t> recv_counts(p);
+        mxx::all2all(send_counts.data(), 1, recv_counts.data(), this->comm);
+        ::std::vector<value_type> buffer(::std::accumulate(recv_counts.begin(), recv_counts.end(), static_cast<size_t>(0)));
+        mxx::all2allv(input.data(), send_counts, buffer.data(), recv_counts, this->comm);
+        input.swap(buffer);
+
+        // start of each sorted run.
+        ::std::vector<size_t> offsets(1, 0);
+        for (int i = 0; i < p; ++i) offsets.emplace_back(offsets.back() + recv_counts[i]);
+
+        // k-way merge, pairwise.
+        typename Base::StoreTransformedFunc store_comp;
+        for (size_t step = 1; step < static_cast<size_t>(p); step <<= 1) {
+          for (size_t i = 0; i + step < static_cast<size_t>(p); i += 2 * step) {
+            size_t last = ::std::min(i + 2 * step, static_cast<size_t>(p));
+            ::std::inplace_merge(input.begin() + offsets[i], input.begin() + offsets[i + step],
+                                 input.begin() + offsets[last], store_comp);
+          }
+        }
+      }
+
+      /// merge sorted new elements into the local container.  stable, so existing elements come first.
+      void append_merge(::std::vector<value_type> & input) {
+        this->local_sort();
+        size_t before = c.size();
+        this->local_reserve(before + input.size());
+        ::std::move(input.begin(), input.end(), ::std::back_inserter(c));
+        ::std::inplace_merge(c.begin(), c.begin() + before, c.end(), typename Base::StoreTransformedFunc());
+        this->sorted = true;
+      }
+
+      /// rebalance if the max local size exceeds max_imbalance times the mean.  splitters remain valid otherwise.  collective.
+      /// @return  true if redistributed.
+      bool append_balance() {
+        if (this->comm.size() == 1) return false;
+
+        size_t mx = ::mxx::allreduce(c.size(), [](size_t const & x, size_t const & y) { return ::std::max(x, y); }, this->comm);
+        size_t total = ::mxx::allreduce(c.size(), ::std::plus<size_t>(), this->comm);
+        if (static_cast<double>(mx) * this->comm.size() <= max_imbalance * static_cast<double>(total)) return false;
+
+        this->set_balanced(false);
+        this->redistribute();
+        return true;
+      }
+
 
 
     public:
 
       virtual ~sorted_map_base() {};
 
+      /// max local size / mean local size above which append() rebalances.
+      void set_max_imbalance(double x) {
+        if (x < 1.0) throw ::std::invalid_argument("max imbalance must be at least 1.");
+        max_imbalance = x;
+      }
+      double get_max_imbalance() const {
+        return max_imbalance;
+      }
+
       /// returns the local storage.  please use sparingly.
       local_container_type& get_local_container() { return c; }
 
@@ -1049,9 +1130,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           // distribute (communication part)
           std::vector<size_t> recv_counts;
           {
-				std::vector<size_t> i2o;
 				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				keys.swap(buffer);
 //      		  ::dsc::distribute_sorted_unique(keys, this->key_to_rank, sorted_input, this->comm,
 //      				  typename Base::StoreTransformedFunc(),
@@ -1265,9 +1345,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 //            BLISS_UNUSED(recv_counts);
           std::vector<size_t> recv_counts;
           {
-				std::vector<size_t> i2o;
 				std::vector<Key > buffer;
-				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				//::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
 				keys.swap(buffer);
           }
@@ -1783,7 +1862,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 
 			BL_BENCH_END(rehash, "splitters1", this->key_to_rank.map.size());
 
-			if (this->comm.rank() == 0) printf("split1\n");  fflush(stdout);
+			if (this->comm.rank() == 0) BL_DEBUGF("split1\n");
 
 
 
@@ -1799,7 +1878,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
 //            		::dsc::distribute(this->c, this->key_to_rank, this->sorted, this->comm));
         	BL_BENCH_END(rehash, "dist", this->c.size());
 
-        	if (this->comm.rank() == 0) printf("dist\n");  fflush(stdout);
+        	if (this->comm.rank() == 0) BL_DEBUGF("dist\n");
 
 
         	// 11. local sort and reduce
@@ -1808,14 +1887,14 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         	this->local_reduction(this->c, this->sorted);
         	BL_BENCH_END(rehash, "reduce", this->c.size());
 
-        	if (this->comm.rank() == 0) printf("reduce\n");  fflush(stdout);
+        	if (this->comm.rank() == 0) BL_DEBUGF("reduce\n");
 
         	// 12. stable block decomposition
             BL_BENCH_START(rehash);
             ::mxx::stable_distribute(this->c, this->comm).swap(this->c);
             BL_BENCH_END(rehash, "block decomp", this->c.size());
 
-        	if (this->comm.rank() == 0) printf("block\n"); fflush(stdout);
+        	if (this->comm.rank() == 0) BL_DEBUGF("block\n");
 
         	// 13. record the splitters. first entry of each, except the first bucket
             BL_BENCH_START(rehash);
@@ -1829,7 +1908,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
             ::mxx::allgatherv(this->key_to_rank.map, this->comm).swap(this->key_to_rank.map);
             BL_BENCH_END(rehash, "final_splitter", this->key_to_rank.map.size());
 
-        	if (this->comm.rank() == 0) printf("splitters\n"); fflush(stdout);
+        	if (this->comm.rank() == 0) BL_DEBUGF("splitters\n");
 
 
         } else {
@@ -2112,7 +2191,7 @@ using SortedMapParams = ::dsc::DistributedMapParams<
               if (dist > 1) {  // if > 1, the value crossed boundary and we have extra entries to remove.
 
                 size_t offset = ::std::distance(boundary_values.begin(), range.second);
-                if (boundary_ids[offset - 1] < this->comm.rank()) {  // not an owner, so need to remove this element
+                if (boundary_ids[offset - 1] != this->comm.rank()) {  // not an owner, so need to remove this element
                   // now remove this element.  there is only 1, since it's unique.  also c is at least 1 in size before.
                   this->c.pop_back();
 
@@ -2245,9 +2324,8 @@ using SortedMapParams = ::dsc::DistributedMapParams<
           BL_BENCH_START(update);
     //      ::dsc::distribute_bucketed(input, recv_counts, this->comm).swap(input);
             std::vector<size_t> recv_counts;
-            std::vector<size_t> i2o;
             std::vector<::std::pair<Key, V> > buffer;
-            ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+            ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
             input.swap(buffer);
 
           BL_BENCH_END(update, "distribute", input.size());
@@ -2294,6 +2372,78 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         return count;
       }
 
+
+      /**
+       * @brief incrementally insert new elements into a distributed map.  collective.
+       * @details  if the map is globally sorted (e.g. after a find, count, or Index::insert), only the new elements are
+       *           sorted and reduced.  since the splitters are sorted, the sorted input goes to each rank as 1 contiguous
+       *           run.  the p received runs are merged pairwise, then merged into the local container, and reduced.
+       *           splitters are kept, and the map is rebalanced only when the max local size exceeds max_imbalance times
+       *           the mean.  existing elements come first in the reduction, as in insert followed by redistribute.
+       *
+       *           a map that is not globally sorted is appended to by insert then redistribute.
+       * @return  number of elements inserted locally, before reduction.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t append(::std::vector<::std::pair<Key, T> > &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        BL_BENCH_INIT(append);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(append, "sorted_map:append", this->comm);
+          return 0;
+        }
+
+        if (!(this->is_globally_sorted())) {
+          BL_BENCH_START(append);
+          size_t count = this->insert(input, sorted_input, pred);
+          BL_BENCH_END(append, "insert", count);
+
+          BL_BENCH_COLLECTIVE_START(append, "redistribute", this->comm);
+          this->redistribute();
+          BL_BENCH_END(append, "redistribute", this->c.size());
+
+          BL_BENCH_REPORT_MPI_NAMED(append, "sorted_map:append", this->comm);
+          return count;
+        }
+
+        BL_BENCH_START(append);
+        this->transform_input(input);
+        if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+          input.erase(::std::remove_if(input.begin(), input.end(), [&pred](value_type const & x) {
+            return !pred(x);
+          }), input.end());
+        }
+        size_t count = input.size();
+        BL_BENCH_END(append, "transform_input", input.size());
+
+        // sort and reduce only the new elements.
+        BL_BENCH_START(append);
+        this->local_reduction(input, sorted_input);
+        BL_BENCH_END(append, "delta_reduc", input.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(append, "a2a_merge", this->comm);
+          this->append_distribute(input);
+          BL_BENCH_END(append, "a2a_merge", input.size());
+        }
+
+        // merge into the local container, existing elements first, and reduce.
+        BL_BENCH_START(append);
+        this->append_merge(input);
+        this->local_reduction(this->c, true);
+        BL_BENCH_END(append, "merge", this->c.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(append, "balance", this->comm);
+          this->append_balance();
+          BL_BENCH_END(append, "balance", this->c.size());
+        }
+
+        BL_BENCH_REPORT_MPI_NAMED(append, "sorted_map:append", this->comm);
+
+        return count;
+      }
+
   };
 
 
@@ -2659,8 +2809,377 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         return count;
       }
 
+      /**
+       * @brief incrementally insert new elements into a distributed multimap.  collective.
+       * @details  same as sorted_map::append, but without reduction:  if the multimap is globally sorted, only the new
+       *           elements are sorted, sent to their ranks by the current splitters as contiguous runs, k-way merged, then
+       *           merged into the local container after the existing entries.  the multimap is rebalanced only when the
+       *           max local size exceeds max_imbalance times the mean.
+       *
+       *           a multimap that is not globally sorted is appended to by insert then redistribute.
+       * @return  number of elements inserted locally.
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t append(::std::vector<::std::pair<Key, T> > &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        BL_BENCH_INIT(append);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(append, "sorted_multimap:append", this->comm);
+          return 0;
+        }
+
+        if (!(this->is_globally_sorted())) {
+          BL_BENCH_START(append);
+          size_t count = this->insert(input, sorted_input, pred);
+          BL_BENCH_END(append, "insert", count);
+
+          BL_BENCH_COLLECTIVE_START(append, "redistribute", this->comm);
+          this->redistribute();
+          BL_BENCH_END(append, "redistribute", this->c.size());
+
+          BL_BENCH_REPORT_MPI_NAMED(append, "sorted_multimap:append", this->comm);
+          return count;
+        }
+
+        BL_BENCH_START(append);
+        this->transform_input(input);
+        if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+          input.erase(::std::remove_if(input.begin(), input.end(), [&pred](value_type const & x) {
+            return !pred(x);
+          }), input.end());
+        }
+        size_t count = input.size();
+        BL_BENCH_END(append, "transform_input", input.size());
+
+        // sort only the new elements.
+        BL_BENCH_START(append);
+        ::fsc::sort(input, sorted_input, typename Base::Base::StoreTransformedFunc());
+        BL_BENCH_END(append, "delta_sort", input.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_COLLECTIVE_START(append, "a2a_merge", this->comm);
+          this->append_distribute(input);
+          BL_BENCH_END(append, "a2a_merge", input.size());
+        }
+
+        BL_BENCH_START(append);
+        this->append_merge(input);
+        BL_BENCH_END(append, "merge", this->c.size());
+
+        // redistribute recounts the unique keys.  otherwise the splitters are kept, so recount here.
+        BL_BENCH_COLLECTIVE_START(append, "balance", this->comm);
+        if (!(this->append_balance())) local_unique_count = sorted_multimap::local_unique_size();
+        BL_BENCH_END(append, "balance", this->c.size());
+
+        BL_BENCH_REPORT_MPI_NAMED(append, "sorted_multimap:append", this->comm);
+
+        return count;
+      }
+
+  };
+
+
+  /**
+   * @brief  distributed sorted multimap that can be compressed once built, for read-mostly position indices.
+   * @details compress() globally sorts the entries, then replaces the local pair vector with a ::fsc::compressed_multimap
+   *          (sorted unique keys, delta and varint encoded value lists) and releases the vector.
+   *          find and count are then answered from the compressed form, with queries routed by the splitters.
+   *          insert and erase decompress first, so compress() should be called again after modifications.
+   *
+   *          values must be supported by ::fsc::posting_codec.  values of a key are returned in ascending order.
+   *          cbegin/cend and get_local_container see an empty vector while compressed.
+   */
+  template<typename Key, typename T,
+  	  template <typename> class MapParams,
+  class Alloc = ::std::allocator< ::std::pair<Key, T> >
+  >
+  class compressed_sorted_multimap : public sorted_multimap<Key, T, MapParams, Alloc> {
+    protected:
+      using Base = sorted_multimap<Key, T, MapParams, Alloc>;
+      using MapBase = typename Base::Base::Base;
+
+    public:
+      using local_container_type = typename Base::local_container_type;
+      using compressed_local_container_type = ::fsc::compressed_multimap<Key, T, typename MapBase::StoreTransformedFunc>;
+
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<Key, T>;
+      using size_type             = typename local_container_type::size_type;
+
+    protected:
+      compressed_local_container_type cc;
+
+      /// collective state: all ranks compress and decompress together.
+      bool compressed;
+
+      /// restore the pair vector so that the base class can modify it.  order is unchanged, so the distribution flags stay valid.
+      void decompress() {
+        if (!compressed) return;
+
+        ::std::vector<::std::pair<Key, T> > tmp;
+        cc.to_vector(tmp);
+        this->c.assign(tmp.begin(), tmp.end());
+        cc.clear();
+        compressed = false;
+      }
+
+      using Base::redistribute;
+
+      /// the compressed form is already globally sorted, and the splitters are kept from compress().
+      virtual void redistribute() {
+        if (!compressed) Base::redistribute();
+      }
+
+      /// find the entries of one key in the compressed form.  scratch holds the decoded entries when filtering.
+      template <typename OutputIter, typename Predicate>
+      size_t local_find(Key const & k, OutputIter & output, ::std::vector<::std::pair<Key, T> > & scratch,
+                        Predicate const & pred) const {
+        if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return cc.find(k, output);
+
+        scratch.clear();
+        cc.find(k, ::std::back_inserter(scratch));
+        if (!pred(scratch.begin(), scratch.end())) return 0;
+
+        size_t count = 0;
+        for (auto const & x : scratch) {
+          if (pred(x)) {
+            *output = x;
+            ++output;
+            ++count;
+          }
+        }
+        return count;
+      }
+
+      /// count the entries of one key in the compressed form.  only the count is decoded if unfiltered.
+      template <typename Predicate>
+      size_t local_count(Key const & k, ::std::vector<::std::pair<Key, T> > & scratch,
+                         Predicate const & pred) const {
+        if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value)
+          return cc.count(k);
+
+        scratch.clear();
+        cc.find(k, ::std::back_inserter(scratch));
+        if (!pred(scratch.begin(), scratch.end())) return 0;
+        return ::std::count_if(scratch.begin(), scratch.end(), pred);
+      }
+
+      /**
+       * @brief answer queries from the compressed form.  queries are made unique, sent to the owner by the splitters,
+       *        and the results are returned to the querying ranks.
+       * @param op    called with (key, output iterator), appends the results for one key.
+       */
+      template <typename R, typename LocalOp>
+      ::std::vector<R> query_compressed(::std::vector<Key>& keys, bool sorted_input, LocalOp const & op) const {
+        ::std::vector<R> results;
+
+        // still participate in the collectives if empty.
+        if (::dsc::empty(keys, this->comm)) return results;
+
+        this->transform_input(keys);
+        ::fsc::sorted_unique(keys, sorted_input,
+                             typename MapBase::StoreTransformedFunc(),
+                             typename MapBase::StoreTransformedEqual());
+
+        ::fsc::back_emplace_iterator<::std::vector<R> > emplace_iter(results);
+
+        if (this->comm.size() > 1) {
+          std::vector<size_t> recv_counts;
+          {
+            std::vector<Key > buffer;
+            ::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
+            keys.swap(buffer);
+          }
+
+          // results for each source rank, in rank order.
+          std::vector<size_t> send_counts(this->comm.size(), 0);
+          auto start = keys.begin();
+          for (int i = 0; i < this->comm.size(); ++i) {
+            auto end = start + recv_counts[i];
+            size_t before = results.size();
+            for (auto it = start; it != end; ++it) op(*it, emplace_iter);
+            send_counts[i] = results.size() - before;
+            start = end;
+          }
+
+          mxx::all2allv(results, send_counts, this->comm).swap(results);
+        } else {
+          for (auto it = keys.begin(); it != keys.end(); ++it) op(*it, emplace_iter);
+        }
+        return results;
+      }
+
+    public:
+
+      compressed_sorted_multimap(const mxx::comm& _comm) : Base(_comm), compressed(false) {}
 
+      virtual ~compressed_sorted_multimap() {}
+
+      /**
+       * @brief globally sort and balance the entries, then compress the local entries and release the pair vector.  collective.
+       */
+      void compress() {
+        if (compressed) return;
+
+        if ((this->comm.size() > 1) && !this->empty()) this->redistribute();
+        else this->local_sort();
+
+        cc.build_sorted(this->c.cbegin(), this->c.cend());
+        local_container_type().swap(this->c);
+        compressed = true;
+      }
+
+      bool is_compressed() const {
+        return compressed;
+      }
 
+      /// bytes used by the local compressed form.  0 if not compressed.
+      size_t local_compressed_bytes() const {
+        return compressed ? cc.memory_usage() : 0;
+      }
+
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find(::std::vector<Key>& keys, bool sorted_input = false,
+          Predicate const& pred = Predicate()) const {
+        if (!compressed) return Base::find(keys, sorted_input, pred);
+
+        ::std::vector<::std::pair<Key, T> > scratch;
+        return this->template query_compressed<::std::pair<Key, T> >(keys, sorted_input,
+            [this, &scratch, &pred](Key const & k, ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > & out) {
+          this->local_find(k, out, scratch, pred);
+        });
+      }
+
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, T> > find(Predicate const& pred = Predicate()) const {
+        if (!compressed) return Base::find(pred);
+
+        ::std::vector<::std::pair<Key, T> > results;
+        if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value) {
+          cc.to_vector(results);
+        } else {
+          ::std::vector<Key> keys;
+          cc.get_keys(keys);
+          ::std::vector<::std::pair<Key, T> > scratch;
+          ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > emplace_iter(results);
+          for (auto const & k : keys) this->local_find(k, emplace_iter, scratch, pred);
+        }
+        if (this->comm.size() > 1) this->comm.barrier();
+        return results;
+      }
+
+      template <bool remove_duplicate = true, typename Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(::std::vector<Key>& keys, bool sorted_input = false,
+          Predicate const & pred = Predicate()) const {
+        if (!compressed) return Base::template count<remove_duplicate>(keys, sorted_input, pred);
+
+        ::std::vector<::std::pair<Key, T> > scratch;
+        return this->template query_compressed<::std::pair<Key, size_type> >(keys, sorted_input,
+            [this, &scratch, &pred](Key const & k, ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, size_type> > > & out) {
+          *out = ::std::make_pair(k, this->local_count(k, scratch, pred));
+          ++out;
+        });
+      }
+
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      ::std::vector<::std::pair<Key, size_type> > count(Predicate const & pred = Predicate()) const {
+        if (!compressed) return Base::count(pred);
+
+        ::std::vector<::std::pair<Key, size_type> > results;
+        ::std::vector<Key> keys;
+        cc.get_keys(keys);
+        results.reserve(keys.size());
+        ::std::vector<::std::pair<Key, T> > scratch;
+        for (auto const & k : keys) results.emplace_back(k, this->local_count(k, scratch, pred));
+
+        if (this->comm.size() > 1) this->comm.barrier();
+        return results;
+      }
+
+      /// insert decompresses first.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(::std::vector<::std::pair<Key, T> > &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        this->decompress();
+        return Base::insert(input, sorted_input, pred);
+      }
+
+      /// append decompresses first.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t append(::std::vector<::std::pair<Key, T> > &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        this->decompress();
+        return Base::append(input, sorted_input, pred);
+      }
+
+      /// erase decompresses first.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const & pred = Predicate() ) {
+        this->decompress();
+        return Base::erase(keys, sorted_input, pred);
+      }
+
+      template <typename Predicate>
+      size_t erase(Predicate const & pred = Predicate()) {
+        this->decompress();
+        return Base::erase(pred);
+      }
+
+      virtual size_t unique_size() const {
+        if (!compressed) return Base::unique_size();
+
+        if (this->comm.size() == 1)
+          return cc.unique_size();
+        else
+          return ::mxx::allreduce(cc.unique_size(), this->comm);
+      }
+
+      virtual size_t local_unique_size() const {
+        return compressed ? cc.unique_size() : Base::local_unique_size();
+      }
+
+      virtual bool local_empty() const {
+        return compressed ? cc.empty() : Base::local_empty();
+      }
+
+      virtual size_t local_size() const {
+        return compressed ? cc.size() : Base::local_size();
+      }
+
+      virtual std::vector<std::pair<Key, T> > to_vector() const {
+        std::vector<std::pair<Key, T> > result;
+        this->to_vector(result);
+        return result;
+      }
+
+      virtual void to_vector(std::vector<std::pair<Key, T> > & result) const {
+        if (compressed) cc.to_vector(result);
+        else Base::to_vector(result);
+      }
+
+      virtual std::vector<Key> keys() const {
+        std::vector<Key> result;
+        this->keys(result);
+        return result;
+      }
+
+      virtual void keys(std::vector<Key> & result) const {
+        if (compressed) cc.get_keys(result);
+        else Base::keys(result);
+      }
+
+    protected:
+      virtual void local_reset() {
+        cc = compressed_local_container_type();
+        compressed = false;
+        Base::local_reset();
+      }
+
+      virtual void local_clear() {
+        cc.clear();
+        compressed = false;
+        Base::local_clear();
+      }
   };
 
 
@@ -2906,6 +3425,23 @@ using SortedMapParams = ::dsc::DistributedMapParams<
         return count;
       }
 
+      using Base::append;
+
+      /**
+       * @brief incrementally count new keys into the distributed map.  collective.  see sorted_map::append
+       */
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t append(::std::vector<Key> &input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        ::std::vector<::std::pair<Key, T> > temp;
+        temp.reserve(input.size());
+        ::fsc::back_emplace_iterator<::std::vector<::std::pair<Key, T> > > temp_emplacer(temp);
+        ::std::transform(input.begin(), input.end(), temp_emplacer, [](Key const & x) {
+          return ::std::make_pair(x, T(1));
+        });
+
+        return Base::append(temp, sorted_input, pred);
+      }
+
 
 
   };
@@ -68,6 +68,7 @@
 #include "common/kmer_transform.hpp"
 
 #include "containers/dsc_container_utils.hpp"
+#include "containers/unordered_vecmap.hpp"
 
 #include "io/incremental_mxx.hpp"
 
@@ -392,9 +393,8 @@ namespace dsc  // distributed std container
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-  				std::vector<size_t> i2o;
   				std::vector<Key > buffer;
-  				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+  				::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
   				keys.swap(buffer);
   	//            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
   	//            				typename Base::StoreTransformedFunc(),
@@ -446,7 +446,8 @@ namespace dsc  // distributed std container
             auto resp_total = resp_displs[this->comm.size() - 1] + resp_counts[this->comm.size() - 1];
             auto max_send_count = *(::std::max_element(send_counts.begin(), send_counts.end()));
             results.resize(resp_total);   // allocate, not just reserve
-            ::std::vector<::std::pair<Key, T> > local_results(2 * max_send_count);
+            // double buffered send buffer for the results.
+            ::std::vector<::std::pair<Key, T>, ::imxx::buffer_allocator<::std::pair<Key, T> > > local_results(2 * max_send_count);
             size_t local_offset = 0;
             auto local_results_iter = local_results.begin();
 
@@ -590,9 +591,8 @@ namespace dsc  // distributed std container
                 // distribute (communication part)
                 std::vector<size_t> recv_counts;
                 {
-  				  std::vector<size_t> i2o;
   				  std::vector<Key > buffer;
-  				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+  				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
   				  keys.swap(buffer);
   	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
   	  //            				typename Base::StoreTransformedFunc(),
@@ -626,7 +626,7 @@ namespace dsc  // distributed std container
                     static_cast<double>(req_sofar)) *
                                     static_cast<double>(req_total) * 1.1f);
                 if (new_est > results.capacity()) {
-                  if (this->comm.rank() == 0) printf("rank %d nkeys %lu nresuts %lu est result size %lu original estimate %lu\n", this->comm.rank(), keys.size(), results.size(), new_est, results.capacity());
+                  if (this->comm.rank() == 0) BL_DEBUGF("rank %d nkeys %lu nresuts %lu est result size %lu original estimate %lu\n", this->comm.rank(), keys.size(), results.size(), new_est, results.capacity());
                   results.reserve(new_est);  // if new_est is lower than capacity, nothing happens.
                 }
               }
@@ -639,7 +639,7 @@ namespace dsc  // distributed std container
               start = end;
             }
             BL_BENCH_END(find, "local_find", results.size());
-            if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
 
 
             BL_BENCH_COLLECTIVE_START(find, "a2a2", this->comm);
@@ -676,7 +676,7 @@ namespace dsc  // distributed std container
             QueryProcessor::process(c, keys.begin() + estimating, keys.end(), emplace_iter, find_element, sorted_input, pred);
             BL_BENCH_END(find, "local_find", results.size());
 
-            if (this->comm.rank() == 0) printf("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
+            if (this->comm.rank() == 0) BL_DEBUGF("rank %d result size %lu capacity %lu\n", this->comm.rank(), results.size(), results.capacity());
 
           }
 
@@ -738,9 +738,8 @@ namespace dsc  // distributed std container
   //            BLISS_UNUSED(recv_counts);
               std::vector<size_t> recv_counts;
               {
-  				std::vector<size_t> i2o;
   				std::vector<Key > buffer;
-  				::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+  				::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
   				//::imxx::destructive_distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
   				keys.swap(buffer);
               }
@@ -917,9 +916,8 @@ namespace dsc  // distributed std container
               // distribute (communication part)
               std::vector<size_t> recv_counts;
               {
-				  std::vector<size_t> i2o;
 				  std::vector<Key > buffer;
-				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+				  ::imxx::distribute(keys, this->key_to_rank, recv_counts, buffer, this->comm);
 				  keys.swap(buffer);
 	  //            ::dsc::distribute_unique(keys, this->key_to_rank, sorted_input, this->comm,
 	  //            				typename Base::StoreTransformedFunc(),
@@ -1204,9 +1202,8 @@ namespace dsc  // distributed std container
 //          auto recv_counts(::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm));
 //          BLISS_UNUSED(recv_counts);
           std::vector<size_t> recv_counts;
-			  std::vector<size_t> i2o;
 			  std::vector<::std::pair<Key, T> > buffer;
-			  ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+			  ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
 			  input.swap(buffer);
           BL_BENCH_END(insert, "dist_data", input.size());
         }
@@ -1258,14 +1255,16 @@ namespace dsc  // distributed std container
    * @tparam Hash   hash function for local and distribution.  requires a template arugment (Key), and a bool (prefix, chooses the MSBs of hash instead of LSBs)
    * @tparam Equal   default to ::std::equal_to<Key>   equal function for the local storage.
    * @tparam Alloc  default to ::std::allocator< ::std::pair<const Key, T> >    allocator for local storage.
+   * @tparam LocalContainer  default to ::std::unordered_multimap.  see unordered_multimap_csr for ::fsc::unordered_csr_multimap.
    */
   template<typename Key, typename T,
   template <typename> class MapParams,
-  class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+  class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+  template <typename, typename, typename, typename, typename...> class LocalContainer = ::std::unordered_multimap
   >
-  class unordered_multimap : public unordered_map_base<Key, T, ::std::unordered_multimap, MapParams, Alloc> {
+  class unordered_multimap : public unordered_map_base<Key, T, LocalContainer, MapParams, Alloc> {
     protected:
-      using Base = unordered_map_base<Key, T, ::std::unordered_multimap, MapParams, Alloc>;
+      using Base = unordered_map_base<Key, T, LocalContainer, MapParams, Alloc>;
 
 
     public:
@@ -1371,7 +1370,7 @@ namespace dsc  // distributed std container
       /// access the current the multiplicity.  only multimap needs to override this.
       virtual float get_multiplicity() const {
         // multimaps would add a collective function to change the multiplicity
-        if (this->comm.rank() == 0) printf("rank %d unordered_multimap get_multiplicity called\n", this->comm.rank());
+        if (this->comm.rank() == 0) BL_DEBUGF("rank %d unordered_multimap get_multiplicity called\n", this->comm.rank());
 
 
         // one approach is to add up the number of repeats for the key of each entry, then divide by total count.
@@ -1489,9 +1488,8 @@ namespace dsc  // distributed std container
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
 
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
           std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
           input.swap(buffer);
 
           //auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
@@ -1534,6 +1532,75 @@ namespace dsc  // distributed std container
 
 
 
+  /**
+   * @brief  distributed unordered multimap with ::fsc::unordered_csr_multimap as the local container.
+   * @details  the values of each key are stored contiguously, in 1 array per rank, instead of 1 node per entry.
+   *           suited for position indices, which are built in bulk and then queried.
+   *           the local container is compacted at the end of each insert, so queries see all inserted entries.
+   *           the storage transform of MapParams has to be identity, since the local container orders keys by operator<.
+   *           canonical kmers are fine:  their input transform canonicalizes the keys before they are stored or queried.
+   *           bimolecule kmers are not, since both orientations are stored.
+   */
+  template<typename Key, typename T,
+  template <typename> class MapParams,
+  class Alloc = ::std::allocator< ::std::pair<const Key, T> >
+  >
+  class unordered_multimap_csr : public unordered_multimap<Key, T, MapParams, Alloc, ::fsc::unordered_csr_multimap> {
+    protected:
+      using Base = unordered_multimap<Key, T, MapParams, Alloc, ::fsc::unordered_csr_multimap>;
+
+      static_assert(::std::is_same<typename Base::template StoreTransform<Key>, ::bliss::transform::identity<Key> >::value,
+                    "unordered_multimap_csr requires the identity storage transform.");
+
+      /// the csr container erases by key, not by iterator.  the predicate is still applied to (key, value) pairs.
+      struct LocalErase {
+          template<class DB, typename Query, class OutputIter>
+          size_t operator()(DB &db, Query const &v, OutputIter &) {
+              return db.erase(v);
+          }
+          template<class DB, typename Query, class OutputIter, class Predicate = ::bliss::filter::TruePredicate>
+          size_t operator()(DB &db, Query const &v, OutputIter &,
+                            Predicate const& pred) {
+              auto range = (const_cast<DB const &>(db)).equal_range(v);
+              if (!pred(range.first, range.second)) return 0;
+              return db.erase(v, [&v, &pred](T const & t) {
+                return pred(typename DB::value_type(v, t));
+              });
+          }
+      } csr_erase_element;
+
+    public:
+      unordered_multimap_csr(const mxx::comm& _comm) : Base(_comm) {}
+
+      virtual ~unordered_multimap_csr() {}
+
+      /**
+       * @brief insert new elements in the distributed unordered_multimap, then compact the local container.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector<::std::pair<Key, T> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+        size_t count = Base::insert(input, sorted_input, pred);
+        this->c.compact();
+        return count;
+      }
+
+      /// erase elements with the specified keys in the distributed unordered_multimap.
+      template <class Predicate = ::bliss::filter::TruePredicate>
+      size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate() ) {
+          return Base::erase(csr_erase_element, keys, sorted_input, pred);
+      }
+      template <typename Predicate>
+      size_t erase(Predicate const & pred = Predicate()) {
+        return Base::erase(csr_erase_element, pred);
+      }
+
+      /// get the size of unique keys in the current local container.
+      virtual size_t local_unique_size() const {
+        return this->c.unique_size();
+      }
+  };
+
+
   /**
    * @brief  distributed unordered reduction map following std unordered map's interface.  Insertion applies the binary reduction operator between the existing and inserted element (in that order).
    * @details   This class is modeled after the std::unordered_map, but allows a binary reduction operator to be used during insertion.
@@ -1715,9 +1782,8 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
           std::vector<::std::pair<Key, T> > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
           input.swap(buffer);
 
 //          auto recv_counts = ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
@@ -1845,9 +1911,8 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // first remove duplicates.  sort, then get unique, finally remove the rest.  may not be needed
           std::vector<size_t> recv_counts;
-          std::vector<size_t> i2o;
           std::vector< Key > buffer;
-          ::imxx::distribute(input, this->key_to_rank, recv_counts, i2o, buffer, this->comm);
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
           input.swap(buffer);
 
           BL_BENCH_END(insert, "dist_data", input.size());
@@ -1862,9 +1927,7 @@ namespace dsc  // distributed std container
           BL_BENCH_START(insert);
           // preallocate.  easy way out - estimate to be 1/2 of input.  then at the end, resize if significantly less.
           //this->c.resize(input.size() / 2);
-          if (this->comm.rank() == 0)
-          std::cout << "rank " << this->comm.rank() <<
-            " BEFORE input=" << input.size() << " size=" << this->local_size() << " buckets=" << this->c.bucket_count() << std::endl;
+          if (this->comm.rank() == 0) BL_DEBUGF("rank %d BEFORE input=%lu size=%lu buckets=%lu\n", this->comm.rank(), input.size(), this->local_size(), this->c.bucket_count());
 
           // then insert all the rest,
           auto local_start = ::bliss::iterator::make_transform_iterator(input.begin(), trans);
@@ -33,6 +33,7 @@
 #include "containers/fsc_container_utils.hpp"
 
 #include "utils/benchmark_utils.hpp"
+#include "utils/telemetry.hpp"
 
 #include <mxx/distribution.hpp>
 #include <mxx/samplesort.hpp>
@@ -53,6 +54,13 @@ namespace dsc {
 	}
 
 
+  /// account an all2allv in telemetry.  sent is in elements, received is the output of the all2allv.
+  template <typename V>
+  inline void telemetry_a2a(size_t sent, ::std::vector<V> const & received) {
+    ::plog::Telemetry::get().add_bytes(sent * sizeof(V), received.size() * sizeof(V));
+  }
+
+
   // =============== convenience functions for distribution of vector via all to all and a rank mapping function
 	// TODO: make this cleaner...
 
@@ -463,7 +471,9 @@ namespace dsc {
 		  ::std::vector<size_t> temp(send_counts);
 		  mxx::all2all(send_counts, _comm).swap(send_counts);
 
-	      return mxx::all2allv(vals, temp, _comm);
+	      ::std::vector<V> result = mxx::all2allv(vals, temp, _comm);
+	      telemetry_a2a(vals.size(), result);
+	      return result;
 	  }
 
 
@@ -488,7 +498,9 @@ namespace dsc {
 
       // distribute (communication part)
       BL_BENCH_COLLECTIVE_START(distribute, "a2a", _comm);
+      size_t sent = vals.size();
       mxx::all2allv(vals, send_counts, _comm).swap(vals);
+      telemetry_a2a(sent, vals);
       BL_BENCH_END(distribute, "a2a", vals.size());
 
       BL_BENCH_START(distribute);
@@ -528,7 +540,9 @@ namespace dsc {
 
         // distribute (communication part)
         BL_BENCH_COLLECTIVE_START(distribute, "a2a", _comm);
+        size_t sent = vals.size();
         mxx::all2allv(vals, send_counts, _comm).swap(vals);
+        telemetry_a2a(sent, vals);
         BL_BENCH_END(distribute, "a2a", vals.size());
 
         BL_BENCH_START(distribute);
@@ -571,7 +585,9 @@ namespace dsc {
 
         // distribute (communication part)
         BL_BENCH_COLLECTIVE_START(distribute, "a2a", _comm);
+        size_t sent = vals.size();
         mxx::all2allv(vals, send_counts, _comm).swap(vals);
+        telemetry_a2a(sent, vals);
         BL_BENCH_END(distribute, "a2a", vals.size());
 
         BL_BENCH_START(distribute);
@@ -610,7 +626,9 @@ namespace dsc {
 
         // distribute (communication part)
         BL_BENCH_COLLECTIVE_START(distribute, "a2a", _comm);
+        size_t sent = vals.size();
         mxx::all2allv(vals, send_counts, _comm).swap(vals);
+        telemetry_a2a(sent, vals);
         BL_BENCH_END(distribute, "a2a", vals.size());
 
         BL_BENCH_START(distribute);
@@ -669,7 +687,9 @@ namespace dsc {
 
         // distribute (communication part)
         BL_BENCH_COLLECTIVE_START(distribute, "a2a", _comm);
+        size_t sent = vals.size();
         mxx::all2allv(vals, send_counts, _comm).swap(vals);
+        telemetry_a2a(sent, vals);
         BL_BENCH_END(distribute, "a2a", vals.size());
 
 
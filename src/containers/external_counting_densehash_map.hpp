@@ -0,0 +1,321 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    external_counting_densehash_map.hpp
+ * @ingroup index
+ * @author  tpan
+ * @brief   out-of-core distributed counting map.  kmers are spilled to disk in hash buckets, then counted 1 bucket at a time.
+ * @details insert() distributes the keys with the map's KeyToRank, exactly as counting_densehash_map does, but instead of
+ *          counting them, each rank appends its received keys to B bucket files, selected by hash bits that are independent
+ *          of the rank and of the local table's hash.  the appends are buffered, so the files are written in large sequential blocks.
+ *
+ *          process(op) then loads the buckets in turn into the map's local counting table, and calls op(bucket, map).
+ *          all ranks go through the same B buckets in lockstep, so op may use the map's collective calls (find, count, etc.)
+ *          for the keys of the current bucket.  since every key is in exactly 1 bucket, the buckets are complete and disjoint,
+ *          and only 1 bucket's distinct keys need to fit in memory.
+ *
+ *          files are named <prefix>.<rank>.<bucket>.bin, and are removed after process() and on destruction.
+ */
+#ifndef EXTERNAL_COUNTING_DENSEHASH_MAP_HPP_
+#define EXTERNAL_COUNTING_DENSEHASH_MAP_HPP_
+
+#include <cstdio>
+#include <cstring>  // strerror
+#include <cerrno>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include "containers/distributed_densehash_map.hpp"
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+#include "iterators/transform_iterator.hpp"
+
+namespace dsc
+{
+
+  /**
+   * @brief  distributed counting map that spills keys to disk and counts 1 hash bucket at a time.
+   * @details  the local counting table (and its find/count/erase etc.) holds the current bucket only, within process().
+   */
+  template<
+    typename Key, typename T,
+    template <typename> class MapParams,
+    typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+    class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+    template <typename, typename, typename, template <typename> class,
+      typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
+  >
+  class external_counting_densehash_map :
+    public counting_densehash_map<Key, T, MapParams, SpecialKeys, Alloc, LocalContainer> {
+
+    protected:
+      using Base = counting_densehash_map<Key, T, MapParams, SpecialKeys, Alloc, LocalContainer>;
+
+      /// bucket from the distribution hash with all of its bits, remixed, so that it is independent of both the rank
+      /// (the hash's leading bits) and the local table's hash.
+      struct KeyToBucket {
+          typename Base::DistTransformedFunc full_hash;
+          const size_t b;
+
+          KeyToBucket(size_t buckets) :
+            full_hash(typename Base::DistFunc(64), typename Base::DistTrans()), b(buckets) {}
+
+          inline size_t operator()(Key const & x) const {
+            uint64_t h = full_hash(x);
+            // murmur3 finalizer
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h % b;
+          }
+      } key_to_bucket;
+
+      std::string prefix;
+
+      /// per bucket write buffer and file
+      std::vector<std::vector<Key> > buffers;
+      std::vector<FILE *> files;
+      std::vector<size_t> spilled;
+
+      /// elements per bucket buffer
+      size_t buffer_size;
+
+      std::string filename(size_t bucket) const {
+        std::stringstream ss;
+        ss << prefix << "." << this->comm.rank() << "." << bucket << ".bin";
+        return ss.str();
+      }
+
+      [[noreturn]] void io_error(const char * op, size_t bucket) const {
+        int myerr = errno;
+        std::stringstream ss;
+        ss << "ERROR in external_counting_densehash_map " << op << ": [" << filename(bucket) << "] error " << myerr << ": " << strerror(myerr);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+
+      /// throw on all ranks if any rank failed.  collective.  error is this rank's message, empty if it succeeded.
+      void check_errors(std::string const & error, const char * op) const {
+        int failed = ::mxx::allreduce(error.empty() ? 0 : 1, this->comm);
+        if (failed == 0) return;
+
+        std::stringstream ss;
+        ss << "ERROR in external_counting_densehash_map " << op << ": " << failed << " rank(s) failed";
+        if (!error.empty()) ss << ".  rank " << this->comm.rank() << ": " << error;
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+
+      /// append the buffered keys of a bucket to its file.
+      void flush(size_t bucket) {
+        std::vector<Key> & buf = buffers[bucket];
+        if (buf.empty()) return;
+
+        if (files[bucket] == nullptr) {
+          files[bucket] = fopen(filename(bucket).c_str(), "wb");
+          if (files[bucket] == nullptr) io_error("open", bucket);
+        }
+        if (fwrite(buf.data(), sizeof(Key), buf.size(), files[bucket]) != buf.size()) io_error("write", bucket);
+
+        spilled[bucket] += buf.size();
+        buf.clear();
+      }
+
+      void remove_files() {
+        for (size_t i = 0; i < files.size(); ++i) {
+          if (files[i] != nullptr) {
+            fclose(files[i]);
+            files[i] = nullptr;
+            ::std::remove(filename(i).c_str());
+          }
+          spilled[i] = 0;
+          buffers[i].clear();
+        }
+      }
+
+      /// count the keys of 1 bucket into the local table, reading at most buffer_size * buckets keys at a time.
+      void load(size_t bucket) {
+        this->local_clear();
+
+        flush(bucket);
+        if (files[bucket] == nullptr) return;
+
+        if (fflush(files[bucket]) != 0) io_error("flush", bucket);
+        FILE * f = fopen(filename(bucket).c_str(), "rb");
+        if (f == nullptr) io_error("open", bucket);
+
+        auto trans = [](Key const & x) {
+          return ::std::make_pair(x, T(1));
+        };
+
+        std::vector<Key> block(::std::min(spilled[bucket], buffer_size * files.size()));
+        size_t remaining = spilled[bucket];
+        while (remaining > 0) {
+          size_t n = ::std::min(remaining, block.size());
+          if (fread(block.data(), sizeof(Key), n, f) != n) {
+            fclose(f);
+            io_error("read", bucket);
+          }
+          this->local_insert(::bliss::iterator::make_transform_iterator(block.begin(), trans),
+                             ::bliss::iterator::make_transform_iterator(block.begin() + n, trans));
+          remaining -= n;
+        }
+        fclose(f);
+      }
+
+    public:
+      using local_container_type = typename Base::local_container_type;
+
+      /**
+       * @param _comm     communicator
+       * @param buckets   number of buckets per rank.  choose so that distinct keys per rank / buckets fit in memory.
+       * @param _prefix   path prefix of the bucket files, e.g. on node local scratch.
+       * @param buffer_bytes  total write buffer per rank, split evenly between buckets.
+       */
+      external_counting_densehash_map(const mxx::comm& _comm, size_t buckets, std::string const & _prefix,
+                                      size_t buffer_bytes = (64UL << 20)) :
+        Base(_comm), key_to_bucket(buckets), prefix(_prefix),
+        buffers(buckets), files(buckets, nullptr), spilled(buckets, 0),
+        buffer_size(::std::max(buffer_bytes / (::std::max(buckets, static_cast<size_t>(1)) * sizeof(Key)), static_cast<size_t>(1))) {
+        if (buckets == 0) throw std::invalid_argument("external_counting_densehash_map needs at least 1 bucket.");
+        for (auto & b : buffers) b.reserve(buffer_size);
+      }
+
+      virtual ~external_counting_densehash_map() {
+        remove_files();
+      };
+
+      /// number of buckets per rank
+      inline size_t num_buckets() const {
+        return files.size();
+      }
+
+      /// number of keys spilled to disk or buffered on this rank.
+      size_t local_spilled_size() const {
+        size_t count = 0;
+        for (size_t i = 0; i < files.size(); ++i) count += spilled[i] + buffers[i].size();
+        return count;
+      }
+
+      /**
+       * @brief  distribute keys to their ranks, and append them to this rank's bucket files.  collective.
+       * @details  nothing is counted until process().  a file error on any rank throws on all ranks.
+       * @param sorted_input  ignored:  keys are bucketed by hash.
+       * @return number of keys spilled on this rank.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      size_t insert(std::vector< Key >& input, bool sorted_input = false, Predicate const &pred = Predicate()) {
+        BL_BENCH_INIT(spill);
+
+        if (::dsc::empty(input, this->comm)) {
+          BL_BENCH_REPORT_MPI_NAMED(spill, "external_count_densehash_map:insert", this->comm);
+          return 0;
+        }
+
+        BL_BENCH_START(spill);
+        this->transform_input(input);
+        BL_BENCH_END(spill, "transform_input", input.size());
+
+        if (this->comm.size() > 1) {
+          BL_BENCH_START(spill);
+          std::vector<size_t> recv_counts;
+          std::vector< Key > buffer;
+          ::imxx::distribute(input, this->key_to_rank, recv_counts, buffer, this->comm);
+          input.swap(buffer);
+          BL_BENCH_END(spill, "dist_data", input.size());
+        }
+
+        BL_BENCH_START(spill);
+        size_t count = 0;
+        // a write failure is reduced before returning, so that all ranks throw together.
+        std::string error;
+        try {
+          for (auto it = input.begin(); it != input.end(); ++it) {
+            if (!::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value && !pred(*it)) continue;
+
+            size_t b = key_to_bucket(*it);
+            buffers[b].push_back(*it);
+            if (buffers[b].size() >= buffer_size) flush(b);
+            ++count;
+          }
+        } catch (::std::exception const & e) {
+          error = e.what();
+        }
+        check_errors(error, "insert");
+        BL_BENCH_END(spill, "spill", count);
+
+        BL_BENCH_REPORT_MPI_NAMED(spill, "external_count_densehash_map:insert", this->comm);
+
+        return count;
+      }
+
+      /**
+       * @brief  count each bucket in memory in turn, and call op(bucket, *this) with the bucket's counts in the local table.  collective.
+       * @details  op can read the local table via get_local_container(), or use the collective queries.
+       *           if keep is false, the bucket files are removed afterwards and the map is empty.
+       *           a file error on any rank throws on all ranks before op is called for the bucket.
+       */
+      template <typename Op>
+      void process(Op && op, bool keep = false) {
+        BL_BENCH_INIT(process);
+
+        for (size_t b = 0; b < files.size(); ++b) {
+          BL_BENCH_START(process);
+          std::string error;
+          try {
+            load(b);
+          } catch (::std::exception const & e) {
+            error = e.what();
+            this->local_clear();
+          }
+          check_errors(error, "process");
+          BL_BENCH_END(process, "load", this->local_size());
+
+          BL_BENCH_START(process);
+          op(b, *this);
+          BL_BENCH_END(process, "op", this->local_size());
+        }
+
+        this->local_clear();
+        if (!keep) remove_files();
+
+        BL_BENCH_REPORT_MPI_NAMED(process, "external_count_densehash_map:process", this->comm);
+      }
+
+      /**
+       * @brief  emit the local (key, count) entries that satisfy pred, from all buckets.  collective.
+       * @details  e.g. with a minimum count predicate, the result can be much smaller than the distinct keys.
+       */
+      template <typename Predicate = ::bliss::filter::TruePredicate>
+      void emit(std::vector<::std::pair<Key, T> > & result, Predicate const & pred = Predicate(), bool keep = false) {
+        result.clear();
+        process([&result, &pred](size_t, external_counting_densehash_map const & m) {
+          auto const & lc = m.get_local_container();
+          for (auto it = lc.begin(); it != lc.end(); ++it) {
+            if (::std::is_same<Predicate, ::bliss::filter::TruePredicate>::value || pred(*it))
+              result.emplace_back((*it).first, (*it).second);
+          }
+        }, keep);
+      }
+  };
+
+} /* namespace dsc */
+
+#endif /* EXTERNAL_COUNTING_DENSEHASH_MAP_HPP_ */
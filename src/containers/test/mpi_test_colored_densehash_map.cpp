@@ -0,0 +1,339 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_colored_densehash_map.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the multi-sample (colored) counting map against per-sample histograms.
+ * @details samples are inserted both as (kmer, sample) pairs in 1 pass, and 1 sample per call.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <map>
+#include <random>
+#include <vector>
+#include <stdexcept>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "containers/color_counts.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+
+TEST(ColorCounts, adaptive)
+{
+  // 4 samples:  dense once 2 are present.
+  ::fsc::color_counts<uint32_t, uint16_t> few;
+  few.add(3, 1, 4);
+  EXPECT_FALSE(few.is_dense(4));
+  few.add(3, 2, 4);
+  EXPECT_FALSE(few.is_dense(4));
+  few.add(1, 1, 4);
+  EXPECT_TRUE(few.is_dense(4));
+  EXPECT_EQ(3U, few.get(3, 4));
+  EXPECT_EQ(1U, few.get(1, 4));
+  EXPECT_EQ(0U, few.get(0, 4));
+  EXPECT_EQ(2UL, few.colors(4));
+
+  // 1 sample:  always dense.
+  ::fsc::color_counts<uint32_t, uint16_t> one;
+  one.add(0, 5, 1);
+  EXPECT_TRUE(one.is_dense(1));
+  EXPECT_EQ(5U, one.get(0, 1));
+
+  // 200 samples:  sparse until 100 are present, colors kept sorted.
+  ::fsc::color_counts<uint32_t, uint16_t> many;
+  for (uint16_t c = 0; c < 99; ++c) many.add(198 - 2 * c, c + 1, 200);
+  EXPECT_FALSE(many.is_dense(200));
+  EXPECT_EQ(99UL, many.colors(200));
+  EXPECT_EQ(1U, many.get(198, 200));
+  EXPECT_EQ(0U, many.get(197, 200));
+
+  std::vector<uint16_t> order;
+  many.for_each([&order](uint16_t const & c, uint32_t const &) { order.push_back(c); }, 200);
+  EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+
+  many.add(1, 7, 200);
+  EXPECT_TRUE(many.is_dense(200));
+  EXPECT_EQ(100UL, many.colors(200));
+  EXPECT_EQ(7U, many.get(1, 200));
+  EXPECT_EQ(99U, many.get(2, 200));
+
+  std::vector<uint64_t> bits(4);
+  many.to_bits(bits.data(), 200);
+  EXPECT_EQ(0x5555555555555556ULL, bits[0]);   // even samples from 2, and sample 1.
+  EXPECT_EQ(0x0000000000000055ULL, bits[3]);   // samples 192, 194, 196, 198
+}
+
+TEST(ColorCounts, storage)
+{
+  // 2 colors fit inline, the third goes to the heap.
+  ::fsc::color_counts<uint32_t, uint16_t> x;
+  x.add(5, 1, 100);
+  x.add(2, 1, 100);
+  EXPECT_EQ(0UL, x.heap_bytes());
+  x.add(9, 3, 100);
+  EXPECT_LT(0UL, x.heap_bytes());
+
+  // copies are independent.
+  ::fsc::color_counts<uint32_t, uint16_t> y(x);
+  y.add(9, 1, 100);
+  EXPECT_EQ(3U, x.get(9, 100));
+  EXPECT_EQ(4U, y.get(9, 100));
+
+  ::fsc::color_counts<uint32_t, uint16_t> z;
+  z.add(1, 1, 100);
+  z = x;
+  EXPECT_EQ(3UL, z.colors(100));
+  EXPECT_EQ(0U, z.get(1, 100));
+
+  ::fsc::color_counts<uint32_t, uint16_t> w(std::move(y));
+  EXPECT_TRUE(y.empty());
+  EXPECT_EQ(4U, w.get(9, 100));
+  EXPECT_EQ(1U, w.get(2, 100));
+
+  // inline dense form.
+  ::fsc::color_counts<uint32_t, uint16_t> d;
+  d.add(3, 2, 4);
+  d.add(0, 1, 4);
+  EXPECT_TRUE(d.is_dense(4));
+  EXPECT_EQ(0UL, d.heap_bytes());
+  ::fsc::color_counts<uint32_t, uint16_t> e;
+  e = std::move(d);
+  EXPECT_EQ(2U, e.get(3, 4));
+  EXPECT_EQ(1U, e.get(0, 4));
+  EXPECT_EQ(0U, e.get(1, 4));
+}
+
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+template <typename Key>
+using MapParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key, ::bliss::index::kmer::DistHashMurmur>;
+
+using MapType = ::dsc::colored_counting_densehash_map<KmerType, uint32_t, MapParams, SpecialKeys>;
+
+
+class ColoredDensehashMapTest : public ::testing::Test
+{
+  protected:
+    static constexpr size_t samples = 70;
+
+    std::vector<std::pair<KmerType, uint16_t> > input;
+
+    /// small key space so that samples overlap.  key 1 is in every sample, other keys in few.
+    void generate(::mxx::comm const & comm) {
+      std::default_random_engine gen(31 + comm.rank());
+
+      input.clear();
+      for (size_t s = 0; s < samples; ++s) {
+        KmerType core;
+        core.getDataRef()[0] = 1;
+        input.emplace_back(core, static_cast<uint16_t>(s));
+
+        std::uniform_int_distribution<uint64_t> dist(1, 20 * (s + 1));
+        for (size_t i = 0; i < 30; ++i) {
+          KmerType k;
+          k.getDataRef()[0] = dist(gen);
+          input.emplace_back(k, static_cast<uint16_t>(s));
+        }
+      }
+      std::shuffle(input.begin(), input.end(), gen);
+    }
+
+    /// global (kmer, sample) histogram.
+    std::map<std::pair<KmerType, uint16_t>, uint32_t> histogram(::mxx::comm const & comm) {
+      std::vector<std::pair<KmerType, uint16_t> > all = ::mxx::allgatherv(input, comm);
+      std::map<std::pair<KmerType, uint16_t>, uint32_t> result;
+      for (auto const & x : all) ++result[x];
+      return result;
+    }
+
+    /// query keys 0 to 1500, including absent ones.
+    std::vector<KmerType> queries(::mxx::comm const & comm) {
+      std::vector<KmerType> q;
+      for (uint64_t i = comm.rank(); i <= 1500; i += comm.size()) {
+        KmerType k;
+        k.getDataRef()[0] = i;
+        q.push_back(k);
+      }
+      std::reverse(q.begin(), q.end());
+      return q;
+    }
+
+    void check_counts(MapType const & map, ::mxx::comm const & comm) {
+      auto gold = histogram(comm);
+
+      std::vector<KmerType> q = queries(comm);
+      std::vector<KmerType> q_orig(q);
+      std::vector<uint32_t> rows;
+      map.counts(q, rows);
+      EXPECT_EQ(q_orig, q);
+      ASSERT_EQ(q.size() * samples, rows.size());
+
+      std::vector<uint64_t> bits;
+      map.presence(q, bits);
+      ASSERT_EQ(q.size() * map.words_per_row(), bits.size());
+
+      for (size_t i = 0; i < q.size(); ++i) {
+        for (size_t s = 0; s < samples; ++s) {
+          auto it = gold.find(std::make_pair(q[i], static_cast<uint16_t>(s)));
+          uint32_t expected = (it == gold.end()) ? 0 : it->second;
+          EXPECT_EQ(expected, rows[i * samples + s]);
+          EXPECT_EQ(expected > 0, ((bits[i * map.words_per_row() + (s >> 6)] >> (s & 63)) & 1) == 1);
+        }
+      }
+    }
+};
+constexpr size_t ColoredDensehashMapTest::samples;
+
+
+TEST_F(ColoredDensehashMapTest, insert_pairs)
+{
+  ::mxx::comm comm;
+  MapType map(comm, samples);
+  generate(comm);
+
+  std::vector<std::pair<KmerType, uint16_t> > temp(input);
+  map.insert(temp);
+
+  auto gold = histogram(comm);
+  std::map<KmerType, size_t> keys;
+  for (auto const & x : gold) ++keys[x.first.first];
+
+  // each key once.
+  EXPECT_EQ(keys.size(), map.size());
+  // the common keys are dense, the rare ones sparse.
+  size_t dense = ::mxx::allreduce(map.local_dense_size(), comm);
+  EXPECT_GT(dense, 0UL);
+  EXPECT_LT(dense, keys.size());
+
+  check_counts(map, comm);
+}
+
+TEST_F(ColoredDensehashMapTest, insert_per_sample)
+{
+  ::mxx::comm comm;
+  MapType map(comm, samples);
+  generate(comm);
+
+  // ranks insert different samples in the same call.
+  for (size_t i = 0; i < samples; ++i) {
+    uint16_t s = (i + comm.rank()) % samples;
+    std::vector<KmerType> temp;
+    for (auto const & x : input) {
+      if (x.second == s) temp.push_back(x.first);
+    }
+    map.insert(temp, s);
+  }
+
+  check_counts(map, comm);
+}
+
+TEST_F(ColoredDensehashMapTest, matrices)
+{
+  ::mxx::comm comm;
+  MapType map(comm, samples);
+  generate(comm);
+
+  std::vector<std::pair<KmerType, uint16_t> > temp(input);
+  map.insert(temp);
+
+  auto gold = histogram(comm);
+  std::map<KmerType, std::vector<uint16_t> > present;
+  for (auto const & x : gold) present[x.first.first].push_back(x.first.second);
+
+  // local parts of the presence matrix cover every key once.
+  std::vector<KmerType> keys;
+  std::vector<uint64_t> bits;
+  map.local_presence(keys, bits);
+  ASSERT_EQ(keys.size() * map.words_per_row(), bits.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(1UL, present.count(keys[i]));
+    for (auto s : present[keys[i]]) {
+      EXPECT_EQ(1UL, (bits[i * map.words_per_row() + (s >> 6)] >> (s & 63)) & 1);
+    }
+  }
+  EXPECT_EQ(present.size(), ::mxx::allreduce(keys.size(), comm));
+
+  std::vector<size_t> shared(samples * samples, 0);
+  for (auto const & x : present) {
+    for (auto a : x.second)
+      for (auto b : x.second) ++shared[a * samples + b];
+  }
+  EXPECT_EQ(shared, map.sharing());
+}
+
+TEST_F(ColoredDensehashMapTest, bad_sample)
+{
+  ::mxx::comm comm;
+  EXPECT_THROW(MapType(comm, 0), std::invalid_argument);
+  EXPECT_THROW(MapType(comm, 65537), std::invalid_argument);
+
+  MapType map(comm, samples);
+  std::vector<std::pair<KmerType, uint16_t> > temp(1, std::make_pair(KmerType(), static_cast<uint16_t>(samples)));
+  EXPECT_THROW(map.insert(temp), std::invalid_argument);
+
+  // a bad id on 1 rank throws on all ranks, and the map stays usable.
+  temp.assign(1, std::make_pair(KmerType(), static_cast<uint16_t>((comm.rank() == comm.size() - 1) ? samples : 0)));
+  EXPECT_THROW(map.insert(temp), std::invalid_argument);
+
+  std::vector<KmerType> keys(1);
+  EXPECT_THROW(map.insert(keys, static_cast<uint16_t>((comm.rank() == 0) ? samples : 1)), std::invalid_argument);
+
+  temp.assign(1, std::make_pair(KmerType(), static_cast<uint16_t>(0)));
+  map.insert(temp);
+  EXPECT_EQ(1UL, map.size());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
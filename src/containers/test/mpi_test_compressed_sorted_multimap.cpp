@@ -0,0 +1,187 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_compressed_sorted_multimap.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test find and count of the distributed compressed sorted multimap against the gathered input.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <map>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "containers/distributed_sorted_map.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using MapParams = ::bliss::index::kmer::SingleStrandSortedMapParams<Key>;
+
+using MapType = ::dsc::compressed_sorted_multimap<KmerType, uint32_t, MapParams>;
+
+
+class CompressedSortedMultimapTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::pair<KmerType, uint32_t> > input;
+    std::vector<KmerType> queries;
+    /// all of the input, from all ranks.
+    std::multimap<KmerType, uint32_t> gold;
+
+    /// small key space, so that keys repeat within and across ranks.
+    virtual void SetUp() {
+      ::mxx::comm comm;
+      std::default_random_engine gen(7 + comm.rank());
+      std::uniform_int_distribution<uint64_t> dist(1, 400);
+
+      for (uint32_t i = 0; i < 2000; ++i) {
+        KmerType k;
+        k.getDataRef()[0] = dist(gen);
+        input.emplace_back(k, comm.rank() * 2000 + i);
+      }
+      for (size_t i = 0; i < 200; ++i) {
+        KmerType k;
+        k.getDataRef()[0] = dist(gen) + 200;  // some are absent.
+        queries.push_back(k);
+      }
+
+      auto all = ::mxx::allgatherv(input, comm);
+      gold.insert(all.begin(), all.end());
+    }
+
+    /// expected find results for this rank's queries, sorted.
+    std::vector<std::pair<KmerType, uint32_t> > gold_find() const {
+      std::vector<KmerType> q(queries);
+      std::sort(q.begin(), q.end());
+      q.erase(std::unique(q.begin(), q.end()), q.end());
+
+      std::vector<std::pair<KmerType, uint32_t> > results;
+      for (auto const & k : q) {
+        auto range = gold.equal_range(k);
+        results.insert(results.end(), range.first, range.second);
+      }
+      std::sort(results.begin(), results.end());
+      return results;
+    }
+
+    template <typename V>
+    static std::vector<V> sorted(std::vector<V> v) {
+      std::sort(v.begin(), v.end());
+      return v;
+    }
+};
+
+
+TEST_F(CompressedSortedMultimapTest, find_count)
+{
+  ::mxx::comm comm;
+  MapType test(comm);
+
+  std::vector<std::pair<KmerType, uint32_t> > temp(input);
+  test.insert(temp);
+  test.compress();
+  EXPECT_TRUE(test.is_compressed());
+
+  EXPECT_EQ(gold.size(), test.size());
+  size_t unique = 0;
+  for (auto it = gold.begin(); it != gold.end(); it = gold.upper_bound(it->first)) ++unique;
+  EXPECT_EQ(unique, test.unique_size());
+
+  std::vector<KmerType> q(queries);
+  EXPECT_EQ(gold_find(), sorted(test.find(q)));
+
+  q = queries;
+  auto counts = test.count(q);
+  // the query vector is redistributed by count.
+  q = queries;
+  std::sort(q.begin(), q.end());
+  q.erase(std::unique(q.begin(), q.end()), q.end());
+  ASSERT_EQ(q.size(), counts.size());
+  for (auto const & c : counts) {
+    EXPECT_EQ(gold.count(c.first), c.second);
+  }
+
+  // the whole map.
+  std::vector<std::pair<KmerType, uint32_t> > all;
+  test.to_vector(all);
+  all = ::mxx::allgatherv(all, comm);
+  std::vector<std::pair<KmerType, uint32_t> > gold_all(gold.begin(), gold.end());
+  EXPECT_EQ(sorted(gold_all), sorted(all));
+}
+
+TEST_F(CompressedSortedMultimapTest, insert_after_compress)
+{
+  ::mxx::comm comm;
+  MapType test(comm);
+
+  size_t half = input.size() / 2;
+  std::vector<std::pair<KmerType, uint32_t> > temp(input.begin(), input.begin() + half);
+  test.insert(temp);
+  test.compress();
+
+  // decompresses, then compress again.
+  temp.assign(input.begin() + half, input.end());
+  test.insert(temp);
+  EXPECT_FALSE(test.is_compressed());
+  test.compress();
+
+  EXPECT_EQ(gold.size(), test.size());
+  std::vector<KmerType> q(queries);
+  EXPECT_EQ(gold_find(), sorted(test.find(q)));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
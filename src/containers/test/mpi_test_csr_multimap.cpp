@@ -0,0 +1,165 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_csr_multimap.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the distributed unordered multimap with the CSR local container, against the std::unordered_multimap version.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "containers/distributed_unordered_map.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using MapParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key, ::bliss::index::kmer::DistHashMurmur>;
+
+using CSRMapType = ::dsc::unordered_multimap_csr<KmerType, uint32_t, MapParams>;
+using GoldMapType = ::dsc::unordered_multimap<KmerType, uint32_t, MapParams>;
+
+
+class CSRMultimapTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::pair<KmerType, uint32_t> > input;
+    std::vector<KmerType> queries;
+
+    /// small key space, so that keys repeat within and across ranks.
+    virtual void SetUp() {
+      ::mxx::comm comm;
+      std::default_random_engine gen(11 + comm.rank());
+      std::uniform_int_distribution<uint64_t> dist(1, 400);
+
+      for (uint32_t i = 0; i < 2000; ++i) {
+        KmerType k;
+        k.getDataRef()[0] = dist(gen);
+        input.emplace_back(k, comm.rank() * 2000 + i);
+      }
+      for (size_t i = 0; i < 200; ++i) {
+        KmerType k;
+        k.getDataRef()[0] = dist(gen) + 200;  // some are absent.
+        queries.push_back(k);
+      }
+    }
+
+    template <typename V>
+    static std::vector<V> gather_sorted(std::vector<V> v, ::mxx::comm const & comm) {
+      v = ::mxx::allgatherv(v, comm);
+      std::sort(v.begin(), v.end());
+      return v;
+    }
+};
+
+
+TEST_F(CSRMultimapTest, insert_find)
+{
+  ::mxx::comm comm;
+  CSRMapType test(comm);
+  GoldMapType gold(comm);
+
+  // 2 inserts, so the second merges into existing keys.
+  size_t half = input.size() / 2;
+  std::vector<std::pair<KmerType, uint32_t> > temp(input.begin(), input.begin() + half);
+  test.insert(temp);
+  temp.assign(input.begin() + half, input.end());
+  test.insert(temp);
+  temp = input;
+  gold.insert(temp);
+
+  EXPECT_EQ(gold.size(), test.size());
+  EXPECT_EQ(gold.unique_size(), test.unique_size());
+
+  std::vector<KmerType> q(queries);
+  auto test_found = test.find(q);
+  q = queries;
+  auto gold_found = gold.find(q);
+  EXPECT_EQ(gather_sorted(gold_found, comm), gather_sorted(test_found, comm));
+
+  q = queries;
+  auto test_counts = test.count(q);
+  q = queries;
+  auto gold_counts = gold.count(q);
+  EXPECT_EQ(gather_sorted(gold_counts, comm), gather_sorted(test_counts, comm));
+}
+
+TEST_F(CSRMultimapTest, erase)
+{
+  ::mxx::comm comm;
+  CSRMapType test(comm);
+  GoldMapType gold(comm);
+
+  std::vector<std::pair<KmerType, uint32_t> > temp(input);
+  test.insert(temp);
+  temp = input;
+  gold.insert(temp);
+
+  std::vector<KmerType> q(queries);
+  test.erase(q);
+  q = queries;
+  gold.erase(q);
+
+  EXPECT_EQ(gold.size(), test.size());
+
+  std::vector<std::pair<KmerType, uint32_t> > test_all, gold_all;
+  test.to_vector(test_all);
+  gold.to_vector(gold_all);
+  EXPECT_EQ(gather_sorted(gold_all, comm), gather_sorted(test_all, comm));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_densehash_set_ops.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test intersect, subtract, merge, and join between distributed densehash maps.
+ * @details results should be the same whether the 2 maps are co-partitioned (rank-local) or
+ *          have different distribution hash functions (other map redistributed).
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <map>
+#include <random>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+template <typename Key>
+using MurmurParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key, ::bliss::index::kmer::DistHashMurmur>;
+template <typename Key>
+using FarmParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key, ::bliss::index::kmer::DistHashFarm>;
+
+using MapType = ::dsc::counting_densehash_map<KmerType, size_t, MurmurParams, SpecialKeys>;
+
+
+template <typename OtherMap>
+class DensehashSetOpsTest : public ::testing::Test
+{
+  protected:
+    std::vector<KmerType> a_input;
+    std::vector<KmerType> b_input;
+
+    /// a small key space so that the 2 maps overlap.
+    void generate(std::vector<KmerType> & kmers, size_t count, uint64_t max_key, unsigned int seed) {
+      std::default_random_engine gen(seed);
+      std::uniform_int_distribution<uint64_t> dist(1, max_key);
+
+      kmers.clear();
+      for (size_t i = 0; i < count; ++i) {
+        KmerType k;
+        k.getDataRef()[0] = dist(gen);
+        kmers.push_back(k);
+      }
+    }
+
+    /// global histogram of the input kmers.
+    std::map<KmerType, size_t> histogram(std::vector<KmerType> const & kmers, ::mxx::comm const & comm) {
+      std::vector<KmerType> all = ::mxx::allgatherv(kmers, comm);
+      std::map<KmerType, size_t> result;
+      for (auto const & k : all) ++result[k];
+      return result;
+    }
+
+    /// global content of a map.
+    template <typename Map>
+    std::map<KmerType, size_t> gather(Map const & map, ::mxx::comm const & comm) {
+      std::vector<std::pair<KmerType, size_t> > entries;
+      map.to_vector(entries);
+      entries = ::mxx::allgatherv(entries, comm);
+      return std::map<KmerType, size_t>(entries.begin(), entries.end());
+    }
+
+    void build(MapType & a, OtherMap & b, ::mxx::comm const & comm) {
+      generate(a_input, 1000, 1500, 17 + comm.rank());
+      generate(b_input, 1000, 1500, 4231 + comm.rank());
+
+      std::vector<KmerType> temp(a_input);
+      a.insert(temp);
+      temp = b_input;
+      b.insert(temp);
+    }
+};
+
+// same distribution hash: co-partitioned.  different distribution hash: redistributed.
+typedef ::testing::Types<
+    ::dsc::counting_densehash_map<KmerType, size_t, MurmurParams, SpecialKeys>,
+    ::dsc::counting_densehash_map<KmerType, size_t, FarmParams, SpecialKeys>
+> OtherMapTypes;
+TYPED_TEST_CASE(DensehashSetOpsTest, OtherMapTypes);
+
+
+TYPED_TEST(DensehashSetOpsTest, copartitioned)
+{
+  ::mxx::comm comm;
+  MapType a(comm);
+  TypeParam b(comm);
+
+  bool expected = ::std::is_same<typename MapType::distribution_function_type,
+      typename TypeParam::distribution_function_type>::value;
+  EXPECT_EQ(expected, a.is_copartitioned(b));
+  EXPECT_EQ(expected, b.is_copartitioned(a));
+}
+
+TYPED_TEST(DensehashSetOpsTest, intersect)
+{
+  ::mxx::comm comm;
+  MapType a(comm);
+  TypeParam b(comm);
+  this->build(a, b, comm);
+
+  auto ga = this->histogram(this->a_input, comm);
+  auto gb = this->histogram(this->b_input, comm);
+
+  a.intersect(b);
+  auto result = this->gather(a, comm);
+
+  std::map<KmerType, size_t> gold;
+  for (auto const & x : ga) {
+    if (gb.count(x.first) > 0) gold.insert(x);
+  }
+  ASSERT_GT(gold.size(), 0UL);
+  EXPECT_EQ(gold, result);
+
+  // b is unchanged
+  EXPECT_EQ(gb, this->gather(b, comm));
+}
+
+TYPED_TEST(DensehashSetOpsTest, subtract)
+{
+  ::mxx::comm comm;
+  MapType a(comm);
+  TypeParam b(comm);
+  this->build(a, b, comm);
+
+  auto ga = this->histogram(this->a_input, comm);
+  auto gb = this->histogram(this->b_input, comm);
+
+  a.subtract(b);
+  auto result = this->gather(a, comm);
+
+  std::map<KmerType, size_t> gold;
+  for (auto const & x : ga) {
+    if (gb.count(x.first) == 0) gold.insert(x);
+  }
+  ASSERT_GT(gold.size(), 0UL);
+  EXPECT_EQ(gold, result);
+}
+
+TYPED_TEST(DensehashSetOpsTest, merge)
+{
+  ::mxx::comm comm;
+  MapType a(comm);
+  TypeParam b(comm);
+  this->build(a, b, comm);
+
+  auto ga = this->histogram(this->a_input, comm);
+  auto gb = this->histogram(this->b_input, comm);
+
+  // counting map merges with its reduction operator, i.e. counts add.
+  a.merge(b);
+  auto result = this->gather(a, comm);
+
+  std::map<KmerType, size_t> gold(ga);
+  for (auto const & x : gb) gold[x.first] += x.second;
+  EXPECT_EQ(gold, result);
+}
+
+TYPED_TEST(DensehashSetOpsTest, merge_op)
+{
+  ::mxx::comm comm;
+  MapType a(comm);
+  TypeParam b(comm);
+  this->build(a, b, comm);
+
+  auto ga = this->histogram(this->a_input, comm);
+  auto gb = this->histogram(this->b_input, comm);
+
+  a.merge(b, [](size_t const & x, size_t const & y) { return ::std::max(x, y); });
+  auto result = this->gather(a, comm);
+
+  std::map<KmerType, size_t> gold(ga);
+  for (auto const & x : gb) gold[x.first] = ::std::max(gold[x.first], x.second);
+  EXPECT_EQ(gold, result);
+}
+
+TYPED_TEST(DensehashSetOpsTest, join)
+{
+  ::mxx::comm comm;
+  MapType a(comm);
+  TypeParam b(comm);
+  this->build(a, b, comm);
+
+  auto ga = this->histogram(this->a_input, comm);
+  auto gb = this->histogram(this->b_input, comm);
+
+  auto joined = a.join(b);
+  joined = ::mxx::allgatherv(joined, comm);
+
+  std::map<KmerType, std::pair<size_t, size_t> > result(joined.begin(), joined.end());
+  EXPECT_EQ(joined.size(), result.size());
+
+  std::map<KmerType, std::pair<size_t, size_t> > gold;
+  for (auto const & x : ga) {
+    auto it = gb.find(x.first);
+    if (it != gb.end()) gold[x.first] = std::make_pair(x.second, it->second);
+  }
+  EXPECT_EQ(gold, result);
+}
+
+TEST(DensehashMultimapSetOps, merge)
+{
+  ::mxx::comm comm;
+  using MultiMapType = ::dsc::densehash_multimap<KmerType, uint32_t, MurmurParams, SpecialKeys>;
+  using OtherMultiMapType = ::dsc::densehash_multimap<KmerType, uint32_t, FarmParams, SpecialKeys>;
+
+  // small key space, so that keys repeat within and across the 2 maps.
+  std::default_random_engine gen(7 + comm.rank());
+  std::uniform_int_distribution<uint64_t> dist(1, 300);
+  std::vector<std::pair<KmerType, uint32_t> > a_input, b_input;
+  for (uint32_t i = 0; i < 500; ++i) {
+    KmerType k;
+    k.getDataRef()[0] = dist(gen);
+    a_input.emplace_back(k, i);
+    k.getDataRef()[0] = dist(gen);
+    b_input.emplace_back(k, 1000 + i);
+  }
+
+  std::vector<std::pair<KmerType, uint32_t> > gold = ::mxx::allgatherv(a_input, comm);
+  std::vector<std::pair<KmerType, uint32_t> > gold_b = ::mxx::allgatherv(b_input, comm);
+  gold.insert(gold.end(), gold_b.begin(), gold_b.end());
+  std::sort(gold.begin(), gold.end());
+
+  MultiMapType a(comm);
+  MultiMapType b(comm);
+  OtherMultiMapType c(comm);
+  std::vector<std::pair<KmerType, uint32_t> > temp(a_input);
+  a.insert(temp);
+  temp = b_input;
+  b.insert(temp);
+  temp = b_input;
+  c.insert(temp);
+
+  // co-partitioned, and redistributed.  all entries are kept.
+  MultiMapType a2(comm);
+  temp = a_input;
+  a2.insert(temp);
+
+  EXPECT_EQ(gold_b.size(), ::mxx::allreduce(a.merge(b), comm));
+  EXPECT_EQ(gold_b.size(), ::mxx::allreduce(a2.merge(c), comm));
+
+  for (auto m : {&a, &a2}) {
+    std::vector<std::pair<KmerType, uint32_t> > result;
+    m->to_vector(result);
+    result = ::mxx::allgatherv(result, comm);
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(gold, result);
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
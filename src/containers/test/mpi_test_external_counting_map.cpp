@@ -0,0 +1,234 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_external_counting_map.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test that counting through disk buckets gives the same counts as the in memory counting map.
+ * @details a file error on 1 rank should throw on all ranks.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <cstdio>
+#include <map>
+#include <set>
+#include <random>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "containers/distributed_densehash_map.hpp"
+#include "containers/external_counting_densehash_map.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false>;
+
+template <typename Key>
+using MapParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key, ::bliss::index::kmer::DistHashMurmur>;
+
+using MapType = ::dsc::counting_densehash_map<KmerType, uint32_t, MapParams, SpecialKeys>;
+using ExternalMapType = ::dsc::external_counting_densehash_map<KmerType, uint32_t, MapParams, SpecialKeys>;
+
+
+class ExternalCountingMapTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::vector<KmerType> > batches;
+
+    virtual void SetUp() {
+      ::mxx::comm comm;
+      std::default_random_engine gen(11 + comm.rank());
+      std::uniform_int_distribution<uint64_t> dist(1, 5000);
+
+      batches.resize(4);
+      for (auto & b : batches) {
+        for (size_t i = 0; i < 3000; ++i) {
+          KmerType k;
+          k.getDataRef()[0] = dist(gen);
+          b.push_back(k);
+        }
+      }
+    }
+
+    template <typename Entries>
+    std::map<KmerType, uint32_t> gather(Entries const & entries, ::mxx::comm const & comm) {
+      auto all = ::mxx::allgatherv(entries, comm);
+      std::map<KmerType, uint32_t> result;
+      for (auto const & x : all) {
+        EXPECT_EQ(0UL, result.count(x.first));
+        result[x.first] = x.second;
+      }
+      return result;
+    }
+
+    std::map<KmerType, uint32_t> gold(::mxx::comm const & comm) {
+      MapType map(comm);
+      for (auto const & b : batches) {
+        std::vector<KmerType> temp(b);
+        map.insert(temp);
+      }
+      std::vector<std::pair<KmerType, uint32_t> > entries;
+      map.to_vector(entries);
+      return gather(entries, comm);
+    }
+};
+
+
+TEST_F(ExternalCountingMapTest, emit)
+{
+  ::mxx::comm comm;
+  auto expected = gold(comm);
+
+  // small write buffer, so that buckets are appended to many times.
+  ExternalMapType map(comm, 7, "external_counting_test", 7 * 100 * sizeof(KmerType));
+  size_t spilled = 0;
+  for (auto const & b : batches) {
+    std::vector<KmerType> temp(b);
+    spilled += map.insert(temp);
+  }
+  EXPECT_EQ(spilled, map.local_spilled_size());
+  EXPECT_EQ(4UL * 3000UL * comm.size(), ::mxx::allreduce(spilled, comm));
+
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  map.emit(entries);
+  EXPECT_EQ(expected, gather(entries, comm));
+
+  // files are removed.
+  EXPECT_EQ(0UL, map.local_spilled_size());
+  std::stringstream ss;
+  ss << "external_counting_test." << comm.rank() << ".0.bin";
+  EXPECT_EQ(nullptr, fopen(ss.str().c_str(), "rb"));
+}
+
+TEST_F(ExternalCountingMapTest, emit_filtered)
+{
+  ::mxx::comm comm;
+  auto all = gold(comm);
+  std::map<KmerType, uint32_t> expected;
+  for (auto const & x : all) {
+    if (x.second >= 4) expected.insert(x);
+  }
+  ASSERT_GT(expected.size(), 0UL);
+
+  ExternalMapType map(comm, 3, "external_counting_test");
+  for (auto const & b : batches) {
+    std::vector<KmerType> temp(b);
+    map.insert(temp);
+  }
+
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  map.emit(entries, [](std::pair<const KmerType, uint32_t> const & x) { return x.second >= 4; });
+  EXPECT_EQ(expected, gather(entries, comm));
+}
+
+TEST_F(ExternalCountingMapTest, process_buckets)
+{
+  ::mxx::comm comm;
+  auto expected = gold(comm);
+
+  ExternalMapType map(comm, 5, "external_counting_test");
+  for (auto const & b : batches) {
+    std::vector<KmerType> temp(b);
+    map.insert(temp);
+  }
+
+  // buckets are disjoint, and collective queries work on the current bucket.
+  size_t total = 0;
+  std::set<KmerType> seen;
+  map.process([&](size_t bucket, ExternalMapType & m) {
+    std::vector<KmerType> keys;
+    m.get_local_container().keys(keys);
+    for (auto const & k : keys) EXPECT_TRUE(seen.insert(k).second);
+    total += m.size();
+
+    std::vector<KmerType> query(keys);
+    auto found = m.find(query);
+    EXPECT_EQ(keys.size(), found.size());
+    for (auto const & x : found) EXPECT_EQ(expected[x.first], x.second);
+
+    EXPECT_LT(bucket, m.num_buckets());
+  }, true);
+  EXPECT_EQ(expected.size(), total);
+
+  // kept files can be processed again.
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  map.emit(entries);
+  EXPECT_EQ(expected, gather(entries, comm));
+}
+
+TEST_F(ExternalCountingMapTest, file_error)
+{
+  ::mxx::comm comm;
+
+  // only the last rank cannot create its bucket files.
+  std::string prefix = (comm.rank() == comm.size() - 1) ? "/nonexistent_dir/external_counting_test" : "external_counting_test";
+
+  // small write buffer:  the last rank fails while spilling.
+  {
+    ExternalMapType map(comm, 3, prefix, 3 * 100 * sizeof(KmerType));
+    std::vector<KmerType> temp(batches[0]);
+    EXPECT_THROW(map.insert(temp), ::bliss::io::IOException);
+  }
+
+  // large write buffer:  the last rank fails when the first bucket is flushed in process().  op is not called.
+  {
+    ExternalMapType map(comm, 3, prefix);
+    std::vector<KmerType> temp(batches[0]);
+    EXPECT_NO_THROW(map.insert(temp));
+
+    size_t calls = 0;
+    EXPECT_THROW(map.process([&calls](size_t, ExternalMapType &) { ++calls; }), ::bliss::io::IOException);
+    EXPECT_EQ(0UL, calls);
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
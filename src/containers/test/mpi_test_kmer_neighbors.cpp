@@ -0,0 +1,172 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_kmer_neighbors.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the batched hamming distance 1 neighborhood queries of the distributed densehash maps against
+ *          per neighbor lookups in the gathered map content.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <map>
+#include <random>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/kmer_neighbors.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "containers/distributed_densehash_map.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using Neighbors = ::bliss::common::hamming_neighbors<KmerType>;
+using Hits = ::bliss::common::neighborhood_hits<KmerType, uint32_t>;
+
+template <typename Key>
+using SingleStrandParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key, ::bliss::index::kmer::DistHashMurmur>;
+template <typename Key>
+using CanonicalParams = ::bliss::index::kmer::CanonicalHashMapParams<Key, ::bliss::index::kmer::DistHashFarm, ::bliss::index::kmer::StoreHashFarm>;
+
+using SingleStrandMap = ::dsc::counting_densehash_map<KmerType, uint32_t, SingleStrandParams,
+    ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false> >;
+using CanonicalMap = ::dsc::counting_densehash_map<KmerType, uint32_t, CanonicalParams,
+    ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+
+
+class KmerNeighborsMapTest : public ::testing::Test
+{
+  protected:
+    std::vector<KmerType> input;
+    std::vector<KmerType> queries;
+
+    virtual void SetUp() {
+      ::mxx::comm comm;
+      std::default_random_engine gen(17 + comm.rank());
+      // a small range, so that neighborhoods overlap and counts vary.
+      std::uniform_int_distribution<uint64_t> dist(1, 3000);
+      std::uniform_int_distribution<uint64_t> any;
+
+      for (size_t i = 0; i < 5000; ++i) {
+        KmerType k;
+        k.getDataRef()[0] = dist(gen);
+        input.push_back(k);
+      }
+
+      // present kmers, 1 substitution away, and far away.  includes duplicates.
+      std::uniform_int_distribution<unsigned int> idx(1, Neighbors::count - 1);
+      for (size_t i = 0; i < 300; ++i) {
+        queries.push_back(input[i * 7]);
+        queries.push_back(Neighbors::get(input[i * 5], idx(gen)));
+        KmerType k;
+        k.getDataRef()[0] = any(gen) & ((static_cast<uint64_t>(1) << 62) - 1);
+        queries.push_back(k);
+      }
+    }
+
+    template <typename Map, typename Trans>
+    void check(Trans const & trans) {
+      ::mxx::comm comm;
+
+      Map map(comm);
+      std::vector<KmerType> temp(input);
+      map.insert(temp);
+
+      std::vector<std::pair<KmerType, uint32_t> > entries;
+      map.to_vector(entries);
+      auto all = ::mxx::allgatherv(entries, comm);
+      std::map<KmerType, uint32_t> gold(all.begin(), all.end());
+
+      auto results = map.find_neighbors(queries);
+      ASSERT_EQ(queries.size(), results.size());
+
+      size_t found = 0;
+      for (size_t i = 0; i < queries.size(); ++i) {
+        // reference:  look up every neighbor.
+        Hits expected;
+        for (unsigned int j = 0; j < Neighbors::count; ++j) {
+          KmerType nb = Neighbors::get(queries[i], j);
+          if ((j > 0) && (nb == queries[i])) continue;   // not a valid substitution.
+          auto it = gold.find(trans(nb));
+          if (it != gold.end()) expected.add(j, it->second);
+        }
+
+        EXPECT_EQ(expected.found(), results[i].found());
+        EXPECT_EQ(expected.best, results[i].best);
+        EXPECT_EQ(expected.hit_count(), results[i].hit_count());
+        if (expected.found()) {
+          EXPECT_EQ(expected.best_value, results[i].best_value);
+          ++found;
+        }
+        for (unsigned int j = 0; j < Hits::n_words; ++j) EXPECT_EQ(expected.hits[j], results[i].hits[j]);
+      }
+      // present and 1 substitution away queries always hit.
+      EXPECT_GE(found, 600UL);
+
+      // empty query.
+      std::vector<KmerType> none;
+      EXPECT_EQ(0UL, map.find_neighbors(none).size());
+    }
+};
+
+
+TEST_F(KmerNeighborsMapTest, single_strand)
+{
+  this->template check<SingleStrandMap>(::bliss::transform::identity<KmerType>());
+}
+
+TEST_F(KmerNeighborsMapTest, canonical)
+{
+  this->template check<CanonicalMap>(::bliss::kmer::transform::lex_less<KmerType>());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
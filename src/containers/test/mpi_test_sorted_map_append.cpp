@@ -0,0 +1,336 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_sorted_map_append.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test incremental append to the distributed sorted maps, and incremental index update from files,
+ *          against building from all of the input at once.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "containers/distributed_sorted_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
+#include "io/sequence_iterator.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using SortedParams = ::bliss::index::kmer::CanonicalSortedMapParams<Key>;
+template <typename Key>
+using HashParams = ::bliss::index::kmer::CanonicalHashMapParams<Key>;
+
+using CountMapType = ::dsc::counting_sorted_map<KmerType, uint32_t, SortedParams>;
+using MapType = ::dsc::sorted_map<KmerType, uint32_t, SortedParams>;
+using MultimapType = ::dsc::sorted_multimap<KmerType, uint32_t, SortedParams>;
+using CompressedMultimapType = ::dsc::compressed_sorted_multimap<KmerType, uint32_t, SortedParams>;
+using HashMapType = ::dsc::counting_densehash_map<KmerType, uint32_t, HashParams,
+    ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+
+
+class SortedMapAppendTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::vector<KmerType> > batches;
+
+    virtual void SetUp() {
+      ::mxx::comm comm;
+      std::default_random_engine gen(5 + comm.rank());
+      std::uniform_int_distribution<uint64_t> dist(1, 4000);
+
+      batches.resize(4);
+      for (size_t b = 0; b < batches.size(); ++b) {
+        // later batches add new keys as well.
+        std::uniform_int_distribution<uint64_t> d(1, 4000 * (b + 1));
+        for (size_t i = 0; i < 2000; ++i) {
+          KmerType k;
+          k.getDataRef()[0] = d(gen);
+          batches[b].push_back(k);
+        }
+      }
+    }
+
+    template <typename Map>
+    std::map<KmerType, uint32_t> gather(Map const & map, ::mxx::comm const & comm) {
+      std::vector<std::pair<KmerType, uint32_t> > entries;
+      map.to_vector(entries);
+      auto all = ::mxx::allgatherv(entries, comm);
+      std::map<KmerType, uint32_t> result;
+      for (auto const & x : all) {
+        EXPECT_EQ(0UL, result.count(x.first));
+        result[x.first] = x.second;
+      }
+      return result;
+    }
+
+    std::map<KmerType, uint32_t> gold(size_t nbatches, ::mxx::comm const & comm) {
+      CountMapType map(comm);
+      for (size_t b = 0; b < nbatches; ++b) {
+        std::vector<KmerType> temp(batches[b]);
+        map.insert(temp);
+      }
+      map.get_multiplicity();   // redistributes.
+      return gather(map, comm);
+    }
+};
+
+
+TEST_F(SortedMapAppendTest, append)
+{
+  ::mxx::comm comm;
+  auto expected = gold(batches.size(), comm);
+
+  CountMapType map(comm);
+  for (auto const & b : batches) {
+    std::vector<KmerType> temp(b);
+    EXPECT_EQ(b.size(), map.append(temp));
+  }
+  EXPECT_EQ(expected, gather(map, comm));
+
+  // queries use the kept splitters.
+  std::vector<KmerType> query(batches[0]);
+  query.insert(query.end(), batches[3].begin(), batches[3].end());
+  auto found = map.find(query);
+  for (auto const & x : found) {
+    EXPECT_EQ(expected[x.first], x.second);
+  }
+  size_t all_found = ::mxx::allreduce(found.size(), std::plus<size_t>(), comm);
+  EXPECT_GT(all_found, 0UL);
+}
+
+TEST_F(SortedMapAppendTest, rebalance)
+{
+  ::mxx::comm comm;
+
+  CountMapType map(comm);
+  std::vector<KmerType> temp(batches[0]);
+  map.append(temp);
+
+  // all new keys go below the first splitter, so to rank 0.
+  std::vector<KmerType> skewed;
+  if (comm.rank() == 0) {
+    for (uint64_t i = 0; i < 3000UL * comm.size(); ++i) {
+      KmerType k;
+      k.getDataRef()[0] = i;   // canonical, since the leading characters are A.
+      skewed.push_back(k);
+    }
+  }
+  map.set_max_imbalance(1.2);
+  map.append(skewed);
+
+  size_t mx = ::mxx::allreduce(map.local_size(), [](size_t const & x, size_t const & y) { return std::max(x, y); }, comm);
+  size_t total = ::mxx::allreduce(map.local_size(), std::plus<size_t>(), comm);
+  EXPECT_LE(static_cast<double>(mx) * comm.size(), 1.2 * total + comm.size());
+
+  // content is the same as inserting everything.
+  CountMapType ref(comm);
+  std::vector<KmerType> temp0(batches[0]);
+  ref.insert(temp0);
+  ref.insert(skewed);
+  ref.get_multiplicity();
+  EXPECT_EQ(gather(ref, comm), gather(map, comm));
+
+  EXPECT_THROW(map.set_max_imbalance(0.5), std::invalid_argument);
+}
+
+TEST_F(SortedMapAppendTest, keep_existing)
+{
+  ::mxx::comm comm;
+
+  // sorted_map keeps the first value of a key.
+  MapType map(comm);
+  std::vector<std::pair<KmerType, uint32_t> > first, second;
+  for (auto const & k : batches[0]) first.emplace_back(k, 1);
+  for (auto const & k : batches[0]) second.emplace_back(k, 2);
+  map.append(first);
+  map.append(second);
+
+  auto result = gather(map, comm);
+  EXPECT_GT(result.size(), 0UL);
+  for (auto const & x : result) EXPECT_EQ(1U, x.second);
+}
+
+TEST_F(SortedMapAppendTest, multimap_append)
+{
+  ::mxx::comm comm;
+
+  // values identify the batch and rank, so that duplicates are kept apart.
+  std::vector<std::vector<std::pair<KmerType, uint32_t> > > inputs(batches.size());
+  for (size_t b = 0; b < batches.size(); ++b)
+    for (auto const & k : batches[b]) inputs[b].emplace_back(k, b * comm.size() + comm.rank());
+
+  MultimapType ref(comm);
+  for (auto const & in : inputs) {
+    std::vector<std::pair<KmerType, uint32_t> > temp(in);
+    ref.insert(temp);
+  }
+  size_t expected_unique = ref.unique_size();   // redistributes.
+  std::vector<std::pair<KmerType, uint32_t> > entries;
+  ref.to_vector(entries);
+  auto expected = ::mxx::allgatherv(entries, comm);
+  std::sort(expected.begin(), expected.end());
+
+  MultimapType map(comm);
+  CompressedMultimapType cmap(comm);
+  for (auto const & in : inputs) {
+    std::vector<std::pair<KmerType, uint32_t> > temp(in);
+    EXPECT_EQ(in.size(), map.append(temp));
+    temp = in;
+    EXPECT_EQ(in.size(), cmap.append(temp));
+    cmap.compress();
+  }
+  EXPECT_EQ(ref.size(), map.size());
+  EXPECT_EQ(expected_unique, map.unique_size());
+  EXPECT_EQ(expected_unique, cmap.unique_size());
+
+  entries.clear();
+  map.to_vector(entries);
+  auto result = ::mxx::allgatherv(entries, comm);
+  std::sort(result.begin(), result.end());
+  EXPECT_EQ(expected, result);
+
+  // queries use the kept splitters, and see every value of a key.
+  std::vector<KmerType> query(batches[0]);
+  query.insert(query.end(), batches[3].begin(), batches[3].end());
+  std::vector<KmerType> q(query);
+  auto gold_counts = ref.count(q);
+  q = query;
+  auto counts = map.count(q);
+  q = query;
+  auto ccounts = cmap.count(q);
+  std::sort(gold_counts.begin(), gold_counts.end());
+  std::sort(counts.begin(), counts.end());
+  std::sort(ccounts.begin(), ccounts.end());
+  EXPECT_EQ(gold_counts, counts);
+  EXPECT_EQ(gold_counts, ccounts);
+
+  // this rank's queries, against all of the entries.
+  std::sort(query.begin(), query.end());
+  query.erase(std::unique(query.begin(), query.end()), query.end());
+  std::vector<std::pair<KmerType, uint32_t> > gold_found;
+  for (auto const & k : query) {
+    auto range = std::equal_range(expected.begin(), expected.end(), std::make_pair(k, 0U),
+                                  [](std::pair<KmerType, uint32_t> const & x, std::pair<KmerType, uint32_t> const & y) {
+      return x.first < y.first;
+    });
+    gold_found.insert(gold_found.end(), range.first, range.second);
+  }
+  q = query;
+  auto found = cmap.find(q);
+  std::sort(found.begin(), found.end());
+  EXPECT_EQ(gold_found, found);
+  EXPECT_GT(found.size(), 0UL);
+}
+
+TEST(IndexUpdate, update_from)
+{
+  ::mxx::comm comm;
+
+  std::string f1(PROJ_SRC_DIR);
+  f1.append("/test/data/test.small.fastq");
+  std::string f2(PROJ_SRC_DIR);
+  f2.append("/test/data/test.debruijn.small.fastq");
+
+  // sorted map:  build, then update.  vs build from both.
+  {
+    ::bliss::index::kmer::CountIndex2<CountMapType> idx(comm);
+    idx.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(std::vector<std::string>(1, f1), comm);
+    size_t before = idx.size();
+    idx.template update_from<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(std::vector<std::string>(1, f2), comm);
+    EXPECT_GT(idx.size(), before);
+
+    ::bliss::index::kmer::CountIndex2<CountMapType> ref(comm);
+    ref.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(std::vector<std::string>{f1, f2}, comm);
+
+    std::vector<std::pair<KmerType, uint32_t> > a, b;
+    idx.get_map().to_vector(a);
+    ref.get_map().to_vector(b);
+    auto all_a = ::mxx::allgatherv(a, comm);
+    auto all_b = ::mxx::allgatherv(b, comm);
+    std::map<KmerType, uint32_t> ma(all_a.begin(), all_a.end()), mb(all_b.begin(), all_b.end());
+    EXPECT_EQ(mb, ma);
+  }
+
+  // hashed map:  inserts into the existing tables.
+  {
+    ::bliss::index::kmer::CountIndex2<HashMapType> idx(comm);
+    idx.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(std::vector<std::string>(1, f1), comm);
+    idx.template update_from<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(std::vector<std::string>(1, f2), comm);
+
+    ::bliss::index::kmer::CountIndex2<HashMapType> ref(comm);
+    ref.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(std::vector<std::string>{f1, f2}, comm);
+
+    std::vector<std::pair<KmerType, uint32_t> > a, b;
+    idx.get_map().to_vector(a);
+    ref.get_map().to_vector(b);
+    auto all_a = ::mxx::allgatherv(a, comm);
+    auto all_b = ::mxx::allgatherv(b, comm);
+    std::map<KmerType, uint32_t> ma(all_a.begin(), all_a.end()), mb(all_b.begin(), all_b.end());
+    EXPECT_EQ(mb, ma);
+  }
+
+  // unsupported extension.
+  ::bliss::index::kmer::CountIndex2<CountMapType> idx(comm);
+  EXPECT_THROW((idx.template update_from<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(std::vector<std::string>(1, "reads.txt"), comm)),
+               std::invalid_argument);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
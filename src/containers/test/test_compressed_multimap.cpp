@@ -0,0 +1,133 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "containers/compressed_multimap.hpp"
+#include "common/sequence.hpp"
+
+#include <unordered_map>
+#include <random>
+#include <algorithm>
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename T>
+class CompressedMultimapTest : public ::testing::Test
+{
+  protected:
+    ::std::unordered_multimap<uint32_t, uint64_t> gold;
+    ::fsc::compressed_multimap<uint32_t, T> test;
+
+    size_t iters = 100000;
+
+    virtual void SetUp()
+    { // generate some inputs
+      std::default_random_engine generator;
+      std::uniform_int_distribution<uint32_t> key_dist(0,999);
+      std::uniform_int_distribution<uint64_t> val_dist(0, 0x000000FFFFFFFFFFUL);
+
+      ::std::vector<::std::pair<uint32_t, T> > input;
+      for (size_t i=0; i< iters; ++i) {
+        uint32_t key = key_dist(generator);
+        uint64_t val = val_dist(generator);
+        input.emplace_back(key, ::fsc::posting_codec<T>::decode(val));
+        gold.emplace(key, val);
+      }
+      test.build(input);
+    }
+
+    ::std::vector<uint64_t> gold_values(uint32_t k) {
+      ::std::vector<uint64_t> vals;
+      auto range = gold.equal_range(k);
+      for (auto it = range.first; it != range.second; ++it) vals.emplace_back(it->second);
+      ::std::sort(vals.begin(), vals.end());
+      return vals;
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(CompressedMultimapTest);
+
+
+TYPED_TEST_P(CompressedMultimapTest, count)
+{
+  EXPECT_EQ(this->iters, this->test.size());
+  for (uint32_t i = 0; i < 1005; ++i) {
+    EXPECT_EQ(this->gold.count(i), this->test.count(i));
+  }
+}
+
+TYPED_TEST_P(CompressedMultimapTest, find_values)
+{
+  for (uint32_t i = 0; i < 1005; ++i) {
+    ::std::vector<TypeParam> found;
+    size_t n = this->test.find_values(i, ::std::back_inserter(found));
+
+    auto gold_vals = this->gold_values(i);
+    EXPECT_EQ(gold_vals.size(), n);
+
+    // values are decoded in ascending order.
+    ::std::vector<uint64_t> test_vals;
+    for (auto v : found) test_vals.emplace_back(::fsc::posting_codec<TypeParam>::encode(v));
+    EXPECT_TRUE(::std::equal(gold_vals.begin(), gold_vals.end(), test_vals.begin()));
+  }
+}
+
+TYPED_TEST_P(CompressedMultimapTest, batch_find)
+{
+  ::std::vector<uint32_t> query;
+  for (uint32_t i = 0; i < 1005; i += 3) query.emplace_back(i);
+  query.emplace_back(3);  // duplicate is skipped.
+
+  size_t expected = 0;
+  for (uint32_t i = 0; i < 1005; i += 3) expected += this->gold.count(i);
+
+  auto results = this->test.find(query);
+  EXPECT_EQ(expected, results.size());
+  for (auto r : results) {
+    EXPECT_EQ(0U, r.first % 3);
+  }
+}
+
+TYPED_TEST_P(CompressedMultimapTest, to_vector)
+{
+  ::std::vector<::std::pair<uint32_t, TypeParam> > output;
+  this->test.to_vector(output);
+  EXPECT_EQ(this->iters, output.size());
+
+  ::std::vector<::std::pair<uint32_t, uint64_t> > test_vals;
+  for (auto x : output) test_vals.emplace_back(x.first, ::fsc::posting_codec<TypeParam>::encode(x.second));
+  ::std::vector<::std::pair<uint32_t, uint64_t> > gold_vals(this->gold.begin(), this->gold.end());
+  ::std::sort(gold_vals.begin(), gold_vals.end());
+
+  // already sorted by key then value.
+  EXPECT_TRUE(::std::equal(gold_vals.begin(), gold_vals.end(), test_vals.begin()));
+
+  // compressed is smaller than the pair array.
+  EXPECT_LT(this->test.memory_usage(), this->iters * sizeof(::std::pair<uint32_t, TypeParam>));
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(CompressedMultimapTest, count, find_values, batch_find, to_vector);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<uint64_t, ::bliss::common::LongSequenceKmerId, ::bliss::common::ShortSequenceKmerId> CompressedMultimapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, CompressedMultimapTest, CompressedMultimapTestTypes);
@@ -403,6 +403,143 @@ INSTANTIATE_TYPED_TEST_CASE_P(Bliss, DenseHashMapFullTest, DenseHashMapFullTestT
 
 
 
+/*
+ * segmented map uses the same inputs as the partial key space map test.
+ */
+template<typename T>
+class DenseHashSegmentedMapTest : public DenseHashMapPartialTest<T> {};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(DenseHashSegmentedMapTest);
+
+
+TYPED_TEST_P(DenseHashSegmentedMapTest, insert_segmented)
+{
+  using MAP = ::fsc::densehash_segmented_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+  EXPECT_EQ(16UL, test.segment_count());
+  EXPECT_EQ(this->gold.size(), test.size());
+
+  ::std::vector<::std::pair<TypeParam, TypeParam> > test_vals = test.to_vector();
+  ::std::vector<::std::pair<TypeParam, TypeParam> > gold_vals(this->gold.begin(), this->gold.end());
+
+  ::std::sort(test_vals.begin(), test_vals.end());
+  ::std::sort(gold_vals.begin(), gold_vals.end());
+
+  EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+
+  // iterating over all segments should visit every entry once.
+  size_t visited = 0;
+  for (auto it = test.begin(); it != test.end(); ++it) {
+    EXPECT_EQ(this->gold.at((*it).first), (*it).second);
+    ++visited;
+  }
+  EXPECT_EQ(this->gold.size(), visited);
+}
+
+
+TYPED_TEST_P(DenseHashSegmentedMapTest, count_segmented)
+{
+  using MAP = ::fsc::densehash_segmented_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  for (auto i : this->gold) {
+    EXPECT_EQ(1UL, test.count(i.first));
+    EXPECT_TRUE(test.exists(i.first));
+
+    auto test_range = test.equal_range(i.first);
+    ASSERT_TRUE(test_range.first != test_range.second);
+    EXPECT_EQ(i.second, (*(test_range.first)).second);
+  }
+}
+
+TYPED_TEST_P(DenseHashSegmentedMapTest, erase_segmented)
+{
+  using MAP = ::fsc::densehash_segmented_map<TypeParam, TypeParam>;
+
+  MAP test(this->temp.begin(), this->temp.end());
+
+  ::std::vector<TypeParam> ks = test.keys();
+  ks.resize(ks.size() / 2);
+
+  size_t erased = test.erase(ks.begin(), ks.end());
+  EXPECT_EQ(ks.size(), erased);
+  EXPECT_EQ(this->gold.size() - ks.size(), test.size());
+
+  for (auto k : ks) {
+    EXPECT_EQ(0UL, test.count(k));
+  }
+}
+
+TYPED_TEST_P(DenseHashSegmentedMapTest, reserve_segmented)
+{
+  using MAP = ::fsc::densehash_segmented_map<TypeParam, TypeParam>;
+
+  MAP test(128UL, 2);
+  EXPECT_EQ(4UL, test.segment_count());
+  EXPECT_TRUE(test.empty());
+
+  test.resize(this->temp.size());
+  EXPECT_LE(this->temp.size(), test.bucket_count());
+
+  test.insert(this->temp);
+  EXPECT_EQ(this->gold.size(), test.size());
+  EXPECT_LE(test.size(), test.bucket_count());
+}
+
+
+TYPED_TEST_P(DenseHashSegmentedMapTest, iterate_segmented)
+{
+  using MAP = ::fsc::densehash_segmented_map<TypeParam, TypeParam>;
+
+  MAP test;
+  EXPECT_TRUE(test.begin() == test.end());
+  EXPECT_TRUE(test.cbegin() == test.cend());
+
+  // few entries, so most of the segments are empty.
+  ::std::vector<::std::pair<TypeParam, TypeParam> > few(this->temp.begin(), this->temp.begin() + 3);
+  test.insert(few);
+
+  size_t visited = 0;
+  for (auto it = test.cbegin(); it != test.cend(); ++it) ++visited;
+  EXPECT_EQ(test.size(), visited);
+
+  // find continues to the end of the map, and copies keep their position.
+  size_t from_first = 0;
+  for (auto k : test.keys()) {
+    auto it = test.find(k);
+    ASSERT_TRUE(it != test.end());
+    EXPECT_EQ(k, it->first);
+
+    auto copy = it;
+    size_t n = 0;
+    for (; it != test.end(); ++it) ++n;
+    EXPECT_LE(1UL, n);
+    EXPECT_EQ(k, (*copy).first);
+    from_first = ::std::max(from_first, n);
+  }
+  EXPECT_EQ(test.size(), from_first);
+
+  // end iterators can be copied.
+  auto e = test.end();
+  auto e2 = e;
+  EXPECT_TRUE(e2 == test.end());
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(DenseHashSegmentedMapTest, insert_segmented, count_segmented, erase_segmented, reserve_segmented, iterate_segmented);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<uint16_t, uint32_t, uint64_t> DenseHashSegmentedMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, DenseHashSegmentedMapTest, DenseHashSegmentedMapTestTypes);
+
+
+
 
 
 
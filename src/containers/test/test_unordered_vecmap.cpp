@@ -572,3 +572,195 @@ typedef ::testing::Types<int8_t, int16_t, int32_t,
     int64_t, uint64_t> UnorderedVecMapTestTypes;
 INSTANTIATE_TYPED_TEST_CASE_P(Bliss, UnorderedVecMapTest, UnorderedVecMapTestTypes);
 
+
+
+
+
+/*
+ * test class holding some information.  Also, needed for the typed tests
+ */
+template<typename T>
+class UnorderedCSRVecMapTest : public ::testing::Test
+{
+  protected:
+    ::std::unordered_multimap<T, T> gold;
+    ::fsc::unordered_csr_vecmap<T, T> test;
+
+    size_t iters = 100000;
+
+    virtual void SetUp()
+    { // generate some inputs
+
+
+      std::default_random_engine generator;
+      std::uniform_int_distribution<T> distribution(0,99);
+
+
+      for (size_t i=0; i< iters; ++i) {
+        T key = distribution(generator);
+        T val = distribution(generator);
+        test.emplace(::std::move(key), ::std::move(val));
+        gold.emplace(key, val);
+      }
+      // single inserts may leave staged entries.
+      test.compact();
+
+    }
+};
+
+// indicate this is a typed test
+TYPED_TEST_CASE_P(UnorderedCSRVecMapTest);
+
+TYPED_TEST_P(UnorderedCSRVecMapTest, insert)
+{
+  using valType = ::std::pair<TypeParam, TypeParam>;
+
+  ::fsc::unordered_csr_vecmap<TypeParam, TypeParam> test2(this->gold.begin(), this->gold.end());
+
+  ::std::vector<valType> test_vals(test2.begin(), test2.end());
+  ::std::vector<valType> gold_vals(this->gold.begin(), this->gold.end());
+
+  ::std::sort(test_vals.begin(), test_vals.end());
+  ::std::sort(gold_vals.begin(), gold_vals.end());
+
+  EXPECT_EQ(gold_vals.size(), test2.size());
+  EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+
+  // second bulk insert merges into existing ranges.
+  test2.insert(this->gold.begin(), this->gold.end());
+  EXPECT_EQ(2 * this->iters, test2.size());
+  for (int i = 0; i < 99; ++i) {
+    EXPECT_EQ(2 * this->gold.count(i), test2.count(i));
+  }
+}
+
+TYPED_TEST_P(UnorderedCSRVecMapTest, equal_range)
+{
+  for (int i = 0; i < 99; ++i) {
+    auto test_range = this->test.equal_range(i);
+    auto gold_range = this->gold.equal_range(i);
+
+    ::std::vector<TypeParam> test_vals;
+    ::std::vector<TypeParam> gold_vals;
+
+    for (auto it = test_range.first; it != test_range.second; ++it) {
+      EXPECT_EQ(static_cast<TypeParam>(i), (*it).first);
+      test_vals.push_back((*it).second);
+    }
+    for (auto it = gold_range.first; it != gold_range.second; ++it) {
+      gold_vals.push_back(it->second);
+    }
+
+    EXPECT_EQ(gold_vals.size(), test_vals.size());
+
+    ::std::sort(test_vals.begin(), test_vals.end());
+    ::std::sort(gold_vals.begin(), gold_vals.end());
+
+    EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+  }
+}
+
+TYPED_TEST_P(UnorderedCSRVecMapTest, equal_range_value_only)
+{
+  for (int i = 0; i < 99; ++i) {
+    auto test_range = this->test.equal_range_value_only(i);
+    auto gold_range = this->gold.equal_range(i);
+
+    ::std::vector<TypeParam> test_vals(test_range.first, test_range.second);
+    ::std::vector<TypeParam> gold_vals;
+    for (auto it = gold_range.first; it != gold_range.second; ++it) {
+      gold_vals.push_back(it->second);
+    }
+
+    ::std::sort(test_vals.begin(), test_vals.end());
+    ::std::sort(gold_vals.begin(), gold_vals.end());
+
+    EXPECT_EQ(gold_vals.size(), test_vals.size());
+    EXPECT_TRUE(::std::equal(test_vals.begin(), test_vals.end(), gold_vals.begin()));
+  }
+}
+
+TYPED_TEST_P(UnorderedCSRVecMapTest, count)
+{
+  for (int i = 0; i < 99; ++i) {
+    EXPECT_EQ(this->gold.count(i), this->test.count(i));
+  }
+  EXPECT_EQ(this->iters, this->test.size());
+}
+
+TYPED_TEST_P(UnorderedCSRVecMapTest, erase)
+{
+  size_t removed = 0;
+  for (int i = 0; i < 99; i += 2) {
+    EXPECT_EQ(this->gold.count(i), this->test.erase(i));
+    removed += this->gold.count(i);
+  }
+  // remove odd values from odd keys.
+  for (int i = 1; i < 99; i += 2) {
+    size_t odd = 0;
+    auto gold_range = this->gold.equal_range(i);
+    for (auto it = gold_range.first; it != gold_range.second; ++it) {
+      if ((it->second & 1) == 1) ++odd;
+    }
+    EXPECT_EQ(odd, this->test.erase(i, [](TypeParam const & x) { return (x & 1) == 1; }));
+    removed += odd;
+  }
+  EXPECT_EQ(this->iters - removed, this->test.size());
+
+  // compaction after erase keeps the remaining entries.
+  this->test.shrink_to_fit();
+  EXPECT_EQ(this->iters - removed, this->test.size());
+  EXPECT_EQ(this->iters - removed, static_cast<size_t>(::std::distance(this->test.begin(), this->test.end())));
+  for (int i = 0; i < 99; i += 2) {
+    EXPECT_EQ(0UL, this->test.count(i));
+  }
+}
+
+
+TYPED_TEST_P(UnorderedCSRVecMapTest, staged)
+{
+  // too few single inserts to trigger a compaction.  size() agrees with the queries.
+  ::fsc::unordered_csr_vecmap<TypeParam, TypeParam> test2;
+  for (int i = 0; i < 10; ++i) test2.emplace(static_cast<TypeParam>(i % 3), static_cast<TypeParam>(i));
+  EXPECT_EQ(10UL, test2.staged_size());
+  EXPECT_EQ(0UL, test2.size());
+  EXPECT_TRUE(test2.empty());
+  EXPECT_EQ(0UL, test2.count(0));
+  EXPECT_EQ(0L, ::std::distance(test2.begin(), test2.end()));
+
+  test2.compact();
+  EXPECT_EQ(0UL, test2.staged_size());
+  EXPECT_EQ(10UL, test2.size());
+  EXPECT_FALSE(test2.empty());
+  EXPECT_EQ(4UL, test2.count(0));
+  EXPECT_EQ(10L, ::std::distance(test2.begin(), test2.end()));
+
+  // staged entries of a key with compacted entries are not counted either.
+  test2.emplace(static_cast<TypeParam>(0), static_cast<TypeParam>(10));
+  EXPECT_EQ(10UL, test2.size());
+  EXPECT_EQ(4UL, test2.count(0));
+}
+
+TYPED_TEST_P(UnorderedCSRVecMapTest, multiplicity)
+{
+  // key 1 once, key 2 three times:  mean 2, stdev 1.
+  ::std::vector<::std::pair<TypeParam, TypeParam> > input = {{1, 1}, {2, 1}, {2, 2}, {2, 3}};
+  ::fsc::unordered_csr_vecmap<TypeParam, TypeParam> test2(input.begin(), input.end());
+
+  EXPECT_EQ(2UL, test2.unique_size());
+  EXPECT_EQ(1UL, test2.get_min_multiplicity());
+  EXPECT_EQ(3UL, test2.get_max_multiplicity());
+  EXPECT_DOUBLE_EQ(2.0, test2.get_mean_multiplicity());
+  EXPECT_DOUBLE_EQ(1.0, test2.get_stdev_multiplicity());
+}
+
+
+// now register the test cases
+REGISTER_TYPED_TEST_CASE_P(UnorderedCSRVecMapTest, insert, equal_range, equal_range_value_only, count, erase, staged, multiplicity);
+
+
+//////////////////// RUN the tests with different types.
+
+typedef ::testing::Types<int8_t, int16_t, int32_t,
+    int64_t, uint64_t> UnorderedCSRVecMapTestTypes;
+INSTANTIATE_TYPED_TEST_CASE_P(Bliss, UnorderedCSRVecMapTest, UnorderedCSRVecMapTestTypes);
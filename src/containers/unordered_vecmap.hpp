@@ -32,6 +32,8 @@
 #include <scoped_allocator>
 #include <algorithm>
 #include <cmath>   // ceil
+#include <limits>
+#include <iterator>
 //#include "ext/pool_allocator.h"
 
 #include "utils/logging.h"
@@ -1529,6 +1531,492 @@ using allocator = std::allocator<T>;
   };
 
 
+  /**
+   * @brief multimap with CSR layout: unique keys index into one flat value array.
+   * @details  unordered_vecmap allocates a separate vector per key, and each value carries a copy of the key.
+   *          this class stores all values contiguously, grouped by key (compressed sparse row):
+   *            index:   unordered_map<Key, (offset, count)>, one node per unique key
+   *            values:  single vector<T>, entries for a key are values[offset, offset + count)
+   *          there is no per key heap allocation for values, and equal_range_value_only returns
+   *          a contiguous pointer range.
+   *
+   *          the layout is designed for bulk build.  inserted entries are first appended to a staging
+   *          buffer, which is merged into the CSR arrays by compact().  a merge sorts the staging buffer by
+   *          key (Comparator), then rewrites the value array once, appending new values to existing keys'
+   *          ranges and new keys at the end.
+   *          bulk insert compacts at the end.  single inserts compact once the staging buffer is as large as
+   *          the map, so the rewrites are amortized.  erase compacts first, and only updates the index,
+   *          leaving holes in the value array until the next compact() or shrink_to_fit().
+   *          Comparator has to order keys consistently with Equal.
+   *
+   *      memory usage:
+   *        index node has Key + 2 size_t + hash node overhead, U unique elements.
+   *        values store T only, N elements.
+   *        total: sizeof(T) N + (sizeof(Key) + 32) U + 8 HU, compared to (16N or 24N) + 24U + 16 HU for unordered_vecmap.
+   *
+   *      NOTE: queries do not compact.  entries that are still staged after single inserts are not visible
+   *          to queries, nor counted by size() and empty(), until compact() is called.  see staged_size().
+   *          const queries do not modify the map.
+   */
+  template <typename Key,
+  typename T,
+  typename Hash = ::std::hash<Key>,
+  typename Comparator = ::std::less<Key>,
+  typename Equal = ::std::equal_to<Key>,
+  typename Allocator = ::fsc::allocator<::std::pair<Key, T> > >
+  class unordered_csr_vecmap {
+
+    public:
+      using size_type             = size_t;
+
+    protected:
+      struct Less {
+        Comparator l;
+
+        inline bool operator()(Key const &x, Key const &y ) const {
+          return l(x, y);
+        }
+
+        template <typename V>
+        inline bool operator()(::std::pair<Key, V> const & x, ::std::pair<Key, V> const & y) const {
+          return l(x.first, y.first);
+        }
+        template <typename V>
+        inline bool operator()(::std::pair<Key, V> const & x, Key const & y) const {
+          return l(x.first, y);
+        }
+        template <typename V>
+        inline bool operator()(Key const & x, ::std::pair<Key, V> const & y) const {
+          return l(x, y.first);
+        }
+      };
+
+      /// position of a key's values in the flat value array.
+      struct csr_range {
+          size_type offset;
+          size_type count;
+      };
+
+      using staging_type = ::std::vector<::std::pair<Key, T>,
+          typename ::std::allocator_traits<Allocator>::template rebind_alloc<::std::pair<Key, T> > >;
+      using value_container_type = ::std::vector<T,
+          typename ::std::allocator_traits<Allocator>::template rebind_alloc<T> >;
+      using index_container_type = ::std::unordered_map<Key, csr_range, Hash, Equal,
+          typename ::std::allocator_traits<Allocator>::template rebind_alloc<::std::pair<const Key, csr_range> > >;
+
+      using subiter_type = typename value_container_type::iterator;
+      using const_subiter_type = typename value_container_type::const_iterator;
+
+      /**
+       * @brief forward iterator over the CSR map.  dereferences to (key, value) pair constructed on the fly.
+       */
+      template<typename V>
+      class csr_iter :
+    public ::std::iterator<
+    typename ::std::forward_iterator_tag,
+    V
+    >
+      {
+        protected:
+          using index_iter_type = typename index_container_type::const_iterator;
+          using type = csr_iter<V>;
+
+          index_iter_type curr_iter;
+          index_iter_type max_iter;
+          T const * vals;
+          size_type pos;
+
+          /// skip empty ranges
+          void ensure_dereferenceable() {
+            while ((curr_iter != max_iter) && (pos >= curr_iter->second.count)) {
+              ++curr_iter;
+              pos = 0;
+            }
+          }
+
+        public:
+          csr_iter(index_iter_type _iter, index_iter_type _end, T const * _vals, size_type _pos = 0) :
+            curr_iter(_iter), max_iter(_end), vals(_vals), pos(_pos) {
+            ensure_dereferenceable();
+          };
+
+          type& operator++() {
+            if (curr_iter != max_iter) {
+              ++pos;
+              ensure_dereferenceable();
+            }
+            return *this;
+          }
+
+          type operator++(int) {
+            type output(*this);
+            this->operator++();
+            return output;
+          }
+
+          bool operator==(const type& rhs) const {
+            if (curr_iter == max_iter) return rhs.curr_iter == rhs.max_iter;
+            return (curr_iter == rhs.curr_iter) && (pos == rhs.pos);
+          }
+          bool operator!=(const type& rhs) const {
+            return !(this->operator==(rhs));
+          }
+
+          inline V operator*() const {
+            return V(curr_iter->first, vals[curr_iter->second.offset + pos]);
+          }
+      };
+
+
+      /// minimum staging size before single inserts trigger a compaction.
+      static constexpr size_type min_staged = 4096;
+
+      index_container_type index;
+      value_container_type values;
+      staging_type staging;
+      /// number of valid entries in index/values.  excludes staged entries.
+      size_type s;
+
+      /// compact once the staged entries are as many as the compacted ones, so each entry is rewritten O(1) times on average.
+      inline void amortized_compact() {
+        if (staging.size() >= ((s < min_staged) ? min_staged : s)) compact();
+      }
+
+    public:
+      using key_type              = Key;
+      using mapped_type           = T;
+      using value_type            = ::std::pair<const Key, T>;
+      using hasher                = Hash;
+      using key_equal             = Equal;
+      using allocator_type        = Allocator;
+      using reference             = value_type&;
+      using const_reference       = const value_type&;
+      using pointer               = typename std::allocator_traits<Allocator>::pointer;
+      using const_pointer         = typename std::allocator_traits<Allocator>::const_pointer;
+      using iterator              = csr_iter<value_type>;
+      using const_iterator        = csr_iter<const value_type>;
+      using difference_type       = typename value_container_type::difference_type;
+
+
+      /// the first parameter is the load factor of the other vecmaps.  it does not apply here.
+      unordered_csr_vecmap(size_type = 1,
+                   size_type bucket_count = 128,
+                         const Hash& hash = Hash(),
+                         const Equal& equal = Equal(),
+                         const Allocator& alloc = Allocator()) :
+                           index(bucket_count, hash, equal, alloc), values(alloc), staging(alloc),
+                           s(0UL) {};
+
+      template<class InputIt>
+      unordered_csr_vecmap(InputIt first, InputIt last,
+                         size_type load_factor = 1,
+                         size_type bucket_count = 128,
+                         const Hash& hash = Hash(),
+                         const Equal& equal = Equal(),
+                         const Allocator& alloc = Allocator()) :
+                         unordered_csr_vecmap(load_factor, bucket_count, hash, equal, alloc) {
+          this->insert(first, last);
+      };
+
+      virtual ~unordered_csr_vecmap() {};
+
+
+      /**
+       * @brief merge the staged entries into the CSR arrays, and drop holes left by erase.
+       * @details existing keys' values keep their relative order, and new values for a key are appended after them.
+       */
+      void compact() {
+        if (staging.empty() && (values.size() == s)) return;
+
+        Less less;
+        ::std::stable_sort(staging.begin(), staging.end(), less);
+
+        value_container_type new_values;
+        new_values.reserve(s + staging.size());
+
+        // existing keys: copy old range, then append matching staged entries.
+        auto smax = staging.end();
+        for (auto it = index.begin(), max = index.end(); it != max; ++it) {
+          size_type offset = new_values.size();
+          new_values.insert(new_values.end(), values.begin() + it->second.offset,
+                            values.begin() + it->second.offset + it->second.count);
+
+          if (staging.size() > 0) {
+            auto range = ::std::equal_range(staging.begin(), smax, it->first, less);
+            for (; range.first != range.second; ++range.first) {
+              new_values.emplace_back(range.first->second);
+            }
+          }
+          it->second.offset = offset;
+          it->second.count = new_values.size() - offset;
+        }
+
+        // new keys.  staging is sorted, so each new key is one contiguous group.
+        for (auto it = staging.begin(); it != smax;) {
+          auto group_end = ::std::upper_bound(it, smax, it->first, less);
+
+          if (index.find(it->first) == index.end()) {
+            size_type offset = new_values.size();
+            for (auto vit = it; vit != group_end; ++vit) {
+              new_values.emplace_back(vit->second);
+            }
+            index.emplace(it->first, csr_range{offset, new_values.size() - offset});
+          }
+          it = group_end;
+        }
+
+        values.swap(new_values);
+        s = values.size();
+        staging_type().swap(staging);
+      }
+
+
+      iterator begin() {
+        return iterator(index.cbegin(), index.cend(), values.data());
+      }
+      const_iterator begin() const {
+        return cbegin();
+      }
+      const_iterator cbegin() const {
+        return const_iterator(index.cbegin(), index.cend(), values.data());
+      }
+
+      iterator end() {
+        return iterator(index.cend(), index.cend(), values.data());
+      }
+      const_iterator end() const {
+        return cend();
+      }
+      const_iterator cend() const {
+        return const_iterator(index.cend(), index.cend(), values.data());
+      }
+
+
+      /// true if there are no compacted entries.  staged entries are not counted, as queries do not see them.
+      bool empty() const {
+        return s == 0;
+      }
+
+      /// number of compacted entries.  staged entries are not counted, as queries do not see them.
+      size_type size() const {
+        return s;
+      }
+
+      /// number of entries staged by single inserts, to be merged by the next compact().
+      size_type staged_size() const {
+        return staging.size();
+      }
+
+      void reset() {
+        s = 0;
+        index_container_type tmp; tmp.swap(index);
+        value_container_type().swap(values);
+        staging_type().swap(staging);
+      }
+
+      void clear() {
+        s = 0;
+        index.clear();
+        values.clear();
+        staging.clear();
+      }
+
+      void swap(unordered_csr_vecmap & other) {
+        index.swap(other.index);
+        values.swap(other.values);
+        staging.swap(other.staging);
+        ::std::swap(s, other.s);
+      }
+
+      /// rehash the key index for new count number of BUCKETS.
+      void rehash(size_type count) {
+        if (count > index.bucket_count())
+          index.rehash(count);
+      }
+
+      /// bucket count.  same as index buckets
+      size_type bucket_count() { return index.bucket_count(); }
+
+      /// max load factor in elements per bucket.
+      float max_load_factor() {
+        return (index.size() == 0) ? index.max_load_factor() : index.max_load_factor() * (static_cast<float>(s) / static_cast<float>(index.size()));
+      }
+
+      /// reserve for new count of elements.  reserves the staging buffer, and value array.
+      void reserve(size_type count) {
+        this->rehash(std::ceil(static_cast<float>(count) / this->max_load_factor()));
+        if (count > s) staging.reserve(count - s);
+      }
+
+      /// insert.  entry is staged until the next compact(), which happens when enough entries are staged.
+      void insert(const value_type & value) {
+        staging.emplace_back(value.first, value.second);
+        amortized_compact();
+      }
+      void insert(value_type && value) {
+        staging.emplace_back(value.first, ::std::move(value.second));
+        amortized_compact();
+      }
+      void emplace(value_type && value) {
+        staging.emplace_back(value.first, ::std::move(value.second));
+        amortized_compact();
+      }
+      void emplace(Key&& key, T&& value) {
+        staging.emplace_back(::std::forward<Key>(key), ::std::forward<T>(value));
+        amortized_compact();
+      }
+
+      /// bulk insert.  stages the entries, then builds the CSR arrays.
+      template <class InputIt>
+      void insert(InputIt first, InputIt last) {
+        staging.reserve(staging.size() + ::std::distance(first, last));
+        for (; first != last; ++first) {
+          staging.emplace_back(first->first, first->second);
+        }
+        compact();
+      }
+
+      /// same as insert for this class.  the input range is not modified.
+      template <class InputIt>
+      void insert_sorted(InputIt first, InputIt last) {
+        this->insert(first, last);
+      }
+
+
+      template <typename Pred>
+      size_t erase(const key_type& key, Pred const & pred) {
+        compact();
+        auto iter = index.find(key);
+        if (iter == index.end()) return 0;
+
+        auto start = values.begin() + iter->second.offset;
+        auto new_end = ::std::remove_if(start, start + iter->second.count, pred);
+        size_t after = ::std::distance(start, new_end);
+        size_t removed = iter->second.count - after;
+
+        if (after == 0) index.erase(iter);
+        else iter->second.count = after;
+
+        s -= removed;  // leaves hole in values.  cleaned up at compact.
+        return removed;
+      }
+
+      size_t erase(const key_type& key) {
+        compact();
+        auto iter = index.find(key);
+        if (iter == index.end()) return 0;
+
+        size_t c = iter->second.count;
+        s -= c;
+        index.erase(iter);
+
+        return c;
+      }
+
+      size_type count(Key const & key) const {
+        auto iter = index.find(key);
+        return (iter == index.end()) ? 0 : iter->second.count;
+      }
+
+      /// merge staged entries, remove holes, and release excess capacity.
+      void shrink_to_fit() {
+        compact();
+        values.shrink_to_fit();
+      }
+
+
+      void report() {
+          BL_INFOF("csr vecmap bucket count: %lu\n", index.bucket_count());
+          BL_INFOF("csr vecmap load factor: %f\n", index.load_factor());
+          BL_INFOF("csr vecmap unique entries: %lu\n", index.size());
+          BL_INFOF("csr vecmap total size: %lu\n", s);
+          BL_INFOF("csr vecmap value capacity: %lu\n", values.capacity());
+      }
+
+
+      size_type unique_size() const {
+        return index.size();
+      }
+
+
+      size_type get_max_multiplicity() const {
+        size_type max_multiplicity = 0;
+        for (auto it = index.cbegin(); it != index.cend(); ++it) {
+          max_multiplicity = ::std::max(max_multiplicity, it->second.count);
+        }
+        return max_multiplicity;
+      }
+
+      size_type get_min_multiplicity() const {
+        size_type min_multiplicity = ::std::numeric_limits<size_type>::max();
+        for (auto it = index.cbegin(); it != index.cend(); ++it) {
+          min_multiplicity = ::std::min(min_multiplicity, it->second.count);
+        }
+        return min_multiplicity;
+      }
+
+      double get_mean_multiplicity() const {
+        return static_cast<double>(s) / double(index.size());
+      }
+      /// sqrt(E[x^2] - mean^2) over the unique keys.
+      double get_stdev_multiplicity() const {
+        double sum_sq = 0;
+        for (auto it = index.cbegin(); it != index.cend(); ++it) {
+          sum_sq += static_cast<double>(it->second.count) * static_cast<double>(it->second.count);
+        }
+        double mean = get_mean_multiplicity();
+        double var = sum_sq / double(index.size()) - mean * mean;
+        return (var > 0.0) ? ::std::sqrt(var) : 0.0;
+      }
+
+
+      /// values for a key, as a contiguous range.
+      ::std::pair<T const *, T const *> equal_range_value_only(Key const & key) const {
+        auto iter = index.find(key);
+
+        if (iter == index.end()) return ::std::make_pair(nullptr, nullptr);
+
+        T const * start = values.data() + iter->second.offset;
+        return ::std::make_pair(start, start + iter->second.count);
+      }
+
+      ::std::pair<iterator, iterator> equal_range(Key const & key) {
+        auto iter = index.find(key);
+
+        if (iter == index.cend()) return ::std::make_pair(end(), end());
+
+        auto next = iter; ++next;
+        return ::std::make_pair(iterator(iter, index.cend(), values.data()),
+                                iterator(next, index.cend(), values.data()));
+      }
+      ::std::pair<const_iterator, const_iterator> equal_range(Key const & key) const {
+        auto iter = index.find(key);
+
+        if (iter == index.cend()) return ::std::make_pair(cend(), cend());
+
+        auto next = iter; ++next;
+        return ::std::make_pair(const_iterator(iter, index.cend(), values.data()),
+                                const_iterator(next, index.cend(), values.data()));
+      }
+      // NO bucket interfaces
+
+  };
+
+
+  template <typename Key, typename T, typename Hash, typename Comparator, typename Equal, typename Allocator>
+  constexpr typename unordered_csr_vecmap<Key, T, Hash, Comparator, Equal, Allocator>::size_type
+  unordered_csr_vecmap<Key, T, Hash, Comparator, Equal, Allocator>::min_staged;
+
+
+  /// unordered_csr_vecmap with the template parameters of std::unordered_multimap, for use as the local container of
+  /// a distributed map.  keys are ordered by operator<, so the storage transform of the map should be identity.
+  template <typename Key, typename T,
+  typename Hash = ::std::hash<Key>,
+  typename Equal = ::std::equal_to<Key>,
+  typename Allocator = ::fsc::allocator<::std::pair<Key, T> > >
+  using unordered_csr_multimap = unordered_csr_vecmap<Key, T, Hash, ::std::less<Key>, Equal, Allocator>;
+
+
 
 } // end namespace fsc.
 
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_dispatch.hpp
+ * @ingroup index
+ * @author  tpan
+ * @brief   select a compile time Kmer specialization from a runtime kmer length and alphabet.
+ * @details Kmer<K, Alphabet, WordType> fixes k and the alphabet at compile time, so that the parsing, hashing,
+ *          and map operations are fully specialized.  kmer_dispatch instantiates a runner for a configured set
+ *          of (alphabet, k) values, and calls the one matching the runtime arguments.  the hot loops stay
+ *          specialized, and 1 binary serves all configured k.
+ *
+ *          the runner is a functor with a member template
+ *            template <typename KmerType> R run(Args...);
+ *          which is called with the selected Kmer type.  all specializations need to return the same type R.
+ *
+ *          alphabets are identified by the same ids used by the benchmark build (pDNA):  4 = DNA, 5 = DNA5, 16 = DNA16.
+ *
+ *          to spread the instantiations over translation units, declare the runner's template in the dispatching TU
+ *          without defining it, and explicitly instantiate it for each (alphabet, k) in separate TUs.
+ */
+#ifndef KMER_DISPATCH_HPP_
+#define KMER_DISPATCH_HPP_
+
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <utility>  // forward
+#include <algorithm>  // find
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+
+namespace bliss
+{
+  namespace index
+  {
+    namespace kmer
+    {
+
+      /// alphabet from its id.  4 = DNA, 5 = DNA5, 16 = DNA16
+      template <unsigned int ID>
+      struct dna_alphabet;
+      template <>
+      struct dna_alphabet<4> { using type = ::bliss::common::DNA; };
+      template <>
+      struct dna_alphabet<5> { using type = ::bliss::common::DNA5; };
+      template <>
+      struct dna_alphabet<16> { using type = ::bliss::common::DNA16; };
+
+      /// list of kmer lengths to instantiate
+      template <unsigned int... Ks>
+      struct kmer_sizes {};
+
+      /// list of alphabet ids to instantiate
+      template <unsigned int... IDs>
+      struct kmer_alphabets {};
+
+
+      namespace detail {
+
+        /// dispatch over the kmer lengths, for 1 alphabet.  no match.
+        template <typename Alphabet, typename WordType, unsigned int... Ks>
+        struct kmer_size_dispatch {
+            template <typename R, typename Runner, typename... Args>
+            static R run(unsigned int k, Runner &&, Args &&...) {
+              std::stringstream ss;
+              ss << "kmer length " << k << " is not one of the compiled kmer lengths.";
+              throw std::invalid_argument(ss.str());
+            }
+        };
+
+        template <typename Alphabet, typename WordType, unsigned int K, unsigned int... Ks>
+        struct kmer_size_dispatch<Alphabet, WordType, K, Ks...> {
+            template <typename R, typename Runner, typename... Args>
+            static R run(unsigned int k, Runner && runner, Args &&... args) {
+              if (k == K)
+                return runner.template run< ::bliss::common::Kmer<K, Alphabet, WordType> >(std::forward<Args>(args)...);
+              return kmer_size_dispatch<Alphabet, WordType, Ks...>::template run<R>(k, std::forward<Runner>(runner), std::forward<Args>(args)...);
+            }
+        };
+
+        /// dispatch over the alphabets.  no match.
+        template <typename WordType, typename Sizes, unsigned int... IDs>
+        struct kmer_alphabet_dispatch {
+            template <typename R, typename Runner, typename... Args>
+            static R run(unsigned int alpha, unsigned int, Runner &&, Args &&...) {
+              std::stringstream ss;
+              ss << "alphabet " << alpha << " is not one of the compiled alphabets.";
+              throw std::invalid_argument(ss.str());
+            }
+        };
+
+        template <typename WordType, unsigned int... Ks, unsigned int ID, unsigned int... IDs>
+        struct kmer_alphabet_dispatch<WordType, kmer_sizes<Ks...>, ID, IDs...> {
+            template <typename R, typename Runner, typename... Args>
+            static R run(unsigned int alpha, unsigned int k, Runner && runner, Args &&... args) {
+              if (alpha == ID)
+                return kmer_size_dispatch<typename dna_alphabet<ID>::type, WordType, Ks...>::template run<R>(
+                    k, std::forward<Runner>(runner), std::forward<Args>(args)...);
+              return kmer_alphabet_dispatch<WordType, kmer_sizes<Ks...>, IDs...>::template run<R>(
+                  alpha, k, std::forward<Runner>(runner), std::forward<Args>(args)...);
+            }
+        };
+
+        template <unsigned int V, unsigned int... Vs>
+        struct first_value { static constexpr unsigned int value = V; };
+
+      } // namespace detail
+
+
+      /**
+       * @brief  runtime selection of a Kmer specialization.
+       * @tparam WordType   kmer word type
+       * @tparam Alphabets  kmer_alphabets<...> of alphabet ids to instantiate
+       * @tparam Sizes      kmer_sizes<...> of kmer lengths to instantiate
+       */
+      template <typename WordType, typename Alphabets, typename Sizes>
+      class kmer_dispatch;
+
+      template <typename WordType, unsigned int... IDs, unsigned int... Ks>
+      class kmer_dispatch<WordType, kmer_alphabets<IDs...>, kmer_sizes<Ks...> > {
+          static_assert(sizeof...(IDs) > 0, "need at least 1 alphabet");
+          static_assert(sizeof...(Ks) > 0, "need at least 1 kmer length");
+
+        public:
+          /// the first configured specialization.  determines the runner's return type.
+          using first_kmer_type = ::bliss::common::Kmer<detail::first_value<Ks...>::value,
+              typename dna_alphabet<detail::first_value<IDs...>::value>::type, WordType>;
+
+          /// compiled kmer lengths
+          static std::vector<unsigned int> sizes() {
+            return std::vector<unsigned int>{Ks...};
+          }
+          /// compiled alphabet ids
+          static std::vector<unsigned int> alphabets() {
+            return std::vector<unsigned int>{IDs...};
+          }
+
+          /// check if the (alphabet, k) combination is compiled.
+          static bool supports(unsigned int alpha, unsigned int k) {
+            std::vector<unsigned int> a = alphabets();
+            std::vector<unsigned int> s = sizes();
+            return (std::find(a.begin(), a.end(), alpha) != a.end()) &&
+                (std::find(s.begin(), s.end(), k) != s.end());
+          }
+
+          /**
+           * @brief  call runner.run<Kmer<k, alphabet, WordType> >(args...)
+           * @throw  std::invalid_argument if the alphabet or k is not compiled.
+           */
+          template <typename Runner, typename... Args>
+          static auto run(unsigned int alpha, unsigned int k, Runner && runner, Args &&... args)
+          -> decltype(runner.template run<first_kmer_type>(std::forward<Args>(args)...)) {
+            using R = decltype(runner.template run<first_kmer_type>(std::forward<Args>(args)...));
+            return detail::kmer_alphabet_dispatch<WordType, kmer_sizes<Ks...>, IDs...>::template run<R>(
+                alpha, k, std::forward<Runner>(runner), std::forward<Args>(args)...);
+          }
+      };
+
+    } // namespace kmer
+  } // namespace index
+} // namespace bliss
+
+#endif // KMER_DISPATCH_HPP_
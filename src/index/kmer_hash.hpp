@@ -19,7 +19,8 @@
  * @ingroup bliss::hash
  * @author  tpan
  * @brief   collections of hash functions defined for kmers.
- * @details support the following:  raw bits directly extracted; std::hash version; murmurhash; and farm hash
+ * @details support the following:  raw bits directly extracted; std::hash version; murmurhash; farm hash;
+ *          and 3 hashes that work on the kmer's 64 bit lanes directly:  crc32c (hardware with SSE4.2), xxh3 style, and wyhash style.
  *
  *          assuming the use is in a distributed hash table with total buckets N,  N = p * t * l,
  *          where p is number of processes, t is number of threads, and l is number of local buckets.
@@ -60,6 +61,12 @@
 #include <exception>  // for hash - std::system_error
 #include <algorithm>
 #include <type_traits>  // enable_if
+#include <cstring>  // memcpy
+#include <cstdint>
+
+#if defined(__SSE4_2__)
+#include <x86intrin.h>
+#endif
 
 #include "common/alphabets.hpp"
 #include "common/kmer.hpp"
@@ -313,6 +320,255 @@ namespace bliss {
       constexpr uint8_t farm<KMER, Prefix>::batch_size;
 
 
+      namespace detail {
+
+        /// kmer data as 64 bit lanes.  lanes includes the partial last lane, if any.  unused bits of a kmer are 0.
+        template <typename KMER>
+        struct lanes {
+            static constexpr unsigned int bytes = KMER::nWords * sizeof(typename KMER::KmerWordType);
+            static constexpr unsigned int full = bytes / sizeof(uint64_t);
+            static constexpr unsigned int count = (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+            static inline uint64_t get(const KMER & kmer, unsigned int i) {
+              uint64_t v = 0;
+              if (i < full)
+                memcpy(&v, reinterpret_cast<const uint8_t*>(kmer.getData()) + i * sizeof(uint64_t), sizeof(uint64_t));
+              else
+                memcpy(&v, reinterpret_cast<const uint8_t*>(kmer.getData()) + i * sizeof(uint64_t), bytes - full * sizeof(uint64_t));
+              return v;
+            }
+        };
+
+        /// 64x64 -> 128 bit multiply, folded to 64 bits by xor of the halves.
+        inline uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+          unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+          return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+          uint64_t lo_lo = (a & 0xFFFFFFFFULL) * (b & 0xFFFFFFFFULL);
+          uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFFULL);
+          uint64_t lo_hi = (a & 0xFFFFFFFFULL) * (b >> 32);
+          uint64_t hi_hi = (a >> 32) * (b >> 32);
+          uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+          uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+          uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFFULL);
+          return lower ^ upper;
+#endif
+        }
+
+        /// murmur3 64 bit finalizer.  bijective.
+        inline uint64_t fmix64(uint64_t h) {
+          h ^= h >> 33;
+          h *= 0xff51afd7ed558ccdULL;
+          h ^= h >> 33;
+          h *= 0xc4ceb9fe1a85ec53ULL;
+          h ^= h >> 33;
+          return h;
+        }
+
+        /// crc32c (castagnoli) updates, same results as the SSE4.2 crc32 instructions.
+#if defined(__SSE4_2__)
+        inline uint32_t crc32c_u32(uint32_t crc, uint32_t v) {
+          return _mm_crc32_u32(crc, v);
+        }
+        inline uint32_t crc32c_u64(uint32_t crc, uint64_t v) {
+          return static_cast<uint32_t>(_mm_crc32_u64(crc, v));
+        }
+#else
+        /// byte at a time table lookup.  slow, only for builds without SSE4.2.
+        struct crc32c_table {
+            uint32_t t[256];
+            crc32c_table() {
+              for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int j = 0; j < 8; ++j) c = (c >> 1) ^ (0x82F63B78U & (0U - (c & 1U)));
+                t[i] = c;
+              }
+            }
+        };
+        inline uint32_t crc32c_bytes(uint32_t crc, uint64_t v, int bytes) {
+          static const crc32c_table table;
+          for (int i = 0; i < bytes; ++i, v >>= 8) {
+            crc = table.t[(crc ^ static_cast<uint32_t>(v)) & 0xFF] ^ (crc >> 8);
+          }
+          return crc;
+        }
+        inline uint32_t crc32c_u32(uint32_t crc, uint32_t v) {
+          return crc32c_bytes(crc, v, 4);
+        }
+        inline uint32_t crc32c_u64(uint32_t crc, uint64_t v) {
+          return crc32c_bytes(crc, v, 8);
+        }
+#endif
+
+      } // namespace detail
+
+
+      /**
+       * @brief  Kmer hash using crc32c.  1 instruction per 32 or 64 bits of kmer with SSE4.2, table lookup otherwise.
+       * @details  crc is linear, so 2 crc chains with different seeds are not independent.  instead,
+       *           1 word kmers (k <= 32 for DNA):  crc of the low and of the high 32 bits form the 64 bit value.  each 32 bit crc
+       *                is a bijection, so there are no collisions.
+       *           multi word kmers:  1 chain over the lanes, and 1 over the lanes with halves swapped.
+       *           the 64 bit value is then finalized with murmur's fmix64, since the crc bits do not avalanche across the halves.
+       *           Prefix version uses a different seed, as in farm.
+       */
+      template <typename KMER, bool Prefix = false>
+      class crc32c {
+
+        protected:
+          using L = detail::lanes<KMER>;
+          uint32_t seed;
+
+        public:
+          static constexpr uint8_t batch_size = 1;
+
+          static const unsigned int default_init_value = 24U;  // ignored.
+
+          crc32c(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) :
+            seed(Prefix ? (_seed << 1) - 1 : _seed) {};
+
+          inline uint64_t operator()(const KMER & kmer) const {
+            uint64_t h;
+            if (L::count == 1) {
+              uint64_t v = L::get(kmer, 0);
+              h = (static_cast<uint64_t>(detail::crc32c_u32(seed, static_cast<uint32_t>(v))) << 32) |
+                  detail::crc32c_u32(seed, static_cast<uint32_t>(v >> 32));
+            } else {
+              uint32_t a = seed;
+              uint32_t b = ~seed;
+              for (unsigned int i = 0; i < L::count; ++i) {
+                uint64_t v = L::get(kmer, i);
+                a = detail::crc32c_u64(a, v);
+                b = detail::crc32c_u64(b, (v << 32) | (v >> 32));
+              }
+              h = (static_cast<uint64_t>(a) << 32) | b;
+            }
+            return detail::fmix64(h);
+          }
+      };
+      template<typename KMER, bool Prefix>
+      constexpr uint8_t crc32c<KMER, Prefix>::batch_size;
+
+
+      /**
+       * @brief  Kmer hash in the style of XXH3's short input path:  lanes xor'ed with secret words, combined pairwise by folded 128 bit multiply.
+       * @details  not bit compatible with XXH3.  the kmer length is fixed, so there is no length dispatch or bulk loop.
+       *           1 word kmers use the rrmxmx mixer (bijective), multi word kmers the mix16B pairs, overlapping the last pair when the
+       *           lane count is odd, as XXH3 does for its tail.
+       *           Prefix version uses a different seed, as in farm.
+       */
+      template <typename KMER, bool Prefix = false>
+      class xxh3 {
+
+        protected:
+          using L = detail::lanes<KMER>;
+          uint64_t seed;
+
+          static constexpr uint64_t secret[8] = {
+            0x9E3779B185EBCA87ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0x85EBCA77C2B2AE63ULL,
+            0x27D4EB2F165667C5ULL, 0xA0761D6478BD642FULL, 0xE7037ED1A0B428DBULL, 0x8EBC6AF09C88C6E3ULL
+          };
+
+          static inline uint64_t avalanche(uint64_t h) {
+            h ^= h >> 37;
+            h *= 0x165667919E3779F9ULL;
+            h ^= h >> 32;
+            return h;
+          }
+
+          inline uint64_t mix16(uint64_t lo, uint64_t hi, unsigned int i) const {
+            return detail::mul128_fold64(lo ^ (secret[i & 7] + seed), hi ^ (secret[(i + 1) & 7] - seed));
+          }
+
+        public:
+          static constexpr uint8_t batch_size = 1;
+
+          static const unsigned int default_init_value = 24U;  // ignored.
+
+          xxh3(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) :
+            seed(Prefix ? (_seed << 1) - 1 : _seed) {};
+
+          inline uint64_t operator()(const KMER & kmer) const {
+            if (L::count == 1) {
+              // rrmxmx
+              uint64_t h = L::get(kmer, 0) ^ (secret[0] - seed);
+              h ^= ((h << 49) | (h >> 15)) ^ ((h << 24) | (h >> 40));
+              h *= 0x9FB21C651E98DF25ULL;
+              h ^= (h >> 35) + L::bytes;
+              h *= 0x9FB21C651E98DF25ULL;
+              return h ^ (h >> 28);
+            }
+
+            uint64_t acc = L::bytes * 0x9E3779B185EBCA87ULL;
+            unsigned int i = 0;
+            for (; i + 1 < L::count; i += 2) {
+              acc += mix16(L::get(kmer, i), L::get(kmer, i + 1), i);
+            }
+            if (i < L::count) {
+              acc += mix16(L::get(kmer, i - 1), L::get(kmer, i), i);
+            }
+            return avalanche(acc);
+          }
+      };
+      template<typename KMER, bool Prefix>
+      constexpr uint8_t xxh3<KMER, Prefix>::batch_size;
+      template<typename KMER, bool Prefix>
+      constexpr uint64_t xxh3<KMER, Prefix>::secret[8];
+
+
+      /**
+       * @brief  Kmer hash in the style of wyhash:  multiply-shift mixing by folded 128 bit multiply (mum) of 2 lanes at a time.
+       * @details  not bit compatible with wyhash.  1 word kmers take 2 multiplies, multi word kmers 1 more per 2 lanes.
+       *           Prefix version uses a different seed, as in farm.
+       */
+      template <typename KMER, bool Prefix = false>
+      class wyhash {
+
+        protected:
+          using L = detail::lanes<KMER>;
+          uint64_t seed;
+
+          static constexpr uint64_t s0 = 0xa0761d6478bd642fULL;
+          static constexpr uint64_t s1 = 0xe7037ed1a0b428dbULL;
+          static constexpr uint64_t s2 = 0x8ebc6af09c88c6e3ULL;
+
+        public:
+          static constexpr uint8_t batch_size = 1;
+
+          static const unsigned int default_init_value = 24U;  // ignored.
+
+          wyhash(const unsigned int prefix_bits = default_init_value, uint32_t const & _seed = 42 ) :
+            seed(detail::mul128_fold64((Prefix ? (_seed << 1) - 1 : _seed) ^ s0, s1)) {};
+
+          inline uint64_t operator()(const KMER & kmer) const {
+            uint64_t a, b;
+            uint64_t h = seed;
+            if (L::count == 1) {
+              a = L::get(kmer, 0);
+              b = (a << 32) | (a >> 32);
+            } else {
+              unsigned int i = 0;
+              for (; i + 2 < L::count; i += 2) {
+                h = detail::mul128_fold64(L::get(kmer, i) ^ s1, L::get(kmer, i + 1) ^ h);
+              }
+              // last 2 lanes, overlapping if the count is odd.
+              a = L::get(kmer, L::count - 2);
+              b = L::get(kmer, L::count - 1);
+            }
+            return detail::mul128_fold64(s2 ^ L::bytes, detail::mul128_fold64(a ^ s1, b ^ h));
+          }
+      };
+      template<typename KMER, bool Prefix>
+      constexpr uint8_t wyhash<KMER, Prefix>::batch_size;
+      template<typename KMER, bool Prefix>
+      constexpr uint64_t wyhash<KMER, Prefix>::s0;
+      template<typename KMER, bool Prefix>
+      constexpr uint64_t wyhash<KMER, Prefix>::s1;
+      template<typename KMER, bool Prefix>
+      constexpr uint64_t wyhash<KMER, Prefix>::s2;
+
+
       namespace sparsehash {
       	  //  ===============
       	  //  Sparse hash specific, kmer related stuff
@@ -68,6 +68,7 @@
 
 #include "io/kmer_file_helper.hpp"
 #include "io/kmer_parser.hpp"
+#include "io/packed_read_store.hpp"
 #include "io/mxx_support.hpp"
 #include "containers/distributed_unordered_map.hpp"
 #include "containers/distributed_sorted_map.hpp"
@@ -224,6 +225,36 @@ public:
 
 	 }
 
+protected:
+	 /// maps with an incremental append (sorted maps) use it.
+	 template <typename M, typename T>
+	 static auto append_impl(M & m, std::vector<T> &temp, int) -> decltype(m.append(temp), void()) {
+		 m.append(temp);
+	 }
+	 /// hashed maps insert into the live tables.
+	 template <typename M, typename T>
+	 static void append_impl(M & m, std::vector<T> &temp, long) {
+		 m.insert(temp);
+	 }
+
+public:
+	 /**
+	  * @brief add entries to an existing index.  collective.
+	  * @details hashed maps insert into the existing tables.  sorted maps sort only the new entries and merge them
+	  *          into the existing sorted data, rebalancing only when needed.  see ::dsc::sorted_map::append and
+	  *          ::dsc::sorted_multimap::append.
+	  */
+	 template <typename T>
+	 void append(std::vector<T> &temp) {
+		BL_BENCH_INIT(append);
+
+		BL_BENCH_START(append);
+		append_impl(this->map, temp, 0);  // COLLECTIVE CALL...
+		BL_BENCH_END(append, "map_append", this->map.local_size());
+
+		BL_BENCH_REPORT_MPI_NAMED(append, "index:append", this->comm);
+	 }
+
 	 // Note that KmerParserType may depend on knowing the Sequence Parser Type (e.g. provide quality score iterators)
 	 //	Output type of KmerParserType may not match Map value type, in which case the map needs to do its own transform.
 	 //     since Kmer template parameter is not explicitly known, we can't hard code the return types of KmerParserType.
@@ -239,19 +270,7 @@ public:
 	 template <template <typename> class SeqParser, template <typename, template <typename> class> class SeqIterType>
 	 void build_mpiio(const std::string & filename, MPI_Comm comm) {
 
-		 // file extension determines SeqParserType
-		 std::string extension = ::bliss::utils::file::get_file_extension(filename);
-		 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
-		 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
-			 throw std::invalid_argument("input filename extension is not supported.");
-		 }
-
-		 // check to make sure that the file parser will work
-		 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
-			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
-		 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
-			 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
-		 }
+		 ::bliss::io::KmerFileHelper::template check_file_types<SeqParser>(std::vector<std::string>(1, filename));
      BL_BENCH_INIT(build);
 
 		 // proceed
@@ -284,19 +303,7 @@ public:
 	   template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
 	   void build_mmap(const std::string & filename, MPI_Comm comm) {
 
-	     // file extension determines SeqParserType
-	     std::string extension = ::bliss::utils::file::get_file_extension(filename);
-	     std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
-	     if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
-	       throw std::invalid_argument("input filename extension is not supported.");
-	     }
-
-	     // check to make sure that the file parser will work
-	     if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
-	       throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
-	     } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
-	       throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
-	     }
+	     ::bliss::io::KmerFileHelper::template check_file_types<SeqParser>(std::vector<std::string>(1, filename));
 	     BL_BENCH_INIT(build);
 
 	     // proceed
@@ -331,19 +338,7 @@ public:
 		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
 		 void build_posix(const std::string & filename, MPI_Comm comm) {
 
-			 // file extension determines SeqParserType
-			 std::string extension = ::bliss::utils::file::get_file_extension(filename);
-			 std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
-			 if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
-				 throw std::invalid_argument("input filename extension is not supported.");
-			 }
-
-			 // check to make sure that the file parser will work
-			 if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
-				 throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
-			 } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
-				 throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
-			 }
+			 ::bliss::io::KmerFileHelper::template check_file_types<SeqParser>(std::vector<std::string>(1, filename));
 	     BL_BENCH_INIT(build);
 
 			 // proceed
@@ -371,6 +366,143 @@ public:
 
 		 }
 
+		 /**
+		  * @brief build index from a file, and keep the parsed sequences in a packed read store.
+		  * @details later passes can call build(store) or generate kmers from the store without reading the file again.
+		  */
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename WordType>
+		 void build_posix(const std::string & filename, MPI_Comm comm, ::bliss::io::packed_read_store<KmerType, WordType> & store) {
+
+			 ::bliss::io::KmerFileHelper::template check_file_types<SeqParser>(std::vector<std::string>(1, filename));
+	     BL_BENCH_INIT(build);
+
+	     BL_BENCH_START(build);
+			 ::std::vector<typename KmerParser::value_type> temp;
+			 bliss::io::KmerFileHelper::template read_file_posix<KmerParser, SeqParser, SeqIterType>(filename, temp, store, comm);
+	     BL_BENCH_END(build, "read", temp.size());
+
+	     BL_BENCH_START(build);
+			 this->insert(temp);
+	     BL_BENCH_END(build, "insert", temp.size());
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_posix_store", this->comm);
+		 }
+
+		 /**
+		  * @brief build index from a FASTQ file, parsing each block while the next blocks are read.
+		  * @details see ::bliss::io::KmerFileHelper::read_file_async.
+		  */
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_posix_async(const std::string & filename, MPI_Comm comm, size_t const block_size = (32UL << 20), size_t const depth = 4) {
+
+			 ::bliss::io::KmerFileHelper::template check_file_types<SeqParser>(std::vector<std::string>(1, filename));
+	     BL_BENCH_INIT(build);
+
+	     BL_BENCH_START(build);
+			 ::std::vector<typename KmerParser::value_type> temp;
+			 bliss::io::KmerFileHelper::template read_file_async<KmerParser, SeqParser, SeqIterType>(filename, temp, comm, block_size, depth);
+	     BL_BENCH_END(build, "read", temp.size());
+
+	     BL_BENCH_START(build);
+			 this->insert(temp);
+	     BL_BENCH_END(build, "insert", temp.size());
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_posix_async", this->comm);
+		 }
+
+		 /**
+		  * @brief build index from the kmers of a packed read store.  no file io or sequence parsing.
+		  * @note  requires that the map accepts kmers as input, e.g. kmer index and count index.
+		  */
+		 template <typename WordType>
+		 void build(::bliss::io::packed_read_store<KmerType, WordType> const & store) {
+	     BL_BENCH_INIT(build);
+
+	     BL_BENCH_START(build);
+			 ::std::vector<KmerType> temp;
+			 store.get_kmers(temp);
+	     BL_BENCH_END(build, "unpack", temp.size());
+
+	     BL_BENCH_START(build);
+			 this->insert(temp);
+	     BL_BENCH_END(build, "insert", temp.size());
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, "index:build_store", this->comm);
+		 }
+
+
+		 /**
+		  * @brief build index from multiple files in one distribute.
+		  * @details the files are treated as one concatenated byte space and block partitioned by bytes across
+		  *          comm, crossing file boundaries.  see ::bliss::io::KmerFileHelper::read_files.
+		  * @tparam FileType  parallel file type used to read each file.
+		  */
+		 template <typename FileType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_files(const std::vector<std::string> & filenames, MPI_Comm comm, std::string const & name) {
+	     BL_BENCH_INIT(build);
+
+	     BL_BENCH_START(build);
+			 ::std::vector<typename KmerParser::value_type> temp;
+			 bliss::io::KmerFileHelper::template read_files<FileType, KmerParser, SeqParser, SeqIterType>(filenames, temp, comm);
+	     BL_BENCH_END(build, "read", temp.size());
+
+	     BL_BENCH_START(build);
+			 this->insert(temp);
+	     BL_BENCH_END(build, "insert", temp.size());
+
+	     BL_BENCH_REPORT_MPI_NAMED(build, name, this->comm);
+		 }
+
+		 /// build index from multiple files using mpiio.  see build_files
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_mpiio(const std::vector<std::string> & filenames, MPI_Comm comm) {
+			 this->template build_files<::bliss::io::parallel::mpiio_file<SeqParser>, SeqParser, SeqIterType>(filenames, comm, "index:build_mpiio_files");
+		 }
+
+		 /// build index from multiple files using mmap.  see build_files
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_mmap(const std::vector<std::string> & filenames, MPI_Comm comm) {
+			 this->template build_files<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser>, SeqParser, SeqIterType>(filenames, comm, "index:build_mmap_files");
+		 }
+
+		 /// build index from multiple files using posix read.  see build_files
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void build_posix(const std::vector<std::string> & filenames, MPI_Comm comm) {
+			 this->template build_files<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser>, SeqParser, SeqIterType>(filenames, comm, "index:build_posix_files");
+		 }
+
+		 /**
+		  * @brief add the kmers of new files to an existing index, e.g. a new sequencing lane.  see append and build_files.
+		  * @details the index can be queried before and after.  reads the files the same way as build_files.
+		  */
+		 template <typename FileType, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void update_files(const std::vector<std::string> & filenames, MPI_Comm comm, std::string const & name) {
+	     BL_BENCH_INIT(update);
+
+	     BL_BENCH_START(update);
+			 ::std::vector<typename KmerParser::value_type> temp;
+			 bliss::io::KmerFileHelper::template read_files<FileType, KmerParser, SeqParser, SeqIterType>(filenames, temp, comm);
+	     BL_BENCH_END(update, "read", temp.size());
+
+	     BL_BENCH_START(update);
+			 this->append(temp);
+	     BL_BENCH_END(update, "append", temp.size());
+
+	     BL_BENCH_REPORT_MPI_NAMED(update, name, this->comm);
+		 }
+
+		 /// add files to an existing index using posix read.  see update_files
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void update_from(const std::vector<std::string> & filenames, MPI_Comm comm) {
+			 this->template update_files<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser>, SeqParser, SeqIterType>(filenames, comm, "index:update_posix_files");
+		 }
+
+		 /// add files to an existing index using mpiio.  see update_files
+		 template <template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+		 void update_from_mpiio(const std::vector<std::string> & filenames, MPI_Comm comm) {
+			 this->template update_files<::bliss::io::parallel::mpiio_file<SeqParser>, SeqParser, SeqIterType>(filenames, comm, "index:update_mpiio_files");
+		 }
+
 
 
 
@@ -419,6 +551,12 @@ template <typename Key>
 using DistHashStd = ::bliss::kmer::hash::cpp_std<Key, true>;
 template <typename Key>
 using DistHashIdentity = ::bliss::kmer::hash::identity<Key, true>;
+template <typename Key>
+using DistHashCrc32c = ::bliss::kmer::hash::crc32c<Key, true>;
+template <typename Key>
+using DistHashXxh3 = ::bliss::kmer::hash::xxh3<Key, true>;
+template <typename Key>
+using DistHashWyhash = ::bliss::kmer::hash::wyhash<Key, true>;
 
 
 template <typename Key>
@@ -429,6 +567,12 @@ template <typename Key>
 using StoreHashStd = ::bliss::kmer::hash::cpp_std<Key, false>;
 template <typename Key>
 using StoreHashIdentity = ::bliss::kmer::hash::identity<Key, false>;
+template <typename Key>
+using StoreHashCrc32c = ::bliss::kmer::hash::crc32c<Key, false>;
+template <typename Key>
+using StoreHashXxh3 = ::bliss::kmer::hash::xxh3<Key, false>;
+template <typename Key>
+using StoreHashWyhash = ::bliss::kmer::hash::wyhash<Key, false>;
 
 // =================  Partially defined aliases for MapParams, for distributed_xxx_maps.
 // NOTE: when using this, need to further alias so that only Key param remains.
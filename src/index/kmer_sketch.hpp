@@ -0,0 +1,539 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_sketch.hpp
+ * @ingroup index
+ * @author  tpan
+ * @brief   bottom-k and FracMinHash sketches of canonical kmer sets, for comparing samples without building an index.
+ * @details a sketch keeps the distinct 64 bit hashes of the (canonicalized) kmers that are
+ *            bottom-k:        among the k smallest.
+ *            FracMinHash:     at most 2^64 / scale.
+ *          each rank sketches its local kmers, and reduce() merges the local sketches along a binomial tree
+ *          and broadcasts the result, so the communication is O(sketch size * log p), independent of the
+ *          number of kmers.  any kmer_hash.hpp hash functor can be used, as long as the compared sketches use
+ *          the same one, with the same seed.
+ *
+ *          serialized sketches store the sorted hashes as Golomb-Rice coded gaps, about 2 + log2(2^64 / n) bits
+ *          per hash instead of 64.
+ *
+ *          insert_file() sketches a FASTQ or FASTA file block by block as it is parsed, so the kmers of a file are
+ *          never all in memory.
+ *
+ *          compare() estimates the Jaccard index and the containments from the hashes below the smaller
+ *          threshold of the 2 sketches, and all_vs_all() distributes the pairwise comparisons of a set of
+ *          sketches over the ranks.
+ */
+#ifndef KMER_SKETCH_HPP_
+#define KMER_SKETCH_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mpi.h"
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>     // memcpy
+#include <limits>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(USE_MPI)
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/datatypes.hpp"
+#endif
+
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "io/io_exception.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss
+{
+  namespace index
+  {
+    namespace kmer
+    {
+
+      /// estimated similarity of 2 sketched kmer sets.
+      struct sketch_similarity {
+          /// hashes in both, and in either, sketch, below the comparison threshold.
+          uint64_t intersection;
+          uint64_t union_size;
+          double jaccard;
+          /// estimated fraction of the first set that is in the second, and vice versa.
+          double containment_first;
+          double containment_second;
+
+          sketch_similarity() : intersection(0), union_size(0), jaccard(0.0), containment_first(0.0), containment_second(0.0) {}
+      };
+
+
+      /**
+       * @brief  bottom-k or FracMinHash sketch of a kmer set.
+       * @tparam Hash       64 bit kmer hash functor, e.g. ::bliss::kmer::hash::farm<KMER, false>
+       * @tparam Transform  canonicalizes a kmer before hashing.  ::bliss::transform::identity for single strand.
+       */
+      template <typename KMER,
+                typename Hash = ::bliss::kmer::hash::farm<KMER, false>,
+                typename Transform = ::bliss::kmer::transform::lex_less<KMER> >
+      class kmer_sketch {
+
+        public:
+          enum mode_type : uint8_t { BOTTOM_K = 0, FRAC_MIN_HASH = 1 };
+
+          using KmerType = KMER;
+
+        protected:
+          static constexpr uint32_t magic = 0x4b534b42;   // "BKSK"
+          static constexpr uint8_t version = 1;
+          static constexpr int reduce_tag = 4721;
+
+          mode_type mode;
+          /// bottom-k:  sketch size.  FracMinHash:  scale.
+          uint64_t param;
+          uint32_t seed;
+
+          Hash hasher;
+          Transform trans;
+
+          /// hashes above threshold are not kept.  fixed for FracMinHash, the k-th smallest for a full bottom-k.
+          uint64_t threshold;
+          /// sorted and distinct up to sorted_size, then newly inserted.  compaction does not change the set.
+          mutable ::std::vector<uint64_t> hashes;
+          mutable size_t sorted_size;
+
+          /// sort, remove duplicates, and for bottom-k keep the k smallest.
+          void compact_impl() const {
+            if (sorted_size == hashes.size()) return;
+            ::std::sort(hashes.begin() + sorted_size, hashes.end());
+            ::std::inplace_merge(hashes.begin(), hashes.begin() + sorted_size, hashes.end());
+            hashes.erase(::std::unique(hashes.begin(), hashes.end()), hashes.end());
+            if ((mode == BOTTOM_K) && (hashes.size() > param)) hashes.resize(param);
+            sorted_size = hashes.size();
+          }
+
+          void update_threshold() {
+            if ((mode == BOTTOM_K) && (hashes.size() == param)) threshold = hashes.back();
+          }
+
+          /// inserted hashes to buffer before compaction.
+          size_t capacity() const {
+            return (mode == BOTTOM_K) ? 2 * param :
+                ::std::max(2 * sorted_size, static_cast<size_t>(1024));
+          }
+
+          /// the threshold for comparison:  all hashes of the set up to it are in the sketch.
+          uint64_t compare_threshold() const {
+            if ((mode == BOTTOM_K) && (hashes.size() == param)) return hashes.back();
+            return (mode == BOTTOM_K) ? ::std::numeric_limits<uint64_t>::max() : threshold;
+          }
+
+          void check_compatible(kmer_sketch const & other) const {
+            if ((mode != other.mode) || (param != other.param) || (seed != other.seed)) {
+              ::std::stringstream ss;
+              ss << "incompatible sketches:  mode " << static_cast<int>(mode) << " vs " << static_cast<int>(other.mode) <<
+                  ", size/scale " << param << " vs " << other.param << ", seed " << seed << " vs " << other.seed;
+              throw ::std::invalid_argument(ss.str());
+            }
+          }
+
+          /// append the sorted other into this sketch.
+          void merge_hashes(uint64_t const * first, uint64_t const * last) {
+            hashes.insert(hashes.end(), first, last);
+            compact_impl();
+            update_threshold();
+          }
+
+          // ========  Golomb-Rice coded gaps.
+
+          static void put_bits(::std::vector<uint8_t> & out, size_t & bit, uint64_t value, unsigned int n) {
+            for (unsigned int i = 0; i < n; ++i, ++bit) {
+              if ((bit & 7) == 0) out.push_back(0);
+              if ((value >> i) & 1) out.back() |= static_cast<uint8_t>(1 << (bit & 7));
+            }
+          }
+          static uint64_t get_bits(uint8_t const * data, size_t len, size_t & bit, unsigned int n) {
+            uint64_t value = 0;
+            for (unsigned int i = 0; i < n; ++i, ++bit) {
+              if ((bit >> 3) >= len) throw ::std::invalid_argument("truncated kmer sketch.");
+              value |= static_cast<uint64_t>((data[bit >> 3] >> (bit & 7)) & 1) << i;
+            }
+            return value;
+          }
+
+          template <typename T>
+          static void put(::std::vector<uint8_t> & out, T const & value) {
+            uint8_t const * p = reinterpret_cast<uint8_t const *>(&value);
+            out.insert(out.end(), p, p + sizeof(T));
+          }
+          template <typename T>
+          static T get(uint8_t const * data, size_t len, size_t & pos) {
+            if (pos + sizeof(T) > len) throw ::std::invalid_argument("truncated kmer sketch.");
+            T value;
+            memcpy(&value, data + pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+          }
+
+        public:
+          /**
+           * @param _mode    BOTTOM_K or FRAC_MIN_HASH
+           * @param _param   sketch size for bottom-k, scale for FracMinHash.  > 0
+           * @param _seed    hash seed.
+           */
+          kmer_sketch(mode_type _mode = BOTTOM_K, uint64_t _param = 1000, uint32_t _seed = 42) :
+            mode(_mode), param(_param), seed(_seed), hasher(Hash::default_init_value, _seed), trans(),
+            threshold(::std::numeric_limits<uint64_t>::max()), sorted_size(0) {
+            if (param == 0) throw ::std::invalid_argument("kmer sketch size or scale must be positive.");
+            if (mode == FRAC_MIN_HASH) threshold = ::std::numeric_limits<uint64_t>::max() / param;
+          }
+
+          inline mode_type get_mode() const { return mode; }
+          inline uint64_t get_param() const { return param; }
+          inline uint32_t get_seed() const { return seed; }
+
+          /// number of distinct hashes.
+          size_t size() const {
+            compact_impl();
+            return hashes.size();
+          }
+
+          /// the sorted, distinct hashes.
+          ::std::vector<uint64_t> const & get_hashes() const {
+            compact_impl();
+            return hashes;
+          }
+
+          void clear() {
+            hashes.clear();
+            sorted_size = 0;
+            threshold = (mode == FRAC_MIN_HASH) ? ::std::numeric_limits<uint64_t>::max() / param : ::std::numeric_limits<uint64_t>::max();
+          }
+
+          inline void insert(KMER const & km) {
+            uint64_t h = hasher(trans(km));
+            if (h > threshold) return;
+            hashes.push_back(h);
+            if (hashes.size() >= capacity()) {
+              compact_impl();
+              update_threshold();
+            }
+          }
+
+          template <typename Iter>
+          void insert(Iter first, Iter last) {
+            for (; first != last; ++first) insert(*first);
+          }
+
+          void insert(::std::vector<KMER> const & kmers) {
+            insert(kmers.begin(), kmers.end());
+          }
+
+          /**
+           * @brief  sketch the kmers of this rank's partition of a file, inserting each parsed block.  collective.
+           * @details see ::bliss::io::KmerFileHelper::read_file_blocks.  call reduce() for the sketch of the whole file.
+           * @tparam SeqParser   ::bliss::io::FASTQParser or ::bliss::io::FASTAParser
+           * @param block_size   number of kmers parsed between inserts.
+           * @return  number of kmers read locally.
+           */
+          template <template <typename> class SeqParser,
+            template <typename, template <typename> class> class SeqIterType = ::bliss::io::SequencesIterator>
+          size_t insert_file(::std::string const & filename, ::mxx::comm const & comm, size_t const block_size = (1UL << 20)) {
+            auto consumer = [this](::std::vector<KMER> & kmers) { this->insert(kmers); };
+            return ::bliss::io::KmerFileHelper::template read_file_blocks_posix<::bliss::index::kmer::KmerParser<KMER>,
+                SeqParser, SeqIterType>(filename, consumer, comm, block_size).second;
+          }
+
+          /// merge another sketch of the same kind.
+          void merge(kmer_sketch const & other) {
+            check_compatible(other);
+            compact_impl();
+            other.compact_impl();
+            merge_hashes(other.hashes.data(), other.hashes.data() + other.hashes.size());
+          }
+
+          /// estimated number of distinct kmers.
+          double cardinality() const {
+            compact_impl();
+            if (mode == FRAC_MIN_HASH) return static_cast<double>(hashes.size()) * static_cast<double>(param);
+            if (hashes.size() < param) return static_cast<double>(hashes.size());
+            // (k - 1) / (k-th smallest hash as a fraction of the hash space).
+            return static_cast<double>(param - 1) /
+                (static_cast<double>(hashes.back()) / static_cast<double>(::std::numeric_limits<uint64_t>::max()));
+          }
+
+#if defined(USE_MPI)
+          /**
+           * @brief  merge the local sketches of all ranks.  collective.  all ranks get the global sketch.
+           * @details  binomial tree to rank 0, then broadcast.
+           */
+          void reduce(::mxx::comm const & comm) {
+            compact_impl();
+            int p = comm.size();
+            int rank = comm.rank();
+
+            ::std::vector<uint64_t> buf;
+            for (int step = 1; step < p; step <<= 1) {
+              if (rank & step) {
+                MPI_Send(hashes.data(), static_cast<int>(hashes.size()), MPI_UINT64_T, rank - step, reduce_tag, comm);
+                break;
+              } else if (rank + step < p) {
+                MPI_Status stat;
+                int count;
+                MPI_Probe(rank + step, reduce_tag, comm, &stat);
+                MPI_Get_count(&stat, MPI_UINT64_T, &count);
+                buf.resize(count);
+                MPI_Recv(buf.data(), count, MPI_UINT64_T, rank + step, reduce_tag, comm, MPI_STATUS_IGNORE);
+                merge_hashes(buf.data(), buf.data() + buf.size());
+              }
+            }
+
+            uint64_t count = hashes.size();
+            MPI_Bcast(&count, 1, MPI_UINT64_T, 0, comm);
+            hashes.resize(count);
+            MPI_Bcast(hashes.data(), static_cast<int>(count), MPI_UINT64_T, 0, comm);
+            sorted_size = hashes.size();
+            update_threshold();
+          }
+#endif
+
+          /**
+           * @brief  estimated Jaccard index and containments.
+           * @details  uses the hashes up to the smaller threshold of a and b.  all hashes of both sets up to it
+           *           are in the sketches, so they are a uniform sample of the union.
+           */
+          static sketch_similarity compare(kmer_sketch const & a, kmer_sketch const & b) {
+            a.check_compatible(b);
+            a.compact_impl();
+            b.compact_impl();
+
+            uint64_t t = ::std::min(a.compare_threshold(), b.compare_threshold());
+            auto ae = ::std::upper_bound(a.hashes.begin(), a.hashes.end(), t);
+            auto be = ::std::upper_bound(b.hashes.begin(), b.hashes.end(), t);
+
+            sketch_similarity sim;
+            auto ai = a.hashes.begin();
+            auto bi = b.hashes.begin();
+            while ((ai != ae) && (bi != be)) {
+              if (*ai < *bi) ++ai;
+              else if (*bi < *ai) ++bi;
+              else {
+                ++sim.intersection;
+                ++ai;
+                ++bi;
+              }
+            }
+            uint64_t na = ::std::distance(a.hashes.begin(), ae);
+            uint64_t nb = ::std::distance(b.hashes.begin(), be);
+            sim.union_size = na + nb - sim.intersection;
+            if (sim.union_size > 0) sim.jaccard = static_cast<double>(sim.intersection) / static_cast<double>(sim.union_size);
+            if (na > 0) sim.containment_first = static_cast<double>(sim.intersection) / static_cast<double>(na);
+            if (nb > 0) sim.containment_second = static_cast<double>(sim.intersection) / static_cast<double>(nb);
+            return sim;
+          }
+
+#if defined(USE_MPI)
+          /**
+           * @brief  compare all pairs of sketches.  collective, all ranks need the same sketches.
+           * @details  the n (n - 1) / 2 pairs are block distributed over the ranks, and the results allgathered.
+           * @return  n x n matrix, row major.  entry (i, j) has containment_first for sketch i.
+           */
+          static ::std::vector<sketch_similarity> all_vs_all(::std::vector<kmer_sketch> const & sketches, ::mxx::comm const & comm) {
+            size_t n = sketches.size();
+            size_t pairs = n * (n - 1) / 2;
+            size_t first = pairs * comm.rank() / comm.size();
+            size_t last = pairs * (comm.rank() + 1) / comm.size();
+
+            // row and column of the first local pair.
+            size_t i = 0, j = 1, row_start = 0;
+            while ((n > 1) && (row_start + (n - 1 - i) <= first)) {
+              row_start += n - 1 - i;
+              ++i;
+            }
+            j = i + 1 + (first - row_start);
+
+            ::std::vector<sketch_similarity> local;
+            local.reserve(last - first);
+            for (size_t x = first; x < last; ++x) {
+              local.emplace_back(compare(sketches[i], sketches[j]));
+              if (++j == n) {
+                ++i;
+                j = i + 1;
+              }
+            }
+
+            ::std::vector<sketch_similarity> all = ::mxx::allgatherv(local, comm);
+
+            ::std::vector<sketch_similarity> result(n * n);
+            size_t x = 0;
+            for (i = 0; i < n; ++i) {
+              result[i * n + i] = compare(sketches[i], sketches[i]);
+              for (j = i + 1; j < n; ++j, ++x) {
+                result[i * n + j] = all[x];
+                result[j * n + i] = all[x];
+                ::std::swap(result[j * n + i].containment_first, result[j * n + i].containment_second);
+              }
+            }
+            return result;
+          }
+#endif
+
+          /// append the serialized sketch:  header, then the Golomb-Rice coded gaps between the sorted hashes.
+          void serialize(::std::vector<uint8_t> & out) const {
+            compact_impl();
+
+            // rice parameter:  log2 of the mean gap.
+            uint64_t n = hashes.size();
+            unsigned int b = 0;
+            if (n > 0) {
+              uint64_t mean = hashes.back() / n;
+              while ((b < 63) && ((static_cast<uint64_t>(1) << (b + 1)) <= mean)) ++b;
+            }
+
+            put(out, magic);
+            put(out, version);
+            put(out, static_cast<uint8_t>(mode));
+            put(out, static_cast<uint16_t>(KMER::size));
+            put(out, seed);
+            put(out, param);
+            put(out, n);
+            put(out, static_cast<uint8_t>(b));
+
+            ::std::vector<uint8_t> bits;
+            size_t bit = 0;
+            uint64_t prev = 0;
+            for (auto h : hashes) {
+              uint64_t gap = h - prev;
+              prev = h;
+              uint64_t q = gap >> b;
+              for (uint64_t i = 0; i < q; ++i) put_bits(bits, bit, 1, 1);
+              put_bits(bits, bit, 0, 1);
+              put_bits(bits, bit, gap, b);
+            }
+            put(out, static_cast<uint64_t>(bits.size()));
+            out.insert(out.end(), bits.begin(), bits.end());
+          }
+
+          /**
+           * @brief  read a serialized sketch, replacing the content of this one.
+           * @return  the number of bytes read.
+           */
+          size_t deserialize(uint8_t const * data, size_t len) {
+            size_t pos = 0;
+            if (get<uint32_t>(data, len, pos) != magic) throw ::std::invalid_argument("not a kmer sketch.");
+            if (get<uint8_t>(data, len, pos) != version) throw ::std::invalid_argument("unsupported kmer sketch version.");
+            uint8_t m = get<uint8_t>(data, len, pos);
+            uint16_t k = get<uint16_t>(data, len, pos);
+            if ((m > FRAC_MIN_HASH) || (k != KMER::size)) {
+              ::std::stringstream ss;
+              ss << "kmer sketch of mode " << static_cast<int>(m) << " and kmer size " << k << " does not match kmer size " << KMER::size;
+              throw ::std::invalid_argument(ss.str());
+            }
+            uint32_t s = get<uint32_t>(data, len, pos);
+            uint64_t prm = get<uint64_t>(data, len, pos);
+            uint64_t n = get<uint64_t>(data, len, pos);
+            unsigned int b = get<uint8_t>(data, len, pos);
+            uint64_t nbytes = get<uint64_t>(data, len, pos);
+            if ((prm == 0) || (b > 63) || (pos + nbytes > len) || (n > nbytes * 8)) throw ::std::invalid_argument("corrupt kmer sketch.");
+
+            *this = kmer_sketch(static_cast<mode_type>(m), prm, s);
+            hashes.reserve(n);
+            size_t bit = 0;
+            uint64_t prev = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+              uint64_t q = 0;
+              while (get_bits(data + pos, nbytes, bit, 1) == 1) ++q;
+              uint64_t h = prev + ((q << b) | get_bits(data + pos, nbytes, bit, b));
+              if ((i > 0) && (h <= prev)) throw ::std::invalid_argument("corrupt kmer sketch.");
+              hashes.push_back(h);
+              prev = h;
+            }
+            sorted_size = hashes.size();
+            update_threshold();
+            return pos + nbytes;
+          }
+
+          void save(::std::string const & filename) const {
+            ::std::vector<uint8_t> out;
+            serialize(out);
+            FILE * f = fopen(filename.c_str(), "wb");
+            if ((f == nullptr) || (fwrite(out.data(), 1, out.size(), f) != out.size())) {
+              if (f != nullptr) fclose(f);
+              ::std::stringstream ss;
+              ss << "ERROR: unable to write kmer sketch to " << filename;
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+            }
+            fclose(f);
+          }
+
+          void load(::std::string const & filename) {
+            FILE * f = fopen(filename.c_str(), "rb");
+            if (f == nullptr) {
+              ::std::stringstream ss;
+              ss << "ERROR: unable to read kmer sketch from " << filename;
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+            }
+            ::std::vector<uint8_t> in;
+            uint8_t buf[65536];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), f)) > 0) in.insert(in.end(), buf, buf + n);
+            fclose(f);
+            deserialize(in.data(), in.size());
+          }
+      };
+
+      template <typename KMER, typename Hash, typename Transform>
+      constexpr uint32_t kmer_sketch<KMER, Hash, Transform>::magic;
+      template <typename KMER, typename Hash, typename Transform>
+      constexpr uint8_t kmer_sketch<KMER, Hash, Transform>::version;
+      template <typename KMER, typename Hash, typename Transform>
+      constexpr int kmer_sketch<KMER, Hash, Transform>::reduce_tag;
+
+    } // namespace kmer
+  } // namespace index
+} // namespace bliss
+
+
+#if defined(USE_MPI)
+namespace mxx {
+
+  template<>
+    struct datatype_builder<::bliss::index::kmer::sketch_similarity> :
+    public datatype_contiguous<uint8_t, sizeof(::bliss::index::kmer::sketch_similarity)> {
+
+      typedef datatype_contiguous<uint8_t, sizeof(::bliss::index::kmer::sketch_similarity)> baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+}  // namespace mxx
+#endif
+
+#endif /* KMER_SKETCH_HPP_ */
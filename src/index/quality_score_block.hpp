@@ -0,0 +1,265 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    quality_score_block.hpp
+ * @ingroup index
+ * @author  Tony Pan <tpan7@gatech.edu>
+ * @brief   computes the quality scores of all kmers of a read in one pass over a contiguous block.
+ * @details this is the block counterpart of QualityScoreSlidingWindow.  instead of decoding and updating a
+ *          ring buffer one character at a time, the quality string of a read is
+ *          1. decoded with the codec's LUT, using AVX2 gathers when available, into log2(p_correct) values with
+ *             invalid (zero probability) bases zeroed out and flagged,
+ *          2. prefix summed, for both the log probabilities and the invalid flags,
+ *          3. differenced at distance k to get every window's sum and invalid count, then exponentiated.
+ *          the prefix sums are accumulated in double, so float codecs are at least as accurate as the sliding window.
+ */
+
+#ifndef BLISS_INDEX_QUALITY_SCORE_BLOCK_HPP
+#define BLISS_INDEX_QUALITY_SCORE_BLOCK_HPP
+
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <cmath>
+#include <cstring>   // memcpy
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <x86intrin.h>
+#endif
+
+#include "index/quality_scores.hpp"
+
+namespace bliss
+{
+namespace index
+{
+
+/**
+ * @brief block computation of kmer quality scores, i.e. probability that all bases of a kmer are correct.
+ * @details buffers are kept between calls, so reuse 1 instance for all reads of a partition.
+ *          results are the same as from QualityScoreGenerationIterator over the same characters.
+ * @tparam KMER_SIZE   window size
+ * @tparam Encoder     quality score codec, e.g. Illumina18QualityScoreCodec<double>
+ */
+template <unsigned int KMER_SIZE,
+          typename Encoder = bliss::index::Illumina18QualityScoreCodec<double> >
+class QualityScoreBlock
+{
+  public:
+    /// Type of the output scores is equal to the floating point type returned by the encoding
+    typedef typename Encoder::value_type QualityType;
+
+  protected:
+    /// quality characters of the read, with EOL removed.
+    std::vector<unsigned char> chars;
+    /// decoded log2(p_correct) values.  0 for invalid bases.
+    std::vector<QualityType> values;
+    /// 1 for invalid bases (zero probability of being correct), else 0.
+    std::vector<uint8_t> invalid;
+    /// prefix sums of values.
+    std::vector<double> prefix;
+    /// prefix sums of invalid.
+    std::vector<uint32_t> invalid_prefix;
+    /// kmer quality scores.
+    std::vector<QualityType> scores;
+
+    /// scalar decode, for the tail of the block or without AVX2.
+    static void decode_scalar(const unsigned char * q, size_t n, QualityType * vals, uint8_t * inv) {
+      const QualityType lo = Encoder::DecodeLUT[0];
+      const QualityType hi = Encoder::DecodeLUT[95];
+
+      for (size_t i = 0; i < n; ++i) {
+        QualityType v = Encoder::decode(q[i]);
+        bool ok = (v > lo) && (v < hi);
+        vals[i] = ok ? v : 0;
+        inv[i] = ok ? 0 : 1;
+      }
+    }
+
+    /// decode in SIMD lanes.  returns the number of characters processed.
+    template <typename T>
+    static size_t decode_simd(const unsigned char *, size_t, T *, uint8_t *) {
+      return 0;
+    }
+
+#if defined(__AVX2__)
+    /// 4 doubles per gather.
+    static size_t decode_simd(const unsigned char * q, size_t n, double * vals, uint8_t * inv) {
+      const double * lut = Encoder::DecodeLUT.data();
+      const __m128i offset = _mm_set1_epi32(Encoder::min_input);
+      const __m256d lo = _mm256_set1_pd(Encoder::DecodeLUT[0]);
+      const __m256d hi = _mm256_set1_pd(Encoder::DecodeLUT[95]);
+
+      size_t i = 0;
+      int32_t c4;
+      for (; (i + 4) <= n; i += 4) {
+        memcpy(&c4, q + i, 4);
+        __m128i idx = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(c4)), offset);
+        __m256d v = _mm256_i32gather_pd(lut, idx, 8);
+        __m256d ok = _mm256_and_pd(_mm256_cmp_pd(v, lo, _CMP_GT_OQ), _mm256_cmp_pd(v, hi, _CMP_LT_OQ));
+        _mm256_storeu_pd(vals + i, _mm256_and_pd(v, ok));
+
+        int m = _mm256_movemask_pd(ok);
+        inv[i]     = (~m) & 0x1;
+        inv[i + 1] = ((~m) >> 1) & 0x1;
+        inv[i + 2] = ((~m) >> 2) & 0x1;
+        inv[i + 3] = ((~m) >> 3) & 0x1;
+      }
+      return i;
+    }
+
+    /// 8 floats per gather.
+    static size_t decode_simd(const unsigned char * q, size_t n, float * vals, uint8_t * inv) {
+      const float * lut = Encoder::DecodeLUT.data();
+      const __m256i offset = _mm256_set1_epi32(Encoder::min_input);
+      const __m256 lo = _mm256_set1_ps(Encoder::DecodeLUT[0]);
+      const __m256 hi = _mm256_set1_ps(Encoder::DecodeLUT[95]);
+
+      size_t i = 0;
+      for (; (i + 8) <= n; i += 8) {
+        __m256i idx = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(q + i))), offset);
+        __m256 v = _mm256_i32gather_ps(lut, idx, 4);
+        __m256 ok = _mm256_and_ps(_mm256_cmp_ps(v, lo, _CMP_GT_OQ), _mm256_cmp_ps(v, hi, _CMP_LT_OQ));
+        _mm256_storeu_ps(vals + i, _mm256_and_ps(v, ok));
+
+        int m = ~_mm256_movemask_ps(ok);
+        for (int j = 0; j < 8; ++j) {
+          inv[i + j] = (m >> j) & 0x1;
+        }
+      }
+      return i;
+    }
+#endif
+
+  public:
+
+    /**
+     * @brief decode a block of quality characters into log2(p_correct), with invalid bases set to 0 and flagged.
+     * @param q     quality characters, contiguous, no EOL.
+     * @param n     number of characters
+     * @param vals  output log2(p_correct), n entries
+     * @param inv   output invalid flags, n entries
+     */
+    static void decode(const unsigned char * q, size_t n, QualityType * vals, uint8_t * inv) {
+      size_t i = decode_simd(q, n, vals, inv);
+      decode_scalar(q + i, n - i, vals + i, inv + i);
+    }
+
+    /**
+     * @brief compute the quality scores of all kmers in a contiguous quality string.
+     * @return  scores, 1 per kmer, in order.  valid until the next call.
+     */
+    std::vector<QualityType> const & compute(const unsigned char * q, size_t n) {
+      scores.clear();
+      if (n < KMER_SIZE) return scores;
+
+      values.resize(n);
+      invalid.resize(n);
+      decode(q, n, values.data(), invalid.data());
+
+      prefix.resize(n + 1);
+      invalid_prefix.resize(n + 1);
+      prefix[0] = 0.0;
+      invalid_prefix[0] = 0;
+      for (size_t i = 0; i < n; ++i) {
+        prefix[i + 1] = prefix[i] + values[i];
+        invalid_prefix[i + 1] = invalid_prefix[i] + invalid[i];
+      }
+
+      scores.resize(n - KMER_SIZE + 1);
+      for (size_t i = 0; i < scores.size(); ++i) {
+        scores[i] = (invalid_prefix[i + KMER_SIZE] > invalid_prefix[i]) ? 0.0 :
+            std::exp2(static_cast<QualityType>(prefix[i + KMER_SIZE] - prefix[i]));
+      }
+      return scores;
+    }
+
+    /**
+     * @brief compute the quality scores of all kmers from a character iterator, e.g. a NonEOLIter over a read's quality string.
+     * @return  scores, 1 per kmer, in order.  valid until the next call.
+     */
+    template <typename Iter>
+    std::vector<QualityType> const & compute(Iter begin, Iter end) {
+      chars.assign(begin, end);
+      return compute(chars.data(), chars.size());
+    }
+
+    /// scores from the last compute call.
+    std::vector<QualityType> const & get_scores() const {
+      return scores;
+    }
+};
+
+
+/**
+ * @brief forward iterator over the scores of a QualityScoreBlock that shares ownership of the block.
+ * @details the iterator and its copies keep the block alive, so the scores stay valid independent of whoever computed them.
+ *          a default constructed iterator has no block.  it is an end marker only, and must not be dereferenced.
+ * @tparam Block   QualityScoreBlock type
+ */
+template <typename Block>
+class QualityScoreBlockIterator :
+    public std::iterator<std::forward_iterator_tag, typename Block::QualityType, std::ptrdiff_t,
+                         typename Block::QualityType const *, typename Block::QualityType const &>
+{
+  protected:
+    using score_iterator = typename std::vector<typename Block::QualityType>::const_iterator;
+
+    /// the block whose scores are iterated.
+    std::shared_ptr<Block const> block;
+    /// current position in the block's scores.
+    score_iterator curr;
+
+  public:
+    using value_type = typename Block::QualityType;
+
+    QualityScoreBlockIterator() : block(), curr() {}
+
+    explicit QualityScoreBlockIterator(std::shared_ptr<Block const> const & _block) :
+      block(_block), curr(_block->get_scores().cbegin()) {}
+
+    value_type const & operator*() const {
+      return *curr;
+    }
+
+    QualityScoreBlockIterator & operator++() {
+      ++curr;
+      return *this;
+    }
+
+    QualityScoreBlockIterator operator++(int) {
+      QualityScoreBlockIterator out(*this);
+      ++curr;
+      return out;
+    }
+
+    /// iterators over different blocks, or without a block, are never equal.
+    bool operator==(QualityScoreBlockIterator const & other) const {
+      return (block == other.block) && (!block || (curr == other.curr));
+    }
+
+    bool operator!=(QualityScoreBlockIterator const & other) const {
+      return !(this->operator==(other));
+    }
+};
+
+
+} // namespace index
+} // namespace bliss
+
+#endif // BLISS_INDEX_QUALITY_SCORE_BLOCK_HPP
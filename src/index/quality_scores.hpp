@@ -97,6 +97,9 @@ public:
     /// number of possible quality-score character values
     static constexpr unsigned char size = MaxInput - MinInput + 1;
 
+    /// ascii value of the lowest quality score, i.e. the offset into DecodeLUT.
+    static constexpr unsigned char min_input = MinInput;
+
 protected:
     /// Type of the lookup-table
     typedef std::array<OutT, 96> LUTType;
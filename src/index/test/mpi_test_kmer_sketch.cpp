@@ -0,0 +1,282 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_kmer_sketch.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the kmer sketches:  the distributed sketch is the same as the serial one, bottom-k keeps the k smallest
+ *          hashes, canonicalization, the similarity estimates, and serialization.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+#include <stdexcept>
+#include <string>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_sketch.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/sequence_iterator.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using SketchType = ::bliss::index::kmer::kmer_sketch<KmerType>;
+
+
+static KmerType make_kmer(uint64_t v) {
+  KmerType k;
+  k.getDataRef()[0] = v & ((static_cast<uint64_t>(1) << 62) - 1);
+  return k;
+}
+
+/// kmers with values in [first, last).
+static std::vector<KmerType> range_kmers(uint64_t first, uint64_t last) {
+  std::vector<KmerType> kmers;
+  for (uint64_t v = first; v < last; ++v) kmers.push_back(make_kmer(v * 0x9E3779B97F4A7C15ULL));
+  return kmers;
+}
+
+
+TEST(KmerSketch, reduce)
+{
+  ::mxx::comm comm;
+  std::default_random_engine gen(3 + comm.rank());
+  std::uniform_int_distribution<uint64_t> dist(0, 20000);
+
+  std::vector<KmerType> kmers;
+  for (size_t i = 0; i < 10000; ++i) kmers.push_back(make_kmer(dist(gen) * 0x9E3779B97F4A7C15ULL));
+  auto all = ::mxx::allgatherv(kmers, comm);
+
+  SketchType::mode_type modes[] = {SketchType::BOTTOM_K, SketchType::FRAC_MIN_HASH};
+  uint64_t params[] = {500, 20};
+  for (int m = 0; m < 2; ++m) {
+    SketchType local(modes[m], params[m]);
+    local.insert(kmers);
+    local.reduce(comm);
+
+    SketchType serial(modes[m], params[m]);
+    serial.insert(all);
+
+    EXPECT_EQ(serial.get_hashes(), local.get_hashes());
+  }
+}
+
+TEST(KmerSketch, bottom_k)
+{
+  auto kmers = range_kmers(0, 5000);
+  // duplicates do not count.
+  auto dups = range_kmers(0, 2000);
+  kmers.insert(kmers.end(), dups.begin(), dups.end());
+
+  ::bliss::kmer::hash::farm<KmerType, false> hasher(24, 42);
+  ::bliss::kmer::transform::lex_less<KmerType> trans;
+  std::set<uint64_t> expected;
+  for (auto const & k : kmers) expected.insert(hasher(trans(k)));
+
+  SketchType sketch(SketchType::BOTTOM_K, 100);
+  sketch.insert(kmers);
+  ASSERT_EQ(100UL, sketch.size());
+  EXPECT_TRUE(std::equal(sketch.get_hashes().begin(), sketch.get_hashes().end(), expected.begin()));
+  EXPECT_NEAR(5000.0, sketch.cardinality(), 1500.0);
+
+  // fewer kmers than k:  all of them.
+  SketchType small(SketchType::BOTTOM_K, 10000);
+  small.insert(kmers);
+  EXPECT_EQ(expected.size(), small.size());
+  EXPECT_EQ(5000.0, small.cardinality());
+
+  SketchType frac(SketchType::FRAC_MIN_HASH, 10);
+  frac.insert(kmers);
+  size_t below = 0;
+  for (auto h : expected) below += (h <= std::numeric_limits<uint64_t>::max() / 10) ? 1 : 0;
+  EXPECT_EQ(below, frac.size());
+
+  EXPECT_THROW(SketchType(SketchType::BOTTOM_K, 0), std::invalid_argument);
+}
+
+TEST(KmerSketch, canonical)
+{
+  auto kmers = range_kmers(0, 3000);
+  std::vector<KmerType> rc;
+  for (auto const & k : kmers) rc.push_back(k.reverse_complement());
+
+  SketchType a(SketchType::BOTTOM_K, 200), b(SketchType::BOTTOM_K, 200);
+  a.insert(kmers);
+  b.insert(rc);
+  EXPECT_EQ(a.get_hashes(), b.get_hashes());
+  EXPECT_EQ(1.0, SketchType::compare(a, b).jaccard);
+}
+
+TEST(KmerSketch, similarity)
+{
+  // |A| = |B| = 20000, |A & B| = 10000:  jaccard 1/3, containment 1/2.
+  auto a_kmers = range_kmers(0, 20000);
+  auto b_kmers = range_kmers(10000, 30000);
+
+  SketchType::mode_type modes[] = {SketchType::BOTTOM_K, SketchType::FRAC_MIN_HASH};
+  uint64_t params[] = {2000, 10};
+  for (int m = 0; m < 2; ++m) {
+    SketchType a(modes[m], params[m]), b(modes[m], params[m]);
+    a.insert(a_kmers);
+    b.insert(b_kmers);
+
+    auto sim = SketchType::compare(a, b);
+    EXPECT_NEAR(1.0 / 3.0, sim.jaccard, 0.04);
+    EXPECT_NEAR(0.5, sim.containment_first, 0.05);
+    EXPECT_NEAR(0.5, sim.containment_second, 0.05);
+
+    auto self = SketchType::compare(a, a);
+    EXPECT_EQ(1.0, self.jaccard);
+  }
+
+  // different seeds are not comparable.
+  SketchType c(SketchType::BOTTOM_K, 2000, 7), d(SketchType::BOTTOM_K, 2000);
+  EXPECT_THROW(SketchType::compare(c, d), std::invalid_argument);
+}
+
+TEST(KmerSketch, all_vs_all)
+{
+  ::mxx::comm comm;
+
+  std::vector<SketchType> sketches;
+  for (uint64_t i = 0; i < 7; ++i) {
+    sketches.emplace_back(SketchType::BOTTOM_K, 300);
+    auto kmers = range_kmers(i * 1000, i * 1000 + 4000);
+    sketches.back().insert(kmers);
+  }
+
+  auto result = SketchType::all_vs_all(sketches, comm);
+  ASSERT_EQ(49UL, result.size());
+  for (size_t i = 0; i < 7; ++i) {
+    for (size_t j = 0; j < 7; ++j) {
+      auto sim = SketchType::compare(sketches[i], sketches[j]);
+      EXPECT_EQ(sim.intersection, result[i * 7 + j].intersection);
+      EXPECT_EQ(sim.jaccard, result[i * 7 + j].jaccard);
+      EXPECT_EQ(sim.containment_first, result[i * 7 + j].containment_first);
+      EXPECT_EQ(sim.containment_second, result[i * 7 + j].containment_second);
+    }
+  }
+}
+
+TEST(KmerSketch, serialize)
+{
+  ::mxx::comm comm;
+  auto kmers = range_kmers(0, 50000);
+
+  SketchType::mode_type modes[] = {SketchType::BOTTOM_K, SketchType::FRAC_MIN_HASH};
+  uint64_t params[] = {5000, 20};
+  for (int m = 0; m < 2; ++m) {
+    SketchType sketch(modes[m], params[m], 11);
+    sketch.insert(kmers);
+
+    std::vector<uint8_t> bytes;
+    sketch.serialize(bytes);
+    // gaps take well under 64 bits.
+    EXPECT_LT(bytes.size(), sketch.size() * 8 * 7 / 8);
+
+    SketchType copy;
+    EXPECT_EQ(bytes.size(), copy.deserialize(bytes.data(), bytes.size()));
+    EXPECT_EQ(sketch.get_hashes(), copy.get_hashes());
+    EXPECT_EQ(sketch.get_mode(), copy.get_mode());
+    EXPECT_EQ(sketch.get_param(), copy.get_param());
+    EXPECT_EQ(11U, copy.get_seed());
+    EXPECT_EQ(1.0, SketchType::compare(sketch, copy).jaccard);
+
+    // truncated or corrupt.
+    EXPECT_THROW(copy.deserialize(bytes.data(), bytes.size() / 2), std::invalid_argument);
+    bytes[0] ^= 1;
+    EXPECT_THROW(copy.deserialize(bytes.data(), bytes.size()), std::invalid_argument);
+  }
+
+  std::stringstream ss;
+  ss << "kmer_sketch_test." << comm.rank() << ".bin";
+  SketchType sketch;
+  sketch.insert(kmers);
+  sketch.save(ss.str());
+  SketchType loaded;
+  loaded.load(ss.str());
+  EXPECT_EQ(sketch.get_hashes(), loaded.get_hashes());
+  std::remove(ss.str().c_str());
+
+  EXPECT_THROW(loaded.load(ss.str()), ::bliss::io::IOException);
+}
+
+TEST(KmerSketch, insert_file)
+{
+  ::mxx::comm comm;
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/test.medium.fastq");
+
+  // gold:  this rank's kmers, read all at once from the same partition.
+  std::vector<KmerType> kmers;
+  ::bliss::io::KmerFileHelper::template read_file_posix<::bliss::index::kmer::KmerParser<KmerType>,
+     ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, kmers, comm);
+  EXPECT_GT(::mxx::allreduce(kmers.size(), comm), 0UL);
+
+  for (auto mode : {SketchType::BOTTOM_K, SketchType::FRAC_MIN_HASH}) {
+    SketchType gold(mode, 64);
+    gold.insert(kmers);
+    gold.reduce(comm);
+
+    // small blocks, so that each rank inserts several.
+    for (size_t block_size : {100UL, 1UL << 20}) {
+      SketchType sketch(mode, 64);
+      EXPECT_EQ(kmers.size(), sketch.template insert_file<::bliss::io::FASTQParser>(filename, comm, block_size));
+
+      sketch.reduce(comm);
+      EXPECT_EQ(gold.get_hashes(), sketch.get_hashes()) << "block size " << block_size;
+    }
+  }
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_kmer_dispatch.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test runtime selection of Kmer specializations.
+ * @details
+ *
+ */
+
+// include google test
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+
+#include "common/kmer.hpp"
+#include "common/alphabets.hpp"
+#include "utils/kmer_utils.hpp"
+#include "index/kmer_dispatch.hpp"
+
+
+using Dispatch = ::bliss::index::kmer::kmer_dispatch<uint64_t,
+    ::bliss::index::kmer::kmer_alphabets<4, 16>,
+    ::bliss::index::kmer::kmer_sizes<15, 21, 31, 63> >;
+
+
+/// encode a kmer from a string, and report the specialization used.
+struct kmer_runner {
+    template <typename KmerType>
+    std::string run(std::string const & seq, unsigned int & k, unsigned int & bits) {
+      k = KmerType::size;
+      bits = KmerType::bitsPerChar;
+
+      KmerType kmer;
+      for (size_t i = 0; i < KmerType::size; ++i) {
+        kmer.nextFromChar(KmerType::KmerAlphabet::FROM_ASCII[static_cast<size_t>(seq[i])]);
+      }
+      return bliss::utils::KmerUtils::toASCIIString(kmer);
+    }
+};
+
+/// runner without result.
+struct count_runner {
+    size_t calls = 0;
+    size_t words = 0;
+
+    template <typename KmerType>
+    void run() {
+      ++calls;
+      words = KmerType::nWords;
+    }
+};
+
+
+TEST(KmerDispatch, select)
+{
+  std::string seq("ACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCAACGTTGCA");
+  unsigned int k = 0;
+  unsigned int bits = 0;
+
+  for (unsigned int kk : Dispatch::sizes()) {
+    std::string out = Dispatch::run(4, kk, kmer_runner(), seq, k, bits);
+    EXPECT_EQ(kk, k);
+    EXPECT_EQ(2U, bits);
+    EXPECT_EQ(seq.substr(0, kk), out);
+
+    out = Dispatch::run(16, kk, kmer_runner(), seq, k, bits);
+    EXPECT_EQ(kk, k);
+    EXPECT_EQ(4U, bits);
+    EXPECT_EQ(seq.substr(0, kk), out);
+  }
+}
+
+TEST(KmerDispatch, void_runner)
+{
+  count_runner r;
+  Dispatch::run(16, 63, r);
+  EXPECT_EQ(4UL, r.words);   // 63 * 4 bits in 64 bit words
+  Dispatch::run(4, 63, r);
+  EXPECT_EQ(2UL, r.words);   // 63 * 2 bits
+  EXPECT_EQ(2UL, r.calls);
+}
+
+TEST(KmerDispatch, unsupported)
+{
+  unsigned int k = 0;
+  unsigned int bits = 0;
+
+  EXPECT_TRUE(Dispatch::supports(16, 21));
+  EXPECT_FALSE(Dispatch::supports(5, 21));
+  EXPECT_FALSE(Dispatch::supports(4, 22));
+
+  EXPECT_THROW(Dispatch::run(4, 22, kmer_runner(), std::string("ACGT"), k, bits), std::invalid_argument);
+  EXPECT_THROW(Dispatch::run(5, 21, kmer_runner(), std::string("ACGT"), k, bits), std::invalid_argument);
+  EXPECT_EQ(0U, k);
+}
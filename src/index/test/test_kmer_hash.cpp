@@ -127,6 +127,9 @@ TYPED_TEST_P(KmerHashTest, hash)
 	this->template hash_vector<bliss::kmer::hash::identity>(std::string("identity"));
 	this->template hash_vector<bliss::kmer::hash::murmur  >(std::string("murmur"));
 	this->template hash_vector<bliss::kmer::hash::farm    >(std::string("farm"));
+	this->template hash_vector<bliss::kmer::hash::crc32c  >(std::string("crc32c"));
+	this->template hash_vector<bliss::kmer::hash::xxh3    >(std::string("xxh3"));
+	this->template hash_vector<bliss::kmer::hash::wyhash  >(std::string("wyhash"));
 }
 
 
@@ -134,7 +137,29 @@ TYPED_TEST_P(KmerHashTest, hash)
 
 
 
-REGISTER_TYPED_TEST_CASE_P(KmerHashTest, hash);
+TYPED_TEST_P(KmerHashTest, prefix)
+{
+  // prefix versions are used for distribution, and should not be the same function as the storage hash.
+  bliss::kmer::hash::crc32c<TypeParam, false> c;
+  bliss::kmer::hash::crc32c<TypeParam, true> cp;
+  bliss::kmer::hash::xxh3<TypeParam, false> x;
+  bliss::kmer::hash::xxh3<TypeParam, true> xp;
+  bliss::kmer::hash::wyhash<TypeParam, false> w;
+  bliss::kmer::hash::wyhash<TypeParam, true> wp;
+
+  size_t same_c = 0, same_x = 0, same_w = 0;
+  for (size_t i = 0; i < 1000; ++i) {
+    same_c += (c(this->kmers[i]) == cp(this->kmers[i]));
+    same_x += (x(this->kmers[i]) == xp(this->kmers[i]));
+    same_w += (w(this->kmers[i]) == wp(this->kmers[i]));
+  }
+  EXPECT_EQ(0UL, same_c);
+  EXPECT_EQ(0UL, same_x);
+  EXPECT_EQ(0UL, same_w);
+}
+
+
+REGISTER_TYPED_TEST_CASE_P(KmerHashTest, hash, prefix);
 
 //////////////////// RUN the tests with different types.
 
@@ -193,3 +218,15 @@ typedef ::testing::Types<
 > KmerHashTestTypes;
 INSTANTIATE_TYPED_TEST_CASE_P(Bliss, KmerHashTest, KmerHashTestTypes);
 
+
+// crc32c check values (RFC 3720), for both the SSE4.2 and the table versions.
+TEST(KmerHashCrc32c, check_values)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+  for (int i = 0; i < 4; ++i) crc = bliss::kmer::hash::detail::crc32c_u64(crc, 0ULL);
+  EXPECT_EQ(0x8A9136AAU, ~crc);
+
+  crc = 0xFFFFFFFFU;
+  for (int i = 0; i < 8; ++i) crc = bliss::kmer::hash::detail::crc32c_u32(crc, 0xFFFFFFFFU);
+  EXPECT_EQ(0x62A8AB43U, ~crc);
+}
@@ -30,6 +30,7 @@
 
 // include classes to test
 #include "index/quality_score_iterator.hpp"
+#include "index/quality_score_block.hpp"
 #include <vector>
 #include <algorithm>
 #include <cassert>
@@ -177,6 +178,17 @@ void iter_decode(const std::vector<unsigned char>& data, // quality score value
 }
 
 
+// templated test function
+template<typename CODEC, unsigned int K>
+void block_decode(const std::vector<unsigned char>& data, // quality score value
+                           std::vector<typename CODEC::value_type>& output) {
+
+  bliss::index::QualityScoreBlock<K, CODEC> block;
+
+  output = block.compute(data.begin(), data.end());
+}
+
+
 // templated test function
 template<typename CODEC, unsigned int K>
 void codec_decode(const std::vector<unsigned char> & data, // quality score value
@@ -337,6 +349,23 @@ void testQualityIterator(const std::string & strdata) {
   EXPECT_TRUE(same);
 
 
+  std::vector<OT> blockDecoded;
+  block_decode< Encoder, K >(gold, blockDecoded);
+  same = compare_vectors<OT>(blockDecoded, goldDecoded);
+
+  if (!same) {
+    BL_ERROR( "block decode: result not same" << std::endl );
+
+    BL_ERROR( "GOLD decoded: size: " << goldDecoded.size() );
+    std::copy(goldDecoded.begin() , goldDecoded.end(), std::ostream_iterator<OT>(std::cout, ","));
+    std::cout << std::endl;
+    BL_ERROR( "block decoded: size: " << blockDecoded.size());
+    std::copy(blockDecoded.begin() , blockDecoded.end(), std::ostream_iterator<OT>(std::cout, ","));
+    std::cout << std::endl;
+  }
+
+  EXPECT_TRUE(same);
+
 }
 
 
@@ -0,0 +1,405 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    async_block_reader.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   asynchronous block reader for file descriptors, keeping multiple reads in flight.
+ * @details a byte range is split into fixed size blocks.  up to "depth" blocks are read concurrently.
+ *          two modes:
+ *            read():         read the whole range into a contiguous buffer.  concurrency only.
+ *            read_blocks():  stream the blocks in file order to a callback, using a ring of "depth" buffers.
+ *                            while the callback processes block i, blocks i+1 .. i+depth-1 are loading,
+ *                            so parsing overlaps I/O.
+ *
+ *          two engines:
+ *            io_uring (when configured with USE_IO_URING and liburing is found).  a single ring with "depth"
+ *                     outstanding reads.  falls back to the thread engine if ring setup fails at runtime.
+ *            threads  pread64 from "depth" worker threads.  each worker owns one buffer slot in the ring.
+ *
+ *          block size defaults to 32MB, which matches the preferred lustre stripe size (see file.hpp notes).
+ */
+#ifndef SRC_IO_ASYNC_BLOCK_READER_HPP_
+#define SRC_IO_ASYNC_BLOCK_READER_HPP_
+
+#include "bliss-config.hpp"
+
+#include <unistd.h>     // pread64
+#include <fcntl.h>
+#include <cstring>      // strerror
+#include <cerrno>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <sstream>
+#include <stdexcept>    // invalid_argument
+#include <algorithm>    // min
+
+#if defined(USE_IO_URING)
+#include <liburing.h>
+#endif
+
+#include "io/io_exception.hpp"
+#include "partition/range.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss {
+
+  namespace io {
+
+    /**
+     * @brief reads a range of a file descriptor in blocks, with several blocks in flight.  see file description.
+     * @note  the file descriptor is not owned.  pread is used so the fd offset is not changed.
+     */
+    class async_block_reader {
+
+      public:
+        using range_type = ::bliss::partition::range<size_t>;
+
+      protected:
+        /// file descriptor, not owned.
+        int fd;
+
+        /// size of each read request.
+        size_t block_size;
+
+        /// number of outstanding reads
+        size_t depth;
+
+        /// blocking read of a whole block at offset, handling short reads.
+        void pread_full(unsigned char * out, size_t bytes, size_t offset) const {
+          size_t s = 0;
+          long count;
+          while (s < bytes) {
+            count = pread64(fd, out + s, bytes - s, static_cast<__off64_t>(offset + s));
+            if (count < 0) {
+              if (errno == EINTR) continue;
+              std::stringstream ss;
+              int myerr = errno;
+              ss << "ERROR: async_block_reader pread64: error " << myerr << ": " << strerror(myerr);
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+            }
+            if (count == 0) {
+              std::stringstream ss;
+              ss << "ERROR: async_block_reader pread64: unexpected end of file at " << (offset + s) << ", expected " << (offset + bytes);
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+            }
+            s += count;
+          }
+        }
+
+        /// range of block i in r
+        inline range_type get_block(range_type const & r, size_t i) const {
+          size_t start = r.start + i * block_size;
+          return range_type(start, std::min(start + block_size, r.end));
+        }
+
+        inline size_t get_block_count(range_type const & r) const {
+          return (r.size() + block_size - 1) / block_size;
+        }
+
+        //============ thread engine
+
+        /// buffer slot for the streaming thread engine.  owned by one worker.
+        struct slot {
+            std::vector<unsigned char> buffer;
+            std::mutex mtx;
+            std::condition_variable cv;
+            bool ready;
+            bool stop;
+            std::exception_ptr error;
+            slot() : ready(false), stop(false) {};
+        };
+
+        void read_threads(unsigned char * out, range_type const & r) const {
+          size_t nblocks = get_block_count(r);
+          size_t nthreads = std::min(depth, nblocks);
+
+          std::atomic<size_t> next(0);
+          std::vector<std::exception_ptr> errors(nthreads);
+          std::vector<std::thread> workers;
+          workers.reserve(nthreads);
+
+          for (size_t t = 0; t < nthreads; ++t) {
+            workers.emplace_back([this, out, &r, &next, &errors, nblocks, t](){
+              try {
+                size_t i;
+                while ((i = next.fetch_add(1)) < nblocks) {
+                  range_type b = get_block(r, i);
+                  pread_full(out + (b.start - r.start), b.size(), b.start);
+                }
+              } catch (...) {
+                errors[t] = std::current_exception();
+              }
+            });
+          }
+          for (auto & w : workers) w.join();
+          for (auto & e : errors) if (e) std::rethrow_exception(e);
+        }
+
+        template <typename Op>
+        size_t read_blocks_threads(range_type const & r, Op & op) const {
+          size_t nblocks = get_block_count(r);
+          size_t nthreads = std::min(depth, nblocks);
+
+          std::vector<slot> slots(nthreads);
+          std::vector<std::thread> workers;
+          workers.reserve(nthreads);
+
+          // worker t loads blocks t, t + nthreads, ... into slot t, waiting for the consumer to release the slot.
+          for (size_t t = 0; t < nthreads; ++t) {
+            slots[t].buffer.resize(block_size);
+            workers.emplace_back([this, &r, &slots, nblocks, nthreads, t](){
+              slot & sl = slots[t];
+              for (size_t i = t; i < nblocks; i += nthreads) {
+                {
+                  std::unique_lock<std::mutex> lock(sl.mtx);
+                  sl.cv.wait(lock, [&sl](){ return !sl.ready || sl.stop; });
+                  if (sl.stop) return;
+                }
+                std::exception_ptr err;
+                try {
+                  range_type b = get_block(r, i);
+                  pread_full(sl.buffer.data(), b.size(), b.start);
+                } catch (...) {
+                  err = std::current_exception();
+                }
+                {
+                  std::lock_guard<std::mutex> lock(sl.mtx);
+                  sl.error = err;
+                  sl.ready = true;
+                }
+                sl.cv.notify_all();
+                if (err) return;
+              }
+            });
+          }
+
+          auto stop_all = [&slots, &workers](){
+            for (auto & sl : slots) {
+              { std::lock_guard<std::mutex> lock(sl.mtx); sl.stop = true; }
+              sl.cv.notify_all();
+            }
+            for (auto & w : workers) if (w.joinable()) w.join();
+          };
+
+          // consume in order.
+          size_t total = 0;
+          try {
+            for (size_t i = 0; i < nblocks; ++i) {
+              slot & sl = slots[i % nthreads];
+              {
+                std::unique_lock<std::mutex> lock(sl.mtx);
+                sl.cv.wait(lock, [&sl](){ return sl.ready; });
+                if (sl.error) std::rethrow_exception(sl.error);
+              }
+              range_type b = get_block(r, i);
+              op(b, static_cast<unsigned char const *>(sl.buffer.data()));
+              total += b.size();
+              {
+                std::lock_guard<std::mutex> lock(sl.mtx);
+                sl.ready = false;
+              }
+              sl.cv.notify_all();
+            }
+          } catch (...) {
+            stop_all();
+            throw;
+          }
+          stop_all();
+          return total;
+        }
+
+#if defined(USE_IO_URING)
+        //============ io_uring engine
+
+        /// submit read for block i into buffer.
+        void submit_uring(struct io_uring & ring, unsigned char * buffer, range_type const & b, size_t i) const {
+          struct io_uring_sqe * sqe = io_uring_get_sqe(&ring);
+          if (sqe == nullptr) {
+            // submission queue full:  flush and retry once.
+            io_uring_submit(&ring);
+            sqe = io_uring_get_sqe(&ring);
+          }
+          if (sqe == nullptr) {
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR: async_block_reader io_uring_get_sqe: submission queue full");
+          }
+          io_uring_prep_read(sqe, fd, buffer, b.size(), b.start);
+          io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(i));
+        }
+
+        /// wait for one completion.  returns block id.  short reads are completed synchronously.
+        size_t wait_uring(struct io_uring & ring, range_type const & r, std::vector<unsigned char *> const & buffers,
+                          size_t & completed) const {
+          struct io_uring_cqe * cqe;
+          int ret = io_uring_wait_cqe(&ring, &cqe);
+          if (ret < 0) {
+            std::stringstream ss;
+            ss << "ERROR: async_block_reader io_uring_wait_cqe: error " << -ret << ": " << strerror(-ret);
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+          }
+          size_t i = reinterpret_cast<size_t>(io_uring_cqe_get_data(cqe));
+          int res = cqe->res;
+          io_uring_cqe_seen(&ring, cqe);
+          ++completed;
+
+          if (res < 0) {
+            std::stringstream ss;
+            ss << "ERROR: async_block_reader io_uring read: error " << -res << ": " << strerror(-res);
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+          }
+          range_type b = get_block(r, i);
+          if (static_cast<size_t>(res) < b.size())
+            pread_full(buffers[i] + res, b.size() - res, b.start + res);
+          return i;
+        }
+
+        /// wait for all outstanding requests, so buffers can be released safely after an error.
+        static void drain_uring(struct io_uring & ring, size_t completed, size_t submitted) {
+          struct io_uring_cqe * cqe;
+          for (; completed < submitted; ++completed) {
+            if (io_uring_wait_cqe(&ring, &cqe) < 0) break;
+            io_uring_cqe_seen(&ring, cqe);
+          }
+          io_uring_queue_exit(&ring);
+        }
+
+        /// returns false if ring could not be set up.
+        bool read_uring(unsigned char * out, range_type const & r) const {
+          struct io_uring ring;
+          size_t nblocks = get_block_count(r);
+          if (io_uring_queue_init(depth, &ring, 0) < 0) return false;
+
+          std::vector<unsigned char *> buffers(nblocks);
+          for (size_t i = 0; i < nblocks; ++i) buffers[i] = out + (get_block(r, i).start - r.start);
+
+          size_t submitted = 0, completed = 0;
+          try {
+            while (completed < nblocks) {
+              for (; (submitted < nblocks) && (submitted - completed < depth); ++submitted)
+                submit_uring(ring, buffers[submitted], get_block(r, submitted), submitted);
+              io_uring_submit(&ring);
+
+              wait_uring(ring, r, buffers, completed);
+            }
+          } catch (...) {
+            drain_uring(ring, completed, submitted);
+            throw;
+          }
+          io_uring_queue_exit(&ring);
+          return true;
+        }
+
+        /// returns false if ring could not be set up.
+        template <typename Op>
+        bool read_blocks_uring(range_type const & r, Op & op, size_t & total) const {
+          struct io_uring ring;
+          size_t nblocks = get_block_count(r);
+          size_t nslots = std::min(depth, nblocks);
+          if (io_uring_queue_init(nslots, &ring, 0) < 0) return false;
+
+          std::vector<std::vector<unsigned char> > slots(nslots, std::vector<unsigned char>(block_size));
+          std::vector<unsigned char *> buffers(nblocks);
+          std::vector<bool> done(nblocks, false);
+
+          total = 0;
+          size_t submitted = 0, completed = 0;
+          try {
+            for (; submitted < nslots; ++submitted) {
+              buffers[submitted] = slots[submitted % nslots].data();
+              submit_uring(ring, buffers[submitted], get_block(r, submitted), submitted);
+            }
+            io_uring_submit(&ring);
+
+            for (size_t i = 0; i < nblocks; ++i) {
+              // completions may arrive out of order.
+              while (!done[i]) done[wait_uring(ring, r, buffers, completed)] = true;
+
+              range_type b = get_block(r, i);
+              op(b, static_cast<unsigned char const *>(buffers[i]));
+              total += b.size();
+
+              // slot of block i is free, reuse for block i + nslots.
+              if (submitted < nblocks) {
+                buffers[submitted] = buffers[i];
+                submit_uring(ring, buffers[submitted], get_block(r, submitted), submitted);
+                ++submitted;
+                io_uring_submit(&ring);
+              }
+            }
+          } catch (...) {
+            drain_uring(ring, completed, submitted);
+            throw;
+          }
+          io_uring_queue_exit(&ring);
+          return true;
+        }
+#endif
+
+      public:
+
+        /**
+         * @brief constructor
+         * @param _fd           open file descriptor.  not owned.
+         * @param _block_size   bytes per read request
+         * @param _depth        number of concurrent read requests (and buffers, for read_blocks)
+         */
+        async_block_reader(int _fd, size_t _block_size = (32UL << 20), size_t _depth = 4) :
+          fd(_fd), block_size(_block_size), depth(_depth) {
+          if (block_size == 0) throw std::invalid_argument("ERROR: async_block_reader block size must be positive.");
+          if (depth == 0) throw std::invalid_argument("ERROR: async_block_reader depth must be positive.");
+        };
+
+        size_t get_block_size() const { return block_size; }
+        size_t get_depth() const { return depth; }
+
+        /**
+         * @brief read range r into contiguous buffer out, which must hold r.size() bytes.
+         */
+        void read(unsigned char * out, range_type const & r) const {
+          if (r.size() == 0) return;
+#if defined(USE_IO_URING)
+          if (read_uring(out, r)) return;
+#endif
+          read_threads(out, r);
+        }
+
+        /**
+         * @brief stream range r block by block, in file order.
+         * @details op(range_type const & block_range, unsigned char const * data) is called on the calling thread.
+         *          data is valid only during the call.  later blocks load while op runs.
+         * @return  number of bytes delivered.
+         */
+        template <typename Op>
+        size_t read_blocks(range_type const & r, Op op) const {
+          if (r.size() == 0) return 0;
+#if defined(USE_IO_URING)
+          size_t total = 0;
+          if (read_blocks_uring(r, op, total)) return total;
+#endif
+          return read_blocks_threads(r, op);
+        }
+    };
+
+  } // namespace io
+} // namespace bliss
+
+#endif /* SRC_IO_ASYNC_BLOCK_READER_HPP_ */
@@ -126,10 +126,12 @@ namespace bliss
 
         /// converting constructor.
         template <typename Iterator2>
-        FASTAParser(FASTAParser<Iterator2> const & other) : sequences(other.sequences), seq_offset(other.seq_offset) { }
+        FASTAParser(FASTAParser<Iterator2> const & other) : bliss::io::BaseFileParser<Iterator>(other),
+            sequences(other.sequences), seq_offset(other.seq_offset) { }
         /// converting assignment operator that can transform the base iterator type.
         template <typename Iterator2>
         FASTAParser<Iterator>& operator=(FASTAParser<Iterator2> const & other) {
+          bliss::io::BaseFileParser<Iterator>::operator=(other);
           sequences.assign(other.sequences.begin(), other.sequences.end());
           seq_offset = other.seq_offset;
           return *this;
@@ -603,6 +605,47 @@ namespace bliss
 
         }
 
+        /**
+         * @brief  add the record whose header precedes the search range but whose sequence continues into it.
+         * @details for blocks that are read independently (e.g. demand driven partitioning), where the header
+         *          position is computed elsewhere.  call after the serial init_parser.
+         *          entries found by init_parser with sequence start at or before seq_start are continuation of the
+         *          same header lines (or a partial line at the block start), and are replaced.
+         *          the record ends at the next header line in memory, or at parent range end.
+         * @param[in]   _data         start of iterator, pointing to inMemRange.start
+         * @param[in]   parentRange   the "full" range to which the inMemRange belongs.
+         * @param[in]   inMemRange    the portion of the "full" range that's loaded in memory
+         * @param record_start    position of the record's first header line
+         * @param seq_start       position of the record's first sequence line.
+         */
+        void set_leading_record(const Iterator &_data, const RangeType &parentRange, const RangeType &inMemRange,
+                                typename RangeType::ValueType const & record_start,
+                                typename RangeType::ValueType const & seq_start) {
+          auto new_end = ::std::remove_if(sequences.begin(), sequences.end(), [&seq_start](SequenceOffsetsType const & x){
+            return ::std::get<1>(x) <= seq_start;
+          });
+          sequences.erase(new_end, sequences.end());
+
+          // find the next header line start.
+          typename RangeType::ValueType seq_end = parentRange.end;
+          typename RangeType::ValueType i = ::std::max(seq_start, inMemRange.start);
+          Iterator it = _data;
+          ::std::advance(it, i - inMemRange.start);
+          for (++i; i < inMemRange.end; ++i) {
+            if (*it == '\n') {
+              ++it;
+              if ((*it == '>') || (*it == ';')) {
+                seq_end = i;
+                break;
+              }
+            } else ++it;
+          }
+
+          sequences.insert(sequences.begin(), SequenceOffsetsType(record_start, seq_start, seq_end, 0));
+
+          seq_offset = ::std::numeric_limits<size_t>::max();
+        }
+
 
 
         /**
@@ -622,7 +665,7 @@ namespace bliss
           {
         	  iter = end;
         	  BL_WARNINGF("FASTA LOADER no local sequence\n");
-            return SequenceType(SequenceIdType(offset),
+            return SequenceType(SequenceIdType(offset, 0, this->file_id),
   	  	  	  	    0, // length
   	  	  	  	    0, // offset in record
   	  	  	  	    0,
@@ -632,7 +675,7 @@ namespace bliss
           // end.  return.
           if (iter == end) {
         	  BL_WARNINGF("FASTA LOADER get next record iter == end\n");
-            return SequenceType(SequenceIdType(offset),
+            return SequenceType(SequenceIdType(offset, 0, this->file_id),
   	  	  	  	    0, // length
   	  	  	  	    0, // offset in record
   	  	  	  	    0,
@@ -667,7 +710,7 @@ namespace bliss
             offset += input_dist;
             iter = end;
 
-            return SequenceType(SequenceIdType(offset),
+            return SequenceType(SequenceIdType(offset, 0, this->file_id),
                     0, // length
                     0, // offset in record
                     0,
@@ -699,7 +742,7 @@ namespace bliss
             // no valid.
             offset += input_dist;
             iter = end;
-            return SequenceType(SequenceIdType(std::get<0>(seq), std::get<3>(seq)),
+            return SequenceType(SequenceIdType(std::get<0>(seq), std::get<3>(seq), this->file_id),
 	  	  	  	      std::get<2>(seq) - std::get<0>(seq), // record length
 	  	  	  	      std::get<1>(seq) - std::get<0>(seq),  // first offset of sequence in record
                     offset - std::get<0>(seq),  // iter offset in record
@@ -714,7 +757,7 @@ namespace bliss
 	
 					++seq_offset;
 
-          return SequenceType(SequenceIdType(std::get<0>(seq), std::get<3>(seq)),
+          return SequenceType(SequenceIdType(std::get<0>(seq), std::get<3>(seq), this->file_id),
                               std::get<2>(seq) - std::get<0>(seq),
                               std::get<1>(seq) - std::get<0>(seq),  // first offset of sequence in record
                                 valid.start - std::get<0>(seq),
@@ -164,10 +164,13 @@ namespace bliss
 
         /// converting constructor.
         template <typename Iterator2>
-        SequentialFASTQParser(SequentialFASTQParser<Iterator2> const & other) : SequentialFASTQParser() {}
+        SequentialFASTQParser(SequentialFASTQParser<Iterator2> const & other) : bliss::io::BaseFileParser<Iterator>(other) {}
         /// converting assignment operator that can transform the base iterator type.
         template <typename Iterator2>
-        SequentialFASTQParser<Iterator>& operator=(SequentialFASTQParser<Iterator2> const & other) { return *this; }
+        SequentialFASTQParser<Iterator>& operator=(SequentialFASTQParser<Iterator2> const & other) {
+          bliss::io::BaseFileParser<Iterator>::operator=(other);
+          return *this;
+        }
 
         // inherited reset and init_parser and find_overlap_end
         using bliss::io::BaseFileParser<Iterator>::find_overlap_end;
@@ -452,7 +455,7 @@ namespace bliss
           // likely the record was truncated.
           if ((sstart == send) || (lstart == lend)) {
             this->handleWarning("truncated record? missing seq or quality", orig_iter, lend, orig_offset, offset);
-            return SequenceType(SequenceIdType(record_start_offset),
+            return SequenceType(SequenceIdType(record_start_offset, 0, this->file_id),
                                 offset - record_start_offset,
                                 seq_start_offset - record_start_offset,
                                 sstart, send, lstart, lend);
@@ -460,7 +463,7 @@ namespace bliss
             this->handleError("truncated record? seq and qual differ in length", orig_iter, lend, orig_offset, offset);
           }
 
-          return SequenceType(SequenceIdType(record_start_offset),
+          return SequenceType(SequenceIdType(record_start_offset, 0, this->file_id),
                               offset - record_start_offset,
                               seq_start_offset - record_start_offset,
                               sstart, send, lstart, lend);
@@ -581,10 +584,13 @@ namespace bliss
 
         /// converting constructor.
         template <typename Iterator2>
-        FASTQParser(FASTQParser<Iterator2> const & other) : FASTQParser() {}
+        FASTQParser(FASTQParser<Iterator2> const & other) : bliss::io::SequentialFASTQParser<Iterator>(other) {}
         /// converting assignment operator that can transform the base iterator type.
         template <typename Iterator2>
-        FASTQParser<Iterator>& operator=(FASTQParser<Iterator2> const & other) { return *this; }
+        FASTQParser<Iterator>& operator=(FASTQParser<Iterator2> const & other) {
+          bliss::io::SequentialFASTQParser<Iterator>::operator=(other);
+          return *this;
+        }
 
         // inherited reset and init_parser and find_overlap_end
         using bliss::io::SequentialFASTQParser<Iterator>::find_overlap_end;
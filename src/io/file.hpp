@@ -48,6 +48,9 @@
 #include <fcntl.h>      // for open64 and close
 #include <sstream>      // stringstream
 #include <exception>    // std exception
+#include <vector>
+#include <limits>
+#include <algorithm>
 
 #if defined(USE_MPI)
 #include <mpi.h>
@@ -58,12 +61,14 @@
 #include <mxx/shift.hpp>
 
 #include <io/io_exception.hpp>
+#include <io/async_block_reader.hpp>
 
 #include <io/file_loader.hpp>
 #include <io/fastq_loader.hpp>
 #include <io/fasta_loader.hpp>
 #include <io/unix_domain_socket.h>
 #include <partition/range.hpp>
+#include <partition/partitioner.hpp>
 
 #include <utils/exception_handling.hpp>
 
@@ -220,6 +225,63 @@ struct file_data {
 	}
 };
 
+/**
+ * @brief non-owning view of loaded file data, e.g. in node shared memory.  same interface as file_data.
+ * @details data points to the start of the in memory range.  the owner of the memory must outlive the view.
+ */
+struct file_data_view {
+	using iterator = const unsigned char *;
+	using const_iterator = const unsigned char *;
+
+	// type of ranges
+	using range_type = ::bliss::partition::range<size_t>;
+
+	// range from which the data came
+	range_type parent_range_bytes;
+
+	// range loaded in memory.  INCLUDES OVERLAP
+	range_type in_mem_range_bytes;
+
+	// valid range for this.  EXCLUDES OVERLAP
+	range_type valid_range_bytes;
+
+	// start of the in memory range.
+	const unsigned char * data;
+
+	file_data_view() : data(nullptr) {};
+
+	/// beginning of the valid range
+	const_iterator begin() const {
+		return data + valid_range_bytes.start - in_mem_range_bytes.start;
+	}
+	/// end of valid range
+	const_iterator end() const {
+		return data + valid_range_bytes.end - in_mem_range_bytes.start;
+	}
+
+	/// beginning of the valid range
+	const_iterator cbegin() const {
+		return begin();
+	}
+	/// end of valid range
+	const_iterator cend() const {
+		return end();
+	}
+
+	/// start of inmem range
+	const_iterator in_mem_cbegin() const {
+		return data;
+	}
+	/// end of in mem range
+	const_iterator in_mem_cend() const {
+		return data + in_mem_range_bytes.size();
+	}
+
+	range_type getRange() const {
+		return valid_range_bytes;
+	}
+};
+
 
 
 /**
@@ -910,6 +972,199 @@ public:
 
 
 
+};
+
+
+/**
+ * @brief    posix file wrapper that keeps multiple block reads in flight.  uses io_uring if configured, else a pread thread pool.
+ * @details  read_range reads the whole range with concurrent block reads.
+ *           read_range_blocks streams blocks in order to a callback while subsequent blocks load,
+ *           so that parsing can overlap I/O.  see async_block_reader.
+ *           read_range_records streams record aligned chunks, for parsing while the next blocks load.
+ */
+class async_posix_file : public ::bliss::io::posix_file {
+
+protected:
+
+  using BASE = ::bliss::io::posix_file;
+
+  /// bytes per read request
+  size_t block_size;
+
+  /// number of read requests in flight
+  size_t depth;
+
+public:
+
+  // this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+  using BASE::read_range;
+
+  /**
+   * @brief  bulk load all the data and return it in a newly constructed vector.  reuse vector
+   * @param range_bytes range to read, in bytes
+   * @param output    vector containing data as bytes.
+   * @return  the range for the read data.
+   */
+  virtual range_type read_range(typename ::bliss::io::file_data::container & output, range_type const & range_bytes) {
+    if (this->fd == -1) {
+      throw ::bliss::utils::make_exception<std::logic_error>("ERROR: read_range: file pointer is null");
+    }
+
+    typename BASE::range_type target =
+        BASE::range_type::intersect(this->file_range_bytes, range_bytes);
+
+    if (target.size() == 0) {
+      std::cout << "WARNING: read_range: requested " << range_bytes << " not in file " << this->file_range_bytes << std::endl;
+      output.clear();
+      return target;
+    }
+
+    if (output.capacity() < target.size()) output.resize(target.size());
+
+    ::bliss::io::async_block_reader(this->fd, block_size, depth).read(output.data(), target);
+
+    return target;
+  }
+
+  /**
+   * @brief  stream a range block by block, in order, to op(range_type const & block_range, unsigned char const * data).
+   * @details data is valid only during the call.  later blocks are loading while op runs.
+   * @return  the range that was read.
+   */
+  template <typename Op>
+  range_type read_range_blocks(range_type const & range_bytes, Op op) {
+    if (this->fd == -1) {
+      throw ::bliss::utils::make_exception<std::logic_error>("ERROR: read_range_blocks: file pointer is null");
+    }
+
+    typename BASE::range_type target =
+        BASE::range_type::intersect(this->file_range_bytes, range_bytes);
+
+    if (target.size() > 0)
+      ::bliss::io::async_block_reader(this->fd, block_size, depth).read_blocks(target, op);
+
+    return target;
+  }
+
+  /**
+   * @brief  stream the records that start in a range, in record aligned chunks, to op(range_type const & chunk_range, unsigned char const * data).
+   * @details  blocks are read with read_range_blocks, so parsing of one chunk overlaps the reads of the next blocks.
+   *           each block is appended to a carry buffer.  the chunk ends at the first record start that the parser finds in
+   *           the block, and the partial record after it is carried to the next block.
+   *           the record that straddles the range end is completed from at most 1 extra block past the range.
+   *           records are located with Parser::find_first_record, parent range being the whole file, so a range that
+   *           starts mid-record skips to the next record, as with the partitioned files.
+   *           data is valid only during the call.
+   * @tparam Parser  a file parser on unsigned char const *, e.g. SequentialFASTQParser.
+   * @note   a block must contain a record start, i.e. block_size should be much larger than a record.
+   * @return  the range of the chunks delivered, i.e. from the first record start in range to the first record start after it.
+   */
+  template <typename Parser, typename Op>
+  range_type read_range_records(range_type const & range_bytes, Op op) {
+    if (this->fd == -1) {
+      throw ::bliss::utils::make_exception<std::logic_error>("ERROR: read_range_records: file pointer is null");
+    }
+
+    typename BASE::range_type target =
+        BASE::range_type::intersect(this->file_range_bytes, range_bytes);
+    if (target.size() == 0) return target;
+
+    // 1 block of overlap to complete the last record.
+    range_type overlap(target.start, std::min(this->file_range_bytes.end, target.end + block_size));
+
+    Parser parser;
+    std::vector<unsigned char> carry;   // bytes from rec_start to the end of the latest block.
+    size_t rec_start = target.end;
+    size_t first = target.end;
+    bool started = false;
+    bool done = false;
+
+    ::bliss::io::async_block_reader(this->fd, block_size, depth).read_blocks(overlap,
+        [this, &parser, &carry, &rec_start, &first, &started, &done, &target, &op](range_type const & b, unsigned char const * data) {
+      if (done) return;
+
+      carry.insert(carry.end(), data, data + b.size());
+      range_type in_mem(b.end - carry.size(), b.end);
+      unsigned char const * mem = carry.data();
+
+      if (!started) {
+        // first record in range.
+        rec_start = parser.find_first_record(mem, this->file_range_bytes, in_mem, range_type(target.start, std::min(b.end, target.end)));
+        first = rec_start;
+        started = true;
+        if (rec_start >= target.end) {  // no record starts in range.
+          done = true;
+          return;
+        }
+        carry.erase(carry.begin(), carry.begin() + (rec_start - in_mem.start));
+        in_mem.start = rec_start;
+      }
+
+      // next record start in this block, or the first one at or after the range end for the last chunk.
+      size_t search = std::max(rec_start + 1, (b.end <= target.end) ? b.start : target.end);
+      if (search >= b.end) return;
+      size_t r = parser.find_first_record(mem, this->file_range_bytes, in_mem, range_type(search, b.end));
+      if (r == b.end) return;   // end of file, delivered after the loop.
+
+      op(range_type(rec_start, r), static_cast<unsigned char const *>(mem));
+      carry.erase(carry.begin(), carry.begin() + (r - rec_start));
+      rec_start = r;
+      if (r >= target.end) done = true;
+    });
+
+    if (!started) return range_type(target.end, target.end);
+
+    if (!done) {
+      if (overlap.end != this->file_range_bytes.end) {
+        std::stringstream ss;
+        ss << "ERROR: read_range_records: file " << this->filename << " no record start within 1 block after " << target;
+        throw ::bliss::utils::make_exception<bliss::io::IOException>(ss.str());
+      }
+      // rest of the file.
+      if (carry.size() > 0) op(range_type(rec_start, overlap.end), static_cast<unsigned char const *>(carry.data()));
+      rec_start = overlap.end;
+    }
+    return range_type(first, rec_start);
+  }
+
+  /**
+   * initializes a file for reading.  32MB blocks, 4 in flight.  see set_block_size.
+   * @param _filename   name of file to open
+   */
+  async_posix_file(std::string const & _filename) :
+    BASE(_filename), block_size(32UL << 20), depth(4) {};
+
+  /**
+   * initializes a file for reading.  for use by a parallel file (composition pattern)
+   * @param _filename   name of file to open
+   * @param _file_size  previously computed file size.
+   */
+  async_posix_file(std::string const & _filename, size_t const & _file_size, size_t const & delay_ms) :
+    BASE(_filename, _file_size, delay_ms), block_size(32UL << 20), depth(4) {};
+
+  /**
+   * initializes a file for reading.  for use by a parallel file (composition pattern)
+   * @param _fd   previously opened file descriptor
+   * @param _file_size  previously computed file size.
+   */
+  async_posix_file(int const & _fd, size_t const & _file_size) :
+    BASE(_fd, _file_size), block_size(32UL << 20), depth(4) {};
+
+  /// destructor
+  virtual ~async_posix_file() {};
+
+  /**
+   * @brief set the read request size and the number of requests in flight.
+   * @param _block_size bytes per read request.
+   * @param _depth      number of read requests in flight.
+   */
+  void set_block_size(size_t const & _block_size, size_t const & _depth) {
+    block_size = (_block_size == 0) ? 1 : _block_size;
+    depth = (_depth == 0) ? 1 : _depth;
+  }
+
+  using BASE::read_file;
+
 };
 
 #ifdef USE_MPI
@@ -930,6 +1185,19 @@ protected:
 	/// communicator used.  object instead of being a reference - lifetime of a src comm temp object in constructor is just that of the constructor call.
 	const ::mxx::comm comm;
 
+	/// byte range explicitly assigned to this rank.  used instead of block partitioning among comm if set.
+	range_type assigned_range;
+	bool has_assigned_range;
+
+	/// block partition the range among the ranks in comm, or restrict it to the assigned range if set.
+	template <typename Partitioner>
+	range_type partition_for_rank(Partitioner & partitioner, range_type const & range_bytes) {
+		if (has_assigned_range) return range_type::intersect(range_bytes, assigned_range);
+
+		partitioner.configure(range_bytes, comm.size());
+		return partitioner.getNext(comm.rank());
+	}
+
 		/// compute file size in parallel (1 proc, then broadcast.
 	size_t get_file_size() {
 
@@ -949,7 +1217,7 @@ protected:
 
   base_file(::mxx::comm const & _comm = ::mxx::comm()) :
     ::bliss::io::base_file(static_cast<int>(-1), static_cast<size_t>(0)), // will find real size very soon
-     comm(_comm.copy()) {  // _comm could be a temporary constructed from MPI_Comm.
+     comm(_comm.copy()), has_assigned_range(false) {  // _comm could be a temporary constructed from MPI_Comm.
   };
 
 
@@ -969,12 +1237,24 @@ public:
 	 */
 	base_file(std::string const & _filename, ::mxx::comm const & _comm = ::mxx::comm()) :
 		::bliss::io::base_file(static_cast<int>(-1), static_cast<size_t>(0)), // will find real size very soon
-		 comm(_comm.copy()) {  // _comm could be a temporary constructed from MPI_Comm.  std::move not needed.  copy elision is in effect.
+		 comm(_comm.copy()), has_assigned_range(false) {  // _comm could be a temporary constructed from MPI_Comm.  std::move not needed.  copy elision is in effect.
 	  this->filename = _filename;
 		this->file_range_bytes.end = this->get_file_size();
 		this->BASE::open_file();
 	};
 
+	/**
+	 * @brief assign the byte range this rank reads, instead of block partitioning the file among comm.
+	 * @details used to partition several files as one concatenated byte space.  the ranges assigned to
+	 * 			the ranks of comm should be contiguous in rank order and cover the file.  record boundaries
+	 * 			are still resolved among the ranks of comm by read_file.
+	 * @param range_bytes		range in file coordinates.
+	 */
+	void assign_partition(range_type const & range_bytes) {
+		assigned_range = range_type::intersect(range_bytes, this->file_range_bytes);
+		has_assigned_range = true;
+	}
+
 
 
 	/// destructor
@@ -1095,9 +1375,7 @@ protected:
 			return target;
 		}
 
-		partitioner.configure(target, this->comm.size());
-
-		return partitioner.getNext(this->comm.rank());
+		return this->partition_for_rank(partitioner, target);
 //		typename BASE::range_type result = partitioner.getNext(this->comm.rank());
 //
 //		std::cout << "rank = " << this->comm.rank() << " range " << result << std::endl;
@@ -1133,8 +1411,7 @@ protected:
 		// === multi process.
 
 		// partition valid range
-		partitioner.configure(valid, this->comm.size());
-		valid = partitioner.getNext(this->comm.rank());
+		valid = this->partition_for_rank(partitioner, valid);
 
 		// compute the in mem range.  extend by overlap
 		typename BASE::range_type in_mem_valid = valid;
@@ -1244,9 +1521,7 @@ protected:
 			return target;
 		}
 
-		partitioner.configure(target, this->comm.size());
-
-		return partitioner.getNext(this->comm.rank());
+		return this->partition_for_rank(partitioner, target);
 //		typename BASE::range_type result = partitioner.getNext(this->comm.rank());
 //
 //		std::cout << "rank = " << this->comm.rank() << " range " << result << std::endl;
@@ -1282,8 +1557,7 @@ protected:
 		// === multi process.
 
 		// partition valid range
-		partitioner.configure(valid, this->comm.size());
-		valid = partitioner.getNext(this->comm.rank());
+		valid = this->partition_for_rank(partitioner, valid);
 
 		// compute the in mem range.  extend by overlap
 		typename BASE::range_type in_mem_valid = valid;
@@ -1466,9 +1740,7 @@ protected:
 			return target;
 		}
 
-		partitioner.configure(target, this->comm.size());
-
-		return partitioner.getNext(this->comm.rank());
+		return this->partition_for_rank(partitioner, target);
 //		typename BASE::range_type result = partitioner.getNext(this->comm.rank());
 //
 //		std::cout << "rank = " << this->comm.rank() << " range " << result << std::endl;
@@ -1504,8 +1776,7 @@ protected:
 		// === multi process.
 
 		// partition valid range
-		partitioner.configure(valid, this->comm.size());
-		valid = partitioner.getNext(this->comm.rank());
+		valid = this->partition_for_rank(partitioner, valid);
 
 		// compute the in mem range.  extend by overlap
 		typename BASE::range_type in_mem_valid = valid;
@@ -1629,6 +1900,520 @@ class partitioned_file<::bliss::io::stdio_file, FileParser, ::bliss::io::paralle
 
 
 
+/**
+ * @brief a block of a file read by demand_driven_file.
+ * @details for FASTA, record_start and seq_start are the header and sequence positions of the record that started
+ * 			before this block and continues into it.  both are std::numeric_limits<size_t>::max() if there is none.
+ */
+struct file_block : public ::bliss::io::file_data {
+	size_t record_start;
+	size_t seq_start;
+
+	file_block() : ::bliss::io::file_data(),
+			record_start(::std::numeric_limits<size_t>::max()), seq_start(::std::numeric_limits<size_t>::max()) {};
+};
+
+
+/**
+ * @brief parallel file reader that hands out fixed size blocks to ranks on demand.
+ * @details ranks pull blocks from a counter shared via MPI RMA (DistributedDemandDrivenPartitioner) until the file is
+ * 			exhausted, so a rank that is faster (less contended storage, less loaded node) reads more blocks.
+ * 			blocks are not contiguous per rank, so record boundaries are resolved per block:
+ * 				generic:  block plus overlap.
+ * 				FASTQ:    block is trimmed to [first record after start, first record after end), using the same search
+ * 						  rule for both ends.  adjacent blocks therefore agree without communication.  no overlap needed.
+ * 				FASTA:    block plus overlap, as in partitioned_file.  the line structure of each block is summarized
+ * 						  and allgathered once all blocks are read, so each block knows the header of the record it starts in.
+ *
+ * 			construction, read_file_blocks and destruction are collective.
+ * @tparam FileReader	sequential reader, e.g. posix_file or mmap_file
+ * @tparam FileParser	parser type.  BaseFileParser, FASTQParser, or FASTAParser
+ */
+template <typename FileReader,
+          template <typename> class FileParser = ::bliss::io::BaseFileParser,
+          typename BaseType = ::bliss::io::parallel::base_file >
+class demand_driven_file : public BaseType {
+
+protected:
+	using BASE = BaseType;
+
+	using range_type = typename ::bliss::io::base_file::range_type;
+
+	using FileParserType = FileParser<typename ::bliss::io::file_data::const_iterator>;
+	using FASTQParserType = ::bliss::io::FASTQParser<typename ::bliss::io::file_data::const_iterator>;
+	using FASTAParserType = ::bliss::io::FASTAParser<typename ::bliss::io::file_data::const_iterator>;
+
+	/// FileReader
+	FileReader reader;
+
+	/// overlap amount
+	const size_t overlap;
+
+	/// size of each block handed out.
+	const size_t block_size;
+
+	/// partitioner to use.  shared counter across comm.
+	::bliss::partition::DistributedDemandDrivenPartitioner<range_type> partitioner;
+
+	/// FASTA line structure of each local block, 7 entries per block: see summarize_lines
+	::std::vector<size_t> summaries;
+
+	/// generic: valid range is the block.  overlap appended.
+	template <typename P>
+	void read_block(range_type const & block, ::bliss::io::parallel::file_block & output, P const *) {
+		range_type in_mem = block;
+		in_mem.end += overlap;
+		in_mem.intersect(this->file_range_bytes);
+
+		output.in_mem_range_bytes = reader.read_range(output.data, in_mem);
+		output.valid_range_bytes = block;
+		output.parent_range_bytes = this->file_range_bytes;
+	}
+
+	/// FASTQ: trim the block to the records that start in it.  look-ahead is doubled until the next record is found.
+	void read_block(range_type const & block, ::bliss::io::parallel::file_block & output, FASTQParserType const *) {
+		FASTQParserType parser;
+
+		size_t lookahead = ::std::max(overlap, static_cast<size_t>(sysconf(_SC_PAGE_SIZE))) * 16;
+		range_type in_mem;
+		size_t first = block.start, next = block.end;
+		while (true) {
+			in_mem = block;
+			in_mem.end += lookahead;
+			in_mem.intersect(this->file_range_bytes);
+			in_mem = reader.read_range(output.data, in_mem);
+
+			try {
+				// a record starting exactly at a block start belongs to the previous block, same as in partitioned_file.
+				first = parser.find_first_record(output.data.cbegin(), this->file_range_bytes, in_mem, in_mem);
+				next = parser.find_first_record(output.data.cbegin(), this->file_range_bytes, in_mem, range_type(block.end, in_mem.end));
+				break;
+			} catch (::std::logic_error const & e) {
+				// no complete record in the look-ahead region.
+				if (in_mem.end == this->file_range_bytes.end) throw;
+				lookahead <<= 1;
+			}
+		}
+		next = ::std::max(first, next);
+
+		output.data.erase(output.data.begin() + (next - in_mem.start), output.data.end());
+		output.data.erase(output.data.begin(), output.data.begin() + (first - in_mem.start));
+
+		output.in_mem_range_bytes = range_type(first, next);
+		output.valid_range_bytes = output.in_mem_range_bytes;
+		output.parent_range_bytes = this->file_range_bytes;
+	}
+
+	/// FASTA: read block with overlap, and summarize the line structure.
+	void read_block(range_type const & block, ::bliss::io::parallel::file_block & output, FASTAParserType const *) {
+		// include 1 preceding char to tell if the block starts at a line start.
+		size_t pre = (block.start > this->file_range_bytes.start) ? 1 : 0;
+
+		range_type in_mem = block;
+		in_mem.start -= pre;
+		in_mem.end += 2 * overlap;
+		in_mem.intersect(this->file_range_bytes);
+		in_mem = reader.read_range(output.data, in_mem);
+
+		summarize_lines(block, output.data.cbegin() + pre, (pre == 0) ? '\n' : output.data[0]);
+
+		if (pre > 0) {
+			output.data.erase(output.data.begin());
+			in_mem.start += pre;
+		}
+		output.in_mem_range_bytes = in_mem;
+		output.valid_range_bytes = block;
+		output.parent_range_bytes = this->file_range_bytes;
+
+		FASTAParserType parser;
+		size_t overlap_end = parser.find_overlap_end(output.in_mem_cbegin(), output.parent_range_bytes,
+				output.in_mem_range_bytes, output.valid_range_bytes.end, overlap);
+
+		// erase the extra.
+		output.in_mem_range_bytes.end = overlap_end;
+		output.data.erase(output.data.begin() + output.in_mem_range_bytes.size(), output.data.end());
+	}
+
+	/**
+	 * @brief summarize the lines of a FASTA block, with the same line classification as FASTAParser::init_parser.
+	 * @details appends block id, first line start, first line is header, start of the last header group,
+	 * 			first sequence line after that, last line is header, and first sequence line start.
+	 * 			positions are max if not present.
+	 */
+	void summarize_lines(range_type const & block, typename ::bliss::io::file_data::const_iterator it, unsigned char prev) {
+		constexpr size_t none = ::std::numeric_limits<size_t>::max();
+		size_t first = none, first_header = 0, last_header = none, last_header_seq = none, first_seq = none;
+		size_t kind = 0;   // kind of the last line seen.
+
+		for (size_t i = block.start; i < block.end; ++i, ++it) {
+			if (prev == '\n') {
+				size_t k = ((*it == ';') || (*it == '>')) ? 1 : 0;
+				if (first == none) {
+					first = i;
+					first_header = k;
+					if (k == 1) last_header = i;
+				} else if (k != kind) {
+					if (k == 1) {
+						last_header = i;
+						last_header_seq = none;
+					} else if (last_header_seq == none) last_header_seq = i;
+				}
+				if ((k == 0) && (first_seq == none)) first_seq = i;
+				kind = k;
+			}
+			prev = *it;
+		}
+
+		summaries.insert(summaries.end(), {partitioner.getChunkId(block), first, first_header,
+			last_header, last_header_seq, kind, first_seq});
+	}
+
+	/// generic and FASTQ:  blocks are independent.
+	template <typename P>
+	void finalize_blocks(::std::vector<::bliss::io::parallel::file_block> & blocks, P const *) {}
+
+	/// FASTA: gather the block summaries and scan in file order to find the record in progress at each block start.
+	void finalize_blocks(::std::vector<::bliss::io::parallel::file_block> & blocks, FASTAParserType const *) {
+		constexpr size_t none = ::std::numeric_limits<size_t>::max();
+
+		::std::vector<size_t> all = ::mxx::allgatherv(summaries, this->comm);
+
+		// order by block id.
+		size_t n = partitioner.getChunkCount();
+		::std::vector<size_t> ordered(n * 7, none);
+		for (size_t i = 0; i < all.size(); i += 7) {
+			::std::copy(all.begin() + i, all.begin() + i + 7, ordered.begin() + all[i] * 7);
+		}
+
+		// incoming state for each block: header start, sequence start, and whether the last line was a header.
+		::std::vector<size_t> incoming(n * 3);
+		size_t header = none, seq = none, kind = 0;
+		for (size_t i = 0; i < n; ++i) {
+			incoming[3 * i] = header;
+			incoming[3 * i + 1] = seq;
+			incoming[3 * i + 2] = kind;
+
+			size_t const * s = ordered.data() + 7 * i;
+			if (s[1] == none) continue;   // no line starts in block.
+
+			if (s[3] == none) {    // only sequence lines.
+				if (kind == 1) seq = s[6];
+			} else if (s[3] == s[1]) {   // only header group is at the block start.
+				if (kind == 0) {  // new record
+					header = s[3];
+					seq = s[4];
+				} else if (s[4] != none) {  // continued header group
+					seq = s[4];
+				}
+			} else {
+				header = s[3];
+				seq = s[4];
+			}
+			kind = s[5];
+		}
+
+		// now set the leading record of the local blocks.
+		for (size_t i = 0; i < blocks.size(); ++i) {
+			size_t id = summaries[7 * i];
+			size_t const * s = summaries.data() + 7 * i;
+			size_t h = incoming[3 * id], sq = incoming[3 * id + 1], k = incoming[3 * id + 2];
+
+			if (h == none) continue;   // no header seen yet.
+			if ((s[1] == blocks[i].valid_range_bytes.start) && (s[2] == 1) && (k == 0)) continue;  // new record at block start
+
+			sq = (k == 0) ? sq : s[6];
+			if (sq == none) continue;  // no sequence data for this record in block.
+
+			blocks[i].record_start = h;
+			blocks[i].seq_start = sq;
+		}
+	}
+
+public:
+	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
+	using BASE::read_range;
+
+	/**
+	 * @brief  read the specified range via the sequential reader.  not partitioned.  use read_file_blocks for demand driven reading.
+	 * @param range_bytes	range to read, in bytes
+	 * @param output		vector containing data as bytes.
+	 */
+	virtual range_type read_range(typename ::bliss::io::file_data::container & output,
+	                              range_type const & range_bytes) {
+		return reader.read_range(output, range_bytes);
+	}
+
+	/**
+	 * @brief constructor.  collective
+	 * @param _filename 		name of file to open
+	 * @param _overlap			overlap between blocks.  k-1 for kmers.
+	 * @param _comm				MPI communicator to use.
+	 * @param _block_size		size of each block handed out.
+	 */
+	demand_driven_file(std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm(),
+			size_t const & _block_size = (32UL << 20)) :
+		BaseType(_filename, _comm),
+		 reader(this->fd, this->file_range_bytes.end), overlap(_overlap), block_size(_block_size), partitioner(this->comm) {
+		if (block_size == 0) throw std::invalid_argument("ERROR: demand_driven_file block size is 0");
+	};
+
+	/// destructor.  collective
+	virtual ~demand_driven_file() {};
+
+	/**
+	 * @brief  read blocks until the file is exhausted.  collective.
+	 * @details if reading a block fails on any rank, all ranks throw IOException.
+	 * @return blocks read by this rank, in the order they were handed out.
+	 */
+	::std::vector<::bliss::io::parallel::file_block> read_file_blocks() {
+		::std::vector<::bliss::io::parallel::file_block> blocks;
+		summaries.clear();
+
+		// configure resets the shared counter.
+		partitioner.configure(this->file_range_bytes, this->comm.size(), block_size);
+
+		// a failed rank stops taking blocks, and the others drain the counter.  the failure count is reduced
+		// before any other collective, so that no rank is left waiting in finalize_blocks or the window free.
+		::std::string error;
+		try {
+			range_type block = partitioner.getNext(this->comm.rank());
+			while (block.size() > 0) {
+				blocks.emplace_back();
+				read_block(block, blocks.back(), static_cast<FileParserType const *>(nullptr));
+
+				block = partitioner.getNext(this->comm.rank());
+			}
+		} catch (::std::exception const & e) {
+			error = e.what();
+		}
+		int failed = ::mxx::allreduce(error.empty() ? 0 : 1, this->comm);
+		if (failed > 0) {
+			::std::stringstream ss;
+			ss << "ERROR: demand_driven_file: " << failed << " rank(s) failed to read blocks of " << this->filename;
+			if (!error.empty()) ss << ".  rank " << this->comm.rank() << ": " << error;
+			throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+		}
+
+		finalize_blocks(blocks, static_cast<FileParserType const *>(nullptr));
+
+		return blocks;
+	}
+};
+
+
+/**
+ * @brief parallel file reader where one leader rank per node reads the node's partition into MPI shared memory.
+ * @details the leaders (node rank 0) block partition the file among the nodes with partitioned_file on the leader
+ * 			communicator, which also resolves record boundaries between nodes.  each node therefore issues one contiguous
+ * 			read, and overlap is read once per node instead of once per rank.  the data is placed in an
+ * 			MPI_Win_allocate_shared window, and every local rank gets a file_data_view of its part without copying.
+ *
+ * 			the node range is split among local ranks:
+ * 				FASTQ:		at record starts, found in the shared data.
+ * 				FASTA:		evenly, with k-1 overlap.  headers are resolved by the distributed init_parser.
+ * 				generic:	evenly, with overlap.
+ * 			parsing should use get_comm(), whose rank order follows the byte order of the views (node, then node rank).
+ *
+ * 			construction, read_file, and destruction are collective.  a view is valid until the next read_file or destruction.
+ * @tparam FileReader	sequential reader for the leaders, e.g. posix_file or mmap_file
+ * @tparam FileParser	parser type.  BaseFileParser, FASTQParser, or FASTAParser
+ */
+template <typename FileReader, template <typename> class FileParser = ::bliss::io::BaseFileParser>
+class node_shared_file {
+
+protected:
+	using range_type = ::bliss::partition::range<size_t>;
+
+	using FileParserType = FileParser<typename ::bliss::io::file_data_view::const_iterator>;
+	using FASTQParserType = ::bliss::io::FASTQParser<typename ::bliss::io::file_data_view::const_iterator>;
+	using FASTAParserType = ::bliss::io::FASTAParser<typename ::bliss::io::file_data_view::const_iterator>;
+
+	/// name of file
+	std::string filename;
+
+	/// overlap amount
+	const size_t overlap;
+
+	/// ranks on the same node
+	::mxx::comm node_comm;
+
+	/// node leaders.  the other ranks have a communicator of their own that is not used.
+	::mxx::comm leader_comm;
+
+	/// all ranks, ordered by node then by node rank, i.e. in byte order of the views.
+	::mxx::comm ordered_comm;
+
+	/// shared memory window, allocated on the leader.
+	MPI_Win win;
+
+	/// start of the node's data in shared memory
+	const unsigned char * node_data;
+
+	/// ranges of the node's data.
+	range_type parent;
+	range_type node_in_mem;
+	range_type node_valid;
+
+	/// order ranks by node, using the prefix sum of node sizes among the leaders.
+	::mxx::comm make_ordered_comm(::mxx::comm const & _comm) const {
+		int offset = 0;
+		if (node_comm.rank() == 0) {
+			offset = ::mxx::exscan(node_comm.size(), leader_comm);
+			if (leader_comm.rank() == 0) offset = 0;
+		}
+		MPI_Bcast(&offset, 1, MPI_INT, 0, node_comm);
+
+		return _comm.split(0, offset + node_comm.rank());
+	}
+
+	void free_window() {
+		if (win != MPI_WIN_NULL) MPI_Win_free(&win);
+		win = MPI_WIN_NULL;
+		node_data = nullptr;
+	}
+
+	/// even split of the node's valid range.
+	range_type local_partition() {
+		::bliss::partition::BlockPartitioner<range_type> partitioner;
+		partitioner.configure(node_valid, node_comm.size());
+		return partitioner.getNext(node_comm.rank());
+	}
+
+	/// generic: even split, overlap appended.
+	template <typename P>
+	void make_view(::bliss::io::file_data_view & view, P const *) {
+		view.valid_range_bytes = local_partition();
+		view.in_mem_range_bytes = view.valid_range_bytes;
+		view.in_mem_range_bytes.end += overlap;
+		view.in_mem_range_bytes.intersect(node_in_mem);
+	}
+
+	/// FASTA: even split, overlap of k-1 non-eol characters, same as partitioned_file
+	void make_view(::bliss::io::file_data_view & view, FASTAParserType const *) {
+		view.valid_range_bytes = local_partition();
+
+		FASTAParserType parser;
+		view.in_mem_range_bytes = range_type(view.valid_range_bytes.start,
+				parser.find_overlap_end(node_data, parent, node_in_mem, view.valid_range_bytes.end, overlap));
+	}
+
+	/// FASTQ: first record start at or after the even split.  no overlap needed.
+	void make_view(::bliss::io::file_data_view & view, FASTQParserType const *) {
+		range_type part = local_partition();
+
+		size_t start = (node_comm.rank() == 0) ? node_valid.start : record_start(part.start);
+		size_t end = (node_comm.rank() == (node_comm.size() - 1)) ? node_valid.end : record_start(part.end);
+
+		view.valid_range_bytes = range_type(start, ::std::max(start, end));
+		view.in_mem_range_bytes = view.valid_range_bytes;
+	}
+
+	/// first FASTQ record starting after pos.  a record exactly at pos belongs to the previous rank, as in partitioned_file.
+	size_t record_start(size_t const & pos) {
+		if (pos >= node_valid.end) return node_valid.end;
+
+		FASTQParserType parser;
+		size_t result = node_valid.end;
+		try {
+			result = parser.find_first_record(node_data, parent, node_in_mem, range_type(pos, node_in_mem.end));
+		} catch (::std::logic_error const & e) {
+			// no complete record after pos.
+		}
+		return ::std::min(result, node_valid.end);
+	}
+
+public:
+
+	/**
+	 * @brief constructor.  collective.
+	 * @param _filename 		name of file to open
+	 * @param _overlap			overlap between ranks.  k-1 for kmers.
+	 * @param _comm				MPI communicator to use.
+	 */
+	node_shared_file(std::string const & _filename, size_t const & _overlap = 0UL, ::mxx::comm const & _comm = ::mxx::comm()) :
+		filename(_filename), overlap(_overlap),
+		node_comm(_comm.split_shared()),
+		leader_comm(_comm.split(node_comm.rank() == 0 ? 0 : 1)),
+		ordered_comm(make_ordered_comm(_comm)),
+		win(MPI_WIN_NULL), node_data(nullptr) {};
+
+	/// destructor.  collective.  frees shared memory
+	virtual ~node_shared_file() {
+		free_window();
+	}
+
+	/// communicator in the byte order of the views.  use this for parsing.
+	::mxx::comm const & get_comm() const {
+		return ordered_comm;
+	}
+
+	/**
+	 * @brief  leader reads the node's partition into shared memory.  all ranks get a view of their part.  collective.
+	 * @return view of this rank's part.
+	 */
+	::bliss::io::file_data_view read_file() {
+		free_window();
+
+		// leader reads.  the last entry is the leader's status, so that a failed read does not leave the node waiting.
+		::bliss::io::file_data node_part;
+		::std::string error;
+		size_t ranges[7] = {0, 0, 0, 0, 0, 0, 0};
+		if (node_comm.rank() == 0) {
+			try {
+				::bliss::io::parallel::partitioned_file<FileReader, FileParser> fobj(filename, overlap, leader_comm);
+				node_part = fobj.read_file();
+			} catch (::std::exception const & e) {
+				error = e.what();
+			}
+
+			ranges[0] = node_part.parent_range_bytes.start;   ranges[1] = node_part.parent_range_bytes.end;
+			ranges[2] = node_part.in_mem_range_bytes.start;   ranges[3] = node_part.in_mem_range_bytes.end;
+			ranges[4] = node_part.valid_range_bytes.start;    ranges[5] = node_part.valid_range_bytes.end;
+			ranges[6] = error.empty() ? 0 : 1;
+		}
+		MPI_Bcast(ranges, 7, MPI_UNSIGNED_LONG, 0, node_comm);
+
+		// failed leaders are counted over all ranks, so every rank throws before the shared window is allocated.
+		int failed = ::mxx::allreduce((node_comm.rank() == 0) ? static_cast<int>(ranges[6]) : 0, ordered_comm);
+		if (failed > 0) {
+			::std::stringstream ss;
+			ss << "ERROR: node_shared_file: " << failed << " node leader(s) failed to read " << filename;
+			if (!error.empty()) ss << ".  rank " << ordered_comm.rank() << ": " << error;
+			throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+		}
+
+		parent = range_type(ranges[0], ranges[1]);
+		node_in_mem = range_type(ranges[2], ranges[3]);
+		node_valid = range_type(ranges[4], ranges[5]);
+
+		// copy into shared memory.
+		unsigned char * ptr = nullptr;
+		MPI_Aint bytes = (node_comm.rank() == 0) ? node_part.data.size() : 0;
+		MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, node_comm, &ptr, &win);
+
+		MPI_Aint size;
+		int disp_unit;
+		MPI_Win_shared_query(win, 0, &size, &disp_unit, &ptr);
+
+		MPI_Win_fence(0, win);
+		if (node_comm.rank() == 0) {
+			memcpy(ptr, node_part.data.data(), node_part.data.size());
+			::std::vector<unsigned char>().swap(node_part.data);
+		}
+		MPI_Win_fence(0, win);
+		node_data = ptr;
+
+		// then set up the local view.
+		::bliss::io::file_data_view view;
+		view.parent_range_bytes = parent;
+		make_view(view, static_cast<FileParserType const *>(nullptr));
+		view.data = node_data + (view.in_mem_range_bytes.start - node_in_mem.start);
+
+		return view;
+	}
+};
+
+
 // multilevel parallel file io relies on MPIIO.
 template <template <typename> class FileParser = ::bliss::io::BaseFileParser >
 class mpiio_base_file : public ::bliss::io::base_file {
@@ -1650,6 +2435,10 @@ protected:
 	/// partitioner to use.
 	::bliss::partition::BlockPartitioner<range_type> partitioner;
 
+	/// byte range explicitly assigned to this rank.  used instead of block partitioning among comm if set.
+	range_type assigned_range;
+	bool has_assigned_range;
+
 	std::string get_error_string(std::string const & op_name, int const & return_val) {
 		char error_string[BUFSIZ];
 		int length_of_error_string, error_class;
@@ -1761,8 +2550,10 @@ public:
 		range_type target =
 				BASE::range_type::intersect(range_bytes, this->file_range_bytes);
 
-		// do equal partition
-		if (comm.size() > 1) {
+		// do equal partition, unless a range was assigned.
+		if (has_assigned_range) {
+			target.intersect(assigned_range);
+		} else if (comm.size() > 1) {
 			partitioner.configure(target, comm.size());
 			target = partitioner.getNext(comm.rank());
 		}
@@ -1912,12 +2703,22 @@ public:
 	mpiio_base_file(::std::string const & _filename, size_t const _overlap = 0UL,  ::mxx::comm const & _comm = ::mxx::comm()) :
 	  BASE(static_cast<int>(-1), static_cast<size_t>(0)),
 	 	 overlap(_overlap),
-				  comm(_comm.copy()), fh(MPI_FILE_NULL) {
+				  comm(_comm.copy()), fh(MPI_FILE_NULL), has_assigned_range(false) {
 		this->filename = _filename;
 	  this->open_file();
 		this->file_range_bytes.end = this->get_file_size();  // call after opening file
 	};
 
+	/**
+	 * @brief assign the byte range this rank reads, instead of block partitioning the file among comm.
+	 * @details see ::bliss::io::parallel::base_file::assign_partition.
+	 * @param range_bytes		range in file coordinates.
+	 */
+	void assign_partition(range_type const & range_bytes) {
+		assigned_range = range_type::intersect(range_bytes, this->file_range_bytes);
+		has_assigned_range = true;
+	}
+
 	~mpiio_base_file() { this->close_file(); };
 
 	// this is needed to prevent overload name hiding.  see http://stackoverflow.com/questions/888235/overriding-a-bases-overloaded-function-in-c/888337#888337
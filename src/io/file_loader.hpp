@@ -131,6 +131,9 @@ namespace io
         */
       using RangeType = bliss::partition::range<size_t>;
 
+      /// file id for the SequenceIds produced.  0 unless set.
+      uint16_t file_id;
+
        /**
         * @brief  search for first non-EOL character in a iterator, returns the stopping position as an iterator.  also records offset.
         * @details       iter can point to the previous EOL, or a nonEOL character.
@@ -212,7 +215,7 @@ namespace io
      public:
 
        /// default constructor.
-       BaseFileParser() {};
+       BaseFileParser() : file_id(0) {};
 
        /// default destructor
        virtual ~BaseFileParser() {};
@@ -220,13 +223,18 @@ namespace io
 
        /// converting constructor.
        template <typename Iterator2>
-       BaseFileParser(BaseFileParser<Iterator2> const & other) {}
+       BaseFileParser(BaseFileParser<Iterator2> const & other) : file_id(other.file_id) {}
        /// converting assignment operator that can transform the base iterator type.
        template <typename Iterator2>
        BaseFileParser<Iterator>& operator=(BaseFileParser<Iterator2> const & other) {
+         file_id = other.file_id;
          return *this;
        }
 
+       /// set the file id stored in the SequenceId of each record, e.g. the index of the file in a multi-file read.
+       void set_file_id(uint16_t const & _file_id) { file_id = _file_id; }
+       uint16_t get_file_id() const { return file_id; }
+
 
        /**
         * @brief given a block/range, find the starting point of the first sequence object (here, just the actual start)
@@ -315,7 +323,7 @@ namespace io
          offset += dist;
          iter = end;
 
-         return SequenceType(SequenceIdType(orig_offset), dist, 0, 0, orig_iter, end);
+         return SequenceType(SequenceIdType(orig_offset, 0, this->file_id), dist, 0, 0, orig_iter, end);
        }
 
 
@@ -34,8 +34,12 @@
 #include "iterators/filter_iterator.hpp"
 #include "io/fastq_loader.hpp"
 #include "io/file_loader.hpp"
+#include "index/quality_scores.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <type_traits>
 
 namespace bliss
 {
@@ -164,19 +168,158 @@ namespace bliss
     template <typename Iterator, template <typename> class SeqParser>
     using NFilterSequencesIterator = bliss::io::FilteredSequencesIterator<Iterator, SeqParser, bliss::io::NSequenceFilter>;
 
+    /**
+     * @brief narrow a sequence to [front, back) relative to its current seq_begin, in place.
+     * @details seq_begin_offset moves with seq_begin so the kmer ids stay in file coordinates.  quality iterators
+     *          are kept aligned with the sequence iterators, if the sequence type has them.
+     */
+    template <typename SEQ>
+    typename ::std::enable_if<SEQ::has_quality()>::type narrow_sequence(SEQ & seq, size_t front, size_t back) {
+      ::std::advance(seq.qual_begin, front);
+      seq.qual_end = seq.qual_begin;
+      ::std::advance(seq.qual_end, back - front);
+
+      ::std::advance(seq.seq_begin, front);
+      seq.seq_end = seq.seq_begin;
+      ::std::advance(seq.seq_end, back - front);
+      seq.seq_begin_offset += front;
+    }
+    template <typename SEQ>
+    typename ::std::enable_if<!SEQ::has_quality()>::type narrow_sequence(SEQ & seq, size_t front, size_t back) {
+      ::std::advance(seq.seq_begin, front);
+      seq.seq_end = seq.seq_begin;
+      ::std::advance(seq.seq_end, back - front);
+      seq.seq_begin_offset += front;
+    }
+
+
+    /**
+     * @class bliss::io::NoTrim
+     * @brief   leaves the sequence as is.
+     */
+    struct NoTrim {
+        template <typename SEQ>
+        void operator()(SEQ & x) const {}
+    };
+
+    /**
+     * @class bliss::io::SlidingWindowQualityTrim
+     * @brief   clips the tail of a read starting at the first window whose mean quality is below MinQ.
+     * @details quality is compared as the mean of log2(p_correct) from the codec's decode LUT, so no per base
+     *          conversion to phred score is needed.  sequences without quality scores are not trimmed.
+     * @tparam MinQ     minimum phred score.
+     * @tparam Window   window size in bases.
+     * @tparam Encoder  quality score codec.
+     */
+    template <unsigned char MinQ = 20, unsigned int Window = 4,
+        typename Encoder = ::bliss::index::Illumina18QualityScoreCodec<double> >
+    struct SlidingWindowQualityTrim {
+        static_assert(Window > 0, "window size has to be at least 1");
+        static_assert(MinQ < ::std::tuple_size<decltype(Encoder::DecodeLUT)>::value, "MinQ is outside of the quality score range");
+
+        template <typename SEQ>
+        typename ::std::enable_if<SEQ::has_quality()>::type operator()(SEQ & x) const {
+          size_t len = x.seq_size();
+          if (len == 0) return;
+
+          size_t w = ::std::min(static_cast<size_t>(Window), len);
+          typename Encoder::value_type threshold = static_cast<typename Encoder::value_type>(w) * Encoder::DecodeLUT[MinQ];
+
+          auto head = x.qual_begin;
+          auto tail = x.qual_begin;
+          typename Encoder::value_type sum = 0;
+          for (size_t i = 0; i < w; ++i, ++tail) sum += Encoder::decode(*tail);
+
+          // slide until the window falls below threshold.
+          size_t cut = 0;
+          while ((sum >= threshold) && (cut + w < len)) {
+            sum += Encoder::decode(*tail) - Encoder::decode(*head);
+            ++tail;
+            ++head;
+            ++cut;
+          }
+          if (sum >= threshold) return;
+
+          narrow_sequence(x, 0, cut);
+        }
+
+        template <typename SEQ>
+        typename ::std::enable_if<!SEQ::has_quality()>::type operator()(SEQ & x) const {}
+    };
+
+    /**
+     * @class bliss::io::MottQualityTrim
+     * @brief   keeps the maximal scoring segment of a read, with base score p_err(MinQ) - p_err(q)  (modified Mott algorithm).
+     * @details clips low quality bases from both ends.  error probabilities are derived once from the codec's decode LUT.
+     *          sequences without quality scores are not trimmed.
+     * @tparam MinQ     phred score of the error probability limit.
+     * @tparam Encoder  quality score codec.
+     */
+    template <unsigned char MinQ = 20,
+        typename Encoder = ::bliss::index::Illumina18QualityScoreCodec<double> >
+    struct MottQualityTrim {
+        using LUTType = ::std::array<double, ::std::tuple_size<decltype(Encoder::DecodeLUT)>::value>;
+        static_assert(MinQ < ::std::tuple_size<LUTType>::value, "MinQ is outside of the quality score range");
+
+        /// p_limit - p_err for each quality score.
+        static LUTType const & score_lut() {
+          static const LUTType lut = []() {
+            LUTType l;
+            double limit = 1.0 - ::std::exp2(static_cast<double>(Encoder::DecodeLUT[MinQ]));
+            for (size_t i = 0; i < l.size(); ++i) {
+              l[i] = limit - (1.0 - ::std::exp2(static_cast<double>(Encoder::DecodeLUT[i])));
+            }
+            return l;
+          }();
+          return lut;
+        }
+
+        template <typename SEQ>
+        typename ::std::enable_if<SEQ::has_quality()>::type operator()(SEQ & x) const {
+          LUTType const & lut = score_lut();
+
+          double sum = 0, best = 0;
+          size_t start = 0, best_start = 0, best_end = 0;
+          size_t i = 0;
+          for (auto it = x.qual_begin; it != x.qual_end; ++it, ++i) {
+            int q = static_cast<int>(static_cast<unsigned char>(*it)) - static_cast<int>(Encoder::min_input);
+            sum += lut[::std::min(::std::max(q, 0), static_cast<int>(lut.size()) - 1)];
+            if (sum <= 0) {
+              sum = 0;
+              start = i + 1;
+            } else if (sum > best) {
+              best = sum;
+              best_start = start;
+              best_end = i + 1;
+            }
+          }
+
+          narrow_sequence(x, best_start, best_end);
+        }
+
+        template <typename SEQ>
+        typename ::std::enable_if<!SEQ::has_quality()>::type operator()(SEQ & x) const {}
+    };
+
+
     /**
      * @class bliss::io::SplitSequencesIterator
      * @brief Iterator for parsing and traversing a block of data to access individual sequence records (of some file format), split when predicate fails.
      * @details  for each sequence, scan with predicate.  when predicate fails, split the sequence, and continue on.
      *            EFFECTIVELY BREAKS THE SEQUENCE INTO PARTS WHERE PREDICATE FAILS.
      *
+     *            each record is first narrowed by the Trimmer (e.g. quality trimming), then split.  the parts refer to
+     *            the original data with seq_begin_offset (and quality iterators) adjusted, so kmer ids stay correct and no
+     *            kmer spans a split.  nothing is copied.
+     *
      * @note this iterator is a forward iterator only (for now).
      *
      * @tparam Iterator   Base iterator type to be parsed into sequences
      * @tparam SeqParser     Functoid type to parse data pointed by Iterator into sequence objects..
      * @tparam SequenceType  Sequence Type.  replaceable as long as it supports Quality if SeqParser requires it.
+     * @tparam Trimmer       Functoid that narrows a sequence in place before splitting.
      */
-    template<typename Iterator, template <typename> class SeqParser, typename Predicate>
+    template<typename Iterator, template <typename> class SeqParser, typename Predicate, typename Trimmer = ::bliss::io::NoTrim>
     class SplitSequencesIterator : public ::std::iterator<
       typename ::std::conditional<
             ::std::is_same<typename ::std::iterator_traits<Iterator>::iterator_category,
@@ -194,6 +337,9 @@ namespace bliss
         /// predicate function
         Predicate pred;
 
+        /// trimming function
+        Trimmer trim;
+
         /// internal sequence iterator type
         using SeqIterType = ::bliss::io::SequencesIterator<Iterator, SeqParser>;
 
@@ -217,29 +363,33 @@ namespace bliss
             ++_curr;
 
             // get the next sequence if curr is not at end.
-            if (_curr != _end) next = *_curr;
+            if (_curr != _end) {
+              next = *_curr;
+              trim(next);
+            }
           }
         }
 
         /// splits a sequence based on predicate on chars.
         void split_seq() {
           // first copy
-          // leave the quality score as is.  traversal is confined by seq_begin/seq_end.
           seq = next;
 //          std::cout << "RAW SEQ " << seq << " len " << std::distance(seq.seq_begin, seq.seq_end) << std::endl;
 //          std::cout << "RAW NEXT " << next << " len " << std::distance(next.seq_begin, next.seq_end) << std::endl;
 
           // find the beginning of valid.
-          seq.seq_begin = std::find_if(next.seq_begin, next.seq_end, pred);
+          size_t front = std::distance(next.seq_begin, std::find_if(next.seq_begin, next.seq_end, pred));
 //          std::cout << "first SEQ " << seq << " len " << std::distance(seq.seq_begin, seq.seq_end) << std::endl;
 
           // find the end of the valid range
-          seq.seq_end = std::find_if_not(seq.seq_begin, next.seq_end, pred);
+          auto valid_begin = next.seq_begin;
+          std::advance(valid_begin, front);
+          size_t back = front + std::distance(valid_begin, std::find_if_not(valid_begin, next.seq_end, pred));
 //          std::cout << "second SEQ " << seq << " len " << std::distance(seq.seq_begin, seq.seq_end) << std::endl;
 
-          // now update the next seq object.
-          next.seq_begin_offset += std::distance(next.seq_begin, seq.seq_end);
-          next.seq_begin = seq.seq_end;
+          // narrow both.  seq_begin_offset and quality iterators follow.
+          ::bliss::io::narrow_sequence(seq, front, back);
+          ::bliss::io::narrow_sequence(next, back, next.seq_size());
 
 //          std::cout << "SEQ " << seq << " len " << std::distance(seq.seq_begin, seq.seq_end) << std::endl;
 //          std::cout << "NEXT " << next << " len " << std::distance(next.seq_begin, next.seq_end) << std::endl;
@@ -267,11 +417,15 @@ namespace bliss
         explicit SplitSequencesIterator(const SeqParser<Iterator> & f,
                                         Iterator start,
                        Iterator end, const size_t &_offset,
-                       const Predicate & _pred = Predicate())
-            : pred(_pred), _curr(f, start, end, _offset), _end(end) {
+                       const Predicate & _pred = Predicate(),
+                       const Trimmer & _trim = Trimmer())
+            : pred(_pred), trim(_trim), _curr(f, start, end, _offset), _end(end) {
 
           // first initialize one.
-          if (_curr != _end) next = *_curr;
+          if (_curr != _end) {
+            next = *_curr;
+            trim(next);
+          }
 
           // this would not actually increment unless next is empty, but it will split seq.
           this->operator++();
@@ -284,15 +438,16 @@ namespace bliss
          * @param end     end of the data to be parsed.
          */
         explicit SplitSequencesIterator(Iterator end,
-                               const Predicate & _pred = Predicate())
-            : pred(_pred), _curr(end), _end(end) {}
+                               const Predicate & _pred = Predicate(),
+                               const Trimmer & _trim = Trimmer())
+            : pred(_pred), trim(_trim), _curr(end), _end(end) {}
 
         /**
          * @brief default copy constructor
          * @param Other   The SplitSequencesIterator to copy from
          */
         SplitSequencesIterator(const SplitSequencesIterator& Other)
-            : pred(Other.pred), _curr(Other._curr), _end(Other._end),
+            : pred(Other.pred), trim(Other.trim), _curr(Other._curr), _end(Other._end),
               seq(Other.seq), next(Other.next) {}
 
         /**
@@ -303,6 +458,7 @@ namespace bliss
         SplitSequencesIterator& operator=(const SplitSequencesIterator& Other)
         {
           pred  = Other.pred;
+          trim  = Other.trim;
           _curr = Other._curr;
           _end  = Other._end;
           seq   = Other.seq;
@@ -315,7 +471,7 @@ namespace bliss
          * @param Other   The SplitSequencesIterator to copy from
          */
         SplitSequencesIterator(SplitSequencesIterator && Other)
-            : pred(::std::move(Other.pred)),
+            : pred(::std::move(Other.pred)), trim(::std::move(Other.trim)),
               _curr(::std::move(Other._curr)), _end(::std::move(Other._end)),
               seq(::std::move(Other.seq)), next(::std::move(Other.next))  {}
 
@@ -327,6 +483,7 @@ namespace bliss
         SplitSequencesIterator& operator=(SplitSequencesIterator && Other)
         {
           pred  = std::move(Other.pred );
+          trim  = std::move(Other.trim );
           _curr = std::move(Other._curr);
           _end  = std::move(Other._end );
           seq   = std::move(Other.seq  );
@@ -350,11 +507,13 @@ namespace bliss
          */
         SplitSequencesIterator &operator++()
         {
-          // TODO get the next, and apply the predicate.
-          this->get_next();
+          // get the next, and apply the predicate.  skip parts that are empty, e.g. trailing N.
+          do {
+            this->get_next();
 
-          // split if not empty
-          if ((_curr != _end) && (next.seq_begin != next.seq_end)) this->split_seq();
+            // split if not empty
+            if ((_curr != _end) && (next.seq_begin != next.seq_end)) this->split_seq();
+          } while ((_curr != _end) && (seq.seq_begin == seq.seq_end));
 
           //== states updated.  return self.
           return *this;
@@ -439,9 +598,18 @@ namespace bliss
     template <typename Iterator, template <typename> class SeqParser>
     using NSplitSequencesIterator = bliss::io::SplitSequencesIterator<Iterator, SeqParser, bliss::io::NCharFilter>;
 
+    /// quality trim with a sliding window (phred 20, 4 bases), then split at N.
+    template <typename Iterator, template <typename> class SeqParser>
+    using SlidingWindowTrimNSplitSequencesIterator = bliss::io::SplitSequencesIterator<Iterator, SeqParser, bliss::io::NCharFilter,
+        bliss::io::SlidingWindowQualityTrim<> >;
+
+    /// quality trim with the Mott algorithm (phred 20), then split at N.
+    template <typename Iterator, template <typename> class SeqParser>
+    using MottTrimNSplitSequencesIterator = bliss::io::SplitSequencesIterator<Iterator, SeqParser, bliss::io::NCharFilter,
+        bliss::io::MottQualityTrim<> >;
+
 
     // TODO: filter for other characters.
-    // TODO: quality score filter for sequences.
 
   } // iterator
 } // bliss
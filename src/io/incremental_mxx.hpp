@@ -35,12 +35,22 @@
 
 #include "utils/benchmark_utils.hpp"
 #include "utils/function_traits.hpp"
+#include "utils/huge_page_allocator.hpp"
 
 #include "containers/fsc_container_utils.hpp"
 
 namespace imxx
 {
 
+  /// allocator for the internal exchange buffers.  huge pages on the calling thread's numa node if USE_HUGE_PAGE_BUFFERS is defined.
+#if defined(USE_HUGE_PAGE_BUFFERS)
+  template <typename T>
+  using buffer_allocator = ::bliss::utils::huge_page_allocator<T, ::bliss::utils::numa_policy::local>;
+#else
+  template <typename T>
+  using buffer_allocator = ::std::allocator<T>;
+#endif
+
   // local version of MPI
   namespace local {
 
@@ -155,13 +165,13 @@ namespace imxx
       }
     }
 
-    template <typename T, typename Func, typename ASSIGN_TYPE, typename SIZE>
+    template <typename T, typename Func, typename ASSIGN_TYPE, typename SIZE, typename Alloc>
     void
     bucketing_impl(std::vector<T>const & input,
                            Func const & key_func,
                            ASSIGN_TYPE const num_buckets,
                            std::vector<SIZE> & bucket_sizes,
-						   std::vector<T> & results,
+						   std::vector<T, Alloc> & results,
                            size_t first = 0,
                            size_t last = std::numeric_limits<size_t>::max()) {
 
@@ -1108,6 +1118,11 @@ namespace imxx
 
   }
 
+  /**
+   * @brief distribute function without the input to output mapping.  stable within each destination rank.
+   * @details the entries are bucketed into an internal send buffer (see buffer_allocator), and the memory of input is reused for output.
+   *          input is left with the previous content of output.
+   */
   template <typename V, typename ToRank, typename SIZE>
   void distribute(::std::vector<V>& input, ToRank const & to_rank,
                   ::std::vector<SIZE> & recv_counts,
@@ -1130,25 +1145,23 @@ namespace imxx
     std::vector<SIZE> send_counts(_comm.size(), 0);
     BL_BENCH_END(distribute, "alloc_map", input.size());
 
+    // bucketing, into the internal send buffer.
     BL_BENCH_START(distribute);
-    if (output.capacity() < input.size()) output.clear();
-    output.resize(input.size());
-    output.swap(input);  // swap the 2.
-    BL_BENCH_COLLECTIVE_END(distribute, "alloc_permute", output.size(), _comm);
-
-    // bucketing
-    BL_BENCH_START(distribute);
+    ::std::vector<V, buffer_allocator<V> > send_buf(input.size());
     size_t comm_size = _comm.size();
     if (comm_size <= std::numeric_limits<uint8_t>::max()) {
-      imxx::local::bucketing_impl(output, to_rank, static_cast< uint8_t>(comm_size), send_counts, input, 0, output.size());
+      imxx::local::bucketing_impl(input, to_rank, static_cast< uint8_t>(comm_size), send_counts, send_buf, 0, input.size());
     } else if (comm_size <= std::numeric_limits<uint16_t>::max()) {
-      imxx::local::bucketing_impl(output, to_rank, static_cast<uint16_t>(comm_size), send_counts, input, 0, output.size());
+      imxx::local::bucketing_impl(input, to_rank, static_cast<uint16_t>(comm_size), send_counts, send_buf, 0, input.size());
     } else if (comm_size <= std::numeric_limits<uint32_t>::max()) {
-      imxx::local::bucketing_impl(output, to_rank, static_cast<uint32_t>(comm_size), send_counts, input, 0, output.size());
+      imxx::local::bucketing_impl(input, to_rank, static_cast<uint32_t>(comm_size), send_counts, send_buf, 0, input.size());
     } else {
-      imxx::local::bucketing_impl(output, to_rank, static_cast<uint64_t>(comm_size), send_counts, input, 0, output.size());
+      imxx::local::bucketing_impl(input, to_rank, static_cast<uint64_t>(comm_size), send_counts, send_buf, 0, input.size());
     }
-    BL_BENCH_COLLECTIVE_END(distribute, "bucket", input.size(), _comm);
+    BL_BENCH_COLLECTIVE_END(distribute, "bucket", send_buf.size(), _comm);
+
+    // the input is no longer needed.  reuse its memory for the output.
+    output.swap(input);
 
 
     // distribute (communication part)
@@ -1165,7 +1178,7 @@ namespace imxx
     BL_BENCH_COLLECTIVE_END(distribute, "realloc_out", output.size(), _comm);
 
     BL_BENCH_START(distribute);
-    mxx::all2allv(input.data(), send_counts, output.data(), recv_counts, _comm);
+    mxx::all2allv(send_buf.data(), send_counts, output.data(), recv_counts, _comm);
     BL_BENCH_END(distribute, "a2a", output.size());
 
     BL_BENCH_REPORT_MPI_NAMED(distribute, "imxx:distribute_bucket", _comm);
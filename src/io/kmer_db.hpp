@@ -0,0 +1,435 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    kmer_db.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   sorted binary kmer database:  parallel export of kmer counts or positions, and random access reader.
+ * @details file layout.  all integers are in host byte order.
+ *
+ *          header, 64 bytes:
+ *            char[8]   magic           "BLISSKDB"
+ *            uint32    version         1
+ *            uint32    k
+ *            uint32    bits_per_char   bits per character in the kmer alphabet
+ *            uint32    alphabet_size   number of characters in the kmer alphabet
+ *            uint32    kmer_bytes      bytes per kmer in a record (kmer words, in memory order)
+ *            uint32    value_bytes     bytes per count (or position) in a record.
+ *            uint32    prefix_bits     number of most significant kmer bits used for bucketing
+ *            uint32    reserved
+ *            uint64    record_count
+ *            uint64    index_offset    byte offset of the bucket index
+ *            uint64    data_offset     byte offset of the first record
+ *
+ *          bucket index, (2^prefix_bits + 1) uint64:
+ *            entry b is the number of records with prefix less than b.  bucket b occupies records [entry b, entry b+1).
+ *
+ *          records, record_count * (kmer_bytes + value_bytes), no padding:
+ *            sorted by kmer (Kmer::operator<), so the records are also grouped by prefix.
+ *            a kmer may appear in multiple consecutive records, e.g. for a position index.
+ *
+ *          the writer redistributes the records so that each rank holds a contiguous range of buckets,
+ *          sorts locally, and writes at the offset from an exclusive scan of the record counts with a
+ *          collective MPI-IO write.  the reader binary searches one bucket with positioned reads, so
+ *          only the header and the index are kept in memory.
+ */
+#ifndef KMER_DB_HPP_
+#define KMER_DB_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mpi.h"
+#endif
+
+#include <unistd.h>     // pread, close
+#include <fcntl.h>      // open
+#include <cstdint>
+#include <cstring>      // memcpy
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <limits>
+#include <utility>
+
+#if defined(USE_MPI)
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+#include "common/alphabet_traits.hpp"
+#include "io/io_exception.hpp"
+#include "io/mxx_support.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+    namespace kmerdb
+    {
+
+      /// file header.  see file description for layout.
+      struct header {
+          char magic[8];
+          uint32_t version;
+          uint32_t k;
+          uint32_t bits_per_char;
+          uint32_t alphabet_size;
+          uint32_t kmer_bytes;
+          uint32_t value_bytes;
+          uint32_t prefix_bits;
+          uint32_t reserved;
+          uint64_t record_count;
+          uint64_t index_offset;
+          uint64_t data_offset;
+
+          /// construct the header for the given kmer and value types.
+          template <typename KmerType, typename T>
+          static header make(unsigned int prefix_bits, uint64_t record_count) {
+            header h;
+            memcpy(h.magic, "BLISSKDB", 8);
+            h.version = 1;
+            h.k = KmerType::size;
+            h.bits_per_char = KmerType::bitsPerChar;
+            h.alphabet_size = KmerType::KmerAlphabet::SIZE;
+            h.kmer_bytes = sizeof(typename KmerType::KmerWordType) * KmerType::nWords;
+            h.value_bytes = sizeof(T);
+            h.prefix_bits = prefix_bits;
+            h.reserved = 0;
+            h.record_count = record_count;
+            h.index_offset = sizeof(header);
+            h.data_offset = h.index_offset + ((1ULL << prefix_bits) + 1) * sizeof(uint64_t);
+            return h;
+          }
+
+          /// check that the file was written with the given kmer and value types.
+          template <typename KmerType, typename T>
+          bool matches() const {
+            header h = make<KmerType, T>(prefix_bits, record_count);
+            return (memcmp(magic, h.magic, 8) == 0) && (version == h.version) && (k == h.k) &&
+                (bits_per_char == h.bits_per_char) && (alphabet_size == h.alphabet_size) &&
+                (kmer_bytes == h.kmer_bytes) && (value_bytes == h.value_bytes);
+          }
+      };
+      static_assert(sizeof(header) == 64, "kmer db header should be 64 bytes");
+
+      /// bucket of a kmer: its prefix_bits most significant bits.
+      template <typename KmerType>
+      inline size_t get_bucket(KmerType const & kmer, unsigned int prefix_bits) {
+        return (prefix_bits == 0) ? 0 : static_cast<size_t>(kmer.getPrefix(prefix_bits));
+      }
+
+      /// largest supported prefix.  limits the index to 2^24 + 1 entries.
+      constexpr unsigned int max_prefix_bits = 24;
+
+      /**
+       * @brief stable counting sort of records by bucket.  one radix pass over the prefix bits.
+       * @param hist    per bucket record counts of input.  on return, the exclusive prefix sum, i.e. bucket start offsets.
+       */
+      template <typename KmerType, typename T>
+      void bucket_sort(std::vector<std::pair<KmerType, T> > & input, std::vector<size_t> & hist, unsigned int prefix_bits) {
+        size_t offset = 0;
+        size_t count = 0;
+        for (size_t b = 0; b < hist.size(); ++b) {
+          count = hist[b];
+          hist[b] = offset;
+          offset += count;
+        }
+
+        std::vector<std::pair<KmerType, T> > output(input.size());
+        std::vector<size_t> pos(hist);
+        for (auto const & r : input) {
+          output[pos[get_bucket(r.first, prefix_bits)]++] = r;
+        }
+        input.swap(output);
+      }
+
+      /// order records by kmer only.  values of the same kmer keep no particular order.
+      template <typename KmerType, typename T>
+      struct kmer_less {
+          bool operator()(std::pair<KmerType, T> const & x, std::pair<KmerType, T> const & y) const {
+            return x.first < y.first;
+          }
+      };
+
+    } // namespace kmerdb
+
+
+#if defined(USE_MPI)
+
+    /**
+     * @brief collectively write kmer records to a sorted binary kmer database.  see file description for the format.
+     * @details records are redistributed by prefix bucket and sorted.  input is consumed:  on return it holds
+     *          the sorted records that this rank wrote.  keys should be unique across ranks for a count database,
+     *          e.g. the output of a counting map's to_vector.
+     * @param filename      output file.  overwritten if it exists.
+     * @param records       kmer and count (or position) pairs on this rank.
+     * @param comm          communicator.  all ranks must call.
+     * @param prefix_bits   number of most significant kmer bits used for bucketing and the index.
+     * @param radix_sort    if true, group records by bucket with a counting sort before sorting each bucket.
+     *                      otherwise sort the whole local array by comparison.
+     * @return total number of records written.
+     */
+    template <typename KmerType, typename T>
+    size_t write_kmer_db(std::string const & filename, std::vector<std::pair<KmerType, T> > & records,
+                         ::mxx::comm const & comm, unsigned int prefix_bits = 16, bool radix_sort = true) {
+
+      if ((prefix_bits > ::bliss::io::kmerdb::max_prefix_bits) || (prefix_bits > KmerType::nBits)) {
+        throw std::invalid_argument("kmer db prefix bits should be at most 24 and at most the number of bits in the kmer.");
+      }
+
+      using record_type = std::pair<KmerType, T>;
+      const size_t nbuckets = 1ULL << prefix_bits;
+      const size_t kmer_bytes = sizeof(typename KmerType::KmerWordType) * KmerType::nWords;
+      const size_t record_bytes = kmer_bytes + sizeof(T);
+
+      // ======= global bucket histogram.
+      std::vector<size_t> hist(nbuckets, 0);
+      for (auto const & r : records) {
+        ++hist[::bliss::io::kmerdb::get_bucket(r.first, prefix_bits)];
+      }
+      std::vector<size_t> global_hist = ::mxx::allreduce(hist, std::plus<size_t>(), comm);
+
+      // global bucket start offsets, with total at the end.  this is the bucket index.
+      std::vector<uint64_t> index(nbuckets + 1, 0);
+      for (size_t b = 0; b < nbuckets; ++b) {
+        index[b + 1] = index[b] + global_hist[b];
+      }
+      const size_t total = index[nbuckets];
+
+      // ======= assign contiguous bucket ranges to ranks, balanced by record count, and redistribute.
+      if (comm.size() > 1) {
+        if (radix_sort) {
+          ::bliss::io::kmerdb::bucket_sort(records, hist, prefix_bits);
+        } else {
+          std::sort(records.begin(), records.end(), ::bliss::io::kmerdb::kmer_less<KmerType, T>());
+        }
+
+        // records are grouped by bucket, and buckets map monotonically to ranks.
+        std::vector<size_t> send_counts(comm.size(), 0);
+        for (auto const & r : records) {
+          size_t b = ::bliss::io::kmerdb::get_bucket(r.first, prefix_bits);
+          ++send_counts[std::min(static_cast<size_t>(comm.size() - 1), (index[b] * comm.size()) / std::max(total, static_cast<size_t>(1)))];
+        }
+        ::mxx::all2allv(records, send_counts, comm).swap(records);
+
+        // recompute local histogram for the received records.
+        std::fill(hist.begin(), hist.end(), 0);
+        for (auto const & r : records) {
+          ++hist[::bliss::io::kmerdb::get_bucket(r.first, prefix_bits)];
+        }
+      }
+
+      // ======= local sort.
+      if (radix_sort) {
+        ::bliss::io::kmerdb::bucket_sort(records, hist, prefix_bits);
+        for (size_t b = 0; b < nbuckets; ++b) {
+          size_t e = (b + 1 < nbuckets) ? hist[b + 1] : records.size();
+          if (e - hist[b] > 1)
+            std::sort(records.begin() + hist[b], records.begin() + e, ::bliss::io::kmerdb::kmer_less<KmerType, T>());
+        }
+      } else {
+        std::sort(records.begin(), records.end(), ::bliss::io::kmerdb::kmer_less<KmerType, T>());
+      }
+
+      // ======= serialize the records without padding.
+      std::vector<unsigned char> buffer(records.size() * record_bytes);
+      unsigned char * out = buffer.data();
+      for (auto const & r : records) {
+        memcpy(out, r.first.getData(), kmer_bytes);
+        memcpy(out + kmer_bytes, &(r.second), sizeof(T));
+        out += record_bytes;
+      }
+
+      if (records.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        throw std::invalid_argument("kmer db:  too many records on one rank for a single MPI-IO write.");
+      }
+
+      // ======= collective write at exscan offsets.
+      size_t offset = ::mxx::exscan(records.size(), comm);
+      ::bliss::io::kmerdb::header h = ::bliss::io::kmerdb::header::template make<KmerType, T>(prefix_bits, total);
+
+      // remove any previous content.
+      if (comm.rank() == 0) MPI_File_delete(const_cast<char *>(filename.c_str()), MPI_INFO_NULL);
+      comm.barrier();
+
+      MPI_File fh;
+      int res = MPI_File_open(comm, const_cast<char *>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+      if (res != MPI_SUCCESS) {
+        std::stringstream ss;
+        ss << "ERROR in kmer db: rank " << comm.rank() << " unable to open " << filename << " for writing";
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+      MPI_Datatype record_dt;
+      MPI_Type_contiguous(static_cast<int>(record_bytes), MPI_BYTE, &record_dt);
+      MPI_Type_commit(&record_dt);
+
+      if (comm.rank() == 0) {
+        MPI_Status stat;
+        MPI_File_write_at(fh, 0, &h, sizeof(h), MPI_BYTE, &stat);
+        MPI_File_write_at(fh, static_cast<MPI_Offset>(h.index_offset), index.data(),
+                          static_cast<int>(index.size() * sizeof(uint64_t)), MPI_BYTE, &stat);
+      }
+
+      MPI_Status stat;
+      res = MPI_File_write_at_all(fh, static_cast<MPI_Offset>(h.data_offset + offset * record_bytes),
+                                  buffer.data(), static_cast<int>(records.size()), record_dt, &stat);
+
+      MPI_Type_free(&record_dt);
+      MPI_File_close(&fh);
+
+      if (res != MPI_SUCCESS) {
+        std::stringstream ss;
+        ss << "ERROR in kmer db: rank " << comm.rank() << " unable to write records to " << filename;
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+
+      return total;
+    }
+
+    /**
+     * @brief export a distributed counting or position map to a sorted binary kmer database.  collective.
+     * @details uses the map's to_vector.  see write_kmer_db.
+     */
+    template <typename MapType>
+    size_t export_kmer_db(std::string const & filename, MapType const & map, ::mxx::comm const & comm,
+                          unsigned int prefix_bits = 16, bool radix_sort = true) {
+      std::vector<std::pair<typename MapType::key_type, typename MapType::mapped_type> > records;
+      map.to_vector(records);
+      return write_kmer_db(filename, records, comm, prefix_bits, radix_sort);
+    }
+
+#endif
+
+    /**
+     * @brief random access reader for a sorted binary kmer database.
+     * @details keeps only the header and bucket index in memory.  a lookup binary searches
+     *          the kmer's bucket with positioned reads.
+     * @tparam KmerType   kmer type.  must match k, alphabet, and word size of the file.
+     * @tparam T          count or position type.  must match the value width of the file.
+     */
+    template <typename KmerType, typename T>
+    class kmer_db_reader {
+      protected:
+        std::string filename;
+        int fd;
+        ::bliss::io::kmerdb::header h;
+        std::vector<uint64_t> index;
+        size_t kmer_bytes;
+        size_t record_bytes;
+
+        /// read bytes at offset.
+        void read_at(void * buf, size_t bytes, size_t offset) const {
+          unsigned char * out = reinterpret_cast<unsigned char *>(buf);
+          while (bytes > 0) {
+            ssize_t n = pread(fd, out, bytes, static_cast<off_t>(offset));
+            if (n <= 0) {
+              std::stringstream ss;
+              ss << "ERROR in kmer db: unable to read " << bytes << " bytes at " << offset << " from " << filename;
+              throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+            }
+            out += n;
+            offset += n;
+            bytes -= n;
+          }
+        }
+
+      public:
+        kmer_db_reader(std::string const & _filename) : filename(_filename), fd(-1) {
+          fd = open(filename.c_str(), O_RDONLY);
+          if (fd < 0) {
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>("ERROR in kmer db: unable to open " + filename);
+          }
+
+          read_at(&h, sizeof(h), 0);
+          if (!h.template matches<KmerType, T>()) {
+            close(fd);
+            throw std::invalid_argument("kmer db file " + filename + " does not match the kmer and value types.");
+          }
+
+          kmer_bytes = h.kmer_bytes;
+          record_bytes = h.kmer_bytes + h.value_bytes;
+
+          index.resize((1ULL << h.prefix_bits) + 1);
+          read_at(index.data(), index.size() * sizeof(uint64_t), h.index_offset);
+        }
+
+        kmer_db_reader(kmer_db_reader const & other) = delete;
+        kmer_db_reader& operator=(kmer_db_reader const & other) = delete;
+
+        ~kmer_db_reader() {
+          if (fd >= 0) close(fd);
+        }
+
+        /// total number of records
+        size_t size() const { return h.record_count; }
+
+        /// file header
+        ::bliss::io::kmerdb::header const & get_header() const { return h; }
+
+        /// read the i-th record.
+        std::pair<KmerType, T> get(size_t i) const {
+          std::vector<unsigned char> buf(record_bytes);
+          read_at(buf.data(), record_bytes, h.data_offset + i * record_bytes);
+
+          std::pair<KmerType, T> r;
+          memcpy(r.first.getDataRef(), buf.data(), kmer_bytes);
+          memcpy(&(r.second), buf.data() + kmer_bytes, sizeof(T));
+          return r;
+        }
+
+        /// index of the first record with kmer not less than the query.
+        size_t lower_bound(KmerType const & kmer) const {
+          size_t b = ::bliss::io::kmerdb::get_bucket(kmer, h.prefix_bits);
+          size_t lo = index[b];
+          size_t hi = index[b + 1];
+
+          while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (get(mid).first < kmer) lo = mid + 1;
+            else hi = mid;
+          }
+          return lo;
+        }
+
+        /// all counts (or positions) of the query kmer.  empty if not present.
+        std::vector<T> find(KmerType const & kmer) const {
+          std::vector<T> result;
+          size_t end = index[::bliss::io::kmerdb::get_bucket(kmer, h.prefix_bits) + 1];
+          for (size_t i = lower_bound(kmer); i < end; ++i) {
+            std::pair<KmerType, T> r = get(i);
+            if (!(r.first == kmer)) break;
+            result.push_back(r.second);
+          }
+          return result;
+        }
+
+        /// number of records for the query kmer.
+        size_t count(KmerType const & kmer) const {
+          return find(kmer).size();
+        }
+    };
+
+  } /* namespace io */
+} /* namespace bliss */
+
+#endif /* KMER_DB_HPP_ */
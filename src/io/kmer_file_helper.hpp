@@ -71,6 +71,7 @@
 #include "containers/fsc_container_utils.hpp"
 
 #include "io/kmer_parser.hpp"
+#include "io/packed_read_store.hpp"
 #include "io/mxx_support.hpp"
 
 #include "io/sequence_iterator.hpp"
@@ -96,6 +97,26 @@ namespace io
  */
 struct KmerFileHelper {
 
+  /// check that the file extensions are supported, and by SeqParser.  throws std::invalid_argument otherwise.
+  template <template <typename> class SeqParser>
+  static void check_file_types(const ::std::vector<::std::string> & filenames) {
+    for (auto const & filename : filenames) {
+      // file extension determines SeqParserType
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+
+      // check to make sure that the file parser will work
+      if ((extension.compare("fastq") == 0) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value)) {
+        throw std::invalid_argument("Specified File Parser template parameter does not support files with fastq extension.");
+      } else if (((extension.compare("fasta") == 0) || (extension.compare("fa") == 0)) && (!std::is_same<SeqParser<char*>, ::bliss::io::FASTAParser<char*> >::value)) {
+        throw std::invalid_argument("Specified File Parser template parameter does not support files with fasta extension.");
+      }
+    }
+  }
+
 
   /**
    * @brief  generate kmers or kmer tuples for 1 block of raw data.
@@ -106,11 +127,13 @@ struct KmerFileHelper {
    * @tparam BlockType    input partition type, supports in memory (vector) vs memmapped.
    * @param partition
    * @param result        output vector.  should be pre allocated.
+   * @param store         read store that keeps the parsed sequences for later passes.  see ::bliss::io::packed_read_store
    */
-  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType, typename ReadStore>
   static std::pair<size_t, size_t> read_block_old(BlockType const & partition,
       SeqParser<typename BlockType::iterator> const &seq_parser,
-      std::vector<typename KmerParser::value_type>& result) {
+      std::vector<typename KmerParser::value_type>& result,
+      ReadStore & store) {
 
     // from FileLoader type, get the block iter type and range type
     using CharIterType = typename BlockType::const_iterator;
@@ -172,6 +195,7 @@ struct KmerFileHelper {
         }
       }
 
+      store.insert(seq, partition.valid_range_bytes);
       emplace_iter = kmer_parser(seq, emplace_iter);
       if ((seq.seq_offset == seq.seq_begin_offset) ||
           (start_offset >= partition.valid_range_bytes.start)) ++seqs;
@@ -185,6 +209,15 @@ struct KmerFileHelper {
     return std::make_pair(seqs, result.size() - before);
   }
 
+  /// generate kmers or kmer tuples for 1 block of raw data, without keeping the parsed sequences.
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
+  static std::pair<size_t, size_t> read_block_old(BlockType const & partition,
+      SeqParser<typename BlockType::iterator> const &seq_parser,
+      std::vector<typename KmerParser::value_type>& result) {
+    ::bliss::io::no_read_store store;
+    return read_block_old<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result, store);
+  }
+
 
   template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
   static std::pair<size_t, size_t> read_block(BlockType const & partition,
@@ -437,10 +470,12 @@ struct KmerFileHelper {
 
   /**
    * @brief initialize the sequence parser, estimate capacity and reserver, and then call read_block to parse the actual data.
+   * @param file_id   stored in the SequenceId of each record, and so in the kmer positions.
    */
-  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType, typename ReadStore>
   static  ::std::pair<size_t, size_t> parse_file_data_old(const BlockType & partition,
-                         std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm) {
+                         std::vector<typename KmerParser::value_type>& result, ReadStore & store, const mxx::comm & _comm,
+                         uint16_t const file_id = 0) {
       ::std::pair<size_t, size_t> read = {0,0};
 
      constexpr int kmer_size = KmerParser::window_size;
@@ -450,6 +485,7 @@ struct KmerFileHelper {
         // not reusing the SeqParser in loader.  instead, reinitializing one.
         BL_BENCH_START(file);
         SeqParser<typename BlockType::const_iterator> seq_parser;
+        seq_parser.set_file_id(file_id);
         seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
         BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
 
@@ -470,7 +506,7 @@ struct KmerFileHelper {
         BL_BENCH_START(file);
         //=== copy into array
         if (partition.getRange().size() > 0) {
-          read = read_block_old<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result);
+          read = read_block_old<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, result, store);
         }
         BL_BENCH_END(file, "read_seqs", read.first);
         // std::cout << "Last: pos - kmer " << result.back() << std::endl;
@@ -481,6 +517,15 @@ struct KmerFileHelper {
 
   }
 
+  /// parse the partition into kmers, without keeping the parsed sequences.
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename BlockType>
+  static  ::std::pair<size_t, size_t> parse_file_data_old(const BlockType & partition,
+                         std::vector<typename KmerParser::value_type>& result, const mxx::comm & _comm,
+                         uint16_t const file_id = 0) {
+    ::bliss::io::no_read_store store;
+    return parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, store, _comm, file_id);
+  }
+
   /**
    * @brief initialize the sequence parser, estimate capacity and reserver, and then call read_block to parse the actual data.
    */
@@ -547,9 +592,10 @@ struct KmerFileHelper {
    * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
    * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
    */
-  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename ReadStore>
   static  ::std::pair<size_t, size_t> read_file(const std::string & filename,
                          std::vector<typename KmerParser::value_type>& result,
+                         ReadStore & store,
                          const mxx::comm & _comm) {
 
       ::std::pair<size_t, size_t> read = {0, 0};
@@ -568,7 +614,7 @@ struct KmerFileHelper {
 
         // not reusing the SeqParser in loader.  instead, reinitializing one.
         BL_BENCH_START(file);
-        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, _comm);
+        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, store, _comm);
         BL_BENCH_END(file, "read_kmers", read.second);
         // std::cout << "Last: pos - kmer " << result.back() << std::endl;
       }
@@ -578,6 +624,15 @@ struct KmerFileHelper {
       return read;
   }
 
+  /// read a file's content and generate kmers, without keeping the parsed sequences.
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static  ::std::pair<size_t, size_t> read_file(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+    ::bliss::io::no_read_store store;
+    return read_file<FileType, KmerParser, SeqParser, SeqIterType>(filename, result, store, _comm);
+  }
+
 
   /**
    * @brief read a file's content and generate kmers, place in a vector as return result.
@@ -631,6 +686,517 @@ struct KmerFileHelper {
           KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
 
   }
+
+  /**
+   * @brief read a file's content and generate kmers, and keep the parsed sequences in a read store for later passes.
+   * @details kmers generated from the store afterwards are the same as the kmers placed in result.
+   *          see ::bliss::io::packed_read_store
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename ReadStore>
+  static ::std::pair<size_t, size_t> read_file_posix(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         ReadStore & store,
+                         const mxx::comm & _comm) {
+      return read_file<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, result, store, _comm);
+  }
+
+  /// read with mmap and keep the parsed sequences in a read store.  see read_file_posix
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename ReadStore>
+  static ::std::pair<size_t, size_t> read_file_mmap(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         ReadStore & store,
+                         const mxx::comm & _comm) {
+      return read_file<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, result, store, _comm);
+  }
+
+  /// read with mpiio and keep the parsed sequences in a read store.  see read_file_posix
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType, typename ReadStore>
+  static ::std::pair<size_t, size_t> read_file_mpiio(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         ReadStore & store,
+                         const mxx::comm & _comm) {
+      return read_file<::bliss::io::parallel::mpiio_file<SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, result, store, _comm);
+  }
+
+  /// read store that hands the kmers generated so far to a consumer once there are at least block_size.  see read_file_blocks
+  template <typename V, typename Consumer>
+  struct kmer_block_flush {
+      ::std::vector<V> & kmers;
+      Consumer & consumer;
+      size_t const block_size;
+      size_t flushed;
+
+      kmer_block_flush(::std::vector<V> & _kmers, Consumer & _consumer, size_t const _block_size) :
+        kmers(_kmers), consumer(_consumer), block_size(_block_size), flushed(0) {}
+
+      /// called before the kmers of each sequence are generated.
+      template <typename SeqType>
+      void insert(SeqType const &, ::bliss::partition::range<size_t> const &) {
+        if (kmers.size() >= block_size) flush();
+      }
+
+      void flush() {
+        if (kmers.size() == 0) return;
+        flushed += kmers.size();
+        consumer(kmers);
+        kmers.clear();
+      }
+  };
+
+  /**
+   * @brief read a file's content and hand the kmers to a consumer block by block, so that the kmers of a whole
+   *        partition are never in memory together, e.g. for sketching.
+   * @details the partition is read and parsed as in read_file.  whenever at least block_size kmers have been generated,
+   *          at a sequence boundary, they are passed to consumer as a vector, which is then cleared and reused.
+   *          the last partial block is passed at the end.  a parse or consumer failure is reduced, so that all ranks throw together.
+   * @param consumer    called as consumer(::std::vector<KmerParser::value_type> &).  not collective:  ranks call it different numbers of times.
+   * @param block_size  number of kmers per block.
+   * @return  number of sequences and of kmers read.
+   */
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+    typename Consumer>
+  static ::std::pair<size_t, size_t> read_file_blocks(const std::string & filename, Consumer & consumer,
+                         const mxx::comm & _comm, size_t const block_size = (1UL << 20)) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      BL_BENCH_INIT(file);
+
+      BL_BENCH_START(file);
+      ::bliss::io::file_data partition = open_file<FileType>(filename, kmer_size - 1, _comm);
+      BL_BENCH_END(file, "open", partition.getRange().size());
+
+      BL_BENCH_START(file);
+      SeqParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+      seq_parser.init_parser(partition.in_mem_cbegin(), partition.parent_range_bytes, partition.in_mem_range_bytes, partition.getRange(), _comm);
+      BL_BENCH_END(file, "mark_seqs", partition.getRange().size());
+
+      BL_BENCH_START(file);
+      // a parse or consumer failure is reduced before the next collective, so that all ranks throw together.
+      ::std::string error;
+      try {
+        ::std::vector<typename KmerParser::value_type> kmers;
+        kmers.reserve(block_size);
+        kmer_block_flush<typename KmerParser::value_type, Consumer> flusher(kmers, consumer, block_size);
+
+        if (partition.getRange().size() > 0) {
+          read.first = read_block_old<KmerParser, SeqParser, SeqIterType>(partition, seq_parser, kmers, flusher).first;
+        }
+        flusher.flush();
+        read.second = flusher.flushed;
+      } catch (::std::exception const & e) {
+        error = e.what();
+      }
+      int failed = ::mxx::allreduce(error.empty() ? 0 : 1, _comm);
+      if (failed > 0) {
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::io::KmerFileHelper::read_file_blocks: " << failed << " rank(s) failed to parse [" << filename << "]";
+        if (!error.empty()) ss << ".  rank " << _comm.rank() << ": " << error;
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+      BL_BENCH_END(file, "read_kmers", read.second);
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_blocks", _comm);
+      return read;
+  }
+
+  /// read a file with posix read and hand the kmers to a consumer block by block.  see read_file_blocks
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType,
+    typename Consumer>
+  static ::std::pair<size_t, size_t> read_file_blocks_posix(const std::string & filename, Consumer & consumer,
+                         const mxx::comm & _comm, size_t const block_size = (1UL << 20)) {
+      return read_file_blocks<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filename, consumer, _comm, block_size);
+  }
+
+
+  /**
+   * @brief read multiple files as one concatenated byte space and generate kmers, place in a vector as return result.
+   * @details the total bytes of all files are block partitioned across _comm, so a rank may read parts of several
+   *          files and a file may be split across several ranks.  each file is opened with FileType on the communicator
+   *          of the ranks that read it, with each rank's byte range assigned explicitly, so record boundaries
+   *          are resolved by the existing per file logic.  a file read by only 1 rank is opened on MPI_COMM_SELF.
+   *
+   *          a rank shares at most its first and last file with other ranks, and those are consecutive among the
+   *          shared files.  alternating shared files between 2 communicator splits therefore gives each rank
+   *          at most 1 communicator per split, and the number of collective splits is independent of the number of files.
+   *          ranks process their files in order, and each shared file waits only on lower ranks, so this does not deadlock.
+   * @note   kmer positions are offsets within each file.  SequenceId::file_id is the index of the file in filenames.
+   * @tparam FileType     parallel file type, supports assign_partition.
+   * @tparam SeqParser    parser type for extracting sequences.  supports FASTQ and FASTA.   template template parameter, param is iterator
+   * @tparam KmerParser   parser type for generating Kmer.  supports kmer, kmer+pos, kmer+count, kmer+pos/qual.
+   */
+  template <typename FileType, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static  ::std::pair<size_t, size_t> read_files(const ::std::vector<::std::string> & filenames,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+      using range_type = ::bliss::partition::range<size_t>;
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+      if (filenames.size() == 0) return read;
+
+      // same list on all ranks, so all ranks throw together.
+      check_file_types<SeqParser>(filenames);
+      if (filenames.size() > (static_cast<size_t>(::std::numeric_limits<uint8_t>::max()) + 1)) {
+        throw std::invalid_argument("ERROR: read_files: too many files for the 8 bit file id in kmer positions.");
+      }
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      BL_BENCH_INIT(files);
+
+      BL_BENCH_START(files);
+      // file sizes, as offsets into the concatenated byte space.  rank 0 stats the files then broadcast.
+      // the failed file and errno are broadcast first, so that all ranks throw instead of waiting on rank 0.
+      ::std::vector<size_t> offsets(filenames.size() + 1, 0);
+      int error[2] = {-1, 0};
+      if (_comm.rank() == 0) {
+        struct stat64 filestat;
+        for (size_t i = 0; i < filenames.size(); ++i) {
+          if (stat64(filenames[i].c_str(), &filestat) < 0) {
+            error[0] = static_cast<int>(i);
+            error[1] = errno;
+            break;
+          }
+          offsets[i + 1] = offsets[i] + static_cast<size_t>(filestat.st_size);
+        }
+      }
+      if (_comm.size() > 1)
+        MPI_Bcast(error, 2, MPI_INT, 0, _comm);
+      if (error[0] >= 0) {
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::io::KmerFileHelper::read_files: ["  << filenames[error[0]] << "] " << error[1] << ": " << strerror(error[1]);
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+      if (_comm.size() > 1)
+        MPI_Bcast(offsets.data(), offsets.size(), MPI_UNSIGNED_LONG, 0, _comm);
+
+      // block partition the concatenated byte space.
+      ::bliss::partition::BlockPartitioner<range_type> partitioner;
+      partitioner.configure(range_type(0, offsets.back()), _comm.size());
+      ::std::vector<range_type> rank_ranges;
+      rank_ranges.reserve(_comm.size());
+      for (int r = 0; r < _comm.size(); ++r) {
+        rank_ranges.emplace_back(partitioner.getNext(r));
+      }
+      range_type my_range = rank_ranges[_comm.rank()];
+
+      // number of ranks reading each file, and order of each shared file among the shared files.
+      ::std::vector<int> readers(filenames.size(), 0);
+      ::std::vector<size_t> shared_id(filenames.size(), 0);
+      size_t shared_count = 0;
+      int r = 0;
+      for (size_t i = 0; i < filenames.size(); ++i) {
+        if (offsets[i] == offsets[i + 1]) continue;   // empty file
+
+        // skip ranks that end before the file.  rank ranges are contiguous and ordered.
+        while ((r < _comm.size()) && (rank_ranges[r].end <= offsets[i])) ++r;
+        for (int rr = r; (rr < _comm.size()) && (rank_ranges[rr].start < offsets[i + 1]); ++rr) {
+          if (rank_ranges[rr].size() > 0) ++readers[i];
+        }
+        if (readers[i] > 1) shared_id[i] = shared_count++;
+      }
+
+      // split the communicator for the shared files.  color 0 for ranks not in any shared file in this split.
+      int colors[2] = {0, 0};
+      for (size_t i = 0; i < filenames.size(); ++i) {
+        if ((readers[i] < 2) || (range_type::intersect(my_range, range_type(offsets[i], offsets[i + 1])).size() == 0)) continue;
+        colors[shared_id[i] & 0x1] = static_cast<int>(i + 1);
+      }
+      ::mxx::comm even_comm = _comm.split(colors[0]);
+      ::mxx::comm odd_comm = _comm.split(colors[1]);
+      ::mxx::comm self_comm(MPI_COMM_SELF);
+      BL_BENCH_END(files, "partition", my_range.size());
+
+      BL_BENCH_START(files);
+      ::std::pair<size_t, size_t> file_read;
+      for (size_t i = 0; i < filenames.size(); ++i) {
+        range_type file_range(offsets[i], offsets[i + 1]);
+        range_type local = range_type::intersect(file_range, my_range);
+        if (local.size() == 0) continue;
+
+        // convert to file coordinates
+        local.start -= offsets[i];
+        local.end -= offsets[i];
+
+        ::mxx::comm const & file_comm = (readers[i] < 2) ? self_comm :
+            ((shared_id[i] & 0x1) ? odd_comm : even_comm);
+
+        FileType fobj(filenames[i], kmer_size - 1, file_comm);
+        fobj.assign_partition(local);
+        ::bliss::io::file_data partition = fobj.read_file();
+
+        file_read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, file_comm, static_cast<uint16_t>(i));
+        read.first += file_read.first;
+        read.second += file_read.second;
+      }
+      BL_BENCH_END(files, "read_kmers", read.second);
+
+      BL_BENCH_REPORT_MPI_NAMED(files, "io:read_files", _comm);
+      return read;
+  }
+
+  /// read multiple files as one byte space with mpiio.  see read_files
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static  ::std::pair<size_t, size_t> read_files_mpiio(const ::std::vector<::std::string> & filenames,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      return read_files<::bliss::io::parallel::mpiio_file<SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filenames, result, _comm);
+  }
+
+  /// read multiple files as one byte space with mmap.  see read_files
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static  ::std::pair<size_t, size_t> read_files_mmap(const ::std::vector<::std::string> & filenames,
+                        std::vector<typename KmerParser::value_type>& result,
+                        const mxx::comm & _comm) {
+
+      return read_files<::bliss::io::parallel::partitioned_file<::bliss::io::mmap_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filenames, result, _comm);
+  }
+
+  /// read multiple files as one byte space with posix read.  see read_files
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_files_posix(const ::std::vector<::std::string> & filenames,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      return read_files<::bliss::io::parallel::partitioned_file<::bliss::io::posix_file, SeqParser >,
+          KmerParser, SeqParser, SeqIterType>(filenames, result, _comm);
+  }
+
+  /// set up the sequence parser for a block from demand_driven_file.  blocks start at record boundaries, so nothing to do.
+  template <typename Parser>
+  static void init_block_parser(Parser &, ::bliss::io::parallel::file_block const &) {}
+
+  /// set up the FASTA parser for a block from demand_driven_file:  mark the sequences, then add the record that started in a previous block.
+  /// the overlap region is searched as well, so that a sequence ending in the overlap does not run into the next header.
+  template <typename Iterator>
+  static void init_block_parser(::bliss::io::FASTAParser<Iterator> & parser, ::bliss::io::parallel::file_block const & block) {
+    parser.init_parser(block.in_mem_cbegin(), block.parent_range_bytes, block.in_mem_range_bytes, block.in_mem_range_bytes);
+    if (block.record_start != ::std::numeric_limits<size_t>::max())
+      parser.set_leading_record(block.in_mem_cbegin(), block.parent_range_bytes, block.in_mem_range_bytes,
+                                block.record_start, block.seq_start);
+  }
+
+  /**
+   * @brief read a file's content with demand driven block distribution, and generate kmers, place in a vector as return result.
+   * @details ranks pull fixed size blocks from a shared RMA counter until the file is exhausted.
+   *          see ::bliss::io::parallel::demand_driven_file.  output is the same set of kmers as read_file, but the
+   *          distribution across ranks depends on timing.
+   * @tparam FileReader   sequential reader, e.g. posix_file or mmap_file
+   * @param block_size    size of each block.  should be much larger than a record.
+   */
+  template <typename FileReader, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static  ::std::pair<size_t, size_t> read_file_demand(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, size_t const block_size = (32UL << 20)) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      // file extension determines SeqParserType
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+
+      BL_BENCH_INIT(file);
+
+      BL_BENCH_START(file);
+      ::std::vector<::bliss::io::parallel::file_block> blocks;
+      {
+        ::bliss::io::parallel::demand_driven_file<FileReader, SeqParser> fobj(filename, kmer_size - 1, _comm, block_size);
+        blocks = fobj.read_file_blocks();
+      }
+      BL_BENCH_END(file, "open", blocks.size());
+
+      BL_BENCH_START(file);
+      // a parse failure is reduced before the next collective, so that all ranks throw together.
+      ::std::string error;
+      try {
+        ::std::pair<size_t, size_t> block_read;
+        for (auto const & block : blocks) {
+          if (block.getRange().size() == 0) continue;
+
+          SeqParser<typename ::bliss::io::file_data::const_iterator> seq_parser;
+          init_block_parser(seq_parser, block);
+
+          block_read = read_block_old<KmerParser, SeqParser, SeqIterType>(static_cast<::bliss::io::file_data const &>(block), seq_parser, result);
+          read.first += block_read.first;
+          read.second += block_read.second;
+        }
+      } catch (::std::exception const & e) {
+        error = e.what();
+      }
+      int failed = ::mxx::allreduce(error.empty() ? 0 : 1, _comm);
+      if (failed > 0) {
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::io::KmerFileHelper::read_file_demand: " << failed << " rank(s) failed to parse [" << filename << "]";
+        if (!error.empty()) ss << ".  rank " << _comm.rank() << ": " << error;
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+      BL_BENCH_END(file, "read_kmers", read.second);
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_demand", _comm);
+      return read;
+  }
+
+  /// read a file with demand driven block distribution, using mmap.  see read_file_demand
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static  ::std::pair<size_t, size_t> read_file_demand_mmap(const std::string & filename,
+                        std::vector<typename KmerParser::value_type>& result,
+                        const mxx::comm & _comm, size_t const block_size = (32UL << 20)) {
+
+      return read_file_demand<::bliss::io::mmap_file, KmerParser, SeqParser, SeqIterType>(filename, result, _comm, block_size);
+  }
+
+  /// read a file with demand driven block distribution, using posix read.  see read_file_demand
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_demand_posix(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, size_t const block_size = (32UL << 20)) {
+
+      return read_file_demand<::bliss::io::posix_file, KmerParser, SeqParser, SeqIterType>(filename, result, _comm, block_size);
+  }
+
+  /**
+   * @brief read a file's content with several block reads in flight, and generate kmers, place in a vector as return result.
+   * @details each rank takes an even split of the file, and streams it in record aligned chunks with
+   *          ::bliss::io::async_posix_file::read_range_records.  a chunk is parsed while the next blocks load.
+   *          output is the same set of kmers as read_file_posix.
+   * @note    FASTQ only:  chunks are cut at record starts, and a FASTA sequence can span chunks.
+   * @param block_size    size of each read request.  should be much larger than a record.
+   * @param depth         number of read requests in flight.
+   */
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_async(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm, size_t const block_size = (32UL << 20), size_t const depth = 4) {
+
+      using CharIterType = typename ::bliss::io::file_data_view::const_iterator;
+      using range_type = typename ::bliss::io::file_data_view::range_type;
+      static_assert(::std::is_same<SeqParser<CharIterType>, ::bliss::io::FASTQParser<CharIterType> >::value,
+                    "read_file_async supports FASTQParser only.");
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      // file extension determines SeqParserType
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if (extension.compare("fastq") != 0) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+
+      BL_BENCH_INIT(file);
+
+      BL_BENCH_START(file);
+      // a read or parse failure is reduced before the next collective, so that all ranks throw together.
+      ::std::string error;
+      size_t chunks = 0;
+      try {
+        ::bliss::io::async_posix_file fobj(filename);
+        fobj.set_block_size(block_size, depth);
+        range_type parent(0, fobj.size());
+
+        ::bliss::partition::BlockPartitioner<range_type> partitioner;
+        partitioner.configure(parent, _comm.size());
+
+        fobj.template read_range_records<::bliss::io::SequentialFASTQParser<unsigned char const *> >(partitioner.getNext(_comm.rank()),
+            [&read, &result, &parent, &chunks](range_type const & chunk, unsigned char const * data) {
+          // chunk starts at a record, so the FASTQ parser needs no initialization.
+          ::bliss::io::file_data_view view;
+          view.parent_range_bytes = parent;
+          view.in_mem_range_bytes = chunk;
+          view.valid_range_bytes = chunk;
+          view.data = data;
+
+          SeqParser<CharIterType> seq_parser;
+          ::std::pair<size_t, size_t> chunk_read = read_block_old<KmerParser, SeqParser, SeqIterType>(view, seq_parser, result);
+          read.first += chunk_read.first;
+          read.second += chunk_read.second;
+          ++chunks;
+        });
+      } catch (::std::exception const & e) {
+        error = e.what();
+      }
+      int failed = ::mxx::allreduce(error.empty() ? 0 : 1, _comm);
+      if (failed > 0) {
+        ::std::stringstream ss;
+        ss << "ERROR : bliss::io::KmerFileHelper::read_file_async: " << failed << " rank(s) failed to read [" << filename << "]";
+        if (!error.empty()) ss << ".  rank " << _comm.rank() << ": " << error;
+        throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+      }
+      BL_BENCH_END(file, "read_kmers", chunks);
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_async", _comm);
+      return read;
+  }
+
+  /**
+   * @brief read a file's content with one reader per node, and generate kmers, place in a vector as return result.
+   * @details node leaders read the node's partition into shared memory, and all ranks parse views of it.
+   *          see ::bliss::io::parallel::node_shared_file.
+   * @tparam FileReader   sequential reader for the node leaders, e.g. posix_file or mmap_file
+   */
+  template <typename FileReader, typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static  ::std::pair<size_t, size_t> read_file_node_shared(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      ::std::pair<size_t, size_t> read = {0, 0};
+
+      constexpr int kmer_size = KmerParser::window_size;
+
+      // file extension determines SeqParserType
+      std::string extension = ::bliss::utils::file::get_file_extension(filename);
+      std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+      if ((extension.compare("fastq") != 0) && (extension.compare("fasta") != 0) && (extension.compare("fa") != 0)) {
+        throw std::invalid_argument("input filename extension is not supported.");
+      }
+
+      BL_BENCH_INIT(file);
+      {  // ensure that the shared memory is released at the end.
+
+        BL_BENCH_START(file);
+        ::bliss::io::parallel::node_shared_file<FileReader, SeqParser> fobj(filename, kmer_size - 1, _comm);
+        ::bliss::io::file_data_view partition = fobj.read_file();
+        BL_BENCH_END(file, "open", partition.getRange().size());
+
+        BL_BENCH_START(file);
+        read = parse_file_data_old<KmerParser, SeqParser, SeqIterType>(partition, result, fobj.get_comm());
+        BL_BENCH_END(file, "read_kmers", read.second);
+      }
+
+      BL_BENCH_REPORT_MPI_NAMED(file, "io:read_file_node_shared", _comm);
+      return read;
+  }
+
+  /// read a file with one posix reader per node.  see read_file_node_shared
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_node_shared_posix(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      return read_file_node_shared<::bliss::io::posix_file, KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
+  }
+
+  /// read a file with one mmap reader per node.  see read_file_node_shared
+  template <typename KmerParser, template <typename> class SeqParser, template <typename,  template <typename> class> class SeqIterType>
+  static ::std::pair<size_t, size_t> read_file_node_shared_mmap(const std::string & filename,
+                         std::vector<typename KmerParser::value_type>& result,
+                         const mxx::comm & _comm) {
+
+      return read_file_node_shared<::bliss::io::mmap_file, KmerParser, SeqParser, SeqIterType>(filename, result, _comm);
+  }
 #endif
 
 
@@ -60,11 +60,13 @@
 #include "io/sequence_iterator.hpp"
 #include "io/sequence_id_iterator.hpp"
 #include "iterators/transform_iterator.hpp"
+#include "iterators/filter_iterator.hpp"
 #include "common/kmer_iterators.hpp"
 #include "iterators/zip_iterator.hpp"
 #include "iterators/unzip_iterator.hpp"
 #include "iterators/constant_iterator.hpp"
 #include "index/quality_score_iterator.hpp"
+#include "index/quality_score_block.hpp"
 #include "containers/fsc_container_utils.hpp"
 
 namespace bliss
@@ -619,10 +621,10 @@ protected:
   using IdIter = bliss::iterator::AdvancingUnzipIterator<CharPosIter<SeqType>, 1>;
 
 
-  // also remove eol from quality score
+  // quality scores of all kmers in a read are computed as a block.  the iterator shares ownership of the block.
+  using QualBlockType = ::bliss::index::QualityScoreBlock<kmer_type::size, QualityEncoder<QualType> >;
   template <typename SeqType>
-  using QualIterType =
-      bliss::index::QualityScoreGenerationIterator<NonEOLIter<typename SeqType::IteratorType>, kmer_type::size, QualityEncoder<QualType> >;
+  using QualIterType = ::bliss::index::QualityScoreBlockIterator<QualBlockType>;
 
   /// combine kmer iterator and position iterator to create an index iterator type.
   template <typename SeqType>
@@ -631,6 +633,9 @@ protected:
 
   ::bliss::partition::range<size_t> valid_range;
 
+  /// block for the next read.  reused when no iterator from an earlier begin() holds it.
+  mutable std::shared_ptr<QualBlockType> qual_block;
+
 public:
   template <typename SeqType>
   using iterator_type = bliss::iterator::ZipIterator<KmerIter<SeqType>, KmerInfoIterType<SeqType> >;
@@ -638,6 +643,15 @@ public:
 
   KmerPositionQualityTupleParser(::bliss::partition::range<size_t> const & _valid_range) : valid_range(_valid_range) {};
 
+  /// copies get their own block, else the shared block would never be reused.
+  KmerPositionQualityTupleParser(KmerPositionQualityTupleParser const & other) : valid_range(other.valid_range) {};
+
+  KmerPositionQualityTupleParser & operator=(KmerPositionQualityTupleParser const & other) {
+    valid_range = other.valid_range;
+    qual_block.reset();
+    return *this;
+  }
+
   template <typename SeqType>
   iterator_type<SeqType> begin(SeqType const & read, size_t const & window = window_size) const {
 	    static_assert(SeqType::has_quality(), "Sequence Parser needs to support quality scores");
@@ -688,7 +702,10 @@ public:
         		  CharIter<SeqType>(neol, seq_begin, seq_end),
     			  bliss::common::ASCII2<Alphabet>()), true);
           //CharPosIter<SeqType> cp_begin(neol, pp_begin, pp_end);
-          QualIterType<SeqType> qual_start(CharIter<SeqType>(neol, qual_begin, qual_end));
+          // a block still held by an earlier read's iterators is left alone, so those iterators stay valid.
+          if (!qual_block || (qual_block.use_count() > 1)) qual_block = std::make_shared<QualBlockType>();
+          qual_block->compute(CharIter<SeqType>(neol, qual_begin, qual_end), CharIter<SeqType>(neol, qual_end));
+          QualIterType<SeqType> qual_start(qual_block);
           KmerInfoIterType<SeqType> info_start(IdIter<SeqType>(std::make_shared<CharPosIter<SeqType> >(neol, pp_begin, pp_end) ), qual_start);
     	  return iterator_type<SeqType>(start, info_start);
       } else {
@@ -696,7 +713,7 @@ public:
         		  CharIter<SeqType>(neol, seq_end),
     			  bliss::common::ASCII2<Alphabet>()), false);
 //          CharPosIter<SeqType> cp_end(neol, pp_end);
-          QualIterType<SeqType> qual_end_iter(CharIter<SeqType>(neol, qual_end));
+          QualIterType<SeqType> qual_end_iter;
           KmerInfoIterType<SeqType> info_end(IdIter<SeqType>(std::make_shared<CharPosIter<SeqType> >(neol, pp_end)), qual_end_iter);
           return iterator_type<SeqType>(end, info_end);
       }
@@ -727,10 +744,6 @@ public:
       std::tie(seq_begin, seq_end, has_window) =
     		  ::bliss::index::kmer::KmerParser<kmer_type>::get_valid_iterator_range(read, valid_range, window);
 
-      typename SeqType::IteratorType qual_end = read.qual_begin;
-      std::advance(qual_end, std::distance(read.seq_begin, seq_end));
-
-
       //== set up the kmer generating iterators.
       bliss::utils::file::NotEOL neol;
       KmerIter<SeqType> end(BaseCharIterator<SeqType>(CharIter<SeqType>(neol, seq_end), bliss::common::ASCII2<Alphabet>()), false);
@@ -748,8 +761,8 @@ public:
 //      CharPosIter<SeqType> cp_end(neol, pp_end);
 
       // ==== quality scoring
-      // filter eol and generate quality scores
-      QualIterType<SeqType> qual_end_iter(CharIter<SeqType>(neol, qual_end));
+      // only the kmer iterator is compared for end, so the quality iterator needs no block.
+      QualIterType<SeqType> qual_end_iter;
 
       KmerInfoIterType<SeqType> info_end(IdIter<SeqType>(std::make_shared<CharPosIter<SeqType> >(neol, pp_end)), qual_end_iter);
 
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    packed_read_store.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   in-memory store of a rank's parsed sequences, bit packed in the kmer alphabet.
+ * @details sequences are packed once during the first parse of the file, and subsequent passes
+ *          (solid kmer filtering, query after build, graph construction) regenerate kmers from the
+ *          packed words directly, without touching the file or the sequence parser again.
+ *
+ *          each rank stores only the sequence characters that its KmerParser would have used,
+ *          i.e. trimmed to the valid range plus k-1 overlap, so the kmers generated from the
+ *          stores on all ranks are exactly the kmers generated by the original parse.
+ *
+ *          layout is the same as PackedStringImpl:  characters are packed LSB first into
+ *          consecutive words, with no padding between sequences.  an offsets array, in characters,
+ *          delimits the sequences.  quality scores, if kept, are quantized to bins of
+ *          quality_bin phred values and stored as ascii, one byte per base.
+ */
+#ifndef PACKED_READ_STORE_HPP_
+#define PACKED_READ_STORE_HPP_
+
+#include <vector>
+#include <tuple>
+#include <iterator>
+#include <type_traits>
+#include <stdexcept>
+
+#include "common/alphabet_traits.hpp"
+#include "common/base_types.hpp"
+#include "partition/range.hpp"
+#include "utils/file_utils.hpp"
+#include "io/kmer_parser.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    /**
+     * @brief  read store that accepts and ignores sequences.  used when the caller does not keep the parsed reads.
+     */
+    struct no_read_store {
+        template <typename SeqType>
+        void insert(SeqType const &, ::bliss::partition::range<size_t> const &) {}
+    };
+
+    /**
+     * @brief  bit packed store of a rank's sequences, for regenerating kmers without re-reading the file.
+     * @tparam KmerType   kmer type to be generated.  determines the alphabet, the bits per character,
+     *                    and the window size used to trim sequences at the partition boundaries.
+     * @tparam WordType   storage word type.
+     */
+    template <typename KmerType, typename WordType = ::WordType>
+    class packed_read_store {
+
+      public:
+        using kmer_type = KmerType;
+        using word_type = WordType;
+        using Alphabet = typename KmerType::KmerAlphabet;
+
+        /// kmer size.  sequences are trimmed with this window at the partition boundaries.
+        static constexpr size_t window_size = KmerType::size;
+        static constexpr unsigned int bits_per_char = ::bliss::common::AlphabetTraits<Alphabet>::getBitsPerChar();
+        static constexpr unsigned int chars_per_word = (sizeof(WordType) * 8) / bits_per_char;
+
+        /// lowest quality score character (phred 0 in sanger/illumina 1.8 encoding).  quality bins are aligned to this.
+        static constexpr unsigned char min_quality_char = 33;
+
+      protected:
+        static constexpr WordType char_mask = static_cast<WordType>(~(~static_cast<WordType>(0) << bits_per_char));
+
+        /// packed characters of all sequences, back to back.
+        std::vector<WordType> words;
+
+        /// character offset of the start of each sequence, with the total character count appended.
+        std::vector<size_t> offsets;
+
+        /// quantized quality scores, one per character.  empty if quality is not kept.
+        std::vector<unsigned char> qualities;
+
+        /// whether quality scores are kept for sequences that have them.
+        bool keep_quality;
+
+        /// width of the quality score bins, in phred units.
+        unsigned char quality_bin;
+
+        /// append 1 alphabet value to the packed words.
+        inline void push_char(uint8_t c) {
+          size_t pos = offsets.back() % chars_per_word;
+          if (pos == 0) words.push_back(0);
+          words.back() |= (static_cast<WordType>(c) & char_mask) << (pos * bits_per_char);
+          ++offsets.back();
+        }
+
+        /// quality is not available for this sequence type.
+        template <typename SeqType, typename Iter>
+        void insert_quality(SeqType const &, Iter, Iter, std::false_type) {}
+
+        /// store the quantized quality scores corresponding to [seq_begin, seq_end)
+        template <typename SeqType, typename Iter>
+        void insert_quality(SeqType const & read, Iter seq_begin, Iter seq_end, std::true_type) {
+          if (!keep_quality || (read.qual_begin == read.qual_end)) return;
+
+          // align with the start of this sequence, in case earlier sequences had no quality.
+          qualities.resize(offsets[offsets.size() - 2], min_quality_char);
+
+          Iter q = read.qual_begin;
+          std::advance(q, std::distance(read.seq_begin, seq_begin));
+
+          ::bliss::utils::file::NotEOL neol;
+          for (Iter it = seq_begin; it != seq_end; ++it) {
+            if (!neol(*it)) continue;
+            while ((q != read.qual_end) && !neol(*q)) ++q;
+
+            unsigned char v = (q == read.qual_end) ? min_quality_char : static_cast<unsigned char>(*q);
+            qualities.push_back(quantize(v));
+
+            if (q != read.qual_end) ++q;
+          }
+        }
+
+      public:
+        /**
+         * @brief  construct an empty store.
+         * @param _keep_quality   keep quantized quality scores for sequences that have them.
+         * @param _quality_bin    width of the quality bins, in phred units.  1 keeps the scores exactly.
+         */
+        packed_read_store(bool _keep_quality = false, unsigned char _quality_bin = 4) :
+          offsets(1, 0), keep_quality(_keep_quality), quality_bin(_quality_bin) {
+          if (quality_bin == 0) throw std::invalid_argument("quality bin width needs to be at least 1.");
+        }
+
+        /// quantize a quality score character to the lower bound of its bin.
+        inline unsigned char quantize(unsigned char q) const {
+          if (q < min_quality_char) return min_quality_char;
+          return min_quality_char + ((q - min_quality_char) / quality_bin) * quality_bin;
+        }
+
+        /// remove all sequences.
+        void clear() {
+          words.clear();
+          offsets.clear();
+          offsets.push_back(0);
+          qualities.clear();
+        }
+
+        /// reserve space for the specified number of sequences and characters.
+        void reserve(size_t nseqs, size_t nchars) {
+          offsets.reserve(nseqs + 1);
+          words.reserve((nchars + chars_per_word - 1) / chars_per_word);
+          if (keep_quality) qualities.reserve(nchars);
+        }
+
+        /**
+         * @brief  pack one parsed sequence.  only the part used by KmerParser for the given valid range is kept.
+         * @param read          sequence from a SequencesIterator.
+         * @param valid_range   valid range of the partition the sequence came from.
+         */
+        template <typename SeqType>
+        void insert(SeqType const & read, ::bliss::partition::range<size_t> const & valid_range) {
+          typename SeqType::IteratorType seq_begin;
+          typename SeqType::IteratorType seq_end;
+          bool has_window = false;
+
+          std::tie(seq_begin, seq_end, has_window) =
+              ::bliss::index::kmer::KmerParser<KmerType>::get_valid_iterator_range(read, valid_range, window_size);
+          if (seq_begin == seq_end) return;
+
+          size_t before = offsets.back();
+          offsets.push_back(before);
+
+          ::bliss::utils::file::NotEOL neol;
+          for (auto it = seq_begin; it != seq_end; ++it) {
+            if (neol(*it)) push_char(Alphabet::FROM_ASCII[static_cast<size_t>(static_cast<unsigned char>(*it))]);
+          }
+
+          insert_quality(read, seq_begin, seq_end, std::integral_constant<bool, SeqType::has_quality()>());
+
+          // quality is either kept for all sequences or for none, so that offsets index into it as well.
+          if (!qualities.empty() && (qualities.size() != offsets.back()))
+            qualities.resize(offsets.back(), min_quality_char);
+        }
+
+        /// append one sequence given directly as alphabet values, e.g. an assembled contig.
+        template <typename Iter>
+        void insert_values(Iter first, Iter last) {
+          offsets.push_back(offsets.back());
+          for (; first != last; ++first) push_char(static_cast<uint8_t>(*first));
+
+          if (!qualities.empty()) qualities.resize(offsets.back(), min_quality_char);
+        }
+
+        /// number of sequences stored on this rank
+        size_t size() const {
+          return offsets.size() - 1;
+        }
+
+        /// number of characters stored on this rank
+        size_t bases() const {
+          return offsets.back();
+        }
+
+        /// length of the i-th sequence
+        size_t seq_size(size_t i) const {
+          return offsets[i + 1] - offsets[i];
+        }
+
+        /// whether quality scores are stored.
+        bool has_quality() const {
+          return !qualities.empty();
+        }
+
+        /// bytes used by the packed characters, offsets, and qualities.
+        size_t memory_usage() const {
+          return words.size() * sizeof(WordType) + offsets.size() * sizeof(size_t) + qualities.size();
+        }
+
+        /// alphabet value of the j-th character of the i-th sequence
+        uint8_t get(size_t i, size_t j) const {
+          size_t pos = offsets[i] + j;
+          return static_cast<uint8_t>((words[pos / chars_per_word] >> ((pos % chars_per_word) * bits_per_char)) & char_mask);
+        }
+
+        /// unpack the i-th sequence as alphabet values.
+        template <typename OutputIt>
+        OutputIt unpack(size_t i, OutputIt output_iter) const {
+          for (size_t j = 0; j < seq_size(i); ++j, ++output_iter) {
+            *output_iter = get(i, j);
+          }
+          return output_iter;
+        }
+
+        /// quantized quality score characters of the i-th sequence.  empty range if quality is not kept.
+        std::pair<const unsigned char *, const unsigned char *> quality(size_t i) const {
+          if (qualities.empty()) return std::make_pair(nullptr, nullptr);
+          return std::make_pair(qualities.data() + offsets[i], qualities.data() + offsets[i + 1]);
+        }
+
+        /**
+         * @brief  generate the kmers of the i-th sequence directly from the packed words.
+         * @return new position for output_iter
+         */
+        template <typename OutputIt>
+        OutputIt get_kmers(size_t i, OutputIt output_iter) const {
+          size_t pos = offsets[i];
+          size_t end = offsets[i + 1];
+          if ((end - pos) < window_size) return output_iter;
+
+          KmerType kmer;
+          size_t w = pos / chars_per_word;
+          unsigned int c = pos % chars_per_word;
+          WordType word = words[w] >> (c * bits_per_char);
+
+          for (size_t n = 1; pos < end; ++pos, ++n) {
+            kmer.nextFromChar(static_cast<unsigned char>(word & char_mask));
+            word >>= bits_per_char;
+
+            // next word.
+            if ((++c == chars_per_word) && (pos + 1 < end)) {
+              c = 0;
+              word = words[++w];
+            }
+
+            if (n >= window_size) {
+              *output_iter = kmer;
+              ++output_iter;
+            }
+          }
+          return output_iter;
+        }
+
+        /**
+         * @brief  generate the kmers of all stored sequences, appended to result.
+         * @return number of kmers generated.
+         */
+        size_t get_kmers(std::vector<KmerType> & result) const {
+          size_t before = result.size();
+
+          size_t count = 0;
+          for (size_t i = 0; i < size(); ++i) {
+            if (seq_size(i) >= window_size) count += seq_size(i) - window_size + 1;
+          }
+          result.reserve(before + count);
+
+          auto inserter = std::back_inserter(result);
+          for (size_t i = 0; i < size(); ++i) {
+            inserter = get_kmers(i, inserter);
+          }
+          return result.size() - before;
+        }
+    };
+
+    template <typename KmerType, typename WordType>
+    constexpr size_t packed_read_store<KmerType, WordType>::window_size;
+    template <typename KmerType, typename WordType>
+    constexpr unsigned int packed_read_store<KmerType, WordType>::bits_per_char;
+    template <typename KmerType, typename WordType>
+    constexpr unsigned int packed_read_store<KmerType, WordType>::chars_per_word;
+    template <typename KmerType, typename WordType>
+    constexpr unsigned char packed_read_store<KmerType, WordType>::min_quality_char;
+    template <typename KmerType, typename WordType>
+    constexpr WordType packed_read_store<KmerType, WordType>::char_mask;
+
+  } /* namespace io */
+} /* namespace bliss */
+
+#endif /* PACKED_READ_STORE_HPP_ */
@@ -0,0 +1,376 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    read_simulator.hpp
+ * @ingroup io
+ * @author  tpan
+ * @brief   reproducible synthetic genome and FASTQ/FASTA reads, written in parallel via MPI-IO.
+ * @details the genome is never materialized.  each base is a function of (seed, position), so any rank can
+ *          compute any part of it:
+ *            the genome is tiled into slots of repeat_length bases.  a slot is a repeat copy with probability
+ *            repeat_fraction, and then holds 1 of F repeat families, with F chosen so that each family has
+ *            about repeat_copies copies.  each base of a repeat copy mutates with probability repeat_divergence.
+ *            all other bases are uniform random.
+ *
+ *          read i is likewise a function of (seed, i):  a uniform start position and strand, then per base,
+ *          N with probability n_rate, else a substitution with probability error_rate.  num_reads() is
+ *          coverage * genome_size / read_length.  the header records the origin, "@<id> <start><strand>".
+ *
+ *          ids and positions are zero padded, so all records have the same length and read i starts at byte
+ *          i * record_bytes().  each rank writes a contiguous block of reads at that offset with collective
+ *          MPI-IO writes, in bounded size batches.  the file content depends only on the parameters,
+ *          not on the number of ranks.
+ */
+#ifndef READ_SIMULATOR_HPP_
+#define READ_SIMULATOR_HPP_
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mpi.h"
+#endif
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#if defined(USE_MPI)
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+#endif
+
+#include "io/io_exception.hpp"
+#include "utils/exception_handling.hpp"
+
+namespace bliss
+{
+  namespace io
+  {
+
+    /// parameters of the synthetic genome and reads.
+    struct read_sim_params {
+        /// genome length in bases
+        size_t genome_size = 1000000;
+        /// expected fraction of the genome in repeat copies
+        double repeat_fraction = 0.0;
+        /// length of a repeat copy
+        size_t repeat_length = 1000;
+        /// expected number of copies per repeat family
+        size_t repeat_copies = 10;
+        /// per base mutation probability of a repeat copy relative to its family
+        double repeat_divergence = 0.0;
+
+        /// mean read depth
+        double coverage = 10.0;
+        size_t read_length = 100;
+        /// per base substitution probability
+        double error_rate = 0.01;
+        /// per base probability of an N
+        double n_rate = 0.0;
+
+        uint64_t seed = 42;
+        /// FASTQ if true, else FASTA (1 line per sequence)
+        bool fastq = true;
+    };
+
+
+    /**
+     * @brief  synthetic genome and reads, see file description.
+     */
+    class read_simulator {
+
+      protected:
+        read_sim_params params;
+
+        /// independent seeds for the genome, the repeat slots, the repeat families, the repeat mutations, and the reads.
+        uint64_t genome_seed;
+        uint64_t slot_seed;
+        uint64_t family_seed;
+        uint64_t mutation_seed;
+        uint64_t read_seed;
+
+        size_t families;
+        size_t n_reads;
+
+        /// digits of the zero padded id and position fields
+        size_t id_digits;
+        size_t pos_digits;
+
+        /// phred + 33 quality of a called base
+        char quality;
+
+        static inline char base(uint8_t c) {
+          return "ACGT"[c];
+        }
+
+        /// splitmix64 finalizer
+        static inline uint64_t mix(uint64_t x) {
+          x += 0x9E3779B97F4A7C15ULL;
+          x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+          x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+          return x ^ (x >> 31);
+        }
+
+        /// uniform in [0, 1), from the top 53 bits.
+        static inline double unit(uint64_t x) {
+          return static_cast<double>(x >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        /// splitmix64 stream for 1 read.
+        struct stream {
+            uint64_t state;
+            inline uint64_t operator()() {
+              state += 0x9E3779B97F4A7C15ULL;
+              uint64_t x = state;
+              x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+              x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+              return x ^ (x >> 31);
+            }
+        };
+
+        static size_t digits(size_t x) {
+          size_t d = 1;
+          while (x >= 10) {
+            x /= 10;
+            ++d;
+          }
+          return d;
+        }
+
+        static void append_padded(std::string & out, size_t x, size_t width) {
+          size_t pos = out.size();
+          out.append(width, '0');
+          for (size_t i = 0; i < width && x > 0; ++i, x /= 10) {
+            out[pos + width - 1 - i] = '0' + static_cast<char>(x % 10);
+          }
+        }
+
+      public:
+        read_simulator(read_sim_params const & _params) : params(_params) {
+          if (params.read_length == 0) throw std::invalid_argument("read_simulator: read length must be positive.");
+          if (params.genome_size < params.read_length) throw std::invalid_argument("read_simulator: genome is shorter than a read.");
+          if (params.repeat_length == 0 || params.repeat_copies == 0)
+            throw std::invalid_argument("read_simulator: repeat length and copies must be positive.");
+          if (params.repeat_fraction < 0.0 || params.repeat_fraction > 1.0 ||
+              params.repeat_divergence < 0.0 || params.repeat_divergence > 1.0 ||
+              params.error_rate < 0.0 || params.n_rate < 0.0 || (params.error_rate + params.n_rate) > 1.0)
+            throw std::invalid_argument("read_simulator: rates must be in [0, 1].");
+          if (params.coverage < 0.0) throw std::invalid_argument("read_simulator: coverage must not be negative.");
+
+          genome_seed = mix(params.seed);
+          slot_seed = mix(genome_seed);
+          family_seed = mix(slot_seed);
+          mutation_seed = mix(family_seed);
+          read_seed = mix(mutation_seed);
+
+          double copies = params.repeat_fraction * static_cast<double>(params.genome_size) / static_cast<double>(params.repeat_length);
+          families = std::max(static_cast<size_t>(1), static_cast<size_t>(copies / static_cast<double>(params.repeat_copies)));
+
+          n_reads = static_cast<size_t>(std::ceil(params.coverage * static_cast<double>(params.genome_size) /
+                                                  static_cast<double>(params.read_length)));
+
+          id_digits = digits(n_reads == 0 ? 0 : n_reads - 1);
+          pos_digits = digits(params.genome_size - params.read_length);
+
+          double q = (params.error_rate > 0.0) ? -10.0 * std::log10(params.error_rate) : 40.0;
+          quality = static_cast<char>(33 + std::max(2, std::min(40, static_cast<int>(std::lround(q)))));
+        }
+
+        read_sim_params const & get_params() const {
+          return params;
+        }
+
+        /// total number of reads.
+        inline size_t num_reads() const {
+          return n_reads;
+        }
+
+        /// bytes per record, including the newlines.
+        inline size_t record_bytes() const {
+          // header:  marker, id, space, position, strand, newline.  sequence and newline.
+          size_t bytes = 1 + id_digits + 1 + pos_digits + 1 + 1 + params.read_length + 1;
+          // separator line, qualities and newline.
+          if (params.fastq) bytes += 2 + params.read_length + 1;
+          return bytes;
+        }
+
+        /// whether the base at pos is in a repeat copy.
+        inline bool is_repeat(size_t pos) const {
+          return (params.repeat_fraction > 0.0) &&
+              (unit(mix(slot_seed ^ (pos / params.repeat_length))) < params.repeat_fraction);
+        }
+
+        /// 2 bit code of the genome base at pos.
+        inline uint8_t genome_code(size_t pos) const {
+          uint64_t h;
+          if (params.repeat_fraction > 0.0) {
+            size_t slot = pos / params.repeat_length;
+            h = mix(slot_seed ^ slot);
+            if (unit(h) < params.repeat_fraction) {
+              // base of the family, at the same offset.
+              size_t family = (h & 0x7FFFFFFFULL) % families;
+              size_t offset = family * params.repeat_length + (pos - slot * params.repeat_length);
+              uint8_t c = (mix(family_seed + (offset >> 5)) >> ((offset & 31) << 1)) & 0x3;
+              if (params.repeat_divergence > 0.0) {
+                uint64_t m = mix(mutation_seed ^ pos);
+                if (unit(m) < params.repeat_divergence) c = (c + 1 + (m & 0xFF) % 3) & 0x3;
+              }
+              return c;
+            }
+          }
+          return (mix(genome_seed + (pos >> 5)) >> ((pos & 31) << 1)) & 0x3;
+        }
+
+        /// genome bases [start, start + len).
+        std::string genome(size_t start, size_t len) const {
+          if (start + len > params.genome_size) throw std::invalid_argument("read_simulator: genome range out of bounds.");
+          std::string out(len, 'A');
+          for (size_t i = 0; i < len; ++i) out[i] = base(genome_code(start + i));
+          return out;
+        }
+
+        /**
+         * @brief  read id's origin, sequence and qualities.
+         * @param[out] reverse  true if the read is the reverse complement of the genome at start.
+         */
+        void read(size_t id, size_t & start, bool & reverse, std::string & seq, std::string & qual) const {
+          stream rng{read_seed ^ mix(id)};
+          start = rng() % (params.genome_size - params.read_length + 1);
+          reverse = (rng() & 1) != 0;
+
+          seq.resize(params.read_length);
+          qual.assign(params.read_length, quality);
+          for (size_t i = 0; i < params.read_length; ++i) {
+            uint8_t c = reverse ? (0x3 - genome_code(start + params.read_length - 1 - i)) : genome_code(start + i);
+
+            double u = unit(rng());
+            if (u < params.n_rate) {
+              seq[i] = 'N';
+              qual[i] = '#';
+            } else {
+              if (u < params.n_rate + params.error_rate) c = (c + 1 + rng() % 3) & 0x3;
+              seq[i] = base(c);
+            }
+          }
+        }
+
+        /// append the record of read id.
+        void append_record(size_t id, std::string & out) const {
+          size_t start;
+          bool reverse;
+          std::string seq, qual;
+          read(id, start, reverse, seq, qual);
+
+          out.push_back(params.fastq ? '@' : '>');
+          append_padded(out, id, id_digits);
+          out.push_back(' ');
+          append_padded(out, start, pos_digits);
+          out.push_back(reverse ? '-' : '+');
+          out.push_back('\n');
+          out.append(seq);
+          out.push_back('\n');
+          if (params.fastq) {
+            out.append("+\n");
+            out.append(qual);
+            out.push_back('\n');
+          }
+        }
+
+        /// records of reads [first, last).
+        std::string generate(size_t first, size_t last) const {
+          std::string out;
+          if (last <= first) return out;
+          out.reserve((last - first) * record_bytes());
+          for (size_t i = first; i < last; ++i) append_record(i, out);
+          return out;
+        }
+
+#if defined(USE_MPI)
+        /// this rank's block of reads, [first, last).
+        std::pair<size_t, size_t> local_range(::mxx::comm const & comm) const {
+          size_t p = comm.size();
+          size_t r = comm.rank();
+          size_t block = n_reads / p;
+          size_t rem = n_reads % p;
+          size_t first = r * block + std::min(r, rem);
+          return std::make_pair(first, first + block + (r < rem ? 1 : 0));
+        }
+
+        /**
+         * @brief  write all reads to filename, each rank generating and writing its block.  collective.
+         * @param batch_bytes  approximate bytes generated and written per collective write.
+         * @return the number of reads written by this rank.
+         */
+        size_t write(std::string const & filename, ::mxx::comm const & comm, size_t batch_bytes = (32UL << 20)) const {
+          std::pair<size_t, size_t> range = local_range(comm);
+          size_t rb = record_bytes();
+          size_t batch = std::max(static_cast<size_t>(1), std::min(batch_bytes, static_cast<size_t>(1UL << 30)) / rb);
+
+          size_t rounds = (range.second - range.first + batch - 1) / batch;
+          rounds = ::mxx::allreduce(rounds, [](size_t const & x, size_t const & y) { return std::max(x, y); }, comm);
+
+          // remove any previous content.
+          if (comm.rank() == 0) MPI_File_delete(const_cast<char *>(filename.c_str()), MPI_INFO_NULL);
+          comm.barrier();
+
+          MPI_File fh;
+          int res = MPI_File_open(comm, const_cast<char *>(filename.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+          if (res != MPI_SUCCESS) {
+            std::stringstream ss;
+            ss << "ERROR in read_simulator: rank " << comm.rank() << " unable to open " << filename << " for writing";
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+          }
+
+          // every rank joins every round, with an empty write once its block is done.
+          bool ok = true;
+          size_t first = range.first;
+          for (size_t i = 0; i < rounds; ++i) {
+            size_t last = std::min(first + batch, range.second);
+            std::string buffer = generate(first, last);
+
+            MPI_Status stat;
+            res = MPI_File_write_at_all(fh, static_cast<MPI_Offset>(first * rb),
+                                        const_cast<char *>(buffer.data()), static_cast<int>(buffer.size()), MPI_BYTE, &stat);
+            ok &= (res == MPI_SUCCESS);
+            first = last;
+          }
+
+          MPI_File_close(&fh);
+
+          // reduce, so that all ranks throw together.
+          int failed = ::mxx::allreduce(ok ? 0 : 1, comm);
+          if (failed > 0) {
+            std::stringstream ss;
+            ss << "ERROR in read_simulator: " << failed << " rank(s) unable to write reads to " << filename;
+            if (!ok) ss << ", including rank " << comm.rank();
+            throw ::bliss::utils::make_exception<::bliss::io::IOException>(ss.str());
+          }
+
+          return range.second - range.first;
+        }
+#endif
+    };
+
+  } /* namespace io */
+} /* namespace bliss */
+
+#endif /* READ_SIMULATOR_HPP_ */
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    distribute_bucket_test_fixture.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests of imxx::distribute without the input to output mapping, which buckets into an internal send buffer.
+ * @details included by mpi_test_distribute.cpp, and by mpi_test_distribute_huge_page.cpp with USE_HUGE_PAGE_BUFFERS
+ *          defined, so the send buffer comes from imxx::buffer_allocator of either kind.  the includer instantiates
+ *          DistributeBucketTest with the input sizes.
+ *
+ *          the output is checked against mxx::bucketing followed by mxx::all2allv, which is also stable, and the
+ *          recv counts against the source rank of each received entry.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/algos.hpp"
+#include "mxx/reduction.hpp"
+
+#include <cstdint>  // uint32_t
+#include <cstdlib>  // rand
+#include <utility>  // pair
+#include <vector>
+
+#include "io/incremental_mxx.hpp"
+
+
+class DistributeBucketTest : public ::testing::TestWithParam<size_t>
+{
+  protected:
+    using T = std::pair<size_t, int>;
+
+    /// random entries, tagged with the source rank.  none if empty.
+    std::vector<T> make_input(mxx::comm const & comm, bool empty) {
+      std::vector<T> data;
+      if (empty) return data;
+
+      srand((comm.rank() + 1) * (comm.rank() + 1) - 1);
+      size_t val;
+      for (size_t i = 0; i < GetParam(); ++i) {
+        val = rand();
+        val <<= 32;
+        val |= rand();
+        data.emplace_back(val, comm.rank());
+      }
+      return data;
+    }
+
+    /// distribute input with the 5 argument imxx::distribute, and check against mxx.
+    void check(std::vector<T> const & data, mxx::comm const & comm) {
+      int p = comm.size();
+      auto to_rank = [&p](T const & x) { return x.first % p; };
+
+      std::vector<T> gold(data);
+      if (::mxx::any_of(data.size() > 0, comm)) {
+        std::vector<size_t> send_counts = ::mxx::bucketing(gold, to_rank, p);
+        ::mxx::all2allv(gold, send_counts, comm).swap(gold);
+      }
+
+      std::vector<T> input(data);
+      std::vector<T> output;
+      std::vector<size_t> recv_counts;
+      imxx::distribute(input, to_rank, recv_counts, output, comm);
+
+      EXPECT_EQ(gold, output);
+      if (gold.size() == 0) return;   // all inputs were empty.  nothing is exchanged.
+
+      // 1 count per source rank, matching the received entries.
+      ASSERT_EQ(static_cast<size_t>(p), recv_counts.size());
+      size_t offset = 0;
+      for (int i = 0; i < p; ++i) {
+        for (size_t j = offset; j < offset + recv_counts[i] && j < output.size(); ++j) {
+          EXPECT_EQ(i, output[j].second);
+          EXPECT_EQ(static_cast<size_t>(comm.rank()), to_rank(output[j]));
+        }
+        offset += recv_counts[i];
+      }
+      EXPECT_EQ(output.size(), offset);
+
+      // nothing lost or duplicated.
+      EXPECT_EQ(::mxx::allreduce(data.size(), comm), ::mxx::allreduce(output.size(), comm));
+    }
+};
+
+
+TEST_P(DistributeBucketTest, distribute)
+{
+  ::mxx::comm comm;
+  this->check(this->make_input(comm, false), comm);
+}
+
+TEST_P(DistributeBucketTest, distribute_single_rank)
+{
+  ::mxx::comm comm(MPI_COMM_SELF);
+  this->check(this->make_input(comm, false), comm);
+}
+
+TEST_P(DistributeBucketTest, distribute_empty_rank)
+{
+  ::mxx::comm comm;
+  // rank 0 sends nothing, but still receives.
+  this->check(this->make_input(comm, comm.rank() == 0), comm);
+}
+
+#endif
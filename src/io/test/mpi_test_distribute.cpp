@@ -901,6 +901,17 @@ INSTANTIATE_TEST_CASE_P(Bliss, Distribute2PartTest, ::testing::Values(
 
 
 
+//=========================  DISTRIBUTE WITHOUT MAPPING TESTS.  see mpi_test_distribute_huge_page.cpp for the huge page buffers.
+
+#include "io/test/distribute_bucket_test_fixture.cpp"
+
+INSTANTIATE_TEST_CASE_P(Bliss, DistributeBucketTest, ::testing::Values(
+    0UL,            // boundary case
+    (1UL <<  8),
+    (1UL << 15),
+    (1UL << 16)
+));
+
 
 #endif
 
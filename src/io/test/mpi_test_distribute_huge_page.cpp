@@ -0,0 +1,92 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_distribute_huge_page.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests imxx::distribute without the input to output mapping, with the send buffer on huge pages.
+ * @details USE_HUGE_PAGE_BUFFERS is defined here regardless of the build option, so imxx::buffer_allocator is the
+ *          huge page allocator.  the larger inputs exceed its mmap threshold.  see distribute_bucket_test_fixture.cpp
+ */
+
+#if !defined(USE_HUGE_PAGE_BUFFERS)
+#define USE_HUGE_PAGE_BUFFERS
+#endif
+
+#include "io/test/distribute_bucket_test_fixture.cpp"
+
+#if defined(USE_MPI)
+
+#include <type_traits>
+
+static_assert(::std::is_same<::imxx::buffer_allocator<int>,
+              ::bliss::utils::huge_page_allocator<int, ::bliss::utils::numa_policy::local> >::value,
+              "the send buffer should be allocated on huge pages.");
+
+INSTANTIATE_TEST_CASE_P(Bliss, DistributeBucketTest, ::testing::Values(
+    0UL,            // boundary case
+    (1UL <<  8),    // below the mmap threshold
+    (1UL << 18),    // 4MB of entries
+    (1UL << 20)
+));
+
+TEST(DistributeHugePage, mapped)
+{
+  ::mxx::comm comm;
+  auto & stats = ::bliss::utils::huge_page_stats::get();
+
+  // large enough for a mapping.
+  std::vector<std::pair<size_t, int> > input((1UL << 18), std::make_pair(0UL, 0));
+  for (size_t i = 0; i < input.size(); ++i) input[i].first = i;
+  std::vector<std::pair<size_t, int> > output;
+  std::vector<size_t> recv_counts;
+
+  size_t n = input.size();
+  size_t mappings = stats.mappings.load();
+  size_t mapped = stats.mapped.load();
+  stats.peak.store(mapped);
+
+  int p = comm.size();
+  imxx::distribute(input, [&p](std::pair<size_t, int> const & x) { return x.first % p; }, recv_counts, output, comm);
+
+  // the send buffer was mapped, and released.
+  EXPECT_GE(stats.peak.load(), mapped + n * sizeof(std::pair<size_t, int>));
+  EXPECT_EQ(mappings, stats.mappings.load());
+  EXPECT_EQ(mapped, stats.mapped.load());
+  EXPECT_EQ(n * comm.size(), ::mxx::allreduce(output.size(), comm));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+#endif
+
+  return result;
+}
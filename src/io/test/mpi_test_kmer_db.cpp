@@ -0,0 +1,177 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_kmer_db.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test parallel export to the sorted binary kmer database, and random access lookup.
+ * @details each rank generates distinct kmers with known counts, exports collectively, then
+ *          looks up its own and absent kmers with the reader.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <cstdio>  // remove
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "io/kmer_db.hpp"
+
+#if defined(USE_MPI)
+
+template <typename KmerType>
+class KmerDBTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::pair<KmerType, uint32_t> > records;
+    std::string filename;
+
+    virtual void SetUp() {
+      ::mxx::comm comm;
+
+      // distinct kmers on each rank: kmers that this rank owns by a simple hash.
+      std::default_random_engine gen(13);
+      std::uniform_int_distribution<int> dist(0, KmerType::KmerAlphabet::SIZE - 1);
+      KmerType kmer;
+      for (size_t i = 0; i < 20000; ++i) {
+        kmer.nextFromChar(dist(gen));
+        if (i < KmerType::size) continue;
+        if ((kmer.getData()[0] * 0x9E3779B97F4A7C15ULL >> 40) % comm.size() != static_cast<size_t>(comm.rank())) continue;
+        records.emplace_back(kmer, static_cast<uint32_t>(i));
+      }
+      std::sort(records.begin(), records.end(), ::bliss::io::kmerdb::kmer_less<KmerType, uint32_t>());
+      records.erase(std::unique(records.begin(), records.end(),
+                                [](std::pair<KmerType, uint32_t> const & x, std::pair<KmerType, uint32_t> const & y){ return x.first == y.first; }),
+                    records.end());
+
+      filename = "kmer_db_test.bkdb";
+    }
+
+    void check(unsigned int prefix_bits, bool radix) {
+      ::mxx::comm comm;
+
+      std::vector<std::pair<KmerType, uint32_t> > input(records);
+      size_t total = ::bliss::io::write_kmer_db(filename, input, comm, prefix_bits, radix);
+      EXPECT_EQ(::mxx::allreduce(records.size(), comm), total);
+      comm.barrier();
+
+      ::bliss::io::kmer_db_reader<KmerType, uint32_t> reader(filename);
+      EXPECT_EQ(total, reader.size());
+      EXPECT_EQ(prefix_bits, reader.get_header().prefix_bits);
+
+      // globally sorted
+      if (comm.rank() == 0) {
+        for (size_t i = 1; i < reader.size(); ++i) {
+          EXPECT_FALSE(reader.get(i).first < reader.get(i - 1).first) << "record " << i;
+        }
+      }
+
+      // lookup every 7th local record, then a kmer that no rank has
+      for (size_t i = 0; i < records.size(); i += 7) {
+        auto found = reader.find(records[i].first);
+        ASSERT_EQ(1UL, found.size());
+        EXPECT_EQ(records[i].second, found[0]);
+      }
+
+      KmerType absent;
+      absent.nextFromChar(1);
+      bool exists = std::binary_search(records.begin(), records.end(), std::make_pair(absent, 0U),
+                                       ::bliss::io::kmerdb::kmer_less<KmerType, uint32_t>());
+      if (!::mxx::any_of(exists, comm)) {
+        EXPECT_EQ(0UL, reader.count(absent));
+      }
+
+      comm.barrier();
+      if (comm.rank() == 0) std::remove(filename.c_str());
+    }
+};
+
+// single word and multi word kmers.
+typedef ::testing::Types<
+    ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>,
+    ::bliss::common::Kmer<31, ::bliss::common::DNA5, uint16_t>,
+    ::bliss::common::Kmer<63, ::bliss::common::DNA, uint64_t>
+> KmerDBTestTypes;
+TYPED_TEST_CASE(KmerDBTest, KmerDBTestTypes);
+
+TYPED_TEST(KmerDBTest, radix)
+{
+  this->check(12, true);
+}
+
+TYPED_TEST(KmerDBTest, compare_sort)
+{
+  this->check(8, false);
+}
+
+TYPED_TEST(KmerDBTest, no_prefix)
+{
+  this->check(0, true);
+}
+
+TEST(KmerDB, type_mismatch)
+{
+  ::mxx::comm comm;
+  std::string filename("kmer_db_mismatch.bkdb");
+
+  std::vector<std::pair<::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>, uint32_t> > input;
+  ::bliss::io::write_kmer_db(filename, input, comm, 4, true);
+  comm.barrier();
+
+  using ReaderType = ::bliss::io::kmer_db_reader<::bliss::common::Kmer<23, ::bliss::common::DNA, uint64_t>, uint32_t>;
+  EXPECT_THROW(ReaderType reader(filename), std::invalid_argument);
+  using ReaderType2 = ::bliss::io::kmer_db_reader<::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>, uint64_t>;
+  EXPECT_THROW(ReaderType2 reader(filename), std::invalid_argument);
+
+  comm.barrier();
+  if (comm.rank() == 0) std::remove(filename.c_str());
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,375 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_kmer_file_helper.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test reading multiple files as one partitioned byte space, and demand driven and asynchronous block reading.
+ * @details kmers from read_files should be the same as reading each file separately, regardless of
+ *          where the rank boundaries fall relative to the file boundaries, and kmer positions carry the file's index.  kmers from read_file_demand
+ *          and read_file_node_shared should be the same as read_file, regardless of block size or ranks per node.
+ *          kmers from read_file_async should be the same as read_file_posix, regardless of block size or read depth.
+ */
+
+#include "bliss-config.hpp"    // for location of data.
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+#include "mxx/collective.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>   // remove
+#include <iterator>
+#include <algorithm>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/sequence_iterator.hpp"
+#include "utils/kmer_utils.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+using KmerParserType = ::bliss::index::kmer::KmerParser<KmerType>;
+
+class KmerFileHelperMultiFileTest : public ::testing::Test
+{
+  protected:
+    std::vector<std::string> filenames;
+
+    virtual void SetUp() {
+      const char * names[] = {"/test/data/test.small.fastq", "/test/data/test.unitiq1.fastq", "/test/data/test.medium.fastq", "/test/data/natural.fastq"};
+      for (auto n : names) {
+        std::string fn(PROJ_SRC_DIR);
+        fn.append(n);
+        filenames.push_back(fn);
+      }
+    }
+
+    /// order independent summary of the kmers across all ranks: count and sum of first words.
+    std::pair<size_t, uint64_t> summarize(std::vector<KmerType> const & kmers, ::mxx::comm const & comm) {
+      uint64_t sum = 0;
+      for (auto const & k : kmers) sum += k.getData()[0];
+      return std::make_pair(::mxx::allreduce(kmers.size(), comm), ::mxx::allreduce(sum, comm));
+    }
+
+    /// reference: read each file separately on the whole communicator.
+    std::pair<size_t, uint64_t> reference(::mxx::comm const & comm) {
+      std::vector<KmerType> kmers;
+      for (auto const & fn : filenames) {
+        ::bliss::io::KmerFileHelper::template read_file_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(fn, kmers, comm);
+      }
+      return summarize(kmers, comm);
+    }
+};
+
+
+TEST_F(KmerFileHelperMultiFileTest, read_files_posix)
+{
+  ::mxx::comm comm;
+  auto gold = reference(comm);
+
+  std::vector<KmerType> kmers;
+  ::bliss::io::KmerFileHelper::template read_files_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filenames, kmers, comm);
+  auto result = summarize(kmers, comm);
+
+  ASSERT_GT(gold.first, 0UL);
+  EXPECT_EQ(gold.first, result.first);
+  EXPECT_EQ(gold.second, result.second);
+}
+
+TEST_F(KmerFileHelperMultiFileTest, read_files_mmap)
+{
+  ::mxx::comm comm;
+  auto gold = reference(comm);
+
+  std::vector<KmerType> kmers;
+  ::bliss::io::KmerFileHelper::template read_files_mmap<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filenames, kmers, comm);
+  auto result = summarize(kmers, comm);
+
+  EXPECT_EQ(gold.first, result.first);
+  EXPECT_EQ(gold.second, result.second);
+}
+
+TEST_F(KmerFileHelperMultiFileTest, read_files_mpiio)
+{
+  ::mxx::comm comm;
+  auto gold = reference(comm);
+
+  std::vector<KmerType> kmers;
+  ::bliss::io::KmerFileHelper::template read_files_mpiio<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filenames, kmers, comm);
+  auto result = summarize(kmers, comm);
+
+  EXPECT_EQ(gold.first, result.first);
+  EXPECT_EQ(gold.second, result.second);
+}
+
+TEST_F(KmerFileHelperMultiFileTest, read_files_single)
+{
+  ::mxx::comm comm;
+
+  std::vector<KmerType> kmers;
+  ::bliss::io::KmerFileHelper::template read_file_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filenames[2], kmers, comm);
+  auto gold = summarize(kmers, comm);
+
+  kmers.clear();
+  ::bliss::io::KmerFileHelper::template read_files_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      std::vector<std::string>(1, filenames[2]), kmers, comm);
+  auto result = summarize(kmers, comm);
+
+  EXPECT_EQ(gold.first, result.first);
+  EXPECT_EQ(gold.second, result.second);
+}
+
+TEST_F(KmerFileHelperMultiFileTest, read_files_file_id)
+{
+  using TupleType = std::pair<KmerType, ::bliss::common::ShortSequenceKmerId>;
+  using PosParserType = ::bliss::index::kmer::KmerPositionTupleParser<TupleType>;
+
+  ::mxx::comm comm;
+
+  std::vector<TupleType> kmers;
+  ::bliss::io::KmerFileHelper::template read_files_posix<PosParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filenames, kmers, comm);
+
+  std::vector<std::string> contents;
+  for (auto const & fn : filenames) {
+    std::ifstream ifs(fn);
+    contents.emplace_back(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+  }
+
+  // each kmer is found at its position in the file with its id.
+  std::vector<size_t> counts(filenames.size(), 0);
+  for (auto const & t : kmers) {
+    size_t f = t.second.get_file_id();
+    ASSERT_LT(f, filenames.size());
+    ++counts[f];
+    ASSERT_LE(t.second.get_pos() + KmerType::size, contents[f].size());
+    EXPECT_EQ(contents[f].substr(t.second.get_pos(), KmerType::size), ::bliss::utils::KmerUtils::toASCIIString(t.first));
+  }
+
+  for (size_t i = 0; i < filenames.size(); ++i) {
+    size_t total = ::mxx::allreduce(counts[i], comm);
+    if (contents[i].size() > 0) EXPECT_GT(total, 0UL);
+  }
+}
+
+TEST_F(KmerFileHelperMultiFileTest, read_files_missing)
+{
+  ::mxx::comm comm;
+
+  // rank 0 stats the files.  all ranks should throw, instead of the others waiting for rank 0.
+  filenames.insert(filenames.begin() + 1, std::string(PROJ_SRC_DIR) + "/test/data/missing.fastq");
+  std::vector<KmerType> kmers;
+  EXPECT_THROW((::bliss::io::KmerFileHelper::template read_files_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filenames, kmers, comm)),
+               ::bliss::io::IOException);
+
+  // unsupported extension is rejected on all ranks before any communication.
+  EXPECT_THROW((::bliss::io::KmerFileHelper::template read_files_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      std::vector<std::string>(1, "reads.txt"), kmers, comm)), std::invalid_argument);
+}
+
+/// demand driven and node shared reading should produce the same kmers as reading the whole file, for any block size.
+class KmerFileHelperDemandTest : public ::testing::TestWithParam<std::string>
+{
+  protected:
+    /// order independent summary of the kmers across all ranks: count and sum of first words.
+    std::pair<size_t, uint64_t> summarize(std::vector<KmerType> const & kmers, ::mxx::comm const & comm) {
+      uint64_t sum = 0;
+      for (auto const & k : kmers) sum += k.getData()[0];
+      return std::make_pair(::mxx::allreduce(kmers.size(), comm), ::mxx::allreduce(sum, comm));
+    }
+
+    template <template <typename> class SeqParser>
+    void check(std::string const & filename, ::mxx::comm const & comm) {
+      // reference: each rank reads the whole file.
+      std::vector<KmerType> kmers;
+      ::bliss::io::KmerFileHelper::template read_file_posix<KmerParserType, SeqParser, ::bliss::io::SequencesIterator>(filename, kmers, ::mxx::comm(MPI_COMM_SELF));
+      std::pair<size_t, uint64_t> gold(kmers.size(), 0);
+      for (auto const & k : kmers) gold.second += k.getData()[0];
+      ASSERT_GT(gold.first, 0UL);
+
+      std::vector<size_t> block_sizes = {97, 1000, 4096, 1UL << 20};
+      for (auto bs : block_sizes) {
+        kmers.clear();
+        ::bliss::io::KmerFileHelper::template read_file_demand_posix<KmerParserType, SeqParser, ::bliss::io::SequencesIterator>(filename, kmers, comm, bs);
+        auto result = summarize(kmers, comm);
+
+        EXPECT_EQ(gold.first, result.first) << "block size " << bs;
+        EXPECT_EQ(gold.second, result.second) << "block size " << bs;
+      }
+
+      kmers.clear();
+      ::bliss::io::KmerFileHelper::template read_file_demand_mmap<KmerParserType, SeqParser, ::bliss::io::SequencesIterator>(filename, kmers, comm, 1000);
+      auto result = summarize(kmers, comm);
+      EXPECT_EQ(gold.first, result.first);
+      EXPECT_EQ(gold.second, result.second);
+    }
+
+    template <template <typename> class SeqParser>
+    void check_node_shared(std::string const & filename, ::mxx::comm const & comm) {
+      std::vector<KmerType> kmers;
+      ::bliss::io::KmerFileHelper::template read_file_posix<KmerParserType, SeqParser, ::bliss::io::SequencesIterator>(filename, kmers, ::mxx::comm(MPI_COMM_SELF));
+      std::pair<size_t, uint64_t> gold(kmers.size(), 0);
+      for (auto const & k : kmers) gold.second += k.getData()[0];
+
+      kmers.clear();
+      ::bliss::io::KmerFileHelper::template read_file_node_shared_posix<KmerParserType, SeqParser, ::bliss::io::SequencesIterator>(filename, kmers, comm);
+      auto result = summarize(kmers, comm);
+      EXPECT_EQ(gold.first, result.first);
+      EXPECT_EQ(gold.second, result.second);
+
+      kmers.clear();
+      ::bliss::io::KmerFileHelper::template read_file_node_shared_mmap<KmerParserType, SeqParser, ::bliss::io::SequencesIterator>(filename, kmers, comm);
+      result = summarize(kmers, comm);
+      EXPECT_EQ(gold.first, result.first);
+      EXPECT_EQ(gold.second, result.second);
+    }
+};
+
+TEST_P(KmerFileHelperDemandTest, read_file_demand)
+{
+  ::mxx::comm comm;
+
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+
+  if (filename.find(".fastq") != std::string::npos)
+    check<::bliss::io::FASTQParser>(filename, comm);
+  else
+    check<::bliss::io::FASTAParser>(filename, comm);
+}
+
+TEST_P(KmerFileHelperDemandTest, read_file_node_shared)
+{
+  ::mxx::comm comm;
+
+  std::string filename(PROJ_SRC_DIR);
+  filename.append(GetParam());
+
+  if (filename.find(".fastq") != std::string::npos)
+    check_node_shared<::bliss::io::FASTQParser>(filename, comm);
+  else
+    check_node_shared<::bliss::io::FASTAParser>(filename, comm);
+}
+
+TEST(KmerFileHelperDemandError, read_file_demand_malformed)
+{
+  ::mxx::comm comm;
+
+  // valid records, then a tail with no record start.  only the blocks in the tail fail, but all ranks should throw.
+  std::string filename("mpi_test_kmer_file_helper.malformed.fastq");
+  if (comm.rank() == 0) {
+    std::ifstream in(std::string(PROJ_SRC_DIR) + "/test/data/test.small.fastq");
+    std::ofstream out(filename);
+    out << in.rdbuf();
+    for (size_t i = 0; i < 2000; ++i) out << "ACGTACGTAC\n";
+  }
+  comm.barrier();
+
+  std::vector<KmerType> kmers;
+  EXPECT_THROW((::bliss::io::KmerFileHelper::template read_file_demand_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, kmers, comm, 1000)), ::bliss::io::IOException);
+
+  comm.barrier();
+  if (comm.rank() == 0) std::remove(filename.c_str());
+}
+
+TEST(KmerFileHelperDemandError, read_file_node_shared_missing)
+{
+  ::mxx::comm comm;
+
+  // the node leaders fail to open the file.  the other ranks should throw too, instead of waiting for the data.
+  std::string filename(PROJ_SRC_DIR);
+  filename.append("/test/data/does_not_exist.fastq");
+
+  std::vector<KmerType> kmers;
+  EXPECT_THROW((::bliss::io::KmerFileHelper::template read_file_node_shared_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+      filename, kmers, comm)), ::bliss::io::IOException);
+}
+
+TEST(KmerFileHelperAsyncTest, read_file_async)
+{
+  ::mxx::comm comm;
+
+  const char * names[] = {"/test/data/test.small.fastq", "/test/data/natural.fastq", "/test/data/test.medium.fastq"};
+  for (auto n : names) {
+    std::string filename(PROJ_SRC_DIR);
+    filename.append(n);
+
+    // reference: each rank reads the whole file.  sorted, so that rank boundaries do not matter.
+    std::vector<KmerType> gold;
+    ::bliss::io::KmerFileHelper::template read_file_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, gold, ::mxx::comm(MPI_COMM_SELF));
+    std::sort(gold.begin(), gold.end());
+    ASSERT_GT(gold.size(), 0UL);
+
+    // blocks much smaller than, close to, and larger than a rank's share.
+    std::vector<std::pair<size_t, size_t> > configs = {{1000, 1}, {1000, 4}, {4099, 3}, {1UL << 20, 4}};
+    for (auto const & c : configs) {
+      std::vector<KmerType> kmers;
+      auto read = ::bliss::io::KmerFileHelper::template read_file_async<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(
+          filename, kmers, comm, c.first, c.second);
+      EXPECT_EQ(kmers.size(), read.second);
+
+      kmers = ::mxx::allgatherv(kmers, comm);
+      std::sort(kmers.begin(), kmers.end());
+      EXPECT_EQ(gold.size(), kmers.size()) << n << " block size " << c.first << " depth " << c.second;
+      EXPECT_TRUE(gold == kmers) << n << " block size " << c.first << " depth " << c.second;
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, KmerFileHelperDemandTest, ::testing::Values(
+    std::string("/test/data/test.small.fastq"),
+    std::string("/test/data/natural.fastq"),
+    std::string("/test/data/test.medium.fastq"),
+    std::string("/test/data/test.fasta"),
+    std::string("/test/data/test2.fasta"),
+    std::string("/test/data/natural.fasta"),
+    std::string("/test/data/test.unitiqs.fasta")
+));
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
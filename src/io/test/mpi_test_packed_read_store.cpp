@@ -0,0 +1,169 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_packed_read_store.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test packing parsed sequences into a read store and regenerating kmers from it.
+ * @details kmers generated from the packed read store should be the same, in the same order, as
+ *          the kmers generated while parsing the file.
+ */
+
+#include "bliss-config.hpp"    // for location of data.
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <string>
+#include <vector>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/packed_read_store.hpp"
+#include "io/sequence_iterator.hpp"
+
+#if defined(USE_MPI)
+
+template <typename KmerType>
+class PackedReadStoreTest : public ::testing::TestWithParam<std::string>
+{
+  protected:
+    using KmerParserType = ::bliss::index::kmer::KmerParser<KmerType>;
+    using StoreType = ::bliss::io::packed_read_store<KmerType>;
+
+    template <template <typename> class SeqParser>
+    void check(std::string const & filename, ::mxx::comm const & comm, bool keep_quality) {
+      std::vector<KmerType> gold;
+      std::vector<KmerType> kmers;
+
+      StoreType store(keep_quality, 1);
+      ::bliss::io::KmerFileHelper::template read_file_posix<KmerParserType, SeqParser, ::bliss::io::SequencesIterator>(filename, gold, store, comm);
+      ASSERT_GT(::mxx::allreduce(gold.size(), comm), 0UL);
+
+      // stored characters should be at most the sequence characters in the file partition
+      EXPECT_LE(store.size(), store.bases());
+
+      size_t count = store.get_kmers(kmers);
+      EXPECT_EQ(gold.size(), count);
+      ASSERT_EQ(gold.size(), kmers.size());
+      for (size_t i = 0; i < gold.size(); ++i) {
+        EXPECT_EQ(gold[i], kmers[i]) << "kmer " << i;
+      }
+
+      if (keep_quality && ::std::is_same<SeqParser<char*>, ::bliss::io::FASTQParser<char*> >::value) {
+        EXPECT_TRUE(store.has_quality() || (store.size() == 0));
+        for (size_t i = 0; i < store.size(); ++i) {
+          auto q = store.quality(i);
+          EXPECT_EQ(store.seq_size(i), static_cast<size_t>(q.second - q.first));
+          for (; q.first != q.second; ++q.first) {
+            EXPECT_GE(*(q.first), 33);
+            EXPECT_LE(*(q.first), 126);
+          }
+        }
+      } else {
+        EXPECT_FALSE(store.has_quality());
+      }
+    }
+
+    void run(bool keep_quality) {
+      ::mxx::comm comm;
+
+      std::string filename(PROJ_SRC_DIR);
+      filename.append(this->GetParam());
+
+      if (filename.find(".fastq") != std::string::npos)
+        check<::bliss::io::FASTQParser>(filename, comm, keep_quality);
+      else
+        check<::bliss::io::FASTAParser>(filename, comm, keep_quality);
+    }
+};
+
+/// 2 bit packing, 1 word kmer
+class PackedReadStoreDNATest : public PackedReadStoreTest<::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t> > {};
+/// 4 bit packing, multi word kmer
+class PackedReadStoreDNA16Test : public PackedReadStoreTest<::bliss::common::Kmer<31, ::bliss::common::DNA16, uint32_t> > {};
+
+TEST_P(PackedReadStoreDNATest, kmers)
+{
+  this->run(false);
+}
+
+TEST_P(PackedReadStoreDNATest, kmers_with_quality)
+{
+  this->run(true);
+}
+
+TEST_P(PackedReadStoreDNA16Test, kmers)
+{
+  this->run(false);
+}
+
+INSTANTIATE_TEST_CASE_P(Bliss, PackedReadStoreDNATest, ::testing::Values(
+    std::string("/test/data/test.small.fastq"),
+    std::string("/test/data/natural.fastq"),
+    std::string("/test/data/test.fasta"),
+    std::string("/test/data/natural.fasta")
+));
+
+INSTANTIATE_TEST_CASE_P(Bliss, PackedReadStoreDNA16Test, ::testing::Values(
+    std::string("/test/data/test.small.fastq"),
+    std::string("/test/data/test2.fasta")
+));
+
+
+TEST(PackedReadStore, quantize)
+{
+  ::bliss::io::packed_read_store<::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t> > store(true, 8);
+
+  EXPECT_EQ(33, store.quantize(33));
+  EXPECT_EQ(33, store.quantize(40));
+  EXPECT_EQ(41, store.quantize(41));
+  EXPECT_EQ(41, store.quantize(48));
+  EXPECT_EQ(33, store.quantize(10));
+
+  EXPECT_THROW((::bliss::io::packed_read_store<::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t> >(true, 0)), std::invalid_argument);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
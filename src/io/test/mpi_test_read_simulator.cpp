@@ -0,0 +1,235 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_read_simulator.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the synthetic reads:  the parallel written file is the same as the serially generated records,
+ *          it parses as FASTQ and FASTA, and the error, N, and repeat rates are as specified.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+#endif
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint> // for uint64_t, etc.
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <stdexcept>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/sequence_iterator.hpp"
+#include "io/read_simulator.hpp"
+
+#if defined(USE_MPI)
+
+using KmerType = ::bliss::common::Kmer<21, ::bliss::common::DNA, uint64_t>;
+using KmerParserType = ::bliss::index::kmer::KmerParser<KmerType>;
+
+
+static std::string read_all(std::string const & filename) {
+  std::string out;
+  FILE * f = fopen(filename.c_str(), "rb");
+  if (f == nullptr) return out;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return out;
+}
+
+static char complement(char c) {
+  switch (c) {
+    case 'A': return 'T';
+    case 'C': return 'G';
+    case 'G': return 'C';
+    case 'T': return 'A';
+    default: return c;
+  }
+}
+
+
+TEST(ReadSimulator, parallel_write)
+{
+  ::mxx::comm comm;
+
+  ::bliss::io::read_sim_params params;
+  params.genome_size = 50000;
+  params.coverage = 3.0;
+  params.read_length = 101;
+  params.n_rate = 0.01;
+  ::bliss::io::read_simulator sim(params);
+
+  // small batches, so that ranks write in several rounds, and finish at different rounds.
+  std::string filename("read_simulator_test.fastq");
+  size_t written = sim.write(filename, comm, 100 * sim.record_bytes());
+  EXPECT_EQ(sim.num_reads(), ::mxx::allreduce(written, comm));
+  EXPECT_EQ(1486UL, sim.num_reads());
+
+  if (comm.rank() == 0) {
+    std::string content = read_all(filename);
+    EXPECT_EQ(sim.num_reads() * sim.record_bytes(), content.size());
+    EXPECT_TRUE(content == sim.generate(0, sim.num_reads()));
+    EXPECT_EQ(0UL, content.find('@'));
+  }
+  comm.barrier();
+  if (comm.rank() == 0) std::remove(filename.c_str());
+}
+
+TEST(ReadSimulator, parse)
+{
+  ::mxx::comm comm;
+
+  ::bliss::io::read_sim_params params;
+  params.genome_size = 20000;
+  params.coverage = 5.0;
+  params.read_length = 150;
+  params.repeat_fraction = 0.3;
+  params.repeat_length = 500;
+
+  // without Ns, every read has read_length - k + 1 kmers.
+  const char * names[] = {"read_simulator_test.fastq", "read_simulator_test.fasta"};
+  for (int i = 0; i < 2; ++i) {
+    params.fastq = (i == 0);
+    ::bliss::io::read_simulator sim(params);
+    sim.write(names[i], comm);
+
+    std::vector<KmerType> kmers;
+    if (params.fastq) {
+      ::bliss::io::KmerFileHelper::template read_file_posix<KmerParserType, ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(names[i], kmers, comm);
+    } else {
+      ::bliss::io::KmerFileHelper::template read_file_posix<KmerParserType, ::bliss::io::FASTAParser, ::bliss::io::SequencesIterator>(names[i], kmers, comm);
+    }
+    EXPECT_EQ(sim.num_reads() * (params.read_length - KmerType::size + 1), ::mxx::allreduce(kmers.size(), comm));
+
+    comm.barrier();
+    if (comm.rank() == 0) std::remove(names[i]);
+  }
+}
+
+TEST(ReadSimulator, error_rates)
+{
+  ::bliss::io::read_sim_params params;
+  params.genome_size = 100000;
+  params.coverage = 10.0;
+  params.error_rate = 0.02;
+  params.n_rate = 0.005;
+  ::bliss::io::read_simulator sim(params);
+
+  size_t bases = 0, errors = 0, ns = 0, reverse_count = 0;
+  size_t start;
+  bool reverse;
+  std::string seq, qual;
+  for (size_t i = 0; i < sim.num_reads(); ++i) {
+    sim.read(i, start, reverse, seq, qual);
+    ASSERT_LE(start + params.read_length, params.genome_size);
+    std::string ref = sim.genome(start, params.read_length);
+    if (reverse) {
+      std::reverse(ref.begin(), ref.end());
+      std::transform(ref.begin(), ref.end(), ref.begin(), complement);
+      ++reverse_count;
+    }
+    for (size_t j = 0; j < seq.size(); ++j) {
+      if (seq[j] == 'N') {
+        ++ns;
+        EXPECT_EQ('#', qual[j]);
+      } else if (seq[j] != ref[j]) ++errors;
+    }
+    bases += seq.size();
+  }
+
+  EXPECT_NEAR(params.error_rate, static_cast<double>(errors) / bases, 0.002);
+  EXPECT_NEAR(params.n_rate, static_cast<double>(ns) / bases, 0.001);
+  EXPECT_NEAR(0.5, static_cast<double>(reverse_count) / sim.num_reads(), 0.02);
+}
+
+TEST(ReadSimulator, repeats)
+{
+  ::bliss::io::read_sim_params params;
+  params.genome_size = 200000;
+  params.repeat_length = 400;
+  params.repeat_copies = 10;
+
+  // distinct kmers of the genome.  repeat copies of a family share their kmers.
+  auto distinct = [](::bliss::io::read_simulator const & sim) {
+    std::string g = sim.genome(0, sim.get_params().genome_size);
+    std::unordered_set<std::string> kmers;
+    for (size_t i = 0; i + 31 <= g.size(); ++i) kmers.insert(g.substr(i, 31));
+    return static_cast<double>(kmers.size()) / static_cast<double>(g.size());
+  };
+
+  ::bliss::io::read_simulator unique(params);
+  EXPECT_GT(distinct(unique), 0.99);
+
+  params.repeat_fraction = 0.5;
+  ::bliss::io::read_simulator repeated(params);
+  size_t repeat_bases = 0;
+  for (size_t i = 0; i < params.genome_size; ++i) repeat_bases += repeated.is_repeat(i) ? 1 : 0;
+  EXPECT_NEAR(0.5, static_cast<double>(repeat_bases) / params.genome_size, 0.05);
+  // about 1/2 unique, plus 1/10 of the repeats.
+  EXPECT_LT(distinct(repeated), 0.65);
+
+  // different seeds give different genomes.
+  params.seed = 7;
+  ::bliss::io::read_simulator other(params);
+  EXPECT_NE(repeated.genome(0, 1000), other.genome(0, 1000));
+}
+
+TEST(ReadSimulator, invalid)
+{
+  ::bliss::io::read_sim_params params;
+  params.read_length = params.genome_size + 1;
+  EXPECT_THROW(::bliss::io::read_simulator sim(params), std::invalid_argument);
+
+  params.read_length = 100;
+  params.error_rate = 0.8;
+  params.n_rate = 0.3;
+  EXPECT_THROW(::bliss::io::read_simulator sim(params), std::invalid_argument);
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_async_block_reader.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests asynchronous block reader using google test
+ * @details record aligned streaming of async_posix_file is checked against records parsed from the synchronous posix_file read.
+ *
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>   // mkstemp
+#include <unistd.h>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+
+#include "io/async_block_reader.hpp"
+#include "io/file.hpp"
+#include "io/fastq_loader.hpp"
+
+/// write a temporary file with random content.
+class AsyncBlockReaderTest : public ::testing::Test
+{
+  protected:
+    std::string fileName;
+    std::vector<unsigned char> gold;
+    int fd;
+
+    virtual void SetUp()
+    {
+      char name[] = "/tmp/bliss_async_readerXXXXXX";
+      fd = mkstemp(name);
+      ASSERT_GE(fd, 0);
+      fileName = name;
+
+      gold.resize(1000003);
+      std::default_random_engine generator;
+      std::uniform_int_distribution<int> distribution(0, 255);
+      for (auto & c : gold) c = static_cast<unsigned char>(distribution(generator));
+
+      ASSERT_EQ(static_cast<ssize_t>(gold.size()), write(fd, gold.data(), gold.size()));
+    }
+
+    virtual void TearDown() {
+      close(fd);
+      unlink(fileName.c_str());
+    }
+};
+
+
+TEST_F(AsyncBlockReaderTest, read)
+{
+  using range_type = ::bliss::io::async_block_reader::range_type;
+
+  for (size_t block_size : {4096UL, 65536UL, 2000000UL}) {
+    for (size_t depth : {1UL, 3UL, 8UL}) {
+      ::bliss::io::async_block_reader reader(fd, block_size, depth);
+
+      range_type r(12345, gold.size() - 17);
+      std::vector<unsigned char> out(r.size());
+      reader.read(out.data(), r);
+
+      EXPECT_TRUE(std::equal(out.begin(), out.end(), gold.begin() + r.start));
+    }
+  }
+}
+
+TEST_F(AsyncBlockReaderTest, read_blocks)
+{
+  using range_type = ::bliss::io::async_block_reader::range_type;
+
+  for (size_t block_size : {4096UL, 65536UL, 2000000UL}) {
+    for (size_t depth : {1UL, 2UL, 8UL}) {
+      ::bliss::io::async_block_reader reader(fd, block_size, depth);
+
+      range_type r(100, gold.size());
+      std::vector<unsigned char> out;
+      size_t expected_start = r.start;
+      bool ordered = true;
+
+      size_t total = reader.read_blocks(r, [&out, &expected_start, &ordered](range_type const & b, unsigned char const * data){
+        ordered &= (b.start == expected_start);
+        expected_start = b.end;
+        out.insert(out.end(), data, data + b.size());
+      });
+
+      EXPECT_TRUE(ordered);
+      EXPECT_EQ(r.size(), total);
+      EXPECT_EQ(r.size(), out.size());
+      EXPECT_TRUE(std::equal(out.begin(), out.end(), gold.begin() + r.start));
+    }
+  }
+}
+
+TEST_F(AsyncBlockReaderTest, read_past_end)
+{
+  using range_type = ::bliss::io::async_block_reader::range_type;
+
+  ::bliss::io::async_block_reader reader(fd, 4096, 4);
+  std::vector<unsigned char> out(200);
+  EXPECT_THROW(reader.read(out.data(), range_type(gold.size() - 100, gold.size() + 100)), ::bliss::io::IOException);
+
+  EXPECT_THROW(reader.read_blocks(range_type(gold.size() - 100, gold.size() + 100),
+                                  [](range_type const &, unsigned char const *){}), ::bliss::io::IOException);
+}
+
+TEST_F(AsyncBlockReaderTest, callback_exception)
+{
+  using range_type = ::bliss::io::async_block_reader::range_type;
+
+  ::bliss::io::async_block_reader reader(fd, 4096, 4);
+  size_t calls = 0;
+  EXPECT_THROW(reader.read_blocks(range_type(0, gold.size()), [&calls](range_type const &, unsigned char const *){
+    if (++calls == 5) throw std::runtime_error("stop");
+  }), std::runtime_error);
+  EXPECT_EQ(5UL, calls);
+}
+
+
+/// parse all records in a record aligned buffer.  returns (start offset, record) pairs.
+static std::vector<std::pair<size_t, std::string> > parse_fastq(unsigned char const * data, size_t start, size_t end) {
+  ::bliss::io::SequentialFASTQParser<unsigned char const *> parser;
+  std::vector<std::pair<size_t, std::string> > records;
+
+  unsigned char const * it = data;
+  unsigned char const * last = data + (end - start);
+  size_t offset = start;
+  while (it != last) {
+    auto seq = parser.get_next_record(it, last, offset);
+    if (seq.record_size == 0) break;
+    size_t pos = seq.id.get_pos();
+    records.emplace_back(pos, std::string(data + (pos - start), data + (pos - start) + seq.record_size));
+  }
+  return records;
+}
+
+TEST(AsyncPosixFileTest, read_range_records)
+{
+  using range_type = ::bliss::io::async_block_reader::range_type;
+  using Parser = ::bliss::io::SequentialFASTQParser<unsigned char const *>;
+
+  std::string fileName(PROJ_SRC_DIR);
+  fileName.append("/test/data/test.medium.fastq");
+
+  // reference:  synchronous read of the whole file.
+  ::bliss::io::posix_file sync(fileName);
+  ::bliss::io::file_data whole = sync.read_file();
+  auto gold = parse_fastq(whole.data.data(), 0, whole.data.size());
+  ASSERT_GT(gold.size(), 10UL);
+
+  for (size_t block_size : {1024UL, 4099UL, 65536UL}) {
+    for (size_t parts : {1UL, 3UL, 7UL}) {
+      std::vector<std::pair<size_t, std::string> > records;
+      size_t prev_end = 0;
+
+      for (size_t i = 0; i < parts; ++i) {
+        range_type r(whole.data.size() * i / parts, whole.data.size() * (i + 1) / parts);
+
+        ::bliss::io::async_posix_file file(fileName);
+        file.set_block_size(block_size, 3);
+
+        size_t chunk_end = r.start;
+        bool aligned = true;
+        range_type done = file.read_range_records<Parser>(r, [&](range_type const & c, unsigned char const * data) {
+          aligned &= (c.start == chunk_end) || (chunk_end == r.start);
+          aligned &= (data[0] == '@');
+          chunk_end = c.end;
+
+          auto recs = parse_fastq(data, c.start, c.end);
+          records.insert(records.end(), recs.begin(), recs.end());
+        });
+
+        EXPECT_TRUE(aligned);
+        // consecutive ranges produce consecutive chunks, with no gap or overlap.
+        EXPECT_EQ(prev_end, done.start);
+        prev_end = done.end;
+      }
+      EXPECT_EQ(whole.data.size(), prev_end);
+
+      EXPECT_EQ(gold.size(), records.size());
+      EXPECT_TRUE(gold == records);
+    }
+  }
+}
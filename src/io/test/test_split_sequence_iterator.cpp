@@ -0,0 +1,216 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_split_sequence_iterator.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests quality trimming and N splitting of FASTQ records in SplitSequencesIterator, using google test
+ * @details the parts are checked against the original buffer via their file offsets, and kmer positions are checked
+ *          to be in file coordinates and not to span a split.
+ */
+
+#include "bliss-config.hpp"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/sequence.hpp"
+#include "io/fastq_loader.hpp"
+#include "io/filtered_sequence_iterator.hpp"
+#include "io/kmer_parser.hpp"
+#include "utils/kmer_utils.hpp"
+#include "containers/fsc_container_utils.hpp"
+
+
+class SplitSequenceIteratorTest : public ::testing::Test
+{
+  protected:
+    using BufferType = std::vector<char>;
+    using CharIterType = typename BufferType::const_iterator;
+
+    BufferType buffer;
+
+    virtual void SetUp()
+    {
+      // 25 good bases with an N run, then 5 bad bases.
+      add_record("r1", "ACGTACGTACNNNGGCCTTAAGGCCACGTA", std::string(25, 'I') + std::string(5, '#'));
+      // leading N with bad quality, then good bases.
+      add_record("r2", "NNACGTTGCATGCA", std::string("##") + std::string(12, 'I'));
+      // all bad.
+      add_record("r3", "ACGTACGT", std::string(8, '#'));
+      // trailing N.
+      add_record("r4", "TTTTGGGGCCNN", std::string(12, 'I'));
+    }
+
+    void add_record(std::string const & name, std::string const & seq, std::string const & qual) {
+      std::string rec = "@" + name + "\n" + seq + "\n+\n" + qual + "\n";
+      buffer.insert(buffer.end(), rec.begin(), rec.end());
+    }
+
+    /// parts as strings, read from the buffer via the file offsets.
+    template <template <typename, template <typename> class> class SeqIterType>
+    std::vector<std::string> parse() {
+      ::bliss::partition::range<size_t> r(0, buffer.size());
+      ::bliss::io::FASTQParser<CharIterType> parser;
+      size_t offset = parser.init_parser(buffer.cbegin(), r, r, r);
+
+      SeqIterType<CharIterType, ::bliss::io::FASTQParser> it(parser, buffer.cbegin(), buffer.cend(), offset);
+      SeqIterType<CharIterType, ::bliss::io::FASTQParser> end(buffer.cend());
+
+      std::vector<std::string> parts;
+      for (; it != end; ++it) {
+        auto s = *it;
+        std::string part(s.seq_begin, s.seq_end);
+        EXPECT_EQ(std::string(buffer.begin() + s.seq_global_offset(), buffer.begin() + s.seq_global_offset() + s.seq_size()), part);
+        // quality stays aligned with the sequence:  the qualities start 1 sequence line + "\n+\n" later.
+        EXPECT_EQ(s.seq_size(), static_cast<size_t>(std::distance(s.qual_begin, s.qual_end)));
+        auto line_start = std::find(BufferType::const_reverse_iterator(s.seq_begin), buffer.crend(), '\n').base();
+        auto line_end = std::find(s.seq_begin, buffer.cend(), '\n');
+        EXPECT_EQ(std::distance(line_start, line_end) + 3, std::distance(s.seq_begin, s.qual_begin));
+        parts.emplace_back(part);
+      }
+      return parts;
+    }
+};
+
+
+TEST_F(SplitSequenceIteratorTest, n_split)
+{
+  auto parts = this->parse<::bliss::io::NSplitSequencesIterator>();
+  std::vector<std::string> gold = {"ACGTACGTAC", "GGCCTTAAGGCCACGTA", "ACGTTGCATGCA", "ACGTACGT", "TTTTGGGGCC"};
+  EXPECT_EQ(gold, parts);
+}
+
+TEST_F(SplitSequenceIteratorTest, sliding_window)
+{
+  auto parts = this->parse<::bliss::io::SlidingWindowTrimNSplitSequencesIterator>();
+  // r1 is cut at the first window with a bad base.  r2's first window and all of r3 are bad.
+  std::vector<std::string> gold = {"ACGTACGTAC", "GGCCTTAAG", "TTTTGGGGCC"};
+  EXPECT_EQ(gold, parts);
+}
+
+TEST_F(SplitSequenceIteratorTest, mott)
+{
+  auto parts = this->parse<::bliss::io::MottTrimNSplitSequencesIterator>();
+  std::vector<std::string> gold = {"ACGTACGTAC", "GGCCTTAAGGCC", "ACGTTGCATGCA", "TTTTGGGGCC"};
+  EXPECT_EQ(gold, parts);
+}
+
+TEST_F(SplitSequenceIteratorTest, kmer_positions)
+{
+  using KmerType = ::bliss::common::Kmer<5, ::bliss::common::DNA, uint16_t>;
+  using TupleType = std::pair<KmerType, ::bliss::common::ShortSequenceKmerId>;
+  using SeqIterType = ::bliss::io::MottTrimNSplitSequencesIterator<CharIterType, ::bliss::io::FASTQParser>;
+
+  ::bliss::partition::range<size_t> r(0, buffer.size());
+  ::bliss::io::FASTQParser<CharIterType> parser;
+  size_t offset = parser.init_parser(buffer.cbegin(), r, r, r);
+  SeqIterType it(parser, buffer.cbegin(), buffer.cend(), offset);
+  SeqIterType end(buffer.cend());
+
+  ::bliss::index::kmer::KmerPositionTupleParser<TupleType> kmer_parser(r);
+  std::vector<TupleType> kmers;
+  ::fsc::back_emplace_iterator<std::vector<TupleType> > emplace_iter(kmers);
+  for (; it != end; ++it) kmer_parser(*it, emplace_iter);
+
+  // 6 + 8 + 8 + 6.  none across the N run or into the trimmed bases.
+  ASSERT_EQ(28UL, kmers.size());
+  for (auto const & k : kmers) {
+    std::string gold(buffer.begin() + k.second.get_pos(), buffer.begin() + k.second.get_pos() + KmerType::size);
+    EXPECT_EQ(gold, ::bliss::utils::KmerUtils::toASCIIString(k.first));
+    EXPECT_EQ(std::string::npos, gold.find('N'));
+  }
+}
+
+TEST_F(SplitSequenceIteratorTest, kmer_qualities)
+{
+  using KmerType = ::bliss::common::Kmer<5, ::bliss::common::DNA, uint16_t>;
+  using TupleType = std::pair<KmerType, std::pair<::bliss::common::ShortSequenceKmerId, float> >;
+  using SeqIterType = ::bliss::io::NSplitSequencesIterator<CharIterType, ::bliss::io::FASTQParser>;
+  using ParserType = ::bliss::index::kmer::KmerPositionQualityTupleParser<TupleType>;
+
+  ::bliss::partition::range<size_t> r(0, buffer.size());
+  ::bliss::io::FASTQParser<CharIterType> parser;
+  size_t offset = parser.init_parser(buffer.cbegin(), r, r, r);
+  SeqIterType it(parser, buffer.cbegin(), buffer.cend(), offset);
+  SeqIterType end(buffer.cend());
+  std::vector<typename SeqIterType::value_type> seqs(it, end);
+
+  // begin() for every read before iterating any, so each iterator has to own its scores.
+  ParserType kmer_parser(r);
+  std::vector<typename ParserType::template iterator_type<typename SeqIterType::value_type> > starts;
+  for (auto const & s : seqs) starts.emplace_back(kmer_parser.begin(s));
+
+  for (size_t i = 0; i < seqs.size(); ++i) {
+    ::bliss::index::QualityScoreBlock<KmerType::size, ::bliss::index::Illumina18QualityScoreCodec<float> > block;
+    std::vector<float> gold = block.compute(seqs[i].qual_begin, seqs[i].qual_end);
+
+    std::vector<float> quals;
+    for (auto kit = starts[i], kend = kmer_parser.end(seqs[i]); kit != kend; ++kit) quals.push_back((*kit).second.second);
+    EXPECT_EQ(gold, quals);
+  }
+}
+
+TEST_F(SplitSequenceIteratorTest, kmer_qualities_sequential)
+{
+  using KmerType = ::bliss::common::Kmer<5, ::bliss::common::DNA, uint16_t>;
+  using TupleType = std::pair<KmerType, std::pair<::bliss::common::ShortSequenceKmerId, float> >;
+  using SeqIterType = ::bliss::io::NSplitSequencesIterator<CharIterType, ::bliss::io::FASTQParser>;
+  using ParserType = ::bliss::index::kmer::KmerPositionQualityTupleParser<TupleType>;
+
+  ::bliss::partition::range<size_t> r(0, buffer.size());
+  ::bliss::io::FASTQParser<CharIterType> parser;
+  size_t offset = parser.init_parser(buffer.cbegin(), r, r, r);
+  SeqIterType it(parser, buffer.cbegin(), buffer.cend(), offset);
+  SeqIterType end(buffer.cend());
+
+  // 1 read at a time, so the parser reuses its block.  the scores come from the current read.
+  ParserType kmer_parser(r);
+  std::vector<TupleType> kmers;
+  ::fsc::back_emplace_iterator<std::vector<TupleType> > emplace_iter(kmers);
+  std::vector<float> gold;
+  for (; it != end; ++it) {
+    ::bliss::index::QualityScoreBlock<KmerType::size, ::bliss::index::Illumina18QualityScoreCodec<float> > block;
+    std::vector<float> q = block.compute((*it).qual_begin, (*it).qual_end);
+    gold.insert(gold.end(), q.begin(), q.end());
+
+    kmer_parser(*it, emplace_iter);
+  }
+
+  std::vector<float> quals;
+  for (auto const & k : kmers) quals.push_back(k.second.second);
+  EXPECT_EQ(gold, quals);
+}
+
+TEST(SequenceTrim, no_quality)
+{
+  std::string data("NNACGTACGT");
+  ::bliss::common::Sequence<std::string::const_iterator> seq(::bliss::common::SequenceId(100), data.size(), 0, 0,
+                                                             data.cbegin(), data.cend());
+  ::bliss::io::MottQualityTrim<> mott;
+  mott(seq);
+  EXPECT_EQ(data.size(), seq.seq_size());
+
+  ::bliss::io::narrow_sequence(seq, 2, 6);
+  EXPECT_EQ(std::string("ACGT"), std::string(seq.seq_begin, seq.seq_end));
+  EXPECT_EQ(102UL, seq.seq_global_offset());
+}
@@ -127,61 +127,32 @@ namespace bliss
         // note that explicit keyword cannot be on copy and move constructors else the constructors are not defined/found.
 
         /// copy constructor.  respects multi-pass requirement of forward iterator.
+        /// ranges hold iterators into the underlying containers, so curr remains valid in the copy.  also valid for end iterators.
         ConcatenatingIterator(const type& other)
-        : ranges(other.ranges), curr_iter_pos(other.curr_iter_pos)
-        {
-          // move curr forward the same distance as other.curr - other.starts[curr_iter_pos]
-          curr = ranges[curr_iter_pos].first;
-          for (auto it = other.ranges[curr_iter_pos].first;
-              it != other.curr;
-              ++it, ++curr);
-        };
+        : ranges(other.ranges), curr_iter_pos(other.curr_iter_pos), curr(other.curr)
+        {};
 
-        /// copy constructor.  respects multi-pass requirement of forward iterator.
+        /// copy assignment.  respects multi-pass requirement of forward iterator.
         type& operator=(const type& other)
         {
           ranges = other.ranges;
           curr_iter_pos = other.curr_iter_pos;
-          // move curr forward the same distance as other.curr - other.starts[curr_iter_pos]
-          curr = ranges[curr_iter_pos].first;
-          for (auto it = other.ranges[curr_iter_pos].first;
-              it != other.curr;
-              ++it, ++curr);
+          curr = other.curr;
 
           return *this;
         }
 
         /// move constructor.
         ConcatenatingIterator(type&& other)
-        {
-          curr_iter_pos = other.curr_iter_pos;
-
-          // move curr forward the same distance as other.curr - other.starts[curr_iter_pos]
-          int i = 0;
-          for (auto it = other.ranges[curr_iter_pos].first;
-              it != other.curr;
-              ++it, ++i);
-
-          ranges = std::move(other.ranges);
-          curr = ranges[curr_iter_pos].first;
-          for (int j = 0; j < i; ++i, ++curr);
-
-        };
+        : ranges(std::move(other.ranges)), curr_iter_pos(other.curr_iter_pos), curr(std::move(other.curr))
+        {};
 
         /// move assignment operator
         type& operator=(type&& other)
         {
-          curr_iter_pos = other.curr_iter_pos;
-
-          // move curr forward the same distance as other.curr - other.starts[curr_iter_pos]
-          int i = 0;
-          for (auto it = other.ranges[curr_iter_pos].first;
-              it != other.curr;
-              ++it, ++i);
-
           ranges = std::move(other.ranges);
-          curr = ranges[curr_iter_pos].first;
-          for (int j = 0; j < i; ++i, ++curr);
+          curr_iter_pos = other.curr_iter_pos;
+          curr = std::move(other.curr);
 
           return *this;
         }
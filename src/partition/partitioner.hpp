@@ -33,6 +33,10 @@
 #include <type_traits>
 #include "partition/range.hpp"
 
+#if defined(USE_MPI)
+#include <mpi.h>
+#endif
+
 namespace bliss
 {
   /**
@@ -676,6 +680,165 @@ namespace bliss
     };
 
 
+#if defined(USE_MPI)
+    /**
+     * @class DistributedDemandDrivenPartitioner
+     * @brief a partitioner that assigns chunks to MPI ranks in the order that the getNext function is called.
+     * @details same as DemandDrivenPartitioner, but the chunk counter lives in an MPI RMA window on rank 0
+     *          and is incremented with MPI_Fetch_and_op, so faster ranks get more chunks.
+     *
+     *          construction, configure, reset, and destruction are collective over the communicator.
+     *          getNext is not collective.  partId should be the calling rank.
+     *
+     *          if multiple threads of a rank call getNext, MPI must be initialized with MPI_THREAD_MULTIPLE.
+     * @tparam Range  type of the range object to be partitioned.
+     */
+    template<typename Range>
+    class DistributedDemandDrivenPartitioner : public Partitioner<Range, DistributedDemandDrivenPartitioner<Range> >
+    {
+
+        friend Partitioner<Range, DistributedDemandDrivenPartitioner<Range> >;
+
+      protected:
+        /**
+         * @typedef BaseClassType
+         * @brief   the superclass type.
+         */
+        using BaseClassType = Partitioner<Range, DistributedDemandDrivenPartitioner<Range> >;
+
+        /**
+         * @typedef SizeType
+         */
+        using SizeType = typename BaseClassType::SizeType;
+
+        /**
+         * @typedef RangeValueType
+         * @brief   type for the start/end/overlap
+         */
+        using RangeValueType = typename BaseClassType::RangeValueType;
+
+        /// communicator for the ranks sharing the counter
+        MPI_Comm comm;
+
+        /// rank in comm
+        int rank;
+
+        /// RMA window holding the chunk counter on rank 0.
+        MPI_Win win;
+
+        /// local memory of the window.  only rank 0 has a counter
+        unsigned long long * counter;
+
+        /// local flag indicating the range has been exhausted.  avoids RMA calls after the end.
+        std::atomic<bool> done;
+
+      public:
+        /**
+         * @brief constructor.  collective.
+         * @param _comm  communicator.  each rank is a partition.
+         */
+        DistributedDemandDrivenPartitioner(MPI_Comm const & _comm) : BaseClassType(), comm(_comm), rank(0), win(MPI_WIN_NULL), counter(nullptr), done(false) {
+          MPI_Comm_rank(comm, &rank);
+          MPI_Aint bytes = (rank == 0) ? sizeof(unsigned long long) : 0;
+          MPI_Win_allocate(bytes, sizeof(unsigned long long), MPI_INFO_NULL, comm, &counter, &win);
+          if (rank == 0) {
+            MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win);
+            *counter = 0;
+            MPI_Win_unlock(0, win);
+          }
+          MPI_Barrier(comm);
+        };
+
+        DistributedDemandDrivenPartitioner(DistributedDemandDrivenPartitioner const & other) = delete;
+        DistributedDemandDrivenPartitioner & operator=(DistributedDemandDrivenPartitioner const & other) = delete;
+
+        /**
+         * @brief destructor.  collective, frees the window.
+         */
+        virtual ~DistributedDemandDrivenPartitioner() {
+          if (win != MPI_WIN_NULL) MPI_Win_free(&win);
+        }
+
+
+        /**
+         * @brief configures the partitioner with the source range, number of partitions.  collective.
+         * @param _src          range object to be partitioned.  should be the same on all ranks.
+         * @param _nPartitions  the number of partitions.  should be the communicator size
+         * @param _non_overlap_size  size of each chunk for the partitioning.
+         * @return updated non_overlap_size.
+         *
+         */
+        SizeType configure(const Range &_src, const size_t &_nPartitions, const SizeType &_non_overlap_size, const SizeType &_overlap_size = 0) {
+          if (_non_overlap_size <= 0)
+            throw std::invalid_argument("ERROR: partitioner c'tor: non_overlap_size is <= 0");
+
+          this->BaseClassType::configure(_src, _nPartitions, _non_overlap_size, _overlap_size);
+
+          this->nChunks = this->computeNumberOfChunks();
+
+          resetImpl();
+
+          return this->non_overlap_size;
+        };
+
+        /// total number of chunks
+        size_t getChunkCount() const {
+          return this->nChunks;
+        }
+
+        /// id of a chunk returned by getNext.
+        size_t getChunkId(Range const & r) const {
+          return static_cast<size_t>((r.start - this->src.start) / this->non_overlap_size);
+        }
+
+      protected:
+
+         /**
+         * @brief       get the next chunk from the shared counter.
+         * @details     the counter is incremented atomically by MPI_Fetch_and_op under a shared lock,
+         *              so concurrent calls from different ranks get distinct chunks.
+         * @param partId   partition id for the sub range.  not used for the computation.
+         * @return      range of the partition
+         */
+         inline Range getNextImpl(const size_t& partId) {
+
+          if (done.load(std::memory_order_seq_cst)) return this->end;
+
+          unsigned long long one = 1, chunk_id = 0;
+          MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win);
+          MPI_Fetch_and_op(&one, &chunk_id, MPI_UNSIGNED_LONG_LONG, 0, 0, MPI_SUM, win);
+          MPI_Win_unlock(0, win);
+
+          if (chunk_id >= this->nChunks) {
+            done.store(true, std::memory_order_seq_cst);
+            return this->end;
+          }
+
+          else
+            return BaseClassType::computeRangeForChunkId(this->src, 0, chunk_id);
+
+        }
+
+        /**
+         * @brief resets the shared chunk counter and "done".  collective.
+         * @details the barriers make sure no rank is still fetching from the previous round, and that the counter
+         *          is zeroed before anyone fetches from the new round.
+         */
+        void resetImpl() {
+          MPI_Barrier(comm);
+          if (rank == 0) {
+            MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win);
+            *counter = 0;
+            MPI_Win_unlock(0, win);
+          }
+          done.store(false, std::memory_order_seq_cst);
+          MPI_Barrier(comm);
+        }
+
+    };
+#endif
+
+
   } /* namespace partition */
 } /* namespace bliss */
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_distributed_partitioner.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the MPI RMA based demand driven partitioner.
+ * @details every chunk should be handed out exactly once across all ranks.
+ */
+
+#include "bliss-config.hpp"
+
+#if defined(USE_MPI)
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+#endif
+
+#include <gtest/gtest.h>
+#include <cstdint>  // for uint64_t, etc.
+#include <vector>
+#include <algorithm>
+
+#include "partition/range.hpp"
+#include "partition/partitioner.hpp"
+
+#if defined(USE_MPI)
+
+using namespace bliss::partition;
+
+class DistributedPartitionTest : public ::testing::Test {
+  protected:
+    using RangeType = range<size_t>;
+
+    /// get all chunks on this rank, then gather the starts from all ranks.
+    std::vector<size_t> get_all_starts(DistributedDemandDrivenPartitioner<RangeType> & part, ::mxx::comm const & comm,
+                                       RangeType const & src, size_t const & chunk_size) {
+      std::vector<size_t> starts;
+      RangeType r = part.getNext(comm.rank());
+      while (r.size() > 0) {
+        EXPECT_EQ(src.start + part.getChunkId(r) * chunk_size, r.start);
+        EXPECT_EQ(std::min(r.start + chunk_size, src.end), r.end);
+        starts.push_back(r.start);
+        r = part.getNext(comm.rank());
+      }
+      // exhausted stays exhausted
+      EXPECT_EQ(0UL, part.getNext(comm.rank()).size());
+
+      std::vector<size_t> all = ::mxx::allgatherv(starts, comm);
+      std::sort(all.begin(), all.end());
+      return all;
+    }
+};
+
+
+TEST_F(DistributedPartitionTest, each_chunk_once)
+{
+  ::mxx::comm comm;
+
+  std::vector<size_t> lens = {0, 1, 7, 100, 1001};
+  std::vector<size_t> chunks = {1, 3, 64};
+
+  DistributedDemandDrivenPartitioner<RangeType> part(comm);
+  for (auto len : lens) {
+    for (auto c : chunks) {
+      RangeType src(5, 5 + len);
+      part.configure(src, comm.size(), c);
+
+      std::vector<size_t> all = get_all_starts(part, comm, src, c);
+
+      ASSERT_EQ(part.getChunkCount(), all.size());
+      for (size_t i = 0; i < all.size(); ++i) {
+        EXPECT_EQ(src.start + i * c, all[i]);
+      }
+    }
+  }
+}
+
+TEST_F(DistributedPartitionTest, reset)
+{
+  ::mxx::comm comm;
+
+  RangeType src(0, 1000);
+  DistributedDemandDrivenPartitioner<RangeType> part(comm);
+  part.configure(src, comm.size(), 10);
+
+  std::vector<size_t> first = get_all_starts(part, comm, src, 10);
+  part.reset();
+  std::vector<size_t> second = get_all_starts(part, comm, src, 10);
+
+  EXPECT_EQ(100UL, first.size());
+  EXPECT_TRUE(std::equal(first.begin(), first.end(), second.begin()));
+}
+
+#endif
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+#if defined(USE_MPI)
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+#endif
+
+  result = RUN_ALL_TESTS();
+
+#if defined(USE_MPI)
+  comm.barrier();
+#endif
+
+  return result;
+}
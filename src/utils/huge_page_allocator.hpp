@@ -0,0 +1,251 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    huge_page_allocator.hpp
+ * @ingroup utils
+ * @author  tpan
+ * @brief   STL compatible allocator that backs large allocations with huge pages and NUMA placement.
+ * @details allocations at or above a threshold (2MB) are served by anonymous mmap, rounded up to
+ *          a multiple of the huge page size and aligned to a huge page boundary.  the mapping is either requested with MAP_HUGETLB
+ *          (explicit, falls back if the huge page pool is empty) or advised with MADV_HUGEPAGE
+ *          (transparent huge pages).  smaller allocations go through ::operator new.
+ *
+ *          NUMA placement is applied with the mbind system call directly, so libnuma is not needed.
+ *          on single node machines or kernels without NUMA support the mbind call fails silently and
+ *          the kernel default (first touch) applies.
+ *            interleave:  pages are spread round robin over all online nodes.  good for one rank per node.
+ *            local:       pages are placed on the node of the thread calling allocate.
+ *            none:        kernel default, i.e. first touch.
+ *
+ *          mapped bytes are tracked globally (huge_page_stats) so that MemUsage can report them.
+ *
+ *          usable as the Alloc parameter of the distributed maps and any std container, e.g.
+ *            ::std::vector<T, ::bliss::utils::huge_page_allocator<T, ::bliss::utils::numa_policy::interleave> >
+ */
+#ifndef SRC_UTILS_HUGE_PAGE_ALLOCATOR_HPP_
+#define SRC_UTILS_HUGE_PAGE_ALLOCATOR_HPP_
+
+#include <sys/mman.h>     // mmap, madvise
+#include <sys/syscall.h>  // SYS_mbind, SYS_getcpu
+#include <unistd.h>       // syscall
+
+#include <atomic>
+#include <cstddef>  // ptrdiff_t
+#include <cstdint>  // uintptr_t
+#include <cstdio>   // fopen
+#include <new>      // bad_alloc
+#include <limits>
+#include <utility>  // forward
+
+namespace bliss {
+
+  namespace utils {
+
+    /// NUMA placement policy for huge_page_allocator.
+    enum class numa_policy : int { none = 0, interleave = 1, local = 2 };
+
+    /// global counters for memory mapped by huge_page_allocator.  all instantiations share these.
+    struct huge_page_stats {
+        ::std::atomic<size_t> mapped;
+        ::std::atomic<size_t> peak;
+        ::std::atomic<size_t> mappings;
+
+        /// singleton.  function local static so the header stays self contained.
+        static huge_page_stats & get() {
+          static huge_page_stats stats;
+          return stats;
+        }
+
+        void add(size_t bytes) {
+          size_t curr = mapped.fetch_add(bytes) + bytes;
+          ++mappings;
+          size_t prev = peak.load();
+          while ((prev < curr) && !peak.compare_exchange_weak(prev, curr)) {};
+        }
+        void remove(size_t bytes) {
+          mapped.fetch_sub(bytes);
+          --mappings;
+        }
+
+      protected:
+        huge_page_stats() : mapped(0), peak(0), mappings(0) {};
+    };
+
+    namespace detail {
+
+      // linux mempolicy modes.  defined here to avoid depending on numaif.h
+      static constexpr int BL_MPOL_PREFERRED = 1;
+      static constexpr int BL_MPOL_INTERLEAVE = 3;
+
+      /// bit mask of online numa nodes, parsed from sysfs ("0-3,5" format).  0 if unavailable.
+      inline unsigned long online_numa_nodes() {
+        static const unsigned long nodes = []() {
+          unsigned long mask = 0;
+          FILE * fp = fopen("/sys/devices/system/node/online", "r");
+          if (fp == NULL) return mask;
+
+          unsigned int first, last;
+          char sep;
+          while (fscanf(fp, "%u", &first) == 1) {
+            last = first;
+            sep = static_cast<char>(fgetc(fp));
+            if (sep == '-') {
+              if (fscanf(fp, "%u", &last) != 1) break;
+              sep = static_cast<char>(fgetc(fp));
+            }
+            for (unsigned int i = first; (i <= last) && (i < ::std::numeric_limits<unsigned long>::digits); ++i)
+              mask |= (1UL << i);
+            if (sep != ',') break;
+          }
+          fclose(fp);
+          return mask;
+        }();
+        return nodes;
+      }
+
+      /// apply the numa policy to a mapped region.  failures are ignored (kernel default applies).
+      inline void apply_numa_policy(void * ptr, size_t bytes, numa_policy policy) {
+#if defined(SYS_mbind) && defined(SYS_getcpu)
+        if (policy == numa_policy::none) return;
+
+        unsigned long mask = online_numa_nodes();
+        // single node or no numa support.
+        if ((mask & (mask - 1)) == 0) return;
+
+        int mode = BL_MPOL_INTERLEAVE;
+        if (policy == numa_policy::local) {
+          unsigned cpu = 0, node = 0;
+          if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) return;
+          mask = 1UL << node;
+          mode = BL_MPOL_PREFERRED;
+        }
+        syscall(SYS_mbind, ptr, bytes, mode, &mask, ::std::numeric_limits<unsigned long>::digits + 1, 0);
+#else
+        (void)ptr; (void)bytes; (void)policy;
+#endif
+      }
+
+    } // namespace detail
+
+    /**
+     * @brief allocator using huge pages for large allocations, with optional numa placement.
+     * @details stateless, so all instances compare equal and containers can swap/move freely.
+     *          whether a block was mapped is determined from its size, so deallocate must receive
+     *          the same n as allocate, as required by the Allocator concept.
+     * @tparam T         value type
+     * @tparam Policy    numa placement policy
+     * @tparam Explicit  if true, request MAP_HUGETLB pages first, falling back to transparent huge pages.
+     */
+    template <typename T, numa_policy Policy = numa_policy::none, bool Explicit = false>
+    class huge_page_allocator {
+      public:
+        using value_type = T;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using reference = T&;
+        using const_reference = const T&;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+
+        template <typename U>
+        struct rebind {
+            using other = huge_page_allocator<U, Policy, Explicit>;
+        };
+
+        /// huge page size on x86_64.  also used as the threshold for using mmap.
+        static constexpr size_t huge_page_size = 2UL * 1024UL * 1024UL;
+
+        huge_page_allocator() noexcept {};
+        template <typename U>
+        huge_page_allocator(huge_page_allocator<U, Policy, Explicit> const &) noexcept {};
+
+        /// round bytes up to multiple of the huge page size.
+        static size_t mapped_size(size_t bytes) {
+          return (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+        }
+
+        T * allocate(size_t n) {
+          if (n > max_size()) throw ::std::bad_alloc();
+
+          size_t bytes = n * sizeof(T);
+          if (bytes < huge_page_size) return static_cast<T*>(::operator new(bytes));
+
+          bytes = mapped_size(bytes);
+          void * ptr = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+          if (Explicit) ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+          if (ptr == MAP_FAILED) {
+            // mmap only guarantees base page alignment.  over map by 1 huge page and trim both ends,
+            // so that the region starts on a huge page boundary and can be fully backed by THP.
+            void * raw = mmap(NULL, bytes + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) throw ::std::bad_alloc();
+
+            uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (start + huge_page_size - 1) & ~(huge_page_size - 1);
+            size_t head = aligned - start;
+            if (head > 0) munmap(raw, head);
+            if (head < huge_page_size) munmap(reinterpret_cast<void*>(aligned + bytes), huge_page_size - head);
+            ptr = reinterpret_cast<void*>(aligned);
+#if defined(MADV_HUGEPAGE)
+            madvise(ptr, bytes, MADV_HUGEPAGE);  // advisory only.  THP may be disabled.
+#endif
+          }
+          // set policy before the pages are touched.
+          detail::apply_numa_policy(ptr, bytes, Policy);
+
+          huge_page_stats::get().add(bytes);
+          return static_cast<T*>(ptr);
+        }
+
+        void deallocate(T * ptr, size_t n) noexcept {
+          if (ptr == nullptr) return;
+
+          size_t bytes = n * sizeof(T);
+          if (bytes < huge_page_size) {
+            ::operator delete(ptr);
+            return;
+          }
+          bytes = mapped_size(bytes);
+          munmap(ptr, bytes);
+          huge_page_stats::get().remove(bytes);
+        }
+
+        size_t max_size() const noexcept {
+          return ::std::numeric_limits<size_t>::max() / sizeof(T);
+        }
+
+        template <typename U, typename... Args>
+        void construct(U * p, Args&&... args) {
+          ::new(static_cast<void*>(p)) U(::std::forward<Args>(args)...);
+        }
+        template <typename U>
+        void destroy(U * p) {
+          p->~U();
+        }
+    };
+
+    template <typename T, typename U, numa_policy P, bool E>
+    inline bool operator==(huge_page_allocator<T, P, E> const &, huge_page_allocator<U, P, E> const &) { return true; }
+    template <typename T, typename U, numa_policy P, bool E>
+    inline bool operator!=(huge_page_allocator<T, P, E> const &, huge_page_allocator<U, P, E> const &) { return false; }
+
+  } // namespace utils
+} // namespace bliss
+
+
+#endif /* SRC_UTILS_HUGE_PAGE_ALLOCATOR_HPP_ */
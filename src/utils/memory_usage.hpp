@@ -48,6 +48,7 @@
 #include <cmath>  // std::sqrt
 
 #include <io/io_exception.hpp>
+#include <utils/huge_page_allocator.hpp>
 #include <mxx/reduction.hpp>
 
 //http://nadeausoftware.com/articles/2012/07/c_c_tip_how_get_process_resident_set_size_physical_memory_use#GetProcessMemoryInfonbspforpeakandcurrentresidentsetsize
@@ -112,6 +113,8 @@ class MemUsage {
     std::vector<std::string> names;
     std::vector<double> mem_curr;
     std::vector<double> mem_max;
+    /// bytes currently mapped by huge_page_allocator.  included in curr, but reported separately.
+    std::vector<double> mem_huge;
 
   public:
 
@@ -158,6 +161,7 @@ class MemUsage {
       names.clear();
       mem_curr.clear();
       mem_max.clear();
+      mem_huge.clear();
     }
 
 
@@ -166,6 +170,7 @@ class MemUsage {
       names.push_back(name);
       mem_curr.push_back(::getCurrentRSS());
       mem_max.push_back(::getPeakRSS());
+      mem_huge.push_back(::bliss::utils::huge_page_stats::get().mapped.load());
     }
     void collective_mark(::std::string const & name, ::mxx::comm const & comm) {
 
@@ -196,6 +201,10 @@ class MemUsage {
 
         output << "[MEM] " << title << "\tmax\t[,";
         std::transform(mem_max.begin(), mem_max.end(), dit, BtoMB);
+        output << "]" << ::std::endl;
+
+        output << "[MEM] " << title << "\thuge\t[,";
+        std::transform(mem_huge.begin(), mem_huge.end(), dit, BtoMB);
         output << "]";
 
         // print pending stuff, then print entire string at once (minimizes multiple threads/processes mixing output )
@@ -308,6 +317,7 @@ class MemUsage {
 
       ::std::vector<double> curr_mins, curr_maxs, curr_means, curr_stdevs;
       ::std::vector<double> peak_mins, peak_maxs, peak_means, peak_stdevs;
+      ::std::vector<double> huge_maxs, huge_means;
       int p = comm.size();
       int rank = comm.rank();
 
@@ -328,7 +338,12 @@ class MemUsage {
         ::std::for_each(mem_max.begin(), mem_max.end(), [](double &x) { x = x*x; });
         peak_stdevs = ::mxx::reduce(mem_max, 0, ::std::plus<double>(), comm);
 
+        huge_maxs = ::mxx::reduce(mem_huge, 0,
+            [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        huge_means = ::mxx::reduce(mem_huge, 0, ::std::plus<double>(), comm);
+
         if (rank == 0) {
+          ::std::for_each(huge_means.begin(), huge_means.end(), [&p](double & x) { x /= p; });
 
           ::std::for_each(curr_means.begin(), curr_means.end(), [&p](double & x) { x /= p; });
           ::std::transform(curr_stdevs.begin(), curr_stdevs.end(), curr_means.begin(), curr_stdevs.begin(),
@@ -385,6 +400,14 @@ class MemUsage {
 
           output << "[MEM] " << title << "\tpeak_stdev\t[,";
           std::transform(peak_stdevs.begin(), peak_stdevs.end(), dit, BtoMB);
+          output << "]" << std::endl;
+
+          output << "[MEM] " << title << "\thuge_max\t[,";
+          std::transform(huge_maxs.begin(), huge_maxs.end(), dit, BtoMB);
+          output << "]" << std::endl;
+
+          output << "[MEM] " << title << "\thuge_mean\t[,";
+          std::transform(huge_means.begin(), huge_means.end(), dit, BtoMB);
           output << "]";
 
 
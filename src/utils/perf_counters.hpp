@@ -0,0 +1,450 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    perf_counters.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   hardware performance counters (linux perf_event_open) for marked functional blocks, alongside plog::Timer.
+ * @details counts cycles, instructions, last level cache misses, dTLB load misses, and branch misses of each phase,
+ *          in 1 counter group, so that the counts of a phase are from the same time interval.
+ *          the group is opened once per process, on first use, and counts the thread that opened it (user and kernel
+ *          events, as permitted by perf_event_paranoid).  counts are scaled by time enabled / time running, in case the
+ *          kernel multiplexes the group with other users of the counters.
+ *
+ *          graceful fallback:  if the group cannot be opened (not linux, no PMU access in a VM or container,
+ *          perf_event_paranoid too high), every phase records 0 and the reports say the counters are unavailable.
+ *          an event that the PMU does not support is left out of the group, and reported as unavailable.
+ *
+ *          enabled at configure time by ENABLE_PERF_BENCHMARK, which sets BL_BENCHMARK_PERF.
+ *          the BL_BENCH_* macros then report [PERF] lines with the same phase header as the [TIME] lines.
+ */
+#ifndef SRC_UTILS_PERF_COUNTERS_HPP_
+#define SRC_UTILS_PERF_COUNTERS_HPP_
+
+#include "bliss-logger_config.hpp"
+
+#include <cstdint>
+#include <cstring>  // strerror, memset
+#include <cerrno>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iterator>  // ostream_iterator
+#include <algorithm>
+#include <unordered_map>
+#include <functional>
+
+#if defined(__linux__)
+#include <unistd.h>        // syscall, read, close
+#include <sys/ioctl.h>
+#include <sys/syscall.h>   // __NR_perf_event_open
+#include <linux/perf_event.h>
+#endif
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+namespace plog {
+
+/**
+ * @brief  process wide counter group.  use get().
+ */
+class PerfGroup {
+  public:
+    static constexpr int n_events = 5;
+
+    /// snapshot of the counters.  scaled for multiplexing.
+    struct values {
+        double v[n_events];
+    };
+
+    static const char * event_name(int i) {
+      static const char * names[n_events] = {"cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses"};
+      return names[i];
+    }
+
+  protected:
+    /// file descriptor of each event, or -1 if not available.  fds[0] is the group leader.
+    int fds[n_events];
+    /// position of each event in the group read.  -1 if not available.
+    int slots[n_events];
+    int n_open;
+    /// errno of the failed leader open, 0 if open.
+    int err;
+
+#if defined(__linux__)
+    static int open_event(uint32_t type, uint64_t config, int group_fd) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = type;
+      attr.config = config;
+      attr.disabled = (group_fd == -1) ? 1 : 0;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+      if (fd == -1 && (errno == EACCES || errno == EPERM)) {
+        // kernel events not permitted.  count user space only.
+        attr.exclude_kernel = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+      }
+      return fd;
+    }
+#endif
+
+    PerfGroup() : n_open(0), err(ENOSYS) {
+      for (int i = 0; i < n_events; ++i) {
+        fds[i] = -1;
+        slots[i] = -1;
+      }
+
+#if defined(__linux__)
+      const uint32_t types[n_events] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                        PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+      const uint64_t configs[n_events] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,   // last level cache misses on most PMUs.
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_BRANCH_MISSES
+      };
+
+      fds[0] = open_event(types[0], configs[0], -1);
+      if (fds[0] == -1) {
+        err = errno;
+        return;
+      }
+      err = 0;
+      slots[0] = 0;
+      n_open = 1;
+      for (int i = 1; i < n_events; ++i) {
+        fds[i] = open_event(types[i], configs[i], fds[0]);
+        if (fds[i] != -1) slots[i] = n_open++;
+      }
+
+      ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    ~PerfGroup() {
+#if defined(__linux__)
+      for (int i = n_events - 1; i >= 0; --i) {
+        if (fds[i] != -1) close(fds[i]);
+      }
+#endif
+    }
+
+  public:
+    static PerfGroup & get() {
+      static PerfGroup instance;
+      return instance;
+    }
+
+    /// true if the group leader (cycles) could be opened.
+    inline bool available() const {
+      return n_open > 0;
+    }
+    /// true if event i is counted.
+    inline bool available(int i) const {
+      return slots[i] >= 0;
+    }
+    /// reason the counters are unavailable.
+    std::string error() const {
+      return (err == 0) ? std::string() : std::string(strerror(err));
+    }
+
+    /// read the running totals.  all 0 if unavailable.
+    values read() const {
+      values out;
+      for (int i = 0; i < n_events; ++i) out.v[i] = 0;
+
+#if defined(__linux__)
+      if (n_open == 0) return out;
+
+      // nr, time_enabled, time_running, then 1 value per open event.
+      uint64_t buf[3 + n_events];
+      ssize_t bytes = ::read(fds[0], buf, sizeof(buf));
+      if (bytes < static_cast<ssize_t>((3 + n_open) * sizeof(uint64_t))) return out;
+
+      // not scheduled at all:  no estimate.
+      if (buf[2] == 0) return out;
+      double scale = static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+
+      for (int i = 0; i < n_events; ++i) {
+        if (slots[i] >= 0) out.v[i] = static_cast<double>(buf[3 + slots[i]]) * scale;
+      }
+#endif
+      return out;
+    }
+};
+
+
+/**
+ * @brief  per phase counts, recorded by start()/end() and the loop calls, in the same way as plog::Timer.
+ */
+class PerfCounters {
+  protected:
+    std::vector<std::string> names;
+    /// counts[e] has 1 entry per phase.
+    std::vector<double> counts[PerfGroup::n_events];
+
+    PerfGroup::values t1;
+    std::unordered_map<size_t, PerfGroup::values> loop_t1;
+    std::unordered_map<size_t, PerfGroup::values> loop_sum;
+
+    void push(::std::string const & name, PerfGroup::values const & v) {
+      names.push_back(name);
+      for (int e = 0; e < PerfGroup::n_events; ++e) counts[e].push_back(v.v[e]);
+    }
+
+    static PerfGroup::values diff(PerfGroup::values const & x, PerfGroup::values const & y) {
+      PerfGroup::values out;
+      for (int e = 0; e < PerfGroup::n_events; ++e) out.v[e] = x.v[e] - y.v[e];
+      return out;
+    }
+
+  public:
+    PerfCounters() {
+      reset();
+    }
+
+    void reset() {
+      names.clear();
+      for (int e = 0; e < PerfGroup::n_events; ++e) counts[e].clear();
+      loop_t1.clear();
+      loop_sum.clear();
+      t1 = PerfGroup::get().read();
+    }
+
+    /// number of recorded phases
+    inline size_t size() const {
+      return names.size();
+    }
+    /// count of event e in phase i.
+    inline double get(size_t i, int e) const {
+      return counts[e][i];
+    }
+
+//=========== loop stuff.
+    void loop_start(size_t const & id) {
+      PerfGroup::values zero;
+      for (int e = 0; e < PerfGroup::n_events; ++e) zero.v[e] = 0;
+      loop_sum[id] = zero;
+      loop_t1[id] = PerfGroup::get().read();
+    }
+    void loop_resume(size_t const & id) {
+      loop_t1[id] = PerfGroup::get().read();
+    }
+    void loop_pause(size_t const & id) {
+      PerfGroup::values d = diff(PerfGroup::get().read(), loop_t1[id]);
+      PerfGroup::values & s = loop_sum[id];
+      for (int e = 0; e < PerfGroup::n_events; ++e) s.v[e] += d.v[e];
+    }
+    void loop_end(size_t const & id, ::std::string const & name) {
+      push(name, loop_sum[id]);
+      loop_sum.erase(id);
+      loop_t1.erase(id);
+    }
+
+//============ counter start
+    void start() { t1 = PerfGroup::get().read(); }
+    /// records a barrier_<name> phase, to match plog::Timer's collective_start.
+    void collective_start(::std::string const & name, ::mxx::comm const & comm) {
+      t1 = PerfGroup::get().read();
+      comm.barrier();
+      barrier_end(name);
+    }
+    /// ends a barrier_<name> phase begun by start() and restarts the counters.  for sharing a barrier with the timer.
+    void barrier_end(::std::string const & name) {
+      ::std::string tmp("barrier_"); tmp.append(name);
+      end(tmp);
+
+      t1 = PerfGroup::get().read();
+    }
+    void end(::std::string const & name) {
+      push(name, diff(PerfGroup::get().read(), t1));
+    }
+    void collective_end(::std::string const & name, ::mxx::comm const & comm) {
+      comm.barrier();
+      end(name);
+    }
+
+    void report(::std::string const & title) {
+      PerfGroup const & group = PerfGroup::get();
+
+      std::stringstream output;
+      std::ostream_iterator<std::string> nit(output, ",");
+      std::ostream_iterator<double> dit(output, ",");
+
+      output << std::fixed;
+      output << "[PERF] " << title << "\theader\t[,";
+      std::copy(names.begin(), names.end(), nit);
+      output << "]";
+
+      if (!group.available()) {
+        output << std::endl << "[PERF] " << title << "\tunavailable: " << group.error();
+      } else {
+        output.precision(0);
+        for (int e = 0; e < PerfGroup::n_events; ++e) {
+          output << std::endl << "[PERF] " << title << "\t" << PerfGroup::event_name(e);
+          if (!group.available(e)) {
+            output << "\tunavailable";
+            continue;
+          }
+          output << "\t[,";
+          std::copy(counts[e].begin(), counts[e].end(), dit);
+          output << "]";
+        }
+        output.precision(3);
+        output << std::endl << "[PERF] " << title << "\tipc\t[,";
+        for (size_t i = 0; i < names.size(); ++i) {
+          output << ((counts[0][i] > 0) ? counts[1][i] / counts[0][i] : 0.0) << ",";
+        }
+        output << "]";
+      }
+
+      // print pending stuff, then print entire string at once (minimizes multiple threads/processes mixing output )
+      fflush(stdout);
+      printf("%s\n", output.str().c_str());
+      fflush(stdout);
+    }
+
+    /// cross rank sum and max of each event and phase, and ipc from the sums.  ranks without counters contribute 0.
+    void report(::std::string const & title, ::mxx::comm const & comm) {
+      PerfGroup const & group = PerfGroup::get();
+
+      int p = comm.size();
+      int rank = comm.rank();
+
+      // number of ranks with counters.
+      int n_avail = ::mxx::allreduce(group.available() ? 1 : 0, comm);
+
+      std::vector<double> sums[PerfGroup::n_events];
+      std::vector<double> maxs[PerfGroup::n_events];
+      if ((n_avail > 0) && (names.size() > 0)) {
+        for (int e = 0; e < PerfGroup::n_events; ++e) {
+          sums[e] = ::mxx::reduce(counts[e], 0, ::std::plus<double>(), comm);
+          maxs[e] = ::mxx::reduce(counts[e], 0,
+              [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+        }
+      }
+      // an event is reported if any rank counts it.
+      int avail[PerfGroup::n_events];
+      for (int e = 0; e < PerfGroup::n_events; ++e) {
+        avail[e] = ::mxx::allreduce(group.available(e) ? 1 : 0, comm);
+      }
+
+      if (rank == 0) {
+        std::stringstream output;
+        std::ostream_iterator<std::string> nit(output, ",");
+        std::ostream_iterator<double> dit(output, ",");
+
+        output << std::fixed;
+        output << "[PERF] " << "R " << rank << "/" << p << " counters on " << n_avail << " ranks" << std::endl;
+
+        output << "[PERF] " << title << "\theader\t[,";
+        std::copy(names.begin(), names.end(), nit);
+        output << "]";
+
+        if (n_avail == 0) {
+          output << std::endl << "[PERF] " << title << "\tunavailable: " << group.error();
+        } else {
+          for (int e = 0; e < PerfGroup::n_events; ++e) {
+            if (avail[e] == 0) {
+              output << std::endl << "[PERF] " << title << "\t" << PerfGroup::event_name(e) << "\tunavailable";
+              continue;
+            }
+            output.precision(0);
+            output << std::endl << "[PERF] " << title << "\t" << PerfGroup::event_name(e) << "_sum\t[,";
+            std::copy(sums[e].begin(), sums[e].end(), dit);
+            output << "]";
+
+            output << std::endl << "[PERF] " << title << "\t" << PerfGroup::event_name(e) << "_max\t[,";
+            std::copy(maxs[e].begin(), maxs[e].end(), dit);
+            output << "]";
+
+            // imbalance:  max / mean over the ranks with counters.
+            output.precision(3);
+            output << std::endl << "[PERF] " << title << "\t" << PerfGroup::event_name(e) << "_imbalance\t[,";
+            for (size_t i = 0; i < sums[e].size(); ++i) {
+              output << ((sums[e][i] > 0) ? maxs[e][i] * n_avail / sums[e][i] : 0.0) << ",";
+            }
+            output << "]";
+          }
+
+          output.precision(3);
+          output << std::endl << "[PERF] " << title << "\tipc\t[,";
+          for (size_t i = 0; i < names.size(); ++i) {
+            output << ((sums[0][i] > 0) ? sums[1][i] / sums[0][i] : 0.0) << ",";
+          }
+          output << "]";
+        }
+
+        fflush(stdout);
+        printf("%s\n", output.str().c_str());
+        fflush(stdout);
+      }
+      comm.barrier();
+    }
+};
+
+} // end namespace plog
+
+#if BL_BENCHMARK_PERF == 1
+
+#define BL_PERF_INIT(title)      ::plog::PerfCounters title##_perf;
+#define BL_PERF_RESET(title)     do { title##_perf.reset(); } while (0)
+
+#define BL_PERF_LOOP_START(title, id)     do { title##_perf.loop_start(id); } while (0)
+#define BL_PERF_LOOP_RESUME(title, id)    do { title##_perf.loop_resume(id); } while (0)
+#define BL_PERF_LOOP_PAUSE(title, id)     do { title##_perf.loop_pause(id); } while (0)
+#define BL_PERF_LOOP_END(title, id, name) do { title##_perf.loop_end(id, name); } while (0)
+
+#define BL_PERF_START(title)     do { title##_perf.start(); } while (0)
+#define BL_PERF_END(title, name) do { title##_perf.end(name); } while (0)
+#define BL_PERF_COLLECTIVE_START(title, name, comm) do { title##_perf.collective_start(name, comm); } while (0)
+#define BL_PERF_COLLECTIVE_END(title, name, comm) do { title##_perf.collective_end(name, comm); } while (0)
+#define BL_PERF_BARRIER_END(title, name) do { title##_perf.barrier_end(name); } while (0)
+#define BL_PERF_REPORT(title) do { title##_perf.report(#title); } while (0)
+#define BL_PERF_REPORT_NAMED(title, name) do { title##_perf.report(name); } while (0)
+#define BL_PERF_REPORT_MPI(title, comm) do { title##_perf.report(#title, comm); } while (0)
+#define BL_PERF_REPORT_MPI_NAMED(title, name, comm) do { title##_perf.report(name, comm); } while (0)
+
+#else
+
+#define BL_PERF_INIT(title)
+#define BL_PERF_RESET(title)
+#define BL_PERF_LOOP_START(title, id)
+#define BL_PERF_LOOP_RESUME(title, id)
+#define BL_PERF_LOOP_PAUSE(title, id)
+#define BL_PERF_LOOP_END(title, id, name)
+#define BL_PERF_START(title)
+#define BL_PERF_END(title, name)
+#define BL_PERF_COLLECTIVE_START(title, name, comm)
+#define BL_PERF_COLLECTIVE_END(title, name, comm)
+#define BL_PERF_BARRIER_END(title, name)
+#define BL_PERF_REPORT(title)
+#define BL_PERF_REPORT_NAMED(title, name)
+#define BL_PERF_REPORT_MPI(title, comm)
+#define BL_PERF_REPORT_MPI_NAMED(title, name, comm)
+
+#endif
+
+
+#endif /* SRC_UTILS_PERF_COUNTERS_HPP_ */
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    telemetry.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   machine readable phase telemetry, fed by plog::Timer (BL_BENCH_* / BL_TIMER_* macros).
+ * @details disabled unless the environment variable BL_TELEMETRY is set to an output path prefix, on all ranks.
+ *          when disabled, each timer phase costs 1 branch.  when enabled, each phase additionally records
+ *          its start time, the bytes sent and received while it was open (as reported via add_bytes()),
+ *          and the peak resident set size at its end (same getPeakRSS as MemUsage).
+ *
+ *          each MPI timer report reduces its phases across ranks:  min, max, mean, and imbalance (max / mean)
+ *          of duration, element count, bytes sent, bytes received, and peak RSS.
+ *          nesting of the phases is derived from time containment on rank 0.
+ *
+ *          files are written when the process exits, or on flush():
+ *            <prefix>.json                   rank 0:  cross rank statistics of all phases, in report order.
+ *            <prefix>.csv                    rank 0:  the same statistics, 1 row per phase.
+ *            <prefix>.<rank>.trace.json      every rank:  chrome trace (chrome://tracing, perfetto) of its phases.
+ */
+#ifndef SRC_UTILS_TELEMETRY_HPP_
+#define SRC_UTILS_TELEMETRY_HPP_
+
+#include <chrono>
+#include <cstdlib>   // getenv
+#include <cstdio>    // fopen
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+
+#include <mxx/comm.hpp>
+#include <mxx/reduction.hpp>
+
+// reports in bytes.
+#include "getRSS.h"
+
+namespace plog {
+
+class Telemetry {
+  public:
+    /// 1 completed phase on this rank.
+    struct event {
+        std::string title;
+        std::string name;
+        /// seconds since the telemetry epoch
+        double start;
+        double duration;
+        double count;
+        double sent;
+        double recv;
+        double peak;
+    };
+
+    /// min, max, and sum across ranks of 1 quantity.
+    struct stat {
+        double min;
+        double max;
+        double sum;
+    };
+
+    /// cross rank statistics of 1 phase.  only kept on rank 0.
+    struct summary {
+        /// index of the rank 0 event of this phase.
+        size_t event_id;
+        /// duration, count, sent, recv, peak
+        stat stats[5];
+        /// size of the communicator the phase was reduced over.
+        int procs;
+    };
+
+  protected:
+    std::string prefix;
+    bool on;
+    int rank;
+    int procs;
+    std::chrono::steady_clock::time_point epoch;
+
+    /// running totals of the bytes communicated by this rank.
+    double bytes_sent;
+    double bytes_recv;
+
+    std::vector<event> events;
+    std::vector<summary> summaries;
+
+    Telemetry() : on(false), rank(0), procs(1), epoch(std::chrono::steady_clock::now()),
+        bytes_sent(0), bytes_recv(0) {
+      const char * p = std::getenv("BL_TELEMETRY");
+      if (p != nullptr) enable(p);
+    }
+
+    ~Telemetry() {
+      flush();
+    }
+
+    /// rank in MPI_COMM_WORLD, for naming the per rank files.
+    void update_rank() {
+      int initialized = 0;
+      int finalized = 0;
+      MPI_Initialized(&initialized);
+      MPI_Finalized(&finalized);
+      if (initialized && !finalized) {
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &procs);
+      }
+    }
+
+    static std::string escape(std::string const & s) {
+      std::string out;
+      out.reserve(s.size());
+      for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if (static_cast<unsigned char>(c) >= 0x20) out.push_back(c);
+      }
+      return out;
+    }
+
+    /// parent event index for each event, by time containment.  events.size() for top level phases.
+    std::vector<size_t> get_parents() const {
+      std::vector<size_t> order(events.size());
+      std::iota(order.begin(), order.end(), 0);
+      // outer phases first.  for identical intervals, the one reported later is the outer one.
+      std::sort(order.begin(), order.end(), [this](size_t const & x, size_t const & y) {
+        double xe = events[x].start + events[x].duration;
+        double ye = events[y].start + events[y].duration;
+        return (events[x].start < events[y].start) ||
+            ((events[x].start == events[y].start) && ((xe > ye) || ((xe == ye) && (x > y))));
+      });
+
+      std::vector<size_t> parents(events.size(), events.size());
+      std::vector<size_t> stack;
+      for (size_t i : order) {
+        double end = events[i].start + events[i].duration;
+        while (!stack.empty() &&
+            ((events[stack.back()].start + events[stack.back()].duration) < end)) stack.pop_back();
+        if (!stack.empty()) parents[i] = stack.back();
+        stack.push_back(i);
+      }
+      return parents;
+    }
+
+    void write_stat(std::ostream & out, const char * key, stat const & s, int p) const {
+      double mean = s.sum / static_cast<double>(p);
+      out << "\"" << key << "\":{\"min\":" << s.min << ",\"max\":" << s.max << ",\"mean\":" << mean <<
+          ",\"imbalance\":" << ((mean > 0) ? (s.max / mean) : 1.0) << "}";
+    }
+
+    /// path of an event from its top level phase.
+    std::string get_path(size_t id, std::vector<size_t> const & parents, size_t & depth) const {
+      std::string path = escape(events[id].title) + "/" + escape(events[id].name);
+      depth = 0;
+      for (size_t p = parents[id]; p < events.size(); p = parents[p], ++depth) {
+        path = escape(events[p].title) + "/" + escape(events[p].name) + "/" + path;
+      }
+      return path;
+    }
+
+  public:
+    static Telemetry & get() {
+      static Telemetry instance;
+      return instance;
+    }
+
+    /// turn on recording, with the given output path prefix.  BL_TELEMETRY does the same at startup.
+    void enable(std::string const & _prefix) {
+      prefix = _prefix;
+      on = !prefix.empty();
+    }
+    void disable() {
+      on = false;
+    }
+    inline bool enabled() const {
+      return on;
+    }
+
+    /// account for bytes sent and received by this rank, e.g. in an all2allv.
+    inline void add_bytes(size_t sent, size_t recv) {
+      if (!on) return;
+      bytes_sent += static_cast<double>(sent);
+      bytes_recv += static_cast<double>(recv);
+    }
+    inline double get_bytes_sent() const {
+      return bytes_sent;
+    }
+    inline double get_bytes_recv() const {
+      return bytes_recv;
+    }
+
+    /// seconds from the telemetry epoch to t.
+    inline double since_epoch(std::chrono::steady_clock::time_point const & t) const {
+      return std::chrono::duration_cast<std::chrono::duration<double> >(t - epoch).count();
+    }
+
+    std::vector<event> const & get_events() const {
+      return events;
+    }
+    std::vector<summary> const & get_summaries() const {
+      return summaries;
+    }
+
+    /// drop all recorded phases, e.g. between tests.
+    void clear() {
+      events.clear();
+      summaries.clear();
+      bytes_sent = 0;
+      bytes_recv = 0;
+    }
+
+    /// record the phases of 1 timer on this rank only.  all vectors have the same length.
+    void record(std::string const & title, std::vector<std::string> const & names,
+                std::vector<double> const & starts, std::vector<double> const & durations,
+                std::vector<double> const & counts, std::vector<double> const & sent,
+                std::vector<double> const & recv, std::vector<double> const & peaks) {
+      if (!on) return;
+      update_rank();
+
+      events.reserve(events.size() + names.size());
+      for (size_t i = 0; i < names.size(); ++i) {
+        events.push_back(event{title, names[i], starts[i], durations[i], counts[i], sent[i], recv[i], peaks[i]});
+      }
+    }
+
+    /// record the phases of 1 timer, and reduce them across ranks.  collective.
+    void record(std::string const & title, std::vector<std::string> const & names,
+                std::vector<double> const & starts, std::vector<double> const & durations,
+                std::vector<double> const & counts, std::vector<double> const & sent,
+                std::vector<double> const & recv, std::vector<double> const & peaks,
+                ::mxx::comm const & comm) {
+      if (!on) return;
+      size_t first = events.size();
+      record(title, names, starts, durations, counts, sent, recv, peaks);
+      procs = comm.size();
+
+      if (names.size() == 0) return;
+
+      // interleaved so that 1 reduction per operator covers all quantities.
+      std::vector<double> vals;
+      vals.reserve(names.size() * 5);
+      for (size_t i = 0; i < names.size(); ++i) {
+        vals.push_back(durations[i]);
+        vals.push_back(counts[i]);
+        vals.push_back(sent[i]);
+        vals.push_back(recv[i]);
+        vals.push_back(peaks[i]);
+      }
+
+      std::vector<double> mins = ::mxx::reduce(vals, 0,
+          [](double const & x, double const & y) { return ::std::min(x, y); }, comm);
+      std::vector<double> maxs = ::mxx::reduce(vals, 0,
+          [](double const & x, double const & y) { return ::std::max(x, y); }, comm);
+      std::vector<double> sums = ::mxx::reduce(vals, 0, ::std::plus<double>(), comm);
+
+      if (comm.rank() != 0) return;
+
+      for (size_t i = 0; i < names.size(); ++i) {
+        summary s;
+        s.event_id = first + i;
+        s.procs = comm.size();
+        for (size_t j = 0; j < 5; ++j) {
+          s.stats[j] = stat{mins[i * 5 + j], maxs[i * 5 + j], sums[i * 5 + j]};
+        }
+        summaries.push_back(s);
+      }
+    }
+
+    /// cross rank statistics as JSON.  meaningful on rank 0.
+    std::string to_json() const {
+      std::vector<size_t> parents = get_parents();
+
+      std::stringstream out;
+      out.precision(9);
+      out << "{\"procs\":" << procs << ",\"phases\":[";
+      for (size_t i = 0; i < summaries.size(); ++i) {
+        summary const & s = summaries[i];
+        event const & e = events[s.event_id];
+
+        size_t depth;
+        std::string path = get_path(s.event_id, parents, depth);
+
+        if (i > 0) out << ",";
+        out << "\n{\"title\":\"" << escape(e.title) << "\",\"name\":\"" << escape(e.name) <<
+            "\",\"path\":\"" << path << "\",\"depth\":" << depth << ",\"start\":" << e.start << ",";
+        write_stat(out, "duration", s.stats[0], s.procs);  out << ",";
+        write_stat(out, "count", s.stats[1], s.procs);  out << ",";
+        write_stat(out, "bytes_sent", s.stats[2], s.procs);  out << ",";
+        write_stat(out, "bytes_recv", s.stats[3], s.procs);  out << ",";
+        write_stat(out, "peak_rss", s.stats[4], s.procs);
+        out << "}";
+      }
+      out << "\n]}\n";
+      return out.str();
+    }
+
+    /// cross rank statistics as CSV, 1 row per phase, with min, max, mean, and imbalance columns per quantity.  meaningful on rank 0.
+    std::string to_csv() const {
+      static const char * keys[5] = {"duration", "count", "bytes_sent", "bytes_recv", "peak_rss"};
+      std::vector<size_t> parents = get_parents();
+
+      std::stringstream out;
+      out.precision(9);
+      out << "title,name,path,depth,procs,start";
+      for (size_t j = 0; j < 5; ++j) {
+        out << "," << keys[j] << "_min," << keys[j] << "_max," << keys[j] << "_mean," << keys[j] << "_imbalance";
+      }
+      out << "\n";
+
+      for (size_t i = 0; i < summaries.size(); ++i) {
+        summary const & s = summaries[i];
+        event const & e = events[s.event_id];
+
+        size_t depth;
+        std::string path = get_path(s.event_id, parents, depth);
+
+        out << "\"" << escape(e.title) << "\",\"" << escape(e.name) << "\",\"" << path << "\"," <<
+            depth << "," << s.procs << "," << e.start;
+        for (size_t j = 0; j < 5; ++j) {
+          double mean = s.stats[j].sum / static_cast<double>(s.procs);
+          out << "," << s.stats[j].min << "," << s.stats[j].max << "," << mean << "," << ((mean > 0) ? (s.stats[j].max / mean) : 1.0);
+        }
+        out << "\n";
+      }
+      return out.str();
+    }
+
+    /// this rank's phases in chrome trace event format.  times in microseconds.
+    std::string to_trace() const {
+      std::stringstream out;
+      out << std::fixed;
+      out.precision(3);
+      out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+      for (size_t i = 0; i < events.size(); ++i) {
+        event const & e = events[i];
+        if (i > 0) out << ",";
+        out << "\n{\"name\":\"" << escape(e.name) << "\",\"cat\":\"" << escape(e.title) <<
+            "\",\"ph\":\"X\",\"pid\":" << rank << ",\"tid\":0,\"ts\":" << (e.start * 1000000.0) <<
+            ",\"dur\":" << (e.duration * 1000000.0) << ",\"args\":{\"count\":" << e.count <<
+            ",\"bytes_sent\":" << e.sent << ",\"bytes_recv\":" << e.recv << ",\"peak_rss\":" << e.peak << "}}";
+      }
+      out << "\n]}\n";
+      return out.str();
+    }
+
+    /// write the JSON and CSV (rank 0) and chrome trace files.  does not communicate.
+    void flush() const {
+      if (!on || events.empty()) return;
+
+      if (rank == 0) {
+        std::string fn = prefix + ".json";
+        FILE * f = fopen(fn.c_str(), "w");
+        if (f != nullptr) {
+          std::string s = to_json();
+          fwrite(s.data(), 1, s.size(), f);
+          fclose(f);
+        }
+
+        fn = prefix + ".csv";
+        f = fopen(fn.c_str(), "w");
+        if (f != nullptr) {
+          std::string s = to_csv();
+          fwrite(s.data(), 1, s.size(), f);
+          fclose(f);
+        }
+      }
+
+      std::stringstream fn;
+      fn << prefix << "." << rank << ".trace.json";
+      FILE * f = fopen(fn.str().c_str(), "w");
+      if (f != nullptr) {
+        std::string s = to_trace();
+        fwrite(s.data(), 1, s.size(), f);
+        fclose(f);
+      }
+    }
+
+};
+
+} // end namespace plog
+
+#endif /* SRC_UTILS_TELEMETRY_HPP_ */
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_telemetry.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test phase telemetry recorded from plog::Timer, and its cross rank statistics.
+ */
+
+#include "bliss-config.hpp"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+
+// include google test
+#include <gtest/gtest.h>
+#include <string>
+#include <algorithm>
+
+#include "utils/timer.hpp"
+#include "utils/telemetry.hpp"
+
+
+class TelemetryTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp() {
+      ::plog::Telemetry::get().clear();
+      ::plog::Telemetry::get().enable("telemetry_test");
+    }
+    virtual void TearDown() {
+      ::plog::Telemetry::get().clear();
+      ::plog::Telemetry::get().disable();
+    }
+};
+
+
+TEST_F(TelemetryTest, disabled)
+{
+  ::mxx::comm comm;
+  ::plog::Telemetry::get().disable();
+
+  ::plog::Timer outer;
+  outer.start();
+  ::plog::Telemetry::get().add_bytes(100, 200);
+  outer.end("work", 10);
+  outer.report("outer", comm);
+
+  EXPECT_EQ(0UL, ::plog::Telemetry::get().get_events().size());
+  EXPECT_EQ(0UL, ::plog::Telemetry::get().get_summaries().size());
+  EXPECT_EQ(0.0, ::plog::Telemetry::get().get_bytes_sent());
+}
+
+TEST_F(TelemetryTest, nested)
+{
+  ::mxx::comm comm;
+  ::plog::Timer outer;
+  ::plog::Timer inner;
+
+  outer.start();
+  {
+    inner.start();
+    ::plog::Telemetry::get().add_bytes(100 * (comm.rank() + 1), 50);
+    inner.end("a2a", 10);
+
+    inner.collective_start("local", comm);
+    inner.end("local", comm.rank());
+    inner.report("inner", comm);
+  }
+  outer.end("insert", 20);
+  outer.report("outer", comm);
+
+  auto const & events = ::plog::Telemetry::get().get_events();
+  ASSERT_EQ(4UL, events.size());
+  EXPECT_EQ("a2a", events[0].name);
+  EXPECT_EQ("barrier_local", events[1].name);
+  EXPECT_EQ("local", events[2].name);
+  EXPECT_EQ("insert", events[3].name);
+
+  // bytes are attributed to every open phase.
+  EXPECT_EQ(100.0 * (comm.rank() + 1), events[0].sent);
+  EXPECT_EQ(50.0, events[0].recv);
+  EXPECT_EQ(0.0, events[2].sent);
+  EXPECT_EQ(100.0 * (comm.rank() + 1), events[3].sent);
+  EXPECT_GT(events[3].peak, 0.0);
+  EXPECT_LE(events[3].start, events[0].start);
+
+  if (comm.rank() == 0) {
+    auto const & sums = ::plog::Telemetry::get().get_summaries();
+    ASSERT_EQ(4UL, sums.size());
+
+    int p = comm.size();
+    EXPECT_EQ(100.0, sums[0].stats[2].min);
+    EXPECT_EQ(100.0 * p, sums[0].stats[2].max);
+    EXPECT_EQ(50.0 * p * (p + 1), sums[0].stats[2].sum);
+    EXPECT_EQ(0.0, sums[2].stats[1].min);
+    EXPECT_EQ(static_cast<double>(p - 1), sums[2].stats[1].max);
+
+    std::string json = ::plog::Telemetry::get().to_json();
+    EXPECT_NE(std::string::npos, json.find("\"path\":\"outer/insert/inner/a2a\",\"depth\":1"));
+    EXPECT_NE(std::string::npos, json.find("\"path\":\"outer/insert\",\"depth\":0"));
+    EXPECT_NE(std::string::npos, json.find("\"imbalance\":"));
+
+    EXPECT_EQ(p, sums[0].procs);
+    std::string csv = ::plog::Telemetry::get().to_csv();
+    EXPECT_EQ(0UL, csv.find("title,name,path,depth,procs,start,duration_min,"));
+    EXPECT_NE(std::string::npos, csv.find("\"inner\",\"a2a\",\"outer/insert/inner/a2a\",1,"));
+    EXPECT_EQ(5L, std::count(csv.begin(), csv.end(), '\n'));
+  } else {
+    EXPECT_EQ(0UL, ::plog::Telemetry::get().get_summaries().size());
+  }
+
+  std::string trace = ::plog::Telemetry::get().to_trace();
+  EXPECT_NE(std::string::npos, trace.find("\"name\":\"a2a\",\"cat\":\"inner\",\"ph\":\"X\""));
+}
+
+
+int main(int argc, char* argv[])
+{
+  int result = 0;
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+  ::mxx::env e(argc, argv);
+  ::mxx::comm comm;
+
+  result = RUN_ALL_TESTS();
+
+  comm.barrier();
+
+  return result;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_huge_page_allocator.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests huge page allocator using google test
+ * @details
+ *
+ */
+
+#include "utils/huge_page_allocator.hpp"
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <unordered_map>
+#include <numeric>  // iota
+#include <cstdint>
+
+#include "bliss-config.hpp"
+
+template <typename A>
+class HugePageAllocatorTest : public ::testing::Test {};
+
+typedef ::testing::Types<
+    ::bliss::utils::huge_page_allocator<uint64_t>,
+    ::bliss::utils::huge_page_allocator<uint64_t, ::bliss::utils::numa_policy::interleave>,
+    ::bliss::utils::huge_page_allocator<uint64_t, ::bliss::utils::numa_policy::local>,
+    ::bliss::utils::huge_page_allocator<uint64_t, ::bliss::utils::numa_policy::none, true>
+  > HugePageAllocatorTestTypes;
+TYPED_TEST_CASE(HugePageAllocatorTest, HugePageAllocatorTestTypes);
+
+
+TYPED_TEST(HugePageAllocatorTest, small_vector)
+{
+  auto & stats = ::bliss::utils::huge_page_stats::get();
+  size_t before = stats.mapped.load();
+
+  ::std::vector<uint64_t, TypeParam> v(1000);
+  ::std::iota(v.begin(), v.end(), 0);
+
+  // below threshold, not mapped.
+  EXPECT_EQ(before, stats.mapped.load());
+  EXPECT_EQ(499500UL, ::std::accumulate(v.begin(), v.end(), 0UL));
+}
+
+TYPED_TEST(HugePageAllocatorTest, large_vector)
+{
+  auto & stats = ::bliss::utils::huge_page_stats::get();
+  size_t before = stats.mapped.load();
+
+  size_t n = (3UL * TypeParam::huge_page_size) / sizeof(uint64_t) + 5;
+  {
+    ::std::vector<uint64_t, TypeParam> v(n);
+    ::std::iota(v.begin(), v.end(), 0);
+
+    EXPECT_EQ(before + 4 * TypeParam::huge_page_size, stats.mapped.load());
+    EXPECT_EQ(0UL, reinterpret_cast<uintptr_t>(v.data()) % TypeParam::huge_page_size);
+    EXPECT_LE(stats.mapped.load(), stats.peak.load());
+    EXPECT_EQ(n * (n - 1) / 2, ::std::accumulate(v.begin(), v.end(), 0UL));
+  }
+  // released.
+  EXPECT_EQ(before, stats.mapped.load());
+}
+
+TYPED_TEST(HugePageAllocatorTest, grow_vector)
+{
+  auto & stats = ::bliss::utils::huge_page_stats::get();
+  size_t before = stats.mapped.load();
+
+  size_t n = (2UL * TypeParam::huge_page_size) / sizeof(uint64_t);
+  {
+    ::std::vector<uint64_t, TypeParam> v;
+    for (size_t i = 0; i < n; ++i) v.push_back(i);
+
+    EXPECT_EQ(n * (n - 1) / 2, ::std::accumulate(v.begin(), v.end(), 0UL));
+  }
+  EXPECT_EQ(before, stats.mapped.load());
+}
+
+TYPED_TEST(HugePageAllocatorTest, rebind_map)
+{
+  using alloc_type = typename ::std::allocator_traits<TypeParam>::template rebind_alloc<::std::pair<const uint64_t, uint64_t> >;
+  ::std::unordered_map<uint64_t, uint64_t, ::std::hash<uint64_t>, ::std::equal_to<uint64_t>, alloc_type> m;
+
+  for (uint64_t i = 0; i < 100000; ++i) m[i] = i * 2;
+
+  EXPECT_EQ(100000UL, m.size());
+  for (uint64_t i = 0; i < 100000; i += 1000) EXPECT_EQ(i * 2, m[i]);
+}
+
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_perf_counters.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   test the per phase hardware counters.  where the counters are not available (e.g. in containers),
+ *          checks that every phase is still recorded, with 0 counts.
+ */
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+#include <numeric>
+
+#include "utils/perf_counters.hpp"
+
+
+/// work with a known lower bound on instructions.
+static uint64_t work(size_t n) {
+  std::vector<uint64_t> v(n);
+  std::iota(v.begin(), v.end(), 1);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < n; ++i) sum += v[(i * 7919) % n] * v[i];
+  return sum;
+}
+
+
+TEST(PerfCounters, phases)
+{
+  ::plog::PerfGroup const & group = ::plog::PerfGroup::get();
+  if (!group.available()) {
+    printf("hardware counters unavailable: %s\n", group.error().c_str());
+  }
+
+  ::plog::PerfCounters perf;
+
+  perf.start();
+  volatile uint64_t s = work(1000000);
+  perf.end("work");
+
+  perf.start();
+  perf.end("empty");
+
+  // loop phase:  2 pieces of work, with a pause between.
+  perf.loop_start(3);
+  s = s + work(100000);
+  perf.loop_pause(3);
+  s = s + work(1000000);
+  perf.loop_resume(3);
+  s = s + work(100000);
+  perf.loop_pause(3);
+  perf.loop_end(3, "loop");
+
+  ASSERT_EQ(3UL, perf.size());
+
+  for (int e = 0; e < ::plog::PerfGroup::n_events; ++e) {
+    if (!group.available(e)) {
+      for (size_t i = 0; i < perf.size(); ++i) EXPECT_EQ(0.0, perf.get(i, e));
+    } else {
+      for (size_t i = 0; i < perf.size(); ++i) EXPECT_GE(perf.get(i, e), 0.0);
+    }
+  }
+
+  if (group.available(1)) {
+    // at least 1 instruction per element.
+    EXPECT_GT(perf.get(0, 1), 1000000.0);
+    EXPECT_GT(perf.get(0, 1), perf.get(1, 1));
+    // the loop excludes the paused work.
+    EXPECT_GT(perf.get(2, 1), 200000.0);
+    EXPECT_LT(perf.get(2, 1), perf.get(0, 1));
+  }
+
+  perf.report("perf_test");
+
+  perf.reset();
+  EXPECT_EQ(0UL, perf.size());
+}
@@ -36,10 +36,13 @@
 #include <string>
 #include <algorithm>  // std::min
 #include <sstream>
+#include <iterator>  // ostream_iterator
 #include <cmath>
 
 #include <mxx/reduction.hpp>
 
+#include "utils/telemetry.hpp"
+
 
 namespace plog {
 
@@ -55,8 +58,47 @@ class Timer {
     std::unordered_map<size_t, std::chrono::steady_clock::time_point> loop_t1;
     std::unordered_map<size_t, std::chrono::duration<double> > loop_span;
 
+    /// telemetry of each phase:  start time, bytes sent and received, and peak RSS.  only filled if telemetry is enabled.
+    std::vector<double> tel_starts;
+    std::vector<double> tel_sent;
+    std::vector<double> tel_recv;
+    std::vector<double> tel_peaks;
+    /// bytes communicated when the current phase started
+    double tel_sent1, tel_recv1;
+    std::unordered_map<size_t, std::pair<double, double> > loop_bytes;
+
+    void tel_start() {
+      ::plog::Telemetry const & tel = ::plog::Telemetry::get();
+      if (!tel.enabled()) return;
+      tel_sent1 = tel.get_bytes_sent();
+      tel_recv1 = tel.get_bytes_recv();
+    }
+    /// pad to the number of phases, for phases recorded while telemetry was off.
+    void tel_pad() {
+      tel_starts.resize(names.size(), 0);
+      tel_sent.resize(names.size(), 0);
+      tel_recv.resize(names.size(), 0);
+      tel_peaks.resize(names.size(), 0);
+    }
+    void tel_end(std::chrono::steady_clock::time_point const & start, double const & sent1, double const & recv1) {
+      ::plog::Telemetry const & tel = ::plog::Telemetry::get();
+      if (!tel.enabled()) return;
+      // pad phases that were recorded while telemetry was off.
+      tel_starts.resize(names.size() - 1, 0);
+      tel_sent.resize(names.size() - 1, 0);
+      tel_recv.resize(names.size() - 1, 0);
+      tel_peaks.resize(names.size() - 1, 0);
+
+      tel_starts.push_back(tel.since_epoch(start));
+      tel_sent.push_back(tel.get_bytes_sent() - sent1);
+      tel_recv.push_back(tel.get_bytes_recv() - recv1);
+      tel_peaks.push_back(static_cast<double>(::getPeakRSS()));
+    }
+
   public:
     Timer() {
+      // start the telemetry clock no later than the first timer.
+      ::plog::Telemetry::get();
     	reset();
     }
 
@@ -69,6 +111,14 @@ class Timer {
       first = std::chrono::steady_clock::now();
       loop_t1.clear();
       loop_span.clear();
+
+      tel_starts.clear();
+      tel_sent.clear();
+      tel_recv.clear();
+      tel_peaks.clear();
+      loop_bytes.clear();
+      tel_sent1 = 0;
+      tel_recv1 = 0;
     }
 
 
@@ -76,6 +126,8 @@ class Timer {
     void loop_start(size_t const & id) {
       loop_span[id] = std::chrono::duration<double>::zero();
       loop_t1[id] = std::chrono::steady_clock::now();
+      if (::plog::Telemetry::get().enabled())
+        loop_bytes[id] = std::make_pair(::plog::Telemetry::get().get_bytes_sent(), ::plog::Telemetry::get().get_bytes_recv());
     }
     void loop_resume(size_t const & id) {
       loop_t1[id] = std::chrono::steady_clock::now();
@@ -91,16 +143,22 @@ class Timer {
     	cumulative.push_back((std::chrono::duration_cast<std::chrono::duration<double> >(lt2 - first)).count());
     	counts.push_back(n_elem);
 
+    	// start of the loop phase, as if it ran without pauses.
+    	std::pair<double, double> lb = loop_bytes[id];
+    	tel_end(lt2 - std::chrono::duration_cast<std::chrono::steady_clock::duration>(loop_span[id]), lb.first, lb.second);
+
     	loop_span.erase(id);
     	loop_t1.erase(id);
+    	loop_bytes.erase(id);
     }
 
 //============ timer start
-    void start() { t1 = std::chrono::steady_clock::now(); }
+    void start() { t1 = std::chrono::steady_clock::now(); tel_start(); }
     void collective_start(::std::string const & name, ::mxx::comm const & comm) {
 
       // time a barrier.
       t1 = std::chrono::steady_clock::now();
+      tel_start();
       comm.barrier();
       t2 = std::chrono::steady_clock::now();
       time_span = (std::chrono::duration_cast<std::chrono::duration<double> >(t2 - t1));
@@ -110,8 +168,10 @@ class Timer {
       durations.push_back(time_span.count());
       cumulative.push_back((std::chrono::duration_cast<std::chrono::duration<double> >(t2 - first)).count());
       counts.push_back(0);
+      tel_end(t1, tel_sent1, tel_recv1);
 
       t1 = std::chrono::steady_clock::now();
+      tel_start();
     }
     void end(::std::string const & name, double const & n_elem) {
       t2 = std::chrono::steady_clock::now();
@@ -121,6 +181,7 @@ class Timer {
       durations.push_back(time_span.count());
       cumulative.push_back((std::chrono::duration_cast<std::chrono::duration<double> >(t2 - first)).count());
       counts.push_back(n_elem);
+      tel_end(t1, tel_sent1, tel_recv1);
     }
     void collective_end(::std::string const & name, double const & n_elem, ::mxx::comm const & comm) {
 
@@ -130,6 +191,11 @@ class Timer {
 		end(name, n_elem);
     }
     void report(::std::string const & title) {
+        if (::plog::Telemetry::get().enabled()) {
+          tel_pad();
+          ::plog::Telemetry::get().record(title, names, tel_starts, durations, counts, tel_sent, tel_recv, tel_peaks);
+        }
+
         std::stringstream output;
 
         std::ostream_iterator<std::string> nit(output, ",");
@@ -263,6 +329,12 @@ class Timer {
 #endif
 
     void report(::std::string const & title, ::mxx::comm const & comm) {
+      // before the reductions below square the durations and counts.
+      if (::plog::Telemetry::get().enabled()) {
+        tel_pad();
+        ::plog::Telemetry::get().record(title, names, tel_starts, durations, counts, tel_sent, tel_recv, tel_peaks, comm);
+      }
+
       std::vector<double> dur_mins, dur_maxs, dur_means, dur_stdevs;
       std::vector<double> cum_mins, cum_maxs, cum_means, cum_stdevs;
       std::vector<double> cnt_mins, cnt_maxs, cnt_means, cnt_stdevs;
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkDeBruijnCompaction.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   end to end benchmark:  read a FASTQ file, build the distributed de bruijn graph, and compact it into unitigs.
+ * @details reports the time of each stage, and the unitig count, total length, max length, and N50.
+ *          also checks that the unitigs contain every graph node exactly once.
+ */
+
+#include "bliss-config.hpp"
+
+#include <unistd.h>  // get hostname
+
+#include <functional>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <numeric>
+
+#include "utils/logging.h"
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/base_types.hpp"
+#include "utils/kmer_utils.hpp"
+
+#include "io/mxx_support.hpp"
+#include "io/sequence_iterator.hpp"
+#include "io/sequence_id_iterator.hpp"
+#include "iterators/transform_iterator.hpp"
+#include "common/kmer_iterators.hpp"
+#include "iterators/zip_iterator.hpp"
+#include "index/quality_score_iterator.hpp"
+
+#include "debruijn/edge_iterator.hpp"
+#include "index/kmer_index.hpp"
+#include "debruijn/de_bruijn_construct_engine.hpp"
+#include "debruijn/de_bruijn_nodes_distributed.hpp"
+#include "debruijn/de_bruijn_compaction.hpp"
+
+#include "utils/benchmark_utils.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+
+using Alphabet = bliss::common::DNA;
+using KmerType = bliss::common::Kmer<21, Alphabet, WordType>;
+
+template <typename K>
+using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<K>;
+
+template <typename EdgeEnc>
+using CountNodeMapType = bliss::de_bruijn::de_bruijn_nodes_distributed<
+    KmerType, bliss::de_bruijn::node::edge_counts<EdgeEnc, int32_t>, MapParams >;
+
+using GraphType = bliss::de_bruijn::de_bruijn_engine<CountNodeMapType>;
+using EdgeType = typename CountNodeMapType<bliss::common::DNA16>::mapped_type;
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+
+  comm.barrier();
+
+  //////////////// parse parameters
+
+  std::string filename;
+  filename.assign(PROJ_SRC_DIR);
+  filename.append("/test/data/test.debruijn.small.fastq");
+
+  try {
+    TCLAP::CmdLine cmd("Benchmark parallel de bruijn graph construction and unitig compaction", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> fileArg("F", "file", "FASTQ file path", false, filename, "string", cmd);
+
+    cmd.parse( argc, argv );
+
+    filename = fileArg.getValue();
+
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+
+  BL_BENCH_INIT(test);
+
+  // ================  build the graph
+  GraphType idx(comm);
+
+  if (comm.rank() == 0) printf("building de bruijn graph from %s via posix\n", filename.c_str());
+  BL_BENCH_START(test);
+  idx.template build_posix<bliss::io::FASTQParser, bliss::io::SequencesIterator>(filename, comm);
+  BL_BENCH_COLLECTIVE_END(test, "build", idx.local_size(), comm);
+
+  size_t node_count = idx.size();
+  if (comm.rank() == 0) printf("graph has %lu nodes\n", node_count);
+
+  // ================  compact
+  BL_BENCH_START(test);
+  std::vector<std::pair<KmerType, EdgeType> > nodes;
+  idx.get_map().to_vector(nodes);
+  BL_BENCH_COLLECTIVE_END(test, "to_vector", nodes.size(), comm);
+
+  ::bliss::de_bruijn::unitig_compactor<KmerType> compactor(comm);
+  typename ::bliss::de_bruijn::unitig_compactor<KmerType>::unitig_store_type unitigs;
+
+  BL_BENCH_START(test);
+  compactor.compact(nodes, unitigs);
+  BL_BENCH_COLLECTIVE_END(test, "compact", unitigs.size(), comm);
+
+  // ================  statistics and check
+  BL_BENCH_START(test);
+  std::vector<size_t> lengths;
+  lengths.reserve(unitigs.size());
+  size_t kmer_count = 0;
+  for (size_t i = 0; i < unitigs.size(); ++i) {
+    lengths.push_back(unitigs.seq_size(i));
+    kmer_count += unitigs.seq_size(i) - KmerType::size + 1;
+  }
+  lengths = ::mxx::gatherv(lengths, 0, comm);
+  kmer_count = ::mxx::allreduce(kmer_count, comm);
+  BL_BENCH_COLLECTIVE_END(test, "stats", lengths.size(), comm);
+
+  if (comm.rank() == 0) {
+    ::std::sort(lengths.begin(), lengths.end(), ::std::greater<size_t>());
+    size_t total = ::std::accumulate(lengths.begin(), lengths.end(), static_cast<size_t>(0));
+
+    size_t n50 = 0;
+    size_t sum = 0;
+    for (auto l : lengths) {
+      sum += l;
+      if (2 * sum >= total) {
+        n50 = l;
+        break;
+      }
+    }
+
+    printf("unitigs: %lu, total length %lu, max length %lu, N50 %lu.  pointer doubling rounds %lu, cycles %lu\n",
+           lengths.size(), total, (lengths.empty() ? 0UL : lengths.front()), n50,
+           compactor.get_rounds(), compactor.get_cycles());
+
+    if (kmer_count != node_count)
+      printf("ERROR: unitigs contain %lu kmers, graph has %lu nodes\n", kmer_count, node_count);
+  }
+
+  BL_BENCH_REPORT_MPI_NAMED(test, "debruijn_compaction", comm);
+
+  return 0;
+}
@@ -293,6 +293,58 @@ void benchmark_unordered_vecmap(size_t const count, size_t const query_frac, ::m
   BL_BENCH_REPORT_MPI_NAMED(map, "unordered_vecmap", comm);
 }
 
+template <typename Kmer, typename Value>
+void benchmark_unordered_csr_vecmap(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
+  BL_BENCH_INIT(map);
+
+  std::vector<Kmer > query;
+  BL_BENCH_START(map);
+  // no transform involved.
+  ::fsc::unordered_csr_vecmap<Kmer, Value, ::bliss::kmer::hash::farm<Kmer, false> > map(1, count);
+  BL_BENCH_END(map, "reserve", count);
+
+
+  {
+    std::vector<::std::pair<Kmer, Value> > input(count);
+
+    generate_input(input, count);
+    query.resize(count / query_frac);
+    std::transform(input.begin(), input.begin() + input.size() / query_frac, query.begin(),
+                   [](::std::pair<Kmer, Value> const & x){
+      return x.first;
+    });
+
+    BL_BENCH_START(map);
+    map.insert(input.begin(), input.end());
+    BL_BENCH_END(map, "insert", map.size());
+  }
+
+  BL_BENCH_START(map);
+  size_t result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    auto iters = map.equal_range_value_only(query[i]);
+    for (auto it = iters.first; it != iters.second; ++it)
+      result ^= *it;
+  }
+  BL_BENCH_END(map, "find", result);
+
+  BL_BENCH_START(map);
+  result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    result += map.count(query[i]);
+  }
+  BL_BENCH_END(map, "count", result);
+
+  BL_BENCH_START(map);
+  result = 0;
+  for (size_t i = 0, max = count / query_frac; i < max; ++i) {
+    result += map.erase(query[i]);
+  }
+  BL_BENCH_END(map, "erase", result);
+
+  BL_BENCH_REPORT_MPI_NAMED(map, "unordered_csr_vecmap", comm);
+}
+
 //template <typename Kmer, typename Value>
 //void benchmark_hashed_vecmap(size_t const count, size_t const query_frac, ::mxx::comm const & comm) {
 //  BL_BENCH_INIT(map);
@@ -1258,6 +1310,10 @@ int main(int argc, char** argv) {
   benchmark_unordered_vecmap<Kmer, size_t>(count, query_frac, comm);
   BL_BENCH_COLLECTIVE_END(test, "unordered_vecmap", count, comm);
 
+  BL_BENCH_START(test);
+  benchmark_unordered_csr_vecmap<Kmer, size_t>(count, query_frac, comm);
+  BL_BENCH_COLLECTIVE_END(test, "unordered_csr_vecmap", count, comm);
+
 //  BL_BENCH_START(test);
 //  benchmark_hashed_vecmap<Kmer, size_t>(count, query_frac, comm);
 //  BL_BENCH_COLLECTIVE_END(test, "hashed_vecmap", count, comm);
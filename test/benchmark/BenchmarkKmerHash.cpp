@@ -0,0 +1,270 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkKmerHash.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   compare the kmer hash functions on throughput and distribution quality.
+ * @details for each hash, and for a 1 word (k=31) and a 2 word (k=63) kmer, reports
+ *            throughput:      kmers hashed per second, per rank, over the kmers of a FASTQ file.
+ *            rank load:       max / mean kmers per rank, when the file's kmers are assigned by (prefix hash % p), for several p.
+ *                             this is how the distributed maps assign kmers to ranks.
+ *            bucket load:     max and variance / mean of the distinct kmers per bucket, with buckets = low bits of the hash,
+ *                             as in densehash, at load factor 0.5.  variance / mean is 1 for a random function.
+ *            avalanche:       smhasher style.  for random kmers, flip each input bit, and compute the probability of each output bit flipping.
+ *                             reports the mean and max bias |2 * P(flip) - 1|.
+ *          the load metrics are computed over all ranks' kmers, so they do not depend on the number of ranks used.
+ */
+
+#include "bliss-config.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <iostream>
+
+#include "utils/logging.h"
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/sequence_iterator.hpp"
+
+#include "utils/benchmark_utils.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+#include "mxx/reduction.hpp"
+
+
+/// simulated rank counts for the rank load.
+static const std::vector<size_t> rank_counts = {16, 64, 256, 1024, 4096};
+
+
+template <typename KmerType, template <typename, bool> class Hash>
+void benchmark_hash(std::string const & name, std::vector<KmerType> const & kmers,
+                    std::vector<KmerType> const & distinct, size_t iterations, ::mxx::comm const & comm) {
+
+  Hash<KmerType, false> store_hash;
+  Hash<KmerType, true> dist_hash;
+
+  // ============ throughput.
+  uint64_t dummy = 0;
+  comm.barrier();
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t it = 0; it < iterations; ++it) {
+    for (size_t i = 0; i < kmers.size(); ++i) {
+      dummy ^= store_hash(kmers[i]);
+    }
+  }
+  double secs = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+  double rate = (secs > 0) ? static_cast<double>(kmers.size() * iterations) / secs : 0.0;
+  double min_rate = ::mxx::allreduce(rate, ::mxx::min<double>(), comm);
+  double sum_rate = ::mxx::allreduce(rate, comm);
+
+  // ============ rank load, from the distribution hash, over all kmers including duplicates.
+  std::vector<double> rank_imbalance;
+  for (size_t p : rank_counts) {
+    std::vector<size_t> counts(p, 0);
+    for (size_t i = 0; i < kmers.size(); ++i) {
+      ++counts[dist_hash(kmers[i]) % p];
+    }
+    counts = ::mxx::allreduce(counts, std::plus<size_t>(), comm);
+    size_t total = std::accumulate(counts.begin(), counts.end(), static_cast<size_t>(0));
+    size_t mx = *(std::max_element(counts.begin(), counts.end()));
+    rank_imbalance.push_back((total == 0) ? 0.0 : static_cast<double>(mx) * static_cast<double>(p) / static_cast<double>(total));
+  }
+
+  // ============ bucket load, from the storage hash, over distinct kmers.  buckets is the power of 2 at load factor 0.5.
+  size_t n_distinct = ::mxx::allreduce(distinct.size(), comm);
+  size_t buckets = 2;
+  while (buckets < 2 * n_distinct) buckets <<= 1;
+  // bound the memory, by sampling the first 2^24 buckets only.
+  size_t sampled = std::min(buckets, static_cast<size_t>(1) << 24);
+  std::vector<uint32_t> loads(sampled, 0);
+  for (size_t i = 0; i < distinct.size(); ++i) {
+    size_t b = store_hash(distinct[i]) & (buckets - 1);
+    if (b < sampled) ++loads[b];
+  }
+  loads = ::mxx::allreduce(loads, std::plus<uint32_t>(), comm);
+  double mean = 0, var = 0;
+  uint32_t max_load = 0;
+  for (size_t i = 0; i < sampled; ++i) {
+    mean += loads[i];
+    max_load = std::max(max_load, loads[i]);
+  }
+  mean /= static_cast<double>(sampled);
+  for (size_t i = 0; i < sampled; ++i) {
+    var += (loads[i] - mean) * (loads[i] - mean);
+  }
+  var /= static_cast<double>(sampled);
+
+  // ============ avalanche.  rank 0 only, on random kmers (the file's kmers are not independent).
+  double mean_bias = 0, max_bias = 0;
+  if (comm.rank() == 0) {
+    constexpr size_t trials = 10000;
+    std::vector<uint32_t> flips(KmerType::nBits * 64, 0);
+
+    std::default_random_engine gen(17);
+    std::uniform_int_distribution<int> dist(0, KmerType::KmerAlphabet::SIZE - 1);
+    for (size_t t = 0; t < trials; ++t) {
+      KmerType km;
+      for (unsigned int j = 0; j < KmerType::size; ++j) km.nextFromChar(dist(gen));
+      uint64_t h = store_hash(km);
+
+      for (unsigned int bit = 0; bit < KmerType::nBits; ++bit) {
+        KmerType flipped(km);
+        flipped.getDataRef()[bit / (sizeof(typename KmerType::KmerWordType) * 8)] ^=
+            static_cast<typename KmerType::KmerWordType>(1) << (bit % (sizeof(typename KmerType::KmerWordType) * 8));
+        uint64_t d = h ^ store_hash(flipped);
+        for (unsigned int o = 0; o < 64; ++o) {
+          flips[bit * 64 + o] += (d >> o) & 1;
+        }
+      }
+    }
+    for (size_t i = 0; i < flips.size(); ++i) {
+      double bias = std::fabs(2.0 * static_cast<double>(flips[i]) / static_cast<double>(trials) - 1.0);
+      mean_bias += bias;
+      max_bias = std::max(max_bias, bias);
+    }
+    mean_bias /= static_cast<double>(flips.size());
+  }
+
+  // print.
+  dummy = ::mxx::allreduce(dummy, [](uint64_t const & x, uint64_t const & y) { return x ^ y; }, comm);
+  if (comm.rank() == 0) {
+    printf("%-10s k=%3u words=%u  throughput kmers/s/rank: min %.4g mean %.4g.  rank load max/mean:",
+           name.c_str(), KmerType::size, KmerType::nWords, min_rate, sum_rate / comm.size());
+    for (size_t i = 0; i < rank_counts.size(); ++i) {
+      printf(" p=%lu %.4f", rank_counts[i], rank_imbalance[i]);
+    }
+    printf(".  buckets %lu (%lu sampled) load max %u var/mean %.4f.  avalanche bias mean %.4f max %.4f.  (%lx)\n",
+           buckets, sampled, max_load, (mean > 0) ? var / mean : 0.0, mean_bias, max_bias, dummy & 0xF);
+  }
+}
+
+
+template <typename KmerType>
+void benchmark_hashes(std::string const & filename, size_t iterations, ::mxx::comm const & comm) {
+  BL_BENCH_INIT(hash);
+
+  BL_BENCH_START(hash);
+  std::vector<KmerType> kmers;
+  ::bliss::io::KmerFileHelper::template read_file_posix<::bliss::index::kmer::KmerParser<KmerType>,
+     ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, kmers, comm);
+  BL_BENCH_COLLECTIVE_END(hash, "read", kmers.size(), comm);
+
+  // distinct kmers, for the bucket loads.  kmers are not distributed, so the same kmer on 2 ranks counts twice.
+  BL_BENCH_START(hash);
+  std::vector<KmerType> distinct(kmers);
+  std::sort(distinct.begin(), distinct.end());
+  distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+  BL_BENCH_COLLECTIVE_END(hash, "distinct", distinct.size(), comm);
+
+  BL_BENCH_START(hash);
+  benchmark_hash<KmerType, ::bliss::kmer::hash::cpp_std>("std", kmers, distinct, iterations, comm);
+  BL_BENCH_COLLECTIVE_END(hash, "std", kmers.size(), comm);
+
+  BL_BENCH_START(hash);
+  benchmark_hash<KmerType, ::bliss::kmer::hash::identity>("identity", kmers, distinct, iterations, comm);
+  BL_BENCH_COLLECTIVE_END(hash, "identity", kmers.size(), comm);
+
+  BL_BENCH_START(hash);
+  benchmark_hash<KmerType, ::bliss::kmer::hash::murmur>("murmur", kmers, distinct, iterations, comm);
+  BL_BENCH_COLLECTIVE_END(hash, "murmur", kmers.size(), comm);
+
+  BL_BENCH_START(hash);
+  benchmark_hash<KmerType, ::bliss::kmer::hash::farm>("farm", kmers, distinct, iterations, comm);
+  BL_BENCH_COLLECTIVE_END(hash, "farm", kmers.size(), comm);
+
+  BL_BENCH_START(hash);
+  benchmark_hash<KmerType, ::bliss::kmer::hash::crc32c>("crc32c", kmers, distinct, iterations, comm);
+  BL_BENCH_COLLECTIVE_END(hash, "crc32c", kmers.size(), comm);
+
+  BL_BENCH_START(hash);
+  benchmark_hash<KmerType, ::bliss::kmer::hash::xxh3>("xxh3", kmers, distinct, iterations, comm);
+  BL_BENCH_COLLECTIVE_END(hash, "xxh3", kmers.size(), comm);
+
+  BL_BENCH_START(hash);
+  benchmark_hash<KmerType, ::bliss::kmer::hash::wyhash>("wyhash", kmers, distinct, iterations, comm);
+  BL_BENCH_COLLECTIVE_END(hash, "wyhash", kmers.size(), comm);
+
+  BL_BENCH_REPORT_MPI_NAMED(hash, "kmer_hash", comm);
+}
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+
+  comm.barrier();
+
+  //////////////// parse parameters
+
+  std::string filename;
+  filename.assign(PROJ_SRC_DIR);
+  filename.append("/test/data/test.medium.fastq");
+  size_t iterations = 10;
+
+  // Wrap everything in a try block.  Do this every time,
+  // because exceptions will be thrown for problems.
+  try {
+
+    // Define the command line object, and insert a message
+    // that describes the program. The "Command description message"
+    // is printed last in the help text. The second argument is the
+    // delimiter (usually space) and the last one is the version number.
+    // The CmdLine object parses the argv array based on the Arg objects
+    // that it contains.
+    TCLAP::CmdLine cmd("Benchmark kmer hash functions", ' ', "0.1");
+
+    TCLAP::ValueArg<std::string> fileArg("F", "file", "FASTQ file path", false, filename, "string", cmd);
+    TCLAP::ValueArg<size_t> iterArg("I", "iterations", "number of passes over the kmers for throughput", false, iterations, "size_t", cmd);
+
+    cmd.parse( argc, argv );
+
+    filename = fileArg.getValue();
+    iterations = iterArg.getValue();
+
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  // 1 word and 2 word kmers.
+  benchmark_hashes<::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t> >(filename, iterations, comm);
+  benchmark_hashes<::bliss::common::Kmer<63, ::bliss::common::DNA, uint64_t> >(filename, iterations, comm);
+
+  return 0;
+}
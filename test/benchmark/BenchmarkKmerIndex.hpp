@@ -0,0 +1,578 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkKmerIndex.hpp
+ * @ingroup
+ * @author  Tony Pan <tpan7@gatech.edu>
+ * @brief   kmer index benchmark, templated on the Kmer type.
+ * @details the parser, alphabet, kmer store, map, index, and hash types are selected by the pXXX compile flags
+ *          set in CMakeLists.txt.  the kmer length is either fixed by pK, or selected at runtime from the
+ *          pDISPATCH_K and pDISPATCH_DNA lists (see BenchmarkKmerIndex.cpp).
+ *
+ *          benchmark_kmer_index is only defined when pK is set, so that in the dispatching
+ *          executable each (alphabet, k) is instantiated once, in its own BenchmarkKmerIndexInst.cpp object.
+ */
+#ifndef BENCHMARK_KMER_INDEX_HPP_
+#define BENCHMARK_KMER_INDEX_HPP_
+
+#include "bliss-config.hpp"
+
+
+
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <iostream>  // for system("pause");
+
+#include "utils/logging.h"
+#include "utils/transform_utils.hpp"
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "common/base_types.hpp"
+#include "utils/kmer_utils.hpp"
+#include "utils/transform_utils.hpp"
+
+#include "io/mxx_support.hpp"
+
+#include "io/sequence_iterator.hpp"
+#include "io/sequence_id_iterator.hpp"
+
+#include "iterators/transform_iterator.hpp"
+
+#include "common/kmer_iterators.hpp"
+
+#include "iterators/zip_iterator.hpp"
+
+#include "index/quality_score_iterator.hpp"
+
+#include "index/kmer_index.hpp"
+
+#include "utils/benchmark_utils.hpp"
+#include "utils/exception_handling.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+
+// ================ define preproc macro constants
+// needed as #if can only calculate constant int expressions
+#define FASTA 1
+#define FASTQ 0
+
+#define IDEN 10
+#define LEX 11
+#define XOR 12
+
+#define STD 21
+#define MURMUR 22
+#define FARM 23
+#define CRC32C 24
+#define XXH3 25
+#define WYHASH 26
+
+#define POS 31
+#define POSQUAL 32
+#define COUNT 33
+
+#define SORTED 41
+#define ORDERED 42
+#define VEC 43
+#define COMPACTVEC 44
+#define HASHEDVEC 45
+#define UNORDERED 46
+#define DENSEHASH 47
+#define DENSEHASH_SEG 48
+#define CSRVEC 49
+#define COMPRESSED 50
+
+#define SINGLE 51
+#define CANONICAL 52
+#define BIMOLECULE 53
+
+
+
+//================= define types - changeable here...
+
+//================= define types - changeable here...
+
+//========   Kmer parameters
+#if (pDNA == 16)
+using Alphabet = bliss::common::DNA16;
+#elif (pDNA == 5)
+using Alphabet = bliss::common::DNA5;
+#elif (pDNA == 4)
+using Alphabet = bliss::common::DNA;
+#endif
+
+#if defined(pK)
+using KmerType = bliss::common::Kmer<pK, Alphabet, WordType>;
+#endif
+
+//============== index input file format
+#if (pPARSER == FASTA)
+	using IdType = bliss::common::LongSequenceKmerId;
+#define PARSER_TYPE ::bliss::io::FASTAParser
+#elif (pPARSER == FASTQ)
+	using IdType = bliss::common::ShortSequenceKmerId;
+#define PARSER_TYPE ::bliss::io::FASTQParser
+#endif
+
+
+
+// ============  index value type
+using QualType = float;
+using KmerInfoType = std::pair<IdType, QualType>;
+using CountType = uint32_t;
+
+#if (pINDEX == POS)
+	using ValType = IdType;
+#elif (pINDEX == POSQUAL)
+	using ValType = KmerInfoType;
+#elif (pINDEX == COUNT)
+	using ValType = CountType;
+#endif
+
+
+
+
+//============== MAP properties
+
+
+//----- get them all. may not use subsequently.
+
+// distribution transforms
+#if (pDistTrans == LEX)
+	template <typename KM>
+	using DistTrans = bliss::kmer::transform::lex_less<KM>;
+#elif (pDistTrans == XOR)
+	template <typename KM>
+	using DistTrans = bliss::kmer::transform::xor_rev_comp<KM>;
+#else //if (pDistTrans == IDEN)
+	template <typename KM>
+	using DistTrans = bliss::transform::identity<KM>;
+#endif
+
+// distribution hash
+#if (pDistHash == STD)
+	template <typename KM>
+	using DistHash = bliss::kmer::hash::cpp_std<KM, true>;
+#elif (pDistHash == IDEN)
+	template <typename KM>
+	using DistHash = bliss::kmer::hash::identity<KM, true>;
+#elif (pDistHash == MURMUR)
+	template <typename KM>
+	using DistHash = bliss::kmer::hash::murmur<KM, true>;
+#elif (pDistHash == CRC32C)
+	template <typename KM>
+	using DistHash = bliss::kmer::hash::crc32c<KM, true>;
+#elif (pDistHash == XXH3)
+	template <typename KM>
+	using DistHash = bliss::kmer::hash::xxh3<KM, true>;
+#elif (pDistHash == WYHASH)
+	template <typename KM>
+	using DistHash = bliss::kmer::hash::wyhash<KM, true>;
+#else // if (pDistHash == FARM)
+	template <typename KM>
+	using DistHash = bliss::kmer::hash::farm<KM, true>;
+#endif
+
+
+// storage hash type
+#if (pStoreHash == STD)
+	template <typename KM>
+	using StoreHash = bliss::kmer::hash::cpp_std<KM, false>;
+#elif (pStoreHash == IDEN)
+	template <typename KM>
+	using StoreHash = bliss::kmer::hash::identity<KM, false>;
+#elif (pStoreHash == MURMUR)
+	template <typename KM>
+	using StoreHash = bliss::kmer::hash::murmur<KM, false>;
+#elif (pStoreHash == CRC32C)
+	template <typename KM>
+	using StoreHash = bliss::kmer::hash::crc32c<KM, false>;
+#elif (pStoreHash == XXH3)
+	template <typename KM>
+	using StoreHash = bliss::kmer::hash::xxh3<KM, false>;
+#elif (pStoreHash == WYHASH)
+	template <typename KM>
+	using StoreHash = bliss::kmer::hash::wyhash<KM, false>;
+#else //if (pStoreHash == FARM)
+	template <typename KM>
+	using StoreHash = bliss::kmer::hash::farm<KM, false>;
+#endif
+
+
+
+// ==== define Map parameter
+#if (pMAP == SORTED) || (pMAP == COMPRESSED)
+	// choose a MapParam based on type of map and kmer model (canonical, original, bimolecule)
+	#if (pKmerStore == SINGLE)  // single stranded
+		template <typename Key>
+		using MapParams = ::bliss::index::kmer::SingleStrandSortedMapParams<Key>;
+	#elif (pKmerStore == CANONICAL)
+		template <typename Key>
+		using MapParams = ::bliss::index::kmer::CanonicalSortedMapParams<Key>;
+	#elif (pKmerStore == BIMOLECULE)  // bimolecule
+		template <typename Key>
+		using MapParams = ::bliss::index::kmer::BimoleculeSortedMapParams<Key>;
+	#endif
+
+	// DEFINE THE MAP TYPE base on the type of data to be stored.
+	#if ((pINDEX == POS) || (pINDEX == POSQUAL)) && (pMAP == COMPRESSED)  // multimap, compressed after build
+		template <typename KM>
+		using MapType = ::dsc::compressed_sorted_multimap<
+				KM, ValType, MapParams>;
+	#elif (pINDEX == POS) || (pINDEX == POSQUAL)  // multimap
+		template <typename KM>
+		using MapType = ::dsc::sorted_multimap<
+				KM, ValType, MapParams>;
+	#elif (pINDEX == COUNT)  // map
+		template <typename KM>
+		using MapType = ::dsc::counting_sorted_map<
+				KM, ValType, MapParams>;
+	#endif
+
+
+#elif (pMAP == ORDERED)
+	// choose a MapParam based on type of map and kmer model (canonical, original, bimolecule)
+	#if (pKmerStore == SINGLE)  // single stranded
+		template <typename Key>
+		using MapParams = ::bliss::index::kmer::SingleStrandOrderedMapParams<Key, DistHash, ::std::less, DistTrans>;
+	#elif (pKmerStore == CANONICAL)
+		template <typename Key>
+		using MapParams = ::bliss::index::kmer::CanonicalOrderedMapParams<Key, DistHash>;
+	#elif (pKmerStore == BIMOLECULE)  // bimolecule
+		template <typename Key>
+		using MapParams = ::bliss::index::kmer::BimoleculeOrderedMapParams<Key, DistHash>;
+	#endif
+
+	// DEFINE THE MAP TYPE base on the type of data to be stored.
+	#if (pINDEX == POS) || (pINDEX == POSQUAL)  // multimap
+		template <typename KM>
+		using MapType = ::dsc::multimap<
+				KM, ValType, MapParams>;
+	#elif (pINDEX == COUNT)  // map
+		template <typename KM>
+		using MapType = ::dsc::counting_map<
+				KM, ValType, MapParams>;
+	#endif
+
+
+#else  // hashmap
+
+  // choose a MapParam based on type of map and kmer model (canonical, original, bimolecule)
+  #if (pKmerStore == SINGLE)  // single stranded
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::SingleStrandHashMapParams<Key, DistHash, StoreHash, DistTrans>;
+    template <typename KM>
+    using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KM, false>;
+  #elif (pKmerStore == CANONICAL)
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::CanonicalHashMapParams<Key, DistHash, StoreHash>;
+    template <typename KM>
+    using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KM, true>;
+  #elif (pKmerStore == BIMOLECULE)  // bimolecule
+    template <typename Key>
+    using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<Key, DistHash, StoreHash>;
+    template <typename KM>
+    using SpecialKeys = ::bliss::kmer::hash::sparsehash::special_keys<KM, false>;
+  #endif
+
+
+  // DEFINE THE MAP TYPE base on the type of data to be stored.
+  #if (pINDEX == POS) || (pINDEX == POSQUAL)  // multimap
+//    #if (pMAP == VEC)
+//      using MapType = ::dsc::unordered_multimap_vec<
+//          KM, ValType, MapParams>;
+//
+//   #elif (pMAP == UNORDERED)
+    #if (pMAP == UNORDERED)
+      template <typename KM>
+      using MapType = ::dsc::unordered_multimap<
+          KM, ValType, MapParams>;
+//    #elif (pMAP == COMPACTVEC)
+//      using MapType = ::dsc::unordered_multimap_compact_vec<
+//          KM, ValType, MapParams>;
+//    #elif (pMAP == HASHEDVEC)
+//      using MapType = ::dsc::unordered_multimap_hashvec<
+//          KM, ValType, MapParams>;
+    #elif (pMAP == DENSEHASH)
+      template <typename KM>
+      using MapType = ::dsc::densehash_multimap<
+          KM, ValType, MapParams, SpecialKeys<KM> >;
+    #elif (pMAP == CSRVEC)
+      template <typename KM>
+      using MapType = ::dsc::unordered_multimap_csr<
+          KM, ValType, MapParams>;
+    #endif
+  #elif (pINDEX == COUNT)  // map
+    #if (pMAP == DENSEHASH)
+      template <typename KM>
+      using MapType = ::dsc::counting_densehash_map<
+        KM, ValType, MapParams, SpecialKeys<KM> >;
+    #elif (pMAP == DENSEHASH_SEG)
+      template <typename KM>
+      using MapType = ::dsc::counting_densehash_map<
+        KM, ValType, MapParams, SpecialKeys<KM>,
+        ::std::allocator< ::std::pair<const KM, ValType> >, ::fsc::densehash_segmented_map>;
+    #else
+      template <typename KM>
+      using MapType = ::dsc::counting_unordered_map<
+        KM, ValType, MapParams>;
+    #endif
+  #endif
+
+
+#endif
+
+
+
+
+//================ FINALLY, the actual index type.
+
+#if (pINDEX == POS)
+	template <typename KM>
+	using IndexType = bliss::index::kmer::PositionIndex<MapType<KM> >;
+
+#elif (pINDEX == POSQUAL)
+	template <typename KM>
+	using IndexType = bliss::index::kmer::PositionQualityIndex<MapType<KM> >;
+
+#elif (pINDEX == COUNT)  // map
+	template <typename KM>
+	using IndexType = bliss::index::kmer::CountIndex<MapType<KM> >;
+#endif
+
+
+
+/*
+ * BENCHMARK Kmer index building.
+ *
+ * variables:   hash function   (std, murmur, farm)
+ *              store canonical or not (canonicalize on the fly, canonicalize on build/query, no op on build, query doubled)
+ *              k (15, 21, 31, 63)
+ *              backing container type (hashmap, unordered vecmap, sorted array)
+ *
+ *              file reader type - mpi-io, mmap, fileloader without prefetch.  mpi-io performs really well when file's cached.
+ *
+ */
+
+//template <typename IndexType, typename KmerType = typename IndexType::KmerType>
+//std::vector<KmerType> readForQuery(const std::string & filename, MPI_Comm comm) {
+//
+//  ::std::vector<KmerType> query;
+//
+//  IndexType::template read_file<PARSER_TYPE, ::bliss::index::kmer::KmerParser<KmerType> >(filename, query, comm);
+//
+//  return query;
+//}
+
+
+template <typename IndexType, typename KmerType = typename IndexType::KmerType>
+std::vector<KmerType> readForQuery_mpiio(const std::string & filename, MPI_Comm comm) {
+
+  ::std::vector<KmerType> query;
+
+  IndexType idx(comm);
+
+  ::bliss::io::KmerFileHelper::template read_file_mpiio<::bliss::index::kmer::KmerParser<KmerType>, PARSER_TYPE, bliss::io::SequencesIterator >(filename, query, comm);
+
+  return query;
+}
+
+template <typename IndexType, typename KmerType = typename IndexType::KmerType>
+std::vector<KmerType> readForQuery_mmap(const std::string & filename, MPI_Comm comm) {
+
+  ::std::vector<KmerType> query;
+  IndexType idx(comm);
+
+  // default to including quality score iterators.
+  ::bliss::io::KmerFileHelper::template read_file_mmap<::bliss::index::kmer::KmerParser<KmerType>, PARSER_TYPE, bliss::io::SequencesIterator >(filename, query, comm);
+
+  return query;
+}
+
+
+template <typename IndexType, typename KmerType = typename IndexType::KmerType>
+std::vector<KmerType> readForQuery_posix(const std::string & filename, MPI_Comm comm) {
+
+  ::std::vector<KmerType> query;
+  IndexType idx(comm);
+
+  // default to including quality score iterators.
+  ::bliss::io::KmerFileHelper::template read_file_posix<::bliss::index::kmer::KmerParser<KmerType>, PARSER_TYPE, bliss::io::SequencesIterator  >(filename, query, comm);
+
+  return query;
+}
+
+
+template<typename KmerType>
+void sample(std::vector<KmerType> &query, size_t n, unsigned int seed, mxx::comm const & comm) {
+  std::shuffle(query.begin(), query.end(), std::default_random_engine(seed));
+
+  size_t n_p = (n / comm.size());
+  std::vector<size_t> send_counts(comm.size(), n_p);
+
+  if (n < static_cast<size_t>(comm.size())) {
+    n_p = 1;
+
+    for (size_t i = 0; i < n; ++i) {
+      send_counts[(i + comm.rank()) % comm.size()] = 1;
+    }
+    for (int i = n; i < comm.size(); ++i) {
+      send_counts[(i + comm.rank()) % comm.size()] = 0;
+    }
+  }
+
+  std::vector<KmerType> out = ::mxx::all2allv(query, send_counts, comm);
+  query.swap(out);
+}
+
+
+/**
+ * @brief run the benchmark for 1 kmer type:  read the query, build the index, then count, find, and erase.
+ * @param filename      file to index
+ * @param queryname     file to query
+ * @param reader_algo   file reader.  mmap = 5, posix = 7, mpiio = 10.
+ * @param sample_ratio  1 in sample_ratio query kmers are used.
+ */
+template <typename KmerType>
+void benchmark_kmer_index(std::string const & filename, std::string const & queryname,
+                          int reader_algo, int sample_ratio, mxx::comm const & comm);
+
+#if defined(pK)
+template <typename KmerType>
+void benchmark_kmer_index(std::string const & filename, std::string const & queryname,
+                          int reader_algo, int sample_ratio, mxx::comm const & comm) {
+  using IndexType = ::IndexType<KmerType>;
+
+  // ================  read and get file
+  IndexType idx(comm);
+
+  BL_BENCH_INIT(test);
+
+  if (comm.rank() == 0) printf("reading query %s via posix\n", queryname.c_str());
+  BL_BENCH_START(test);
+  auto query = readForQuery_posix<IndexType>(queryname, comm);
+  BL_BENCH_COLLECTIVE_END(test, "read_query", query.size(), comm);
+
+  BL_BENCH_START(test);
+  sample(query, query.size() / sample_ratio, comm.rank(), comm);
+  BL_BENCH_COLLECTIVE_END(test, "sample", query.size(), comm);
+
+
+  {
+	  ::std::vector<typename IndexType::KmerParserType::value_type> temp;
+
+	  BL_BENCH_START(test);
+//	  if (reader_algo == 2)
+//	  {
+//		if (comm.rank() == 0) printf("reading %s via fileloader\n", filename.c_str());
+//
+//		idx.read_file<PARSER_TYPE, typename IndexType::KmerParserType>(filename, temp, comm);
+//
+//	  } else
+	  if (reader_algo == 5) {
+		if (comm.rank() == 0) printf("reading %s via mmap\n", filename.c_str());
+		::bliss::io::KmerFileHelper::read_file_mmap<typename IndexType::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm);
+
+	  } else if (reader_algo == 7) {
+		if (comm.rank() == 0) printf("reading %s via posix\n", filename.c_str());
+		::bliss::io::KmerFileHelper::read_file_posix<typename IndexType::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm);
+
+	  } else if (reader_algo == 10){
+		if (comm.rank() == 0) printf("reading %s via mpiio\n", filename.c_str());
+		::bliss::io::KmerFileHelper::read_file_mpiio<typename IndexType::KmerParserType, PARSER_TYPE, bliss::io::SequencesIterator>(filename, temp, comm);
+	  } else {
+		throw std::invalid_argument("missing file reader type");
+	  }
+	  BL_BENCH_COLLECTIVE_END(test, "read", temp.size(), comm);
+
+	  size_t total = mxx::allreduce(temp.size(), comm);
+	  if (comm.rank() == 0) printf("total size is %lu\n", total);
+
+	  BL_BENCH_START(test);
+	  idx.insert(temp);
+	  BL_BENCH_COLLECTIVE_END(test, "insert", idx.local_size(), comm);
+
+#if (pMAP == COMPRESSED)
+	  BL_BENCH_START(test);
+	  idx.get_map().compress();
+	  BL_BENCH_COLLECTIVE_END(test, "compress", idx.get_map().local_compressed_bytes(), comm);
+#endif
+
+    total = idx.size();
+    if (comm.rank() == 0) printf("total size after insert/rehash is %lu\n", total);
+  }
+
+  {
+
+	  {
+		  auto lquery = query;
+		  BL_BENCH_START(test);
+		  auto counts = idx.count(lquery);
+		  BL_BENCH_COLLECTIVE_END(test, "count", counts.size(), comm);
+	  }
+	  {
+		  auto lquery = query;
+		  BL_BENCH_START(test);
+		  auto found = idx.find(lquery);
+		  BL_BENCH_COLLECTIVE_END(test, "find", found.size(), comm);
+	  }
+#if 0
+	  // separate test because of it being potentially very slow depending on imbalance.
+	  {
+		  auto lquery = query;
+
+	  BL_BENCH_START(test);
+	  auto found = idx.find_collective(lquery);
+	  BL_BENCH_COLLECTIVE_END(test, "find_collective", found.size(), comm);
+	  }
+	    {
+	      auto lquery = query;
+
+	    BL_BENCH_START(test);
+	    auto found = idx.find_overlap(lquery);
+	    BL_BENCH_COLLECTIVE_END(test, "find_overlap", found.size(), comm);
+	    }
+    // separate test because of it being potentially very slow depending on imbalance.
+    {
+      auto lquery = query;
+
+    BL_BENCH_START(test);
+    auto found = idx.find_sendrecv(lquery);
+    BL_BENCH_COLLECTIVE_END(test, "find_sendrecv", found.size(), comm);
+    }
+#endif
+
+	  BL_BENCH_START(test);
+	  idx.erase(query);
+	  BL_BENCH_COLLECTIVE_END(test, "erase", idx.local_size(), comm);
+
+  }
+
+  
+  BL_BENCH_REPORT_MPI_NAMED(test, "app", comm);
+}
+#endif
+
+#endif // BENCHMARK_KMER_INDEX_HPP_
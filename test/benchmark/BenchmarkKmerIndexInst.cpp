@@ -0,0 +1,29 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkKmerIndexInst.cpp
+ * @ingroup
+ * @author  Tony Pan <tpan7@gatech.edu>
+ * @brief   explicit instantiation of the kmer index benchmark for 1 (alphabet, k), set by pDNA and pK.
+ * @details compiled once per (alphabet, k) and linked into the dispatching BenchmarkKmerIndex executable,
+ *          so the specializations compile in parallel and are shared by the executables with the same map configuration.
+ */
+
+#include "BenchmarkKmerIndex.hpp"
+
+template void benchmark_kmer_index<KmerType>(std::string const & filename, std::string const & queryname,
+                                             int reader_algo, int sample_ratio, mxx::comm const & comm);
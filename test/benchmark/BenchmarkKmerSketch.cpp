@@ -0,0 +1,179 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkKmerSketch.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   sketch the canonical kmers of each input file, and compare all pairs of samples.
+ * @details each file is read by all ranks, its kmers are sketched locally block by block as they are parsed, and the
+ *          local sketches are reduced (see index/kmer_sketch.hpp), so no index is built and the kmers of a file are
+ *          never all in memory.
+ *          existing sketch files (.sketch) are loaded instead of read.  the pairwise comparisons are distributed.
+ *
+ *          rank 0 writes <prefix>.csv with 1 row per pair:  first, second, jaccard, containment of first in
+ *          second and of second in first, and the hashes in the intersection and union.  with --save, the
+ *          sketches are written to <input>.sketch.
+ */
+
+#include "bliss-config.hpp"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <iostream>
+
+#include "utils/logging.h"
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_index.hpp"
+#include "index/kmer_sketch.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/sequence_iterator.hpp"
+
+#include "utils/benchmark_utils.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+using SketchType = ::bliss::index::kmer::kmer_sketch<KmerType>;
+
+
+static bool ends_with(std::string const & s, std::string const & suffix) {
+  return (s.size() >= suffix.size()) && (s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+/// sketch 1 file.  collective.
+SketchType sketch_file(std::string const & filename, SketchType::mode_type mode, uint64_t param, uint32_t seed,
+                       ::mxx::comm const & comm) {
+  SketchType sketch(mode, param, seed);
+  if (ends_with(filename, ".sketch")) {
+    sketch.load(filename);
+    return sketch;
+  }
+
+  if (ends_with(filename, ".fasta") || ends_with(filename, ".fa") || ends_with(filename, ".fna")) {
+    sketch.template insert_file<::bliss::io::FASTAParser>(filename, comm);
+  } else {
+    sketch.template insert_file<::bliss::io::FASTQParser>(filename, comm);
+  }
+  sketch.reduce(comm);
+  return sketch;
+}
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+
+  comm.barrier();
+
+  //////////////// parse parameters
+
+  std::vector<std::string> filenames;
+  std::string prefix("sketch");
+  uint64_t size = 1000;
+  uint64_t scale = 0;
+  uint32_t seed = 42;
+  bool save = false;
+
+  // Wrap everything in a try block.  Do this every time,
+  // because exceptions will be thrown for problems.
+  try {
+
+    // Define the command line object, and insert a message
+    // that describes the program. The "Command description message"
+    // is printed last in the help text. The second argument is the
+    // delimiter (usually space) and the last one is the version number.
+    // The CmdLine object parses the argv array based on the Arg objects
+    // that it contains.
+    TCLAP::CmdLine cmd("All vs all comparison of samples by bottom-k or FracMinHash sketches of their canonical kmers", ' ', "0.1");
+
+    TCLAP::ValueArg<uint64_t> sizeArg("k", "sketch-size", "bottom-k sketch size", false, size, "uint64_t", cmd);
+    TCLAP::ValueArg<uint64_t> scaleArg("s", "scale", "FracMinHash scale.  keeps 1 / scale of the hashes.  0 for bottom-k", false, scale, "uint64_t", cmd);
+    TCLAP::ValueArg<uint32_t> seedArg("r", "seed", "hash seed", false, seed, "uint32_t", cmd);
+    TCLAP::ValueArg<std::string> outArg("O", "output", "path prefix of the CSV", false, prefix, "string", cmd);
+    TCLAP::SwitchArg saveArg("S", "save", "write each sketch to <input>.sketch", cmd, false);
+    TCLAP::UnlabeledMultiArg<std::string> fileArg("filenames", "FASTQ or FASTA (.fasta, .fa, .fna) files, or saved .sketch files", true, "string", cmd);
+
+    cmd.parse( argc, argv );
+
+    filenames = fileArg.getValue();
+    prefix = outArg.getValue();
+    size = sizeArg.getValue();
+    scale = scaleArg.getValue();
+    seed = seedArg.getValue();
+    save = saveArg.getValue();
+
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  SketchType::mode_type mode = (scale > 0) ? SketchType::FRAC_MIN_HASH : SketchType::BOTTOM_K;
+  uint64_t param = (scale > 0) ? scale : size;
+
+  BL_BENCH_INIT(sketch);
+
+  BL_BENCH_START(sketch);
+  std::vector<SketchType> sketches;
+  for (auto const & fn : filenames) {
+    sketches.emplace_back(sketch_file(fn, mode, param, seed, comm));
+    if (save && (comm.rank() == 0) && !ends_with(fn, ".sketch")) sketches.back().save(fn + ".sketch");
+  }
+  BL_BENCH_COLLECTIVE_END(sketch, "sketch", sketches.size(), comm);
+
+  BL_BENCH_START(sketch);
+  auto sims = SketchType::all_vs_all(sketches, comm);
+  BL_BENCH_COLLECTIVE_END(sketch, "all_vs_all", sims.size(), comm);
+
+  if (comm.rank() == 0) {
+    std::string fn = prefix + ".csv";
+    FILE * f = fopen(fn.c_str(), "w");
+    if (f == nullptr) {
+      std::cerr << "error: unable to write " << fn << std::endl;
+    } else {
+      fprintf(f, "first,second,jaccard,containment_first,containment_second,intersection,union\n");
+      size_t n = sketches.size();
+      for (size_t i = 0; i < n; ++i) {
+        for (size_t j = i + 1; j < n; ++j) {
+          auto const & s = sims[i * n + j];
+          fprintf(f, "%s,%s,%.6f,%.6f,%.6f,%lu,%lu\n", filenames[i].c_str(), filenames[j].c_str(),
+                  s.jaccard, s.containment_first, s.containment_second, s.intersection, s.union_size);
+        }
+      }
+      fclose(f);
+    }
+  }
+
+  BL_BENCH_REPORT_MPI_NAMED(sketch, "kmer_sketch", comm);
+
+  return 0;
+}
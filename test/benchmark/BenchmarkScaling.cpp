@@ -0,0 +1,328 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    BenchmarkScaling.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   strong and weak scaling of kmer count index build and query, on synthetic reads.
+ * @details for each scaling point p, the first p ranks form a sub communicator, which
+ *            generates:  writes synthetic reads (see io/read_simulator.hpp) to <prefix>.<mode>.p<p>.fastq via MPI-IO,
+ *                        and a query read set with a different seed.
+ *            build:      builds a canonical kmer count index from the file.
+ *            query:      reads the query kmers, then counts and finds them in the index.
+ *          strong scaling keeps the genome size fixed, weak scaling multiplies it by p.
+ *
+ *          rank 0 writes 1 CSV row per point and phase to <prefix>.csv:  mode, procs, genome size, reads, kmers, phase,
+ *          max and mean seconds across ranks, and kmers per second.  the parameters are fixed by the seed, so
+ *          the rows are comparable between runs and builds.  with BL_TELEMETRY set, or with --telemetry, the per phase
+ *          telemetry of the index internals is additionally written to <prefix>.telemetry.csv (see utils/telemetry.hpp),
+ *          with the timer titles prefixed by the scaling point.
+ */
+
+#include "bliss-config.hpp"
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#include "utils/logging.h"
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "containers/distributed_densehash_map.hpp"
+#include "io/kmer_file_helper.hpp"
+#include "io/sequence_iterator.hpp"
+#include "io/read_simulator.hpp"
+
+#include "utils/benchmark_utils.hpp"
+#include "utils/telemetry.hpp"
+
+#include "tclap/CmdLine.h"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+
+using KmerType = ::bliss::common::Kmer<31, ::bliss::common::DNA, uint64_t>;
+
+template <typename Key>
+using MapParams = ::bliss::index::kmer::CanonicalHashMapParams<Key, ::bliss::index::kmer::DistHashFarm, ::bliss::index::kmer::StoreHashFarm>;
+using MapType = ::dsc::counting_densehash_map<KmerType, uint32_t, MapParams,
+    ::bliss::kmer::hash::sparsehash::special_keys<KmerType, true> >;
+using IndexType = ::bliss::index::kmer::CountIndex2<MapType>;
+
+
+/// times the phases of 1 scaling point, and formats them as CSV rows on rank 0.
+class scaling_point {
+  protected:
+    std::string prefix;
+    ::mxx::comm const & comm;
+    std::chrono::steady_clock::time_point t1;
+
+  public:
+    std::stringstream rows;
+
+    /// prefix:  the leading columns of each row.
+    scaling_point(std::string const & _prefix, ::mxx::comm const & _comm) : prefix(_prefix), comm(_comm) {}
+
+    void start() {
+      comm.barrier();
+      t1 = std::chrono::steady_clock::now();
+    }
+
+    /// end a phase that processed n_elem elements on this rank.
+    void end(std::string const & phase, size_t n_elem) {
+      double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+      double mx = ::mxx::allreduce(secs, [](double const & x, double const & y) { return std::max(x, y); }, comm);
+      double sum = ::mxx::allreduce(secs, std::plus<double>(), comm);
+      size_t total = ::mxx::allreduce(n_elem, std::plus<size_t>(), comm);
+
+      if (comm.rank() == 0) {
+        rows << prefix << "," << phase << "," << total << "," << mx << "," << (sum / comm.size()) << "," <<
+            ((mx > 0) ? static_cast<double>(total) / mx : 0.0) << "\n";
+        printf("[SCALING] %s,%s,%lu,%.6f,%.6f\n", prefix.c_str(), phase.c_str(), total, mx, sum / comm.size());
+      }
+    }
+};
+
+
+/// run 1 scaling point on the sub communicator.  returns the CSV rows on rank 0.
+std::string run_point(std::string const & mode, ::bliss::io::read_sim_params params, double query_coverage,
+                      std::string const & prefix, bool keep, ::mxx::comm const & comm) {
+  std::stringstream name;
+  name << prefix << "." << mode << ".p" << comm.size();
+  std::string filename = name.str() + ".fastq";
+  std::string queryname = name.str() + ".query.fastq";
+
+  ::bliss::io::read_simulator sim(params);
+  ::bliss::io::read_sim_params qparams(params);
+  qparams.coverage = query_coverage;
+  qparams.seed = params.seed + 1;
+  ::bliss::io::read_simulator qsim(qparams);
+
+  std::stringstream cols;
+  cols << mode << "," << comm.size() << "," << params.genome_size << "," << sim.num_reads() << "," <<
+      (sim.num_reads() * (params.read_length - KmerType::size + 1));
+  scaling_point point(cols.str(), comm);
+
+  BL_BENCH_INIT(scaling);
+
+  BL_BENCH_START(scaling);
+  point.start();
+  size_t reads = sim.write(filename, comm);
+  reads += qsim.write(queryname, comm);
+  point.end("generate", reads);
+  BL_BENCH_COLLECTIVE_END(scaling, "generate", reads, comm);
+
+  IndexType idx(comm);
+
+  BL_BENCH_START(scaling);
+  point.start();
+  idx.template build_posix<::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(filename, comm);
+  point.end("build", idx.local_size());
+  BL_BENCH_COLLECTIVE_END(scaling, "build", idx.local_size(), comm);
+
+  BL_BENCH_START(scaling);
+  point.start();
+  std::vector<KmerType> query;
+  ::bliss::io::KmerFileHelper::template read_file_posix<::bliss::index::kmer::KmerParser<KmerType>,
+     ::bliss::io::FASTQParser, ::bliss::io::SequencesIterator>(queryname, query, comm);
+  point.end("read_query", query.size());
+  BL_BENCH_COLLECTIVE_END(scaling, "read_query", query.size(), comm);
+
+  {
+    std::vector<KmerType> q(query);
+    BL_BENCH_START(scaling);
+    point.start();
+    auto counts = idx.count(q);
+    point.end("count", query.size());
+    BL_BENCH_COLLECTIVE_END(scaling, "count", counts.size(), comm);
+  }
+
+  {
+    std::vector<KmerType> q(query);
+    BL_BENCH_START(scaling);
+    point.start();
+    auto found = idx.find(q);
+    point.end("find", query.size());
+    BL_BENCH_COLLECTIVE_END(scaling, "find", found.size(), comm);
+  }
+
+  std::stringstream title;
+  title << "scaling:" << mode << ".p" << comm.size();
+  BL_BENCH_REPORT_MPI_NAMED(scaling, title.str(), comm);
+
+  if (!keep) {
+    comm.barrier();
+    if (comm.rank() == 0) {
+      std::remove(filename.c_str());
+      std::remove(queryname.c_str());
+    }
+  }
+
+  return point.rows.str();
+}
+
+
+int main(int argc, char** argv) {
+
+  //////////////// init logging
+  LOG_INIT();
+
+  //////////////// initialize MPI and openMP
+
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  if (comm.rank() == 0) printf("EXECUTING %s\n", argv[0]);
+
+  comm.barrier();
+
+  //////////////// parse parameters
+
+  ::bliss::io::read_sim_params params;
+  std::string mode("both");
+  std::string prefix("scaling");
+  std::string points;
+  double query_coverage = 1.0;
+  bool keep = false;
+  bool telemetry = false;
+
+  // Wrap everything in a try block.  Do this every time,
+  // because exceptions will be thrown for problems.
+  try {
+
+    // Define the command line object, and insert a message
+    // that describes the program. The "Command description message"
+    // is printed last in the help text. The second argument is the
+    // delimiter (usually space) and the last one is the version number.
+    // The CmdLine object parses the argv array based on the Arg objects
+    // that it contains.
+    TCLAP::CmdLine cmd("Strong and weak scaling of kmer index build and query on synthetic reads", ' ', "0.1");
+
+    std::vector<std::string> modes = {"strong", "weak", "both"};
+    TCLAP::ValuesConstraint<std::string> modeVals(modes);
+    TCLAP::ValueArg<std::string> modeArg("m", "mode", "scaling mode", false, mode, &modeVals, cmd);
+    TCLAP::ValueArg<std::string> pointsArg("p", "procs", "comma separated rank counts.  default: powers of 2 up to, and including, all ranks",
+                                           false, points, "string", cmd);
+    TCLAP::ValueArg<std::string> outArg("O", "output", "path prefix of the synthetic files and the CSV", false, prefix, "string", cmd);
+    TCLAP::SwitchArg keepArg("K", "keep", "keep the synthetic files", cmd, false);
+    TCLAP::SwitchArg telArg("T", "telemetry", "write the phase telemetry to <output>.telemetry.*", cmd, false);
+
+    TCLAP::ValueArg<size_t> genomeArg("G", "genome", "genome size.  per rank for weak scaling", false, params.genome_size, "size_t", cmd);
+    TCLAP::ValueArg<double> repeatArg("R", "repeat-fraction", "fraction of the genome in repeat copies", false, params.repeat_fraction, "double", cmd);
+    TCLAP::ValueArg<size_t> repeatLenArg("L", "repeat-length", "length of a repeat copy", false, params.repeat_length, "size_t", cmd);
+    TCLAP::ValueArg<size_t> copiesArg("C", "repeat-copies", "copies per repeat family", false, params.repeat_copies, "size_t", cmd);
+    TCLAP::ValueArg<double> covArg("c", "coverage", "read coverage", false, params.coverage, "double", cmd);
+    TCLAP::ValueArg<double> qcovArg("q", "query-coverage", "query read coverage", false, query_coverage, "double", cmd);
+    TCLAP::ValueArg<size_t> lenArg("l", "read-length", "read length", false, params.read_length, "size_t", cmd);
+    TCLAP::ValueArg<double> errArg("e", "error-rate", "per base substitution rate", false, params.error_rate, "double", cmd);
+    TCLAP::ValueArg<double> nArg("n", "n-rate", "per base N rate", false, params.n_rate, "double", cmd);
+    TCLAP::ValueArg<uint64_t> seedArg("s", "seed", "random seed", false, params.seed, "uint64_t", cmd);
+
+    cmd.parse( argc, argv );
+
+    mode = modeArg.getValue();
+    points = pointsArg.getValue();
+    prefix = outArg.getValue();
+    keep = keepArg.getValue();
+    telemetry = telArg.getValue();
+
+    params.genome_size = genomeArg.getValue();
+    params.repeat_fraction = repeatArg.getValue();
+    params.repeat_length = repeatLenArg.getValue();
+    params.repeat_copies = copiesArg.getValue();
+    params.coverage = covArg.getValue();
+    query_coverage = qcovArg.getValue();
+    params.read_length = lenArg.getValue();
+    params.error_rate = errArg.getValue();
+    params.n_rate = nArg.getValue();
+    params.seed = seedArg.getValue();
+
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  {
+    std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    exit(-1);
+  }
+
+  // each read needs at least 1 kmer.
+  if (params.read_length < KmerType::size) {
+    if (comm.rank() == 0) std::cerr << "error: read length " << params.read_length << " is shorter than the kmer size " << KmerType::size << std::endl;
+    exit(-1);
+  }
+
+  // scaling points.
+  std::vector<int> procs;
+  if (points.empty()) {
+    for (int p = 1; p < comm.size(); p <<= 1) procs.push_back(p);
+    procs.push_back(comm.size());
+  } else {
+    std::stringstream ss(points);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      int p = std::stoi(item);
+      if (p < 1 || p > comm.size()) {
+        if (comm.rank() == 0) std::cerr << "error: scaling point " << p << " is not in [1, " << comm.size() << "]" << std::endl;
+        exit(-1);
+      }
+      procs.push_back(p);
+    }
+  }
+
+  if (telemetry) ::plog::Telemetry::get().enable(prefix + ".telemetry");
+
+  std::string csv("mode,procs,genome_size,reads,kmers,phase,elements,seconds_max,seconds_mean,elements_per_second\n");
+
+  std::vector<std::string> modes;
+  if (mode != "weak") modes.push_back("strong");
+  if (mode != "strong") modes.push_back("weak");
+
+  for (auto const & m : modes) {
+    for (int p : procs) {
+      ::bliss::io::read_sim_params point_params(params);
+      if (m == "weak") point_params.genome_size = params.genome_size * p;
+
+      // ranks outside of the point wait.
+      ::mxx::comm sub = comm.split(comm.rank() < p);
+      if (comm.rank() < p) {
+        csv.append(run_point(m, point_params, query_coverage, prefix, keep, sub));
+      }
+      comm.barrier();
+    }
+  }
+
+  if (comm.rank() == 0) {
+    std::string fn = prefix + ".csv";
+    FILE * f = fopen(fn.c_str(), "w");
+    if (f == nullptr) {
+      std::cerr << "error: unable to write " << fn << std::endl;
+    } else {
+      fwrite(csv.data(), 1, csv.size(), f);
+      fclose(f);
+    }
+  }
+
+  ::plog::Telemetry::get().flush();
+
+  return 0;
+}
@@ -0,0 +1,443 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    de_bruijn_compaction.hpp
+ * @ingroup
+ * @author  tpan
+ * @brief   distributed compaction of de bruijn graph nodes into unitigs.
+ * @details a unitig is a maximal path whose links are unambiguous:  node u is linked to its out neighbor v if u has
+ *          exactly 1 out edge and v has exactly 1 in edge, both in u's orientation.  the links are found with 1 round
+ *          of neighbor degree queries, then the paths are ranked by pointer doubling, in O(log L) rounds of all2allv for
+ *          the longest path length L.  cycles do not finish within log of the node count rounds.  they are broken at
+ *          their smallest kmer and ranked again.
+ *
+ *          nodes are identified by their kmer as stored in the graph, which may be either strand.  the 2 sides of a node,
+ *          IN and OUT, are relative to the stored orientation.  nodes are assigned to ranks by the hash of the canonical kmer.
+ *
+ *          each unitig is assembled on the rank that owns its start node, and stored in packed form.
+ */
+#ifndef DE_BRUIJN_COMPACTION_HPP_
+#define DE_BRUIJN_COMPACTION_HPP_
+
+#include "bliss-config.hpp"
+
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+
+#include <mxx/comm.hpp>
+#include <mxx/collective.hpp>
+#include <mxx/reduction.hpp>
+
+#include "common/kmer.hpp"
+#include "common/kmer_transform.hpp"
+#include "index/kmer_hash.hpp"
+#include "io/mxx_support.hpp"
+#include "io/packed_read_store.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+
+#include "utils/benchmark_utils.hpp"
+
+namespace bliss
+{
+  namespace de_bruijn
+  {
+
+    /**
+     * @brief  compacts the nodes of a distributed de bruijn graph into unitigs.
+     * @tparam KmerType   node kmer type.
+     * @tparam DistHash   hash function on canonical kmers for assigning nodes to ranks.
+     */
+    template <typename KmerType, typename DistHash = ::bliss::kmer::hash::farm<KmerType, true> >
+    class unitig_compactor {
+
+      public:
+        using kmer_type = KmerType;
+        using unitig_store_type = ::bliss::io::packed_read_store<KmerType>;
+
+        /// node sides, relative to the stored orientation of the kmer.
+        static constexpr uint8_t IN = 0;
+        static constexpr uint8_t OUT = 1;
+
+      protected:
+
+        /// farthest node reached so far from a node side.  while not done, side is the side of node through which the path
+        /// enters it, i.e. facing the starting node.  once done, node is the path end and side is its unlinked side.
+        struct path_pointer {
+            KmerType node;
+            KmerType min;     // smallest node passed, for breaking cycles.
+            uint64_t dist;
+            uint8_t side;
+            bool done;        // node is the end of the path.
+        };
+
+        struct node_state {
+            KmerType kmer;
+            KmerType neighbor[2];     // the neighbor on each side, in this node's orientation.  valid if the degree is 1.
+            KmerType link[2];         // stored kmer of the linked node on each side.
+            uint8_t link_side[2];     // side of the linked node that faces this node.
+            uint8_t degree[2];
+            bool linked[2];
+            path_pointer end[2];
+        };
+
+        /// (kmer, in degree, out degree, in neighbor, out neighbor)
+        using node_type = ::std::tuple<KmerType, uint8_t, uint8_t, KmerType, KmerType>;
+        /// (target, target side, requester, requester side)
+        using query_type = ::std::tuple<KmerType, uint8_t, KmerType, uint8_t>;
+        /// (requester, requester side, node, side, dist, done, min)
+        using response_type = ::std::tuple<KmerType, uint8_t, KmerType, uint8_t, uint64_t, uint8_t, KmerType>;
+        /// (unitig start node, start side, position in unitig, kmer in unitig orientation)
+        using member_type = ::std::tuple<KmerType, uint8_t, uint64_t, KmerType>;
+
+        const mxx::comm & comm;
+
+        ::bliss::kmer::transform::lex_less<KmerType> canonical;
+        DistHash hash;
+
+        /// nodes owned by this rank
+        std::vector<node_state> nodes;
+        /// canonical kmer to position in nodes.
+        std::unordered_map<KmerType, size_t, DistHash> index;
+
+        size_t rounds;
+        size_t cycles;
+
+        inline int owner(KmerType const & x) const {
+          return hash(canonical(x)) % comm.size();
+        }
+
+        inline node_state & get_node(KmerType const & x) {
+          return nodes[index.at(canonical(x))];
+        }
+
+        inline bool is_palindrome(KmerType const & x) const {
+          return x == x.reverse_complement();
+        }
+
+        /// send each message to the rank given by the owner of its first element, with 1 all2allv.
+        template <typename T>
+        std::vector<T> exchange(std::vector<T> & msgs) const {
+          if (comm.size() == 1) return ::std::move(msgs);
+
+          std::vector<size_t> send_counts(comm.size(), 0);
+          std::vector<int> ranks;
+          ranks.reserve(msgs.size());
+          for (auto const & m : msgs) {
+            ranks.push_back(owner(::std::get<0>(m)));
+            ++send_counts[ranks.back()];
+          }
+
+          std::vector<size_t> offsets(comm.size(), 0);
+          for (int i = 1; i < comm.size(); ++i) offsets[i] = offsets[i - 1] + send_counts[i - 1];
+
+          std::vector<T> buffer(msgs.size());
+          for (size_t i = 0; i < msgs.size(); ++i) {
+            buffer[offsets[ranks[i]]++] = msgs[i];
+          }
+          msgs.clear();
+
+          return ::mxx::all2allv(buffer, send_counts, comm);
+        }
+
+        /// compute degrees and neighbors, and move the nodes to their owner ranks.
+        template <typename EdgeType>
+        void distribute_nodes(std::vector<std::pair<KmerType, EdgeType> > const & graph_nodes) {
+          using utils = ::bliss::de_bruijn::node::node_utils<KmerType, EdgeType>;
+
+          std::vector<node_type> msgs;
+          msgs.reserve(graph_nodes.size());
+
+          std::vector<KmerType> neighbors;
+          for (auto const & x : graph_nodes) {
+            node_type n(x.first, 0, 0, x.first, x.first);
+
+            utils::get_in_neighbors(x.first, x.second, neighbors);
+            ::std::get<1>(n) = neighbors.size();
+            if (neighbors.size() == 1) ::std::get<3>(n) = neighbors.front();
+
+            utils::get_out_neighbors(x.first, x.second, neighbors);
+            ::std::get<2>(n) = neighbors.size();
+            if (neighbors.size() == 1) ::std::get<4>(n) = neighbors.front();
+
+            msgs.push_back(n);
+          }
+
+          msgs = exchange(msgs);
+
+          nodes.clear();
+          nodes.reserve(msgs.size());
+          index.clear();
+          index.reserve(msgs.size());
+
+          node_state s;
+          for (auto const & m : msgs) {
+            s.kmer = ::std::get<0>(m);
+            s.degree[IN] = ::std::get<1>(m);
+            s.degree[OUT] = ::std::get<2>(m);
+            s.neighbor[IN] = ::std::get<3>(m);
+            s.neighbor[OUT] = ::std::get<4>(m);
+            s.linked[IN] = s.linked[OUT] = false;
+
+            index[canonical(s.kmer)] = nodes.size();
+            nodes.push_back(s);
+          }
+        }
+
+        /// link each node side of degree 1 to its neighbor, if the neighbor's facing side also has degree 1.
+        void link_nodes() {
+          std::vector<query_type> queries;
+          for (auto const & n : nodes) {
+            if (is_palindrome(n.kmer)) continue;
+
+            for (uint8_t s = IN; s <= OUT; ++s) {
+              // self loops and hairpins stay unlinked.
+              if ((n.degree[s] == 1) && !(canonical(n.neighbor[s]) == canonical(n.kmer)))
+                queries.emplace_back(n.neighbor[s], s, n.kmer, s);
+            }
+          }
+
+          queries = exchange(queries);
+
+          std::vector<response_type> responses;
+          for (auto const & q : queries) {
+            auto it = index.find(canonical(::std::get<0>(q)));
+            if (it == index.end()) continue;
+
+            node_state const & t = nodes[it->second];
+            if (is_palindrome(t.kmer)) continue;
+
+            // leaving the requester through side s enters the neighbor through the opposite side, if stored in the same orientation.
+            uint8_t s = ::std::get<3>(q);
+            uint8_t entry = (t.kmer == ::std::get<0>(q)) ? (1 - s) : s;
+            if (t.degree[entry] != 1) continue;
+
+            responses.emplace_back(::std::get<2>(q), s, t.kmer, entry, 1, 0, t.kmer);
+          }
+
+          responses = exchange(responses);
+
+          for (auto const & r : responses) {
+            node_state & n = get_node(::std::get<0>(r));
+            uint8_t s = ::std::get<1>(r);
+            n.linked[s] = true;
+            n.link[s] = ::std::get<2>(r);
+            n.link_side[s] = ::std::get<3>(r);
+          }
+        }
+
+        /// point each side of a node at its linked neighbor, or at itself if the side is a path end.
+        void init_pointers(node_state & n) {
+          for (uint8_t s = IN; s <= OUT; ++s) {
+            path_pointer & e = n.end[s];
+            if (n.linked[s]) {
+              e.node = n.link[s];
+              e.min = n.link[s];
+              e.side = n.link_side[s];
+              e.dist = 1;
+              e.done = false;
+            } else {
+              e.node = n.kmer;
+              e.min = n.kmer;
+              e.side = s;
+              e.dist = 0;
+              e.done = true;
+            }
+          }
+        }
+
+        /**
+         * @brief  pointer doubling:  each unfinished pointer jumps to the pointer of its target on the far side.
+         * @details all responses of a round are computed before any pointer is updated, since the updates
+         *          follow the collective exchange of the responses.
+         * @return number of rounds.
+         */
+        size_t pointer_doubling(size_t max_rounds) {
+          std::vector<query_type> queries;
+          std::vector<response_type> responses;
+
+          size_t round = 0;
+          for (; round < max_rounds; ++round) {
+            queries.clear();
+            for (auto const & n : nodes) {
+              for (uint8_t s = IN; s <= OUT; ++s) {
+                if (!n.end[s].done) queries.emplace_back(n.end[s].node, n.end[s].side, n.kmer, s);
+              }
+            }
+            if (::mxx::allreduce(queries.size(), comm) == 0) break;
+
+            queries = exchange(queries);
+
+            responses.clear();
+            responses.reserve(queries.size());
+            for (auto const & q : queries) {
+              path_pointer const & e = get_node(::std::get<0>(q)).end[1 - ::std::get<1>(q)];
+              responses.emplace_back(::std::get<2>(q), ::std::get<3>(q), e.node, e.side, e.dist, e.done ? 1 : 0, e.min);
+            }
+
+            responses = exchange(responses);
+
+            for (auto const & r : responses) {
+              path_pointer & e = get_node(::std::get<0>(r)).end[::std::get<1>(r)];
+              e.node = ::std::get<2>(r);
+              e.side = ::std::get<3>(r);
+              e.dist += ::std::get<4>(r);
+              e.done = (::std::get<5>(r) != 0);
+              if (::std::get<6>(r) < e.min) e.min = ::std::get<6>(r);
+            }
+          }
+          return round;
+        }
+
+        /// find the path ends and distances of every node.  cycles are cut at their smallest node's OUT link.
+        void rank_paths() {
+          for (auto & n : nodes) init_pointers(n);
+
+          // a path of L nodes finishes within log(L) + 1 rounds.  unfinished pointers have then covered any cycle.
+          size_t total = ::mxx::allreduce(nodes.size(), comm);
+          size_t max_rounds = 1;
+          while ((static_cast<size_t>(1) << max_rounds) <= 2 * total) ++max_rounds;
+
+          rounds = pointer_doubling(max_rounds);
+
+          std::vector<query_type> cuts;
+          for (auto & n : nodes) {
+            if (n.end[IN].done || n.end[OUT].done) continue;
+            if (n.end[OUT].min < n.kmer) continue;
+
+            n.linked[OUT] = false;
+            cuts.emplace_back(n.link[OUT], n.link_side[OUT], n.kmer, OUT);
+          }
+
+          cycles = ::mxx::allreduce(cuts.size(), comm);
+          if (cycles == 0) return;
+
+          cuts = exchange(cuts);
+          for (auto const & c : cuts) {
+            get_node(::std::get<0>(c)).linked[::std::get<1>(c)] = false;
+          }
+
+          for (auto & n : nodes) {
+            if (!n.end[IN].done || !n.end[OUT].done) init_pointers(n);
+          }
+          rounds += pointer_doubling(max_rounds);
+        }
+
+        /// send each node to the owner of its unitig's start, then concatenate the unitigs there.
+        size_t assemble(unitig_store_type & unitigs) {
+          std::vector<member_type> members;
+          members.reserve(nodes.size());
+
+          for (auto const & n : nodes) {
+            path_pointer const & a = n.end[IN];
+            path_pointer const & b = n.end[OUT];
+
+            // unitig starts at the smaller end.  starting from the IN end reads this node in its stored orientation.
+            if ((a.node < b.node) || ((a.node == b.node) && (a.side < b.side)))
+              members.emplace_back(a.node, a.side, a.dist, n.kmer);
+            else
+              members.emplace_back(b.node, b.side, b.dist, n.kmer.reverse_complement());
+          }
+
+          members = exchange(members);
+          ::std::sort(members.begin(), members.end());
+
+          std::vector<uint8_t> seq;
+          size_t count = 0;
+          auto start = members.begin();
+          while (start != members.end()) {
+            auto end = start;
+            while ((end != members.end()) && (::std::get<0>(*end) == ::std::get<0>(*start)) && (::std::get<1>(*end) == ::std::get<1>(*start))) ++end;
+
+            seq.clear();
+            KmerType const & first = ::std::get<3>(*start);
+            for (unsigned int i = KmerType::size; i > 0; --i) {
+              seq.push_back(static_cast<uint8_t>(first.getCharsAtPos(i - 1, 1)));
+            }
+
+            uint64_t pos = 0;
+            for (auto it = start; it != end; ++it, ++pos) {
+              if (::std::get<2>(*it) != pos) throw std::logic_error("unitig members are not contiguous.  the graph's edges may not be symmetric.");
+              if (it != start) seq.push_back(static_cast<uint8_t>(::std::get<3>(*it).getCharsAtPos(0, 1)));
+            }
+
+            unitigs.insert_values(seq.begin(), seq.end());
+            ++count;
+
+            start = end;
+          }
+
+          return count;
+        }
+
+      public:
+        unitig_compactor(const mxx::comm & _comm) : comm(_comm), rounds(0), cycles(0) {}
+
+        /**
+         * @brief  compact the graph into unitigs.  collective.
+         * @param graph_nodes   this rank's nodes and edges, e.g. from the de bruijn map's to_vector.  edges must be symmetric.
+         * @param unitigs       unitigs assembled on this rank are appended.
+         * @return number of unitigs assembled on this rank.
+         */
+        template <typename EdgeType>
+        size_t compact(std::vector<std::pair<KmerType, EdgeType> > const & graph_nodes, unitig_store_type & unitigs) {
+          BL_BENCH_INIT(compact);
+
+          BL_BENCH_COLLECTIVE_START(compact, "distribute", comm);
+          distribute_nodes(graph_nodes);
+          BL_BENCH_END(compact, "distribute", nodes.size());
+
+          BL_BENCH_COLLECTIVE_START(compact, "link", comm);
+          link_nodes();
+          BL_BENCH_END(compact, "link", nodes.size());
+
+          BL_BENCH_COLLECTIVE_START(compact, "list_rank", comm);
+          rank_paths();
+          BL_BENCH_END(compact, "list_rank", rounds);
+
+          BL_BENCH_COLLECTIVE_START(compact, "assemble", comm);
+          size_t count = assemble(unitigs);
+          BL_BENCH_END(compact, "assemble", count);
+
+          BL_BENCH_REPORT_MPI_NAMED(compact, "unitig_compactor:compact", comm);
+
+          return count;
+        }
+
+        /// number of pointer doubling rounds used by the last compact call.
+        size_t get_rounds() const {
+          return rounds;
+        }
+
+        /// number of cycles broken by the last compact call.
+        size_t get_cycles() const {
+          return cycles;
+        }
+    };
+
+    template <typename KmerType, typename DistHash>
+    constexpr uint8_t unitig_compactor<KmerType, DistHash>::IN;
+    template <typename KmerType, typename DistHash>
+    constexpr uint8_t unitig_compactor<KmerType, DistHash>::OUT;
+
+  } /* namespace de_bruijn */
+} /* namespace bliss */
+
+#endif /* DE_BRUIJN_COMPACTION_HPP_ */
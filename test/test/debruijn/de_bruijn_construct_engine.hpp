@@ -66,6 +66,7 @@
 #include "iterators/zip_iterator.hpp"
 #include "iterators/constant_iterator.hpp"
 #include "index/quality_score_iterator.hpp"
+#include "index/quality_score_block.hpp"
 #include "common/kmer_transform.hpp"
 #include "index/kmer_hash.hpp"
 #include "debruijn/de_bruijn_node_trait.hpp"
@@ -171,6 +172,9 @@ namespace bliss
 
         using Alphabet = typename KmerType::KmerAlphabet;
 
+        /// kmer quality scores of the current read, computed as a block.  buffers reused across reads.
+        ::bliss::index::QualityScoreBlock<KmerType::size, QualityEncoder<QualType> > qual_block;
+
        template <typename SeqType, typename OutputIt>
        OutputIt operator()(SeqType & read, OutputIt output_iter) {
 
@@ -192,9 +196,8 @@ namespace bliss
 
           using EdgeIterType = bliss::de_bruijn::iterator::edge_iterator<CharIter, EdgeEncoder>;
 
-          // also remove eol from quality score
-          using QualIterType =
-              bliss::index::QualityScoreGenerationIterator<bliss::index::kmer::NonEOLIter<typename SeqType::IteratorType>, KmerType::size, QualityEncoder<QualType> >;
+          // quality scores from the block buffer.  only the kmer iterator is compared for end.
+          using QualIterType = typename ::std::vector<QualType>::const_iterator;
 
           // combine kmer iterator and position iterator to create an index iterator type.
           using KmerInfoIterType = bliss::iterator::ZipIterator<EdgeIterType, QualIterType>;
@@ -220,8 +223,8 @@ namespace bliss
            EdgeIterType edge_end (CharIter(neol, read.seq_end));
 
 
-           QualIterType qual_start(CharIter(neol, read.qual_begin, read.qual_end));
-            QualIterType qual_end(CharIter(neol, read.qual_end));
+           QualIterType qual_start = qual_block.compute(CharIter(neol, read.qual_begin, read.qual_end), CharIter(neol, read.qual_end)).cbegin();
+            QualIterType qual_end = qual_block.get_scores().cend();
 
             KmerInfoIterType info_start(edge_start, qual_start);
             KmerInfoIterType info_end(edge_end, qual_end);
@@ -40,6 +40,9 @@
 #include <tuple>        // tuple and utility functions
 #include <utility>      // pair and utility functions.
 #include <type_traits>
+#include <array>
+#include <vector>
+#include <limits>
 
 #include "utils/logging.h"
 #include "common/alphabets.hpp"
@@ -265,6 +268,126 @@ namespace bliss
 			};
 
 
+      /**
+       * @brief kmer metadata holding saturating small edge counts, for a compact node table.
+       * @details same layout as edge_counts:  [out A C G T; in A C G T; kmer count], relative to the kmer's orientation.
+       *        counters stop at the max value of COUNT.  update returns a bit mask of the counters that were already
+       *        saturated, so the container can record the excess in an overflow side table.  with uint8_t
+       *        this is 9 bytes per node instead of 36 for edge_counts<ALPHA, uint32_t>.
+       */
+      template<typename ALPHA, typename COUNT = uint8_t>
+      class packed_edge_counts {
+
+          static_assert(::std::is_unsigned<COUNT>::value, "packed edge counts need an unsigned counter type.");
+
+        protected:
+          /// increment counter idx.  returns the overflow bit for idx if the counter is already saturated.
+          inline uint16_t add_1(uint8_t idx) {
+            if (counts[idx] == saturated) return static_cast<uint16_t>(1) << idx;
+            ++counts[idx];
+            return 0;
+          }
+
+        public:
+
+          using Alphabet = ALPHA;
+          using CountType = COUNT;
+
+          /// value of a counter whose true count is kept partly in the overflow table.
+          static constexpr COUNT saturated = ::std::numeric_limits<COUNT>::max();
+
+          friend std::ostream& operator<<(std::ostream& ost, const packed_edge_counts<ALPHA, COUNT> & node)
+          {
+            ost << " dBGr node: counts self = " << static_cast<uint64_t>(node.counts[8]) << " in = [";
+            for (int i = 4; i < 8; ++i) ost << static_cast<uint64_t>(node.counts[i]) << ",";
+            ost << "], out = [";
+            for (int i = 0; i < 4; ++i) ost << static_cast<uint64_t>(node.counts[i]) << ",";
+            ost << "]";
+            return ost;
+          }
+
+          /// array of counts.  format:  [out A C G T; in A C G T; kmer count]
+          std::array<COUNT, 9> counts;
+
+        /*constructor*/
+        packed_edge_counts() : counts({{0, 0, 0, 0, 0, 0, 0, 0, 0}}) {};
+
+        /*destructor.  not virtual, so that we don't have virtual lookup table pointer in the structure as well.*/
+        ~packed_edge_counts() {}
+
+        /**
+         * @brief update the current count from the input left and right chars (encoded in exts).
+         * @param exts            2 4bits in 1 uchar.  ordered as [out, in], lower bits being out.  consistent with the kmer's orientation.
+         * @return                bit i is set if counter i overflowed.  bit 8 is the kmer count.
+         */
+        uint16_t update(uint8_t exts)
+        {
+          uint16_t overflow = add_1(8);   // increment self count.
+
+          if (std::is_same<ALPHA, bliss::common::DNA>::value ||
+              std::is_same<ALPHA, bliss::common::DNA5>::value ||
+              std::is_same<ALPHA, bliss::common::RNA>::value ||
+              std::is_same<ALPHA, bliss::common::RNA5>::value) {
+            // value encodes only 1 possible character.  assume values are 0 1 2 3 for ACGT
+
+            if (std::is_same<ALPHA, bliss::common::DNA5>::value || std::is_same<ALPHA, bliss::common::RNA5>::value) {
+              if ((exts & 0x0C) == 0) overflow |= add_1(exts & 0x3);  // right edge (out), if not unknown.
+              if ((exts & 0xC0) == 0) overflow |= add_1(((exts >> 4) & 0x3) + 4);  // left edge (in), if not unknown.
+            } else {
+              overflow |= add_1(exts & 0x3);  // right edge (out)
+              overflow |= add_1(((exts >> 4) & 0x3) + 4);  // left edge (in)
+            }
+
+          } else {
+            // value encodes 0 or more possible characters.  bit position are ACGT from low to high
+
+            // if not DNA 16, convert to DNA16
+            if (!std::is_same<ALPHA, bliss::common::DNA16>::value) {
+              exts = (bliss::common::DNA16::FROM_ASCII[ALPHA::TO_ASCII[exts >> 4]] << 4) | bliss::common::DNA16::FROM_ASCII[ALPHA::TO_ASCII[exts & 0xF]];
+            }
+
+            for (int i = 0; i < 8; ++i) {
+              if ((exts >> i) & 1) overflow |= add_1(i);
+            }
+          }
+
+          return overflow;
+        }
+
+        /**
+         * @brief update the current count from the input left and right chars (not encoded in exts).
+         * @param exts              2 byte chars, in [out, in] lower byte being out.
+         * @return                  bit i is set if counter i overflowed.
+         */
+        uint16_t update(uint16_t exts)
+        {
+          uint16_t overflow = add_1(8);   // increment self count.
+
+          uint8_t temp = (bliss::common::DNA16::FROM_ASCII[exts >> 8] << 4) | bliss::common::DNA16::FROM_ASCII[exts & 0xFF];
+
+          for (int i = 0; i < 8; ++i) {
+            if ((temp >> i) & 1) overflow |= add_1(i);
+          }
+          return overflow;
+        }
+
+        /// count stored in the node.  saturated if the excess is in the container's overflow table.
+        COUNT get_edge_frequency(uint8_t idx) const {
+          if (idx >= 8) return 0;
+
+          return counts[idx];
+        }
+
+        bool is_saturated(uint8_t idx) const {
+          return counts[idx] == saturated;
+        }
+
+      };
+
+      template<typename ALPHA, typename COUNT>
+      constexpr COUNT packed_edge_counts<ALPHA, COUNT>::saturated;
+
+
       /*node trait class*/
       template<typename ALPHA>
       class edge_exists {
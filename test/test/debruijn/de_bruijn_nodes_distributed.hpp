@@ -34,6 +34,7 @@
 #include <functional> 		// for std::function and std::hash
 #include <algorithm> 		// for sort, stable_sort, unique, is_sorted
 #include <iterator>  // advance, distance
+#include <array>
 
 #include <cstdint>  // for uint8, etc.
 
@@ -41,6 +42,7 @@
 #include "debruijn/de_bruijn_node_trait.hpp"	//node trait data structure storing the linkage information to the node
 #include "containers/distributed_map_base.hpp"
 #include "containers/distributed_unordered_map.hpp"
+#include "containers/distributed_densehash_map.hpp"
 
 #include "utils/benchmark_utils.hpp"  // for timing.
 #include "utils/logging.h"
@@ -263,6 +265,204 @@ namespace bliss{
 				 return count;
 			   }
 		};
+
+		/**
+		 * @brief de bruijn graph node table on the open addressing densehash map.
+		 * @details same insertion semantics as de_bruijn_nodes_distributed (node kept in first seen orientation,
+		 *        edges reverse complemented for the opposite strand), without the per-node allocation and pointers
+		 *        of std::unordered_map.
+		 *
+		 *        with T = packed_edge_counts, counters that saturate are continued in a sparse overflow table keyed by
+		 *        the stored kmer.  use get_edge_frequency(node, idx) or unpack(node) for the exact counts.  the
+		 *        counts in the table are accurate for topology (non-zero) and for values below saturation.
+		 *
+		 *        MapParams should be bimolecule, and SpecialKeys should not be canonical since stored kmers are not.
+		 */
+		template<typename Key, typename T,
+			template <typename> class MapParams,
+			typename SpecialKeys = ::fsc::sparsehash::special_keys<Key>,
+			class Alloc = ::std::allocator< ::std::pair<const Key, T> >,
+			template <typename, typename, typename, template <typename> class,
+			  typename, typename, typename, bool> class LocalContainer = ::fsc::densehash_map
+		  >
+		  class de_bruijn_nodes_densehash : public ::dsc::densehash_map<Key, T, MapParams, SpecialKeys, Alloc, LocalContainer> {
+			  using Base = ::dsc::densehash_map<Key, T, MapParams, SpecialKeys, Alloc, LocalContainer>;
+
+			public:
+			  using local_container_type = typename Base::local_container_type;
+
+			  using key_type              = typename local_container_type::key_type;
+			  using mapped_type           = typename local_container_type::mapped_type;
+			  using value_type            = typename local_container_type::value_type;
+			  using hasher                = typename local_container_type::hasher;
+			  using key_equal             = typename local_container_type::key_equal;
+			  using allocator_type        = typename local_container_type::allocator_type;
+			  using iterator              = typename local_container_type::iterator;
+			  using const_iterator        = typename local_container_type::const_iterator;
+			  using size_type             = typename local_container_type::size_type;
+			  using difference_type       = typename local_container_type::difference_type;
+
+			  using Alphabet = typename T::Alphabet;
+
+			  /// exact counts, for unpacking a node.
+			  using unpacked_type = ::bliss::de_bruijn::node::edge_counts<Alphabet, uint64_t>;
+
+			protected:
+			  using MapBase = typename Base::Base::Base;
+
+			  /// counts in excess of the saturated values, for the few nodes that have them.  [out A C G T; in A C G T; kmer count]
+			  ::std::unordered_map<Key, ::std::array<uint64_t, 9>,
+			    typename MapBase::StoreTransformedFarmHash, typename MapBase::StoreTransformedEqual> overflow;
+
+			  /// update a node's edges, already in the node's orientation.
+			  template <typename V, typename E>
+			  inline void update_node(Key const &, V & edges, E const & exts) {
+				  edges.update(exts);
+			  }
+
+			  /// update packed counts, and move overflowing increments to the overflow table.
+			  template <typename A, typename C, typename E>
+			  inline void update_node(Key const & k, ::bliss::de_bruijn::node::packed_edge_counts<A, C> & edges, E const & exts) {
+				  uint16_t flags = edges.update(exts);
+				  if (flags == 0) return;
+
+				  auto & excess = overflow[k];
+				  for (int i = 0; i < 9; ++i) {
+					  if ((flags >> i) & 1) ++excess[i];
+				  }
+			  }
+
+			  template <class InputIterator, class Predicate>
+			  size_t local_insert(InputIterator first, InputIterator last, Predicate const & pred) {
+
+				  if (first == last) return 0;
+				  size_t before = this->c.size();
+
+				  this->local_reserve(before + ::std::distance(first, last));
+
+				  for (auto it = first; it != last; ++it) {
+					  if (!pred(*it)) continue;
+
+					  // 1 probe:  insert returns the existing node, in either orientation, or the new one.
+					  auto & node = *(this->c.insert(::std::make_pair(it->first, T())).first);
+
+					  // if the stored node has a different orientation, reverse complement the edges.
+					  if (node.first == it->first) {
+						  update_node(node.first, node.second, it->second);
+					  } else {
+						  update_node(node.first, node.second,
+								  bliss::de_bruijn::node::input_edge_utils::reverse_complement_edges<Alphabet>(it->second));
+					  }
+				  }
+
+				  if (this->c.size() != before) this->local_changed = true;
+				  return this->c.size() - before;
+			  }
+
+			  /// drop the overflow counts of nodes that are no longer in the table.
+			  size_t prune_overflow(size_t removed) {
+				  if ((removed == 0) || overflow.empty()) return removed;
+
+				  for (auto it = overflow.begin(); it != overflow.end(); ) {
+					  if (this->c.count(it->first) == 0) it = overflow.erase(it);
+					  else ++it;
+				  }
+				  return removed;
+			  }
+
+			  virtual void local_reset() noexcept {
+				  Base::local_reset();
+				  overflow.clear();
+			  }
+
+			  virtual void local_clear() noexcept {
+				  Base::local_clear();
+				  overflow.clear();
+			  }
+
+			public:
+			  de_bruijn_nodes_densehash(const mxx::comm& _comm) : Base(_comm) {/*do nothing*/}
+
+			  virtual ~de_bruijn_nodes_densehash() {/*do nothing*/};
+
+			  /**
+			   * @brief insert (kmer, edge) tuples.  kmers are not canonicalized.
+			   */
+			  template <typename InputEdgeType, typename Predicate = ::bliss::filter::TruePredicate>
+			  size_t insert(std::vector<::std::pair<Key, InputEdgeType> >& input, bool sorted_input = false, Predicate const & pred = Predicate()) {
+				  // even if count is 0, still need to participate in mpi calls.
+				  BL_BENCH_INIT(insert);
+
+				  static_assert(std::is_same<typename MapBase::InputTransform, ::bliss::transform::identity<Key>>::value,
+						  "de bruijn graph does not support transform of input Kmers. (e.g. canonicalizing).  Hash can use transformed values, though.");
+
+				  if (this->comm.size() > 1) {
+					  BL_BENCH_COLLECTIVE_START(insert, "distribute", this->comm);
+					  ::std::vector<size_t> recv_counts =
+							  ::dsc::distribute(input, this->key_to_rank, sorted_input, this->comm);
+					  BLISS_UNUSED(recv_counts);
+					  BL_BENCH_END(insert, "distribute", input.size());
+				  }
+
+				  BL_BENCH_START(insert);
+				  size_t count = this->local_insert(input.begin(), input.end(), pred);
+				  BL_BENCH_END(insert, "insert", this->c.size());
+
+				  BL_BENCH_REPORT_MPI_NAMED(insert, "dbg_densehash:insert", this->comm);
+
+				  return count;
+			  }
+
+			  /// erase nodes by key, and their overflow counts.  collective.
+			  template <bool remove_duplicate = false, class Predicate = ::bliss::filter::TruePredicate>
+			  size_t erase(::std::vector<Key>& keys, bool sorted_input = false, Predicate const& pred = Predicate()) {
+				  return prune_overflow(Base::template erase<remove_duplicate>(keys, sorted_input, pred));
+			  }
+
+			  /// erase nodes matching the predicate, and their overflow counts.  collective.
+			  template <typename Predicate>
+			  size_t erase(Predicate const & pred = Predicate()) {
+				  return prune_overflow(Base::erase(pred));
+			  }
+
+			  /// keep only nodes whose keys are in other, and their overflow counts.  collective.
+			  template <typename OtherMap>
+			  size_t intersect(OtherMap const & other) {
+				  return prune_overflow(Base::intersect(other));
+			  }
+
+			  /// remove nodes whose keys are in other, and their overflow counts.  collective.
+			  template <typename OtherMap>
+			  size_t subtract(OtherMap const & other) {
+				  return prune_overflow(Base::subtract(other));
+			  }
+
+			  /// number of local nodes with at least 1 saturated counter.
+			  size_t local_overflow_size() const {
+				  return overflow.size();
+			  }
+
+			  /// exact count of edge idx (8 for the kmer count) of a node from this rank's table.
+			  uint64_t get_edge_frequency(value_type const & node, uint8_t idx) const {
+				  if (idx > 8) return 0;
+				  uint64_t count = node.second.counts[idx];
+				  if (overflow.empty()) return count;
+
+				  auto it = overflow.find(node.first);
+				  return (it == overflow.end()) ? count : count + it->second[idx];
+			  }
+
+			  /// exact counts of a node from this rank's table.
+			  unpacked_type unpack(value_type const & node) const {
+				  unpacked_type result;
+				  for (uint8_t i = 0; i < 9; ++i) {
+					  result.counts[i] = get_edge_frequency(node, i);
+				  }
+				  return result;
+			  }
+		};
+
+
 	}/*de_bruijn*/
 }/*bliss*/
 
@@ -91,6 +91,37 @@ namespace mxx {
         return baseType::get_type(); 
       }
 
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+  template<typename A, typename T>
+    struct datatype_builder<bliss::de_bruijn::node::packed_edge_counts<A, T> > :
+    public datatype_builder<decltype(bliss::de_bruijn::node::packed_edge_counts<A, T>::counts) > {
+
+      typedef datatype_builder<decltype(bliss::de_bruijn::node::packed_edge_counts<A, T>::counts) > baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
+      static size_t num_basic_elements() {
+        return baseType::num_basic_elements();
+      }
+    };
+
+
+  template<typename A, typename T>
+    struct datatype_builder<const bliss::de_bruijn::node::packed_edge_counts<A, T> > :
+    public datatype_builder<decltype(bliss::de_bruijn::node::packed_edge_counts<A, T>::counts) > {
+
+      typedef datatype_builder<decltype(bliss::de_bruijn::node::packed_edge_counts<A, T>::counts) > baseType;
+
+      static MPI_Datatype get_type(){
+        return baseType::get_type();
+      }
+
       static size_t num_basic_elements() {
         return baseType::num_basic_elements();
       }
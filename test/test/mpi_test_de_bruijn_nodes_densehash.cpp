@@ -0,0 +1,189 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_de_bruijn_nodes_densehash.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests the densehash de bruijn node table with packed, saturating edge counts, using google test
+ * @details the same input is inserted into a table with edge_counts<DNA16, uint32_t> and into one with
+ *          packed_edge_counts<DNA16>.  the exact counts of the packed table, from get_edge_frequency and unpack,
+ *          should match the uint32_t counts for every node, including a node seen more than 255 times.
+ *          the nodes themselves, e.g. from to_vector, hold counts capped at 255.
+ */
+
+#include "bliss-config.hpp"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/reduction.hpp"
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <utility>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "index/kmer_hash.hpp"
+#include "index/kmer_index.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+#include "debruijn/de_bruijn_nodes_distributed.hpp"
+
+using Alphabet = ::bliss::common::DNA;
+using EdgeEncoder = ::bliss::common::DNA16;
+using KmerType = ::bliss::common::Kmer<21, Alphabet, uint64_t>;
+using InputType = ::std::pair<KmerType, uint8_t>;
+
+template <typename K>
+using MapParams = ::bliss::index::kmer::BimoleculeHashMapParams<K>;
+
+template <typename Edges>
+using NodeMapType = ::bliss::de_bruijn::de_bruijn_nodes_densehash<KmerType, Edges, MapParams,
+    ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false> >;
+
+using PackedMapType = NodeMapType<::bliss::de_bruijn::node::packed_edge_counts<EdgeEncoder> >;
+using CountMapType = NodeMapType<::bliss::de_bruijn::node::edge_counts<EdgeEncoder, uint32_t> >;
+
+class DeBruijnNodesDensehashTest : public ::testing::Test
+{
+  protected:
+    /// kmer seen 300 times per rank, in both orientations, with the same edges.
+    KmerType hot;
+
+    std::vector<InputType> input;
+
+    virtual void SetUp() {
+      ::mxx::comm comm;
+      std::mt19937 gen(17 + comm.rank());
+      std::uniform_int_distribution<int> base(0, 3);
+
+      for (size_t j = 0; j < KmerType::size; ++j) hot.nextFromChar(j & 0x3);
+
+      // random kmers, each with 1 in and 1 out edge, or none at a read end.
+      for (size_t i = 0; i < 1000; ++i) {
+        KmerType k;
+        for (size_t j = 0; j < KmerType::size; ++j) k.nextFromChar(base(gen));
+        uint8_t out = (i % 10 == 0) ? 0 : (1 << base(gen));
+        uint8_t in = (i % 10 == 5) ? 0 : (1 << base(gen));
+        input.emplace_back(k, (in << 4) | out);
+      }
+
+      // in C, out A.  the reverse complement has the complemented edges swapped.
+      uint8_t exts = 0x21;
+      uint8_t rc_exts = ::bliss::de_bruijn::node::input_edge_utils::reverse_complement_edges<EdgeEncoder>(exts);
+      for (size_t i = 0; i < 300; ++i) {
+        if (i & 1) input.emplace_back(hot.reverse_complement(), rc_exts);
+        else input.emplace_back(hot, exts);
+      }
+    }
+};
+
+
+TEST_F(DeBruijnNodesDensehashTest, packed_counts)
+{
+  ::mxx::comm comm;
+
+  // insert permutes its input, so each table gets its own copy.
+  std::vector<InputType> temp(input);
+  CountMapType counts(comm);
+  counts.insert(temp);
+
+  temp = input;
+  PackedMapType packed(comm);
+  packed.insert(temp);
+
+  ASSERT_EQ(counts.size(), packed.size());
+  EXPECT_EQ(counts.local_size(), packed.local_size());
+
+  // same input order, so the same nodes land on the same ranks, in the same orientation.
+  size_t saturated = 0;
+  auto const & pc = packed.get_local_container();
+  for (auto const & node : counts.get_local_container()) {
+    auto it = pc.find(node.first);
+    EXPECT_TRUE(it != pc.end());
+    if (it == pc.end()) continue;
+    EXPECT_EQ(node.first, it->first);
+
+    auto exact = packed.unpack(*it);
+    for (uint8_t i = 0; i < 9; ++i) {
+      EXPECT_EQ(node.second.counts[i], packed.get_edge_frequency(*it, i)) << "edge " << static_cast<int>(i);
+      EXPECT_EQ(node.second.counts[i], exact.counts[i]) << "edge " << static_cast<int>(i);
+    }
+    if (node.second.counts[8] > 255) ++saturated;
+  }
+  EXPECT_EQ(1UL, ::mxx::allreduce(saturated, comm));
+  EXPECT_EQ(1UL, ::mxx::allreduce(packed.local_overflow_size(), comm));
+
+  // the nodes from to_vector (or find) hold the capped counts.
+  std::vector<std::pair<KmerType, typename PackedMapType::mapped_type> > nodes;
+  packed.to_vector(nodes);
+  for (auto const & node : nodes) {
+    if ((node.first != hot) && (node.first != hot.reverse_complement())) continue;
+    EXPECT_EQ(255, static_cast<int>(node.second.counts[8]));
+    EXPECT_TRUE(node.second.is_saturated(0));
+    EXPECT_TRUE(node.second.is_saturated(5));
+    EXPECT_EQ(300UL * comm.size(), packed.get_edge_frequency(node, 8));
+    EXPECT_EQ(300UL * comm.size(), packed.get_edge_frequency(node, 0));  // out A
+    EXPECT_EQ(300UL * comm.size(), packed.get_edge_frequency(node, 5));  // in C
+    EXPECT_EQ(0UL, packed.get_edge_frequency(node, 1));
+  }
+}
+
+TEST_F(DeBruijnNodesDensehashTest, erase_overflow)
+{
+  ::mxx::comm comm;
+
+  std::vector<InputType> temp(input);
+  PackedMapType packed(comm);
+  packed.insert(temp);
+
+  size_t before = packed.size();
+  ASSERT_EQ(1UL, ::mxx::allreduce(packed.local_overflow_size(), comm));
+
+  // erasing an unsaturated node keeps the overflow entry.
+  std::vector<KmerType> keys;
+  if (comm.rank() == 0) keys.push_back(input.front().first);
+  packed.erase(keys);
+  EXPECT_EQ(before - 1, packed.size());
+  EXPECT_EQ(1UL, ::mxx::allreduce(packed.local_overflow_size(), comm));
+
+  // erasing the saturated node, by its reverse complement, removes its overflow entry.
+  keys.clear();
+  if (comm.rank() == 0) keys.push_back(hot.reverse_complement());
+  packed.erase(keys);
+  EXPECT_EQ(before - 2, packed.size());
+  EXPECT_EQ(0UL, ::mxx::allreduce(packed.local_overflow_size(), comm));
+}
+
+
+int main(int argc, char** argv) {
+  // Initialize MPI
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  // Initialize google test
+  ::testing::InitGoogleTest(&argc, argv);
+
+  // Run tests
+  int result = RUN_ALL_TESTS();
+
+  comm.barrier();
+
+  return result;
+}
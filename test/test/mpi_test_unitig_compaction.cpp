@@ -0,0 +1,210 @@
+/*
+ * Copyright 2015 Georgia Institute of Technology
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    mpi_test_unitig_compaction.cpp
+ * @ingroup
+ * @author  tpan
+ * @brief   tests distributed unitig compaction on small known graphs, using google test
+ * @details the graphs are built from sequences with distinct kmers, so the edges are only those of the sequences.
+ *          nodes are stored canonical, and spread round robin over the ranks regardless of owner.
+ *          unitigs are compared as canonical strings, since their orientation is not specified.
+ */
+
+#include "bliss-config.hpp"
+
+#include "mxx/env.hpp"
+#include "mxx/comm.hpp"
+#include "mxx/collective.hpp"
+
+// include google test
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "common/alphabets.hpp"
+#include "common/kmer.hpp"
+#include "utils/kmer_utils.hpp"
+#include "debruijn/de_bruijn_node_trait.hpp"
+#include "debruijn/de_bruijn_compaction.hpp"
+
+using Alphabet = ::bliss::common::DNA;
+// even k, so that reverse complement palindromes exist.
+using KmerType = ::bliss::common::Kmer<6, Alphabet, uint16_t>;
+using EdgeType = ::bliss::de_bruijn::node::edge_exists<Alphabet>;
+using Compactor = ::bliss::de_bruijn::unitig_compactor<KmerType>;
+
+class UnitigCompactionTest : public ::testing::Test
+{
+  protected:
+
+    static std::string reverse_complement(std::string const & s) {
+      std::string r(s.rbegin(), s.rend());
+      for (auto & c : r) c = Alphabet::TO_ASCII[Alphabet::TO_COMPLEMENT[Alphabet::FROM_ASCII[static_cast<size_t>(c)]]];
+      return r;
+    }
+
+    static std::string canonical(std::string const & s) {
+      return ::std::min(s, reverse_complement(s));
+    }
+
+    /// de bruijn nodes of the sequences, with the edges in the orientation of the canonical kmer.
+    static std::vector<std::pair<KmerType, EdgeType> > build(std::vector<std::string> const & seqs) {
+      std::map<KmerType, EdgeType> graph;
+      for (auto const & s : seqs) {
+        for (size_t i = 0; i + KmerType::size <= s.size(); ++i) {
+          KmerType x;
+          for (size_t j = 0; j < KmerType::size; ++j) x.nextFromChar(Alphabet::FROM_ASCII[static_cast<size_t>(s[i + j])]);
+
+          int prev = (i > 0) ? Alphabet::FROM_ASCII[static_cast<size_t>(s[i - 1])] : -1;
+          int next = (i + KmerType::size < s.size()) ? Alphabet::FROM_ASCII[static_cast<size_t>(s[i + KmerType::size])] : -1;
+
+          KmerType y = x.reverse_complement();
+          EdgeType & e = graph[::std::min(x, y)];
+          // in the reverse complement orientation, in and out swap, and the characters are complemented.
+          int rc_prev = (next >= 0) ? Alphabet::TO_COMPLEMENT[next] : -1;
+          int rc_next = (prev >= 0) ? Alphabet::TO_COMPLEMENT[prev] : -1;
+          if (!(y < x)) {   // stored as is.  a palindrome gets both.
+            if (next >= 0) e.counts |= (1 << next);
+            if (prev >= 0) e.counts |= (1 << (prev + 4));
+          }
+          if (!(x < y)) {   // stored as the reverse complement.
+            if (rc_next >= 0) e.counts |= (1 << rc_next);
+            if (rc_prev >= 0) e.counts |= (1 << (rc_prev + 4));
+          }
+        }
+      }
+      return std::vector<std::pair<KmerType, EdgeType> >(graph.begin(), graph.end());
+    }
+
+    /// compact this rank's share of the graph, and gather all the unitigs as sorted canonical strings.
+    static std::vector<std::string> compact(std::vector<std::string> const & seqs, ::mxx::comm const & comm, size_t * cycles = nullptr) {
+      auto all = build(seqs);
+      std::vector<std::pair<KmerType, EdgeType> > local;
+      for (size_t i = comm.rank(); i < all.size(); i += comm.size()) local.push_back(all[i]);
+
+      Compactor compactor(comm);
+      Compactor::unitig_store_type unitigs;
+      size_t count = compactor.compact(local, unitigs);
+      EXPECT_EQ(unitigs.size(), count);
+      if (cycles != nullptr) *cycles = compactor.get_cycles();
+
+      // newline separated, for gathering.
+      std::vector<char> chars;
+      std::vector<uint8_t> values;
+      for (size_t i = 0; i < unitigs.size(); ++i) {
+        values.clear();
+        unitigs.unpack(i, ::std::back_inserter(values));
+        std::string s;
+        for (auto v : values) s.push_back(Alphabet::TO_ASCII[v]);
+        s = canonical(s);
+        chars.insert(chars.end(), s.begin(), s.end());
+        chars.push_back('\n');
+      }
+      chars = ::mxx::allgatherv(chars, comm);
+
+      std::vector<std::string> result;
+      auto start = chars.begin();
+      for (auto it = chars.begin(); it != chars.end(); ++it) {
+        if (*it != '\n') continue;
+        result.emplace_back(start, it);
+        start = it + 1;
+      }
+      ::std::sort(result.begin(), result.end());
+      return result;
+    }
+
+    static std::vector<std::string> sorted(std::vector<std::string> v) {
+      ::std::sort(v.begin(), v.end());
+      return v;
+    }
+
+    // all kmers of the graphs are distinct, and only ACGCGT is a palindrome.
+    const std::string linear = "GCTAAAGACAATTACATAACATACACGTCA";
+    const std::string branch_a = "GCACGAAACTTGTTGGCCCAGTGTGAATCGCT";
+    const std::string branch_b = "GCACGAAACTTGTTGGCCCATAAGGGTTAAGT";
+    const std::string cycle = "TCGGACTGGCATTTTTATTATCGGAC";      // 20 bases, closed by repeating the first kmer.
+    const std::string palindrome = "CACTCAGAAACAACGCGTGAACTCGGGTAA";
+
+    const std::vector<std::string> linear_unitigs = {"GCTAAAGACAATTACATAACATACACGTCA"};
+    // the shared prefix, and each branch with the 5 base overlap.
+    const std::vector<std::string> branch_unitigs = {"ACTTAACCCTTATGGGC", "AGCGATTCACACTGGGC", "GCACGAAACTTGTTGGCCCA"};
+    // cut at the smallest node, AAAAAT, stored as the reverse complement of ATTTTT.
+    const std::vector<std::string> cycle_unitigs = {"AAAATGCCAGTCCGATAATAAAAAT"};
+    // a palindrome node is not linked, so it is a unitig of its own that splits the path.
+    const std::vector<std::string> palindrome_unitigs = {"ACGCGT", "CACTCAGAAACAACGCG", "CGCGTGAACTCGGGTAA"};
+};
+
+
+TEST_F(UnitigCompactionTest, linear)
+{
+  ::mxx::comm comm;
+  EXPECT_EQ(linear_unitigs, compact({linear}, comm));
+  // either strand of the input gives the same graph.
+  EXPECT_EQ(linear_unitigs, compact({reverse_complement(linear)}, comm));
+}
+
+TEST_F(UnitigCompactionTest, branch)
+{
+  ::mxx::comm comm;
+  EXPECT_EQ(branch_unitigs, compact({branch_a, branch_b}, comm));
+}
+
+TEST_F(UnitigCompactionTest, cycle)
+{
+  ::mxx::comm comm;
+  size_t cycles = 0;
+  EXPECT_EQ(cycle_unitigs, compact({cycle}, comm, &cycles));
+  EXPECT_EQ(1UL, cycles);
+}
+
+TEST_F(UnitigCompactionTest, palindrome)
+{
+  ::mxx::comm comm;
+  EXPECT_EQ(palindrome_unitigs, compact({palindrome}, comm));
+}
+
+TEST_F(UnitigCompactionTest, combined)
+{
+  ::mxx::comm comm;
+
+  std::vector<std::string> gold(linear_unitigs);
+  gold.insert(gold.end(), branch_unitigs.begin(), branch_unitigs.end());
+  gold.insert(gold.end(), cycle_unitigs.begin(), cycle_unitigs.end());
+  gold.insert(gold.end(), palindrome_unitigs.begin(), palindrome_unitigs.end());
+
+  EXPECT_EQ(sorted(gold), compact({palindrome, cycle, branch_b, linear, branch_a}, comm));
+}
+
+
+int main(int argc, char** argv) {
+  // Initialize MPI
+  mxx::env e(argc, argv);
+  mxx::comm comm;
+
+  // Initialize google test
+  ::testing::InitGoogleTest(&argc, argv);
+
+  // Run tests
+  int result = RUN_ALL_TESTS();
+
+  comm.barrier();
+
+  return result;
+}
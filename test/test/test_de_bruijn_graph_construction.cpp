@@ -135,6 +135,11 @@ using CountNodeMapType = bliss::de_bruijn::de_bruijn_nodes_distributed<
 template <typename EdgeEnc>
 using ExistNodeMapType = bliss::de_bruijn::de_bruijn_nodes_distributed<
     KmerType, bliss::de_bruijn::node::edge_exists<EdgeEnc>, MapParams >;
+
+template <typename EdgeEnc>
+using PackedNodeMapType = bliss::de_bruijn::de_bruijn_nodes_densehash<
+    KmerType, bliss::de_bruijn::node::packed_edge_counts<EdgeEnc>, MapParams,
+    ::bliss::kmer::hash::sparsehash::special_keys<KmerType, false> >;
 /**
  *
  * @param argc
@@ -205,6 +210,12 @@ int main(int argc, char** argv) {
     ::std::cerr<<"Using DNA16 to represent each edge" << ::std::endl;
   testDeBruijnGraph< bliss::de_bruijn::de_bruijn_engine<ExistNodeMapType>,  bliss::io::FASTQParser >(comm, filename, ::std::string("ST, hash, dbg construction, existence."));
 
+#ifdef USE_MPI
+  if (rank == 0)
+#endif
+    ::std::cerr<<"Using DNA16 to represent each edge, densehash node table with packed counts" << ::std::endl;
+  testDeBruijnGraph< bliss::de_bruijn::de_bruijn_engine<PackedNodeMapType>,  bliss::io::FASTQParser >(comm, filename, ::std::string("ST, densehash, dbg construction, packed count."));
+
 //
 //  ::std::cerr<<"Using ASCII to represent each edge" << ::std::endl;
 //  testDeBruijnGraph< bliss::de_bruijn::de_bruijn_engine_ascii<ExistNodeMapType >,  bliss::io::FASTQParser >(comm, filename, ::std::string("ST, hash, dbg construction, existence."));